@@ -0,0 +1,705 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup mockvarserver mockvarserver
+ * @brief In-process mock of the variable server client API
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file mockvarserver.c
+
+    In-process mock of the variable server client API
+
+    The mock variable server implements the subset of the variable server
+    client API used by libvaraction against an in-process variable table,
+    so evaluation can be measured without inter-process communication.
+
+    Variables are created with MOCK_Create() before the scripts which use
+    them are built.  Each request is counted so the number of requests
+    made by an evaluation can be reported.
+
+    The values of all of the variables can be saved with MOCK_Save(), so
+    a script can be evaluated several times from the same values and the
+    results compared with MOCK_Compare().
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "mockvarserver.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! maximum number of mock variables */
+#define MOCK_MAX_VARS   ( 1024 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! mock variable */
+typedef struct _mockVar
+{
+    /*! variable name */
+    char *name;
+
+    /*! variable value */
+    VarObject obj;
+
+    /*! string buffer returned to the client by VAR_Get */
+    char *workbuf;
+
+    /*! size of the client string buffer */
+    size_t worksize;
+
+} MockVar;
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! mock variable table.  Handle n refers to g_vars[n] */
+static MockVar g_vars[MOCK_MAX_VARS];
+
+/*! number of mock variables */
+static size_t g_nVars = 0;
+
+/*! request counters */
+static MockStats g_stats;
+
+/*! non-NULL variable server handle */
+static int g_server;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static MockVar *Lookup( VAR_HANDLE hVar );
+static bool SameValue( VarObject *pVarObject1, VarObject *pVarObject2 );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  MOCK_Create                                                               */
+/*!
+    Create a mock variable
+
+@param[in]
+    name
+        name of the variable
+
+@param[in]
+    pVarObject
+        pointer to the initial type and value of the variable
+
+@retval handle of the new variable
+@retval VAR_INVALID if the variable could not be created
+
+==============================================================================*/
+VAR_HANDLE MOCK_Create( const char *name, VarObject *pVarObject )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    MockVar *pVar;
+
+    if ( ( name != NULL ) &&
+         ( pVarObject != NULL ) &&
+         ( g_nVars + 1 < MOCK_MAX_VARS ) )
+    {
+        pVar = &g_vars[++g_nVars];
+        pVar->name = strdup( name );
+        pVar->obj = *pVarObject;
+        if ( pVarObject->type == VARTYPE_STR )
+        {
+            pVar->obj.val.str = strdup( ( pVarObject->val.str != NULL )
+                                            ? pVarObject->val.str
+                                            : "" );
+            pVar->obj.len = strlen( pVar->obj.val.str );
+        }
+
+        hVar = (VAR_HANDLE)g_nVars;
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  MOCK_GetStats                                                             */
+/*!
+    Get the mock request counters
+
+@param[out]
+    pStats
+        pointer to the counters to populate
+
+==============================================================================*/
+void MOCK_GetStats( MockStats *pStats )
+{
+    if ( pStats != NULL )
+    {
+        *pStats = g_stats;
+    }
+}
+
+/*============================================================================*/
+/*  MOCK_ResetStats                                                           */
+/*!
+    Reset the mock request counters
+
+==============================================================================*/
+void MOCK_ResetStats( void )
+{
+    memset( &g_stats, 0, sizeof( MockStats ) );
+}
+
+/*============================================================================*/
+/*  MOCK_Save                                                                 */
+/*!
+    Save the values of all of the mock variables
+
+@retval pointer to the snapshot, to be freed with MOCK_FreeSnapshot()
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+MockSnapshot *MOCK_Save( void )
+{
+    MockSnapshot *pSnapshot;
+    VarObject *pValue;
+    bool ok = true;
+    size_t i;
+
+    pSnapshot = calloc( 1, sizeof( MockSnapshot ) );
+    if ( pSnapshot != NULL )
+    {
+        pSnapshot->pValues = calloc( g_nVars + 1, sizeof( VarObject ) );
+        ok = ( pSnapshot->pValues != NULL );
+
+        for ( i = 1; ( ok == true ) && ( i <= g_nVars ); i++ )
+        {
+            pValue = &pSnapshot->pValues[i];
+            *pValue = g_vars[i].obj;
+            pSnapshot->n = i;
+
+            if ( pValue->type == VARTYPE_STR )
+            {
+                pValue->val.str = strdup( g_vars[i].obj.val.str );
+                ok = ( pValue->val.str != NULL );
+            }
+        }
+
+        if ( ok == false )
+        {
+            MOCK_FreeSnapshot( pSnapshot );
+            pSnapshot = NULL;
+        }
+    }
+
+    return pSnapshot;
+}
+
+/*============================================================================*/
+/*  MOCK_Restore                                                              */
+/*!
+    Restore the values of the mock variables from a snapshot
+
+    Variables created after the snapshot was taken are not affected.
+
+@param[in]
+    pSnapshot
+        pointer to the snapshot created by MOCK_Save()
+
+==============================================================================*/
+void MOCK_Restore( MockSnapshot *pSnapshot )
+{
+    VarObject *pValue;
+    char *p;
+    size_t i;
+
+    if ( pSnapshot != NULL )
+    {
+        for ( i = 1; i <= pSnapshot->n; i++ )
+        {
+            pValue = &pSnapshot->pValues[i];
+            if ( pValue->type == VARTYPE_STR )
+            {
+                p = strdup( pValue->val.str );
+                if ( p != NULL )
+                {
+                    free( g_vars[i].obj.val.str );
+                    g_vars[i].obj.val.str = p;
+                    g_vars[i].obj.len = pValue->len;
+                }
+            }
+            else
+            {
+                g_vars[i].obj = *pValue;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  MOCK_Compare                                                              */
+/*!
+    Compare the values of the mock variables with a snapshot
+
+@param[in]
+    pSnapshot
+        pointer to the snapshot created by MOCK_Save()
+
+@retval handle of the first variable whose value differs
+@retval VAR_INVALID if every value matches the snapshot
+
+==============================================================================*/
+VAR_HANDLE MOCK_Compare( MockSnapshot *pSnapshot )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    size_t i;
+
+    if ( pSnapshot != NULL )
+    {
+        for ( i = 1; ( hVar == VAR_INVALID ) && ( i <= pSnapshot->n ); i++ )
+        {
+            if ( SameValue( &pSnapshot->pValues[i], &g_vars[i].obj ) == false )
+            {
+                hVar = (VAR_HANDLE)i;
+            }
+        }
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  MOCK_FreeSnapshot                                                         */
+/*!
+    Free a snapshot created by MOCK_Save()
+
+@param[in]
+    pSnapshot
+        pointer to the snapshot to free (may be NULL)
+
+==============================================================================*/
+void MOCK_FreeSnapshot( MockSnapshot *pSnapshot )
+{
+    size_t i;
+
+    if ( pSnapshot != NULL )
+    {
+        for ( i = 1; i <= pSnapshot->n; i++ )
+        {
+            if ( pSnapshot->pValues[i].type == VARTYPE_STR )
+            {
+                free( pSnapshot->pValues[i].val.str );
+            }
+        }
+
+        free( pSnapshot->pValues );
+        free( pSnapshot );
+    }
+}
+
+/*============================================================================*/
+/*  MOCK_Name                                                                 */
+/*!
+    Get the name of a mock variable
+
+@param[in]
+    hVar
+        handle of the variable
+
+@retval pointer to the name of the variable
+@retval "?" if the handle is invalid
+
+==============================================================================*/
+const char *MOCK_Name( VAR_HANDLE hVar )
+{
+    MockVar *pVar;
+
+    pVar = Lookup( hVar );
+
+    return ( pVar != NULL ) ? pVar->name : "?";
+}
+
+/*============================================================================*/
+/*  VARSERVER_Open                                                            */
+/*!
+    Open the mock variable server
+
+@retval mock variable server handle
+
+==============================================================================*/
+VARSERVER_HANDLE VARSERVER_Open( void )
+{
+    return (VARSERVER_HANDLE)&g_server;
+}
+
+/*============================================================================*/
+/*  VARSERVER_Close                                                           */
+/*!
+    Close the mock variable server
+
+@param[in]
+    hVarServer
+        mock variable server handle
+
+@retval EOK the mock variable server was closed
+
+==============================================================================*/
+int VARSERVER_Close( VARSERVER_HANDLE hVarServer )
+{
+    (void)hVarServer;
+
+    return EOK;
+}
+
+/*============================================================================*/
+/*  VAR_FindByName                                                            */
+/*!
+    Find a mock variable by name
+
+@param[in]
+    hVarServer
+        mock variable server handle
+
+@param[in]
+    pName
+        name of the variable to find
+
+@retval handle of the variable
+@retval VAR_INVALID if the variable was not found
+
+==============================================================================*/
+VAR_HANDLE VAR_FindByName( VARSERVER_HANDLE hVarServer, char *pName )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    size_t i;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pName != NULL ) )
+    {
+        for ( i = 1; i <= g_nVars; i++ )
+        {
+            if ( strcmp( g_vars[i].name, pName ) == 0 )
+            {
+                hVar = (VAR_HANDLE)i;
+                break;
+            }
+        }
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  VAR_Get                                                                   */
+/*!
+    Get the value of a mock variable
+
+    String values are copied into a buffer owned by the mock variable,
+    which remains valid until the next VAR_Get of the same variable.
+
+@param[in]
+    hVarServer
+        mock variable server handle
+
+@param[in]
+    hVar
+        handle of the variable
+
+@param[out]
+    pVarObject
+        pointer to the object to populate
+
+@retval EINVAL invalid argument
+@retval ENOENT the variable does not exist
+@retval ENOMEM memory allocation failure
+@retval EOK the value was retrieved
+
+==============================================================================*/
+int VAR_Get( VARSERVER_HANDLE hVarServer,
+             VAR_HANDLE hVar,
+             VarObject *pVarObject )
+{
+    int result = EINVAL;
+    MockVar *pVar;
+    char *p;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pVarObject != NULL ) )
+    {
+        g_stats.gets++;
+
+        pVar = Lookup( hVar );
+        if ( pVar == NULL )
+        {
+            result = ENOENT;
+        }
+        else if ( pVar->obj.type == VARTYPE_STR )
+        {
+            result = EOK;
+            if ( pVar->worksize <= pVar->obj.len )
+            {
+                p = realloc( pVar->workbuf, pVar->obj.len + 1 );
+                if ( p != NULL )
+                {
+                    pVar->workbuf = p;
+                    pVar->worksize = pVar->obj.len + 1;
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                memcpy( pVar->workbuf, pVar->obj.val.str, pVar->obj.len + 1 );
+                pVarObject->type = VARTYPE_STR;
+                pVarObject->len = pVar->obj.len;
+                pVarObject->val.str = pVar->workbuf;
+            }
+        }
+        else
+        {
+            *pVarObject = pVar->obj;
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VAR_Set                                                                   */
+/*!
+    Set the value of a mock variable
+
+@param[in]
+    hVarServer
+        mock variable server handle
+
+@param[in]
+    hVar
+        handle of the variable
+
+@param[in]
+    pVarObject
+        pointer to the new value
+
+@retval EINVAL invalid argument
+@retval ENOENT the variable does not exist
+@retval ENOMEM memory allocation failure
+@retval EOK the value was set
+
+==============================================================================*/
+int VAR_Set( VARSERVER_HANDLE hVarServer,
+             VAR_HANDLE hVar,
+             VarObject *pVarObject )
+{
+    int result = EINVAL;
+    MockVar *pVar;
+    char *p;
+    size_t len;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pVarObject != NULL ) )
+    {
+        g_stats.sets++;
+
+        pVar = Lookup( hVar );
+        if ( pVar == NULL )
+        {
+            result = ENOENT;
+        }
+        else if ( pVar->obj.type == VARTYPE_STR )
+        {
+            result = ENOMEM;
+            len = ( pVarObject->val.str != NULL )
+                    ? strlen( pVarObject->val.str )
+                    : 0;
+            p = realloc( pVar->obj.val.str, len + 1 );
+            if ( p != NULL )
+            {
+                memcpy( p,
+                        ( pVarObject->val.str != NULL ) ? pVarObject->val.str
+                                                        : "",
+                        len );
+                p[len] = 0;
+                pVar->obj.val.str = p;
+                pVar->obj.len = len;
+                result = EOK;
+            }
+        }
+        else
+        {
+            pVar->obj.val = pVarObject->val;
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VAR_Notify                                                                */
+/*!
+    Request a notification for a mock variable
+
+    The mock variable server counts notification requests but never
+    sends notifications.
+
+@param[in]
+    hVarServer
+        mock variable server handle
+
+@param[in]
+    hVar
+        handle of the variable
+
+@param[in]
+    notificationType
+        type of notification requested
+
+@retval EINVAL invalid argument
+@retval ENOENT the variable does not exist
+@retval EOK the notification was registered
+
+==============================================================================*/
+int VAR_Notify( VARSERVER_HANDLE hVarServer,
+                VAR_HANDLE hVar,
+                NotificationType notificationType )
+{
+    int result = EINVAL;
+
+    (void)notificationType;
+
+    if ( hVarServer != NULL )
+    {
+        g_stats.notifies++;
+        result = ( Lookup( hVar ) != NULL ) ? EOK : ENOENT;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SameValue                                                                 */
+/*!
+    Compare two mock variable values
+
+    Values are compared exactly, so evaluation modes which must produce
+    identical results can be compared.
+
+@param[in]
+    pVarObject1
+        pointer to the first value
+
+@param[in]
+    pVarObject2
+        pointer to the second value
+
+@retval true the values are the same
+@retval false the values differ
+
+==============================================================================*/
+static bool SameValue( VarObject *pVarObject1, VarObject *pVarObject2 )
+{
+    bool same = ( pVarObject1->type == pVarObject2->type );
+
+    if ( same == true )
+    {
+        switch( pVarObject1->type )
+        {
+            case VARTYPE_STR:
+                same = ( strcmp( pVarObject1->val.str,
+                                 pVarObject2->val.str ) == 0 );
+                break;
+
+            case VARTYPE_UINT16:
+                same = ( pVarObject1->val.ui == pVarObject2->val.ui );
+                break;
+
+            case VARTYPE_INT16:
+                same = ( pVarObject1->val.i == pVarObject2->val.i );
+                break;
+
+            case VARTYPE_FLOAT:
+                same = ( memcmp( &pVarObject1->val.f,
+                                 &pVarObject2->val.f,
+                                 sizeof( float ) ) == 0 );
+                break;
+
+            default:
+                same = ( pVarObject1->val.ul == pVarObject2->val.ul );
+                break;
+        }
+    }
+
+    return same;
+}
+
+/*============================================================================*/
+/*  Lookup                                                                    */
+/*!
+    Look up a mock variable by handle
+
+@param[in]
+    hVar
+        handle of the variable
+
+@retval pointer to the mock variable
+@retval NULL if the handle is invalid
+
+==============================================================================*/
+static MockVar *Lookup( VAR_HANDLE hVar )
+{
+    MockVar *pVar = NULL;
+
+    if ( ( hVar != VAR_INVALID ) &&
+         ( (size_t)hVar <= g_nVars ) )
+    {
+        pVar = &g_vars[hVar];
+    }
+
+    return pVar;
+}
+
+/*! @}
+ * end of mockvarserver group */
@@ -0,0 +1,84 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef MOCKVARSERVER_H
+#define MOCKVARSERVER_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <varserver/varserver.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! mock variable server request counters */
+typedef struct _mockStats
+{
+    /*! number of VAR_Get requests */
+    uint64_t gets;
+
+    /*! number of VAR_Set requests */
+    uint64_t sets;
+
+    /*! number of VAR_Notify requests */
+    uint64_t notifies;
+
+} MockStats;
+
+/*! copy of the values of all of the mock variables */
+typedef struct _mockSnapshot
+{
+    /*! pointer to the array of values, indexed by handle */
+    VarObject *pValues;
+
+    /*! number of variables in the snapshot */
+    size_t n;
+
+} MockSnapshot;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+VAR_HANDLE MOCK_Create( const char *name, VarObject *pVarObject );
+
+void MOCK_GetStats( MockStats *pStats );
+
+void MOCK_ResetStats( void );
+
+MockSnapshot *MOCK_Save( void );
+
+void MOCK_Restore( MockSnapshot *pSnapshot );
+
+VAR_HANDLE MOCK_Compare( MockSnapshot *pSnapshot );
+
+void MOCK_FreeSnapshot( MockSnapshot *pSnapshot );
+
+const char *MOCK_Name( VAR_HANDLE hVar );
+
+#endif
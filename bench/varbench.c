@@ -0,0 +1,1811 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varbench varbench
+ * @brief Variable action evaluation benchmark
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varbench.c
+
+    Variable action evaluation benchmark
+
+    The varbench application measures the throughput and latency of
+    compound statement evaluation against the in-process mock variable
+    server.  Each scenario builds a statement list directly using the
+    parse tree construction API and evaluates it repeatedly using the
+    tree interpreter, the compiled program or the parallel executor,
+    recording the latency of each evaluation.  When the library is built
+    with VARACTION_JIT the compiled program is also run as native code.
+    The program mode disables native code, and the jit mode runs the
+    program past the native code threshold before it is timed, so each
+    tier is measured separately.  The throughput of each mode is also
+    reported relative to the tree interpreter.
+
+    With the -v option the scenarios are not timed.  Each one is instead
+    evaluated a few times in every mode from the same initial variable
+    values, and the resulting values are compared with those produced
+    by the tree interpreter.
+
+    Scenarios:
+        arith  - integer and floating point arithmetic chains
+        string - string concatenation
+        nested - nested if/else statements
+        timer  - timer creation and deletion
+        random - generated uint16, uint32 and float arithmetic, bitwise
+                 and comparison statements
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <varaction/varaction.h>
+#include "mockvarserver.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! default number of iterations */
+#define DEFAULT_ITERATIONS  ( 100000 )
+
+/*! depth of the nested if/else scenario */
+#define NESTED_DEPTH        ( 4 )
+
+/*! number of worker threads used by the parallel mode */
+#define BENCH_THREADS       ( 3 )
+
+/*! number of executions before a program is compiled to native code
+ *  in the jit mode */
+#define BENCH_JIT_THRESHOLD ( 1 )
+
+/*! number of top level statements in the random scenario */
+#define RANDOM_STATEMENTS   ( 64 )
+
+/*! maximum expression and if/else nesting depth in the random scenario */
+#define RANDOM_DEPTH        ( 3 )
+
+/*! number of input and output variables of each type in the random
+ *  scenario */
+#define RANDOM_VARS         ( 4 )
+
+/*! fixed seed so the random scenario is the same in every run */
+#define RANDOM_SEED         ( 0x2545f491 )
+
+/*! number of evaluations in each mode when verifying the results */
+#define VERIFY_ITERATIONS   ( 3 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! benchmark scenario */
+typedef struct _scenario
+{
+    /*! name of the scenario */
+    char *name;
+
+    /*! function to build the scenario statement list */
+    Statement *(*build)( VARSERVER_HANDLE hVarServer );
+
+} Scenario;
+
+/*! benchmark state */
+typedef struct _varBenchState
+{
+    /*! number of iterations */
+    size_t iterations;
+
+    /*! name of the scenario to run, or NULL for all scenarios */
+    char *scenario;
+
+    /*! evaluation mode, or NULL for all modes */
+    char *mode;
+
+    /*! evaluation options */
+    uint32_t options;
+
+    /*! true to verify the results of each mode instead of timing them */
+    bool verify;
+
+    /*! throughput of the tree interpreter for the current scenario,
+     *  or 0 if it was not run */
+    double reference;
+
+} VarBenchState;
+
+/*! statement list prepared for evaluation in one mode */
+typedef struct _benchTarget
+{
+    /*! evaluation mode */
+    char *mode;
+
+    /*! statement list evaluated by the tree interpreter */
+    Statement *pStatements;
+
+    /*! program compiled from the statement list (program mode) */
+    VarProgram *pProgram;
+
+    /*! executor running the schedule (parallel mode) */
+    VarExecutor *pExecutor;
+
+    /*! schedule built from the statement list (parallel mode) */
+    VarSchedule *pSchedule;
+
+    /*! number of untimed evaluations before the statement list is timed */
+    size_t warmup;
+
+} BenchTarget;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int ProcessOptions( int argC, char *argV[], VarBenchState *pState );
+static void usage( char *cmdname );
+static int RunScenario( VARSERVER_HANDLE hVarServer,
+                        VarBenchState *pState,
+                        Scenario *pScenario );
+static int RunMode( VARSERVER_HANDLE hVarServer,
+                    VarBenchState *pState,
+                    char *name,
+                    char *mode,
+                    Statement *pStatements );
+static int VerifyScenario( VARSERVER_HANDLE hVarServer,
+                           VarBenchState *pState,
+                           Scenario *pScenario );
+static int VerifyMode( VARSERVER_HANDLE hVarServer,
+                       char *name,
+                       char *mode,
+                       Statement *pStatements,
+                       MockSnapshot *pInitial,
+                       MockSnapshot *pExpected );
+static bool SelectMode( VarBenchState *pState, char *mode );
+static int Prepare( BenchTarget *pTarget, char *mode, Statement *pStatements );
+static int Evaluate( VARSERVER_HANDLE hVarServer, BenchTarget *pTarget );
+static void Release( BenchTarget *pTarget );
+static double Report( char *name,
+                      char *mode,
+                      uint64_t *pSamples,
+                      size_t n,
+                      MockStats *pStats,
+                      double reference );
+static int CompareSamples( const void *p1, const void *p2 );
+static uint64_t Percentile( uint64_t *pSamples, size_t n, double pct );
+static uint64_t TimeNow( void );
+static Statement *NewStatement( Variable *pVariable, int lineno );
+static Statement *Append( Statement *pStatements, Statement *pStatement );
+static Variable *SysVar( VARSERVER_HANDLE hVarServer,
+                         char *name,
+                         VarObject *pVarObject,
+                         bool lvalue );
+static Statement *BuildArith( VARSERVER_HANDLE hVarServer );
+static Statement *BuildString( VARSERVER_HANDLE hVarServer );
+static Statement *BuildNested( VARSERVER_HANDLE hVarServer );
+static Statement *BuildTimer( VARSERVER_HANDLE hVarServer );
+static Statement *BuildRandom( VARSERVER_HANDLE hVarServer );
+static Statement *RandomStatement( VARSERVER_HANDLE hVarServer,
+                                   int depth,
+                                   int lineno );
+static Variable *RandomCondition( VARSERVER_HANDLE hVarServer, int depth );
+static Variable *RandomExpr( VARSERVER_HANDLE hVarServer,
+                             int type,
+                             int depth );
+static Variable *RandomVar( VARSERVER_HANDLE hVarServer,
+                            int type,
+                            bool output );
+static uint32_t Random( void );
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! benchmark scenarios */
+static Scenario scenarios[] =
+{
+    { "arith", BuildArith },
+    { "string", BuildString },
+    { "nested", BuildNested },
+    { "timer", BuildTimer },
+    { "random", BuildRandom },
+    { NULL, NULL }
+};
+
+/*! types of the random scenario variables */
+static int randomTypes[] =
+{
+    VARTYPE_UINT16,
+    VARTYPE_UINT32,
+    VARTYPE_FLOAT
+};
+
+/*! state of the random scenario generator */
+static uint32_t randomState;
+
+/*! evaluation modes.  The first mode is the reference for -v */
+static char *modes[] =
+{
+    "tree",
+    "program",
+#ifdef VARACTION_JIT
+    "jit",
+#endif
+    "parallel",
+    NULL
+};
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  main                                                                      */
+/*!
+    Main entry point for the varbench application
+
+@param[in]
+    argc
+        number of arguments on the command line
+        (including the command itself)
+
+@param[in]
+    argv
+        array of pointers to the command line arguments
+
+@retval EXIT_SUCCESS all of the selected scenarios ran successfully
+@retval EXIT_FAILURE invalid options, a scenario failed, or a mode
+        produced different results
+
+==============================================================================*/
+int main(int argc, char **argv)
+{
+    VarBenchState state;
+    VARSERVER_HANDLE hVarServer;
+    Scenario *pScenario;
+    sigset_t mask;
+    int result = EINVAL;
+    int rc;
+
+    memset( &state, 0, sizeof( VarBenchState ) );
+    state.iterations = DEFAULT_ITERATIONS;
+
+    if ( ProcessOptions( argc, argv, &state ) == EOK )
+    {
+        /* block the timer notification signal so expiring timers
+           do not terminate the benchmark */
+        sigemptyset( &mask );
+        sigaddset( &mask, SIGRTMIN+5 );
+        sigprocmask( SIG_BLOCK, &mask, NULL );
+
+        hVarServer = VARSERVER_Open();
+        InitVarAction();
+        VarActionSetOptions( state.options );
+
+        if ( state.verify == false )
+        {
+            printf( "%-8s %-8s %12s %8s %10s %10s %10s %10s %10s %8s %8s\n",
+                    "scenario", "mode", "ops/s", "vs tree", "p50(ns)",
+                    "p90(ns)", "p99(ns)", "p99.9(ns)", "max(ns)", "gets",
+                    "sets" );
+        }
+
+        result = EOK;
+        for ( pScenario = scenarios; pScenario->name != NULL; pScenario++ )
+        {
+            if ( ( state.scenario == NULL ) ||
+                 ( strcmp( state.scenario, pScenario->name ) == 0 ) )
+            {
+                rc = ( state.verify == true )
+                        ? VerifyScenario( hVarServer, &state, pScenario )
+                        : RunScenario( hVarServer, &state, pScenario );
+                if ( rc != EOK )
+                {
+                    fprintf( stderr,
+                             "%s: %s\n",
+                             pScenario->name,
+                             strerror( rc ) );
+                    result = rc;
+                }
+            }
+        }
+
+        VARSERVER_Close( hVarServer );
+    }
+
+    return ( result == EOK ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*============================================================================*/
+/*  usage                                                                     */
+/*!
+    Display the application usage
+
+@param[in]
+    cmdname
+        pointer to the invoked command name
+
+==============================================================================*/
+static void usage( char *cmdname )
+{
+    if( cmdname != NULL )
+    {
+        fprintf(stderr,
+                "usage: %s [-n iterations] [-s scenario] [-m mode] "
+                "[-p] [-d] [-o] [-c] [-w] [-v] [-h]\n"
+                " [-n iterations] : number of evaluations per scenario\n"
+                " [-s scenario] : arith, string, nested, timer or random\n"
+                " [-m mode] : tree, program, jit (VARACTION_JIT builds) "
+                "or parallel\n"
+                " [-p] : prefetch system variables\n"
+                " [-d] : defer system variable writes\n"
+                " [-o] : optimize expressions\n"
+                " [-c] : short circuit boolean operations\n"
+                " [-w] : use the timer wheel\n"
+                " [-v] : verify every mode against the tree interpreter\n"
+                " [-h] : display this help\n",
+                cmdname );
+    }
+}
+
+/*============================================================================*/
+/*  ProcessOptions                                                            */
+/*!
+    Process the command line options
+
+@param[in]
+    argC
+        number of arguments
+        (including the command itself)
+
+@param[in]
+    argv
+        array of pointers to the command line arguments
+
+@param[in]
+    pState
+        pointer to the benchmark state
+
+@retval EOK the options were processed
+@retval EINVAL invalid options, or a mode which is not built in
+
+==============================================================================*/
+static int ProcessOptions( int argC, char *argV[], VarBenchState *pState )
+{
+    int c;
+    int result = EINVAL;
+    const char *options = "n:s:m:pdocwvh";
+    char **ppMode;
+
+    if( ( pState != NULL ) &&
+        ( argV != NULL ) )
+    {
+        result = EOK;
+
+        while( ( c = getopt( argC, argV, options ) ) != -1 )
+        {
+            switch( c )
+            {
+                case 'n':
+                    pState->iterations = strtoul( optarg, NULL, 0 );
+                    break;
+
+                case 's':
+                    pState->scenario = optarg;
+                    break;
+
+                case 'm':
+                    pState->mode = optarg;
+                    break;
+
+                case 'p':
+                    pState->options |= VA_OPT_PREFETCH;
+                    break;
+
+                case 'd':
+                    pState->options |= VA_OPT_DEFER_WRITES;
+                    break;
+
+                case 'o':
+                    pState->options |= VA_OPT_OPTIMIZE;
+                    break;
+
+                case 'c':
+                    pState->options |= VA_OPT_SHORT_CIRCUIT;
+                    break;
+
+                case 'w':
+                    pState->options |= VA_OPT_TIMER_WHEEL;
+                    break;
+
+                case 'v':
+                    pState->verify = true;
+                    break;
+
+                case 'h':
+                case '?':
+                default:
+                    /* stop at the first invalid option so the program
+                     * exits with EXIT_FAILURE after the usage */
+                    usage( argV[0] );
+                    result = EINVAL;
+                    break;
+            }
+
+            if ( result != EOK )
+            {
+                break;
+            }
+        }
+
+        if ( pState->iterations == 0 )
+        {
+            result = EINVAL;
+        }
+
+        if ( ( result == EOK ) && ( pState->mode != NULL ) )
+        {
+            /* the jit mode only exists if the library has native code */
+            for ( ppMode = modes; *ppMode != NULL; ppMode++ )
+            {
+                if ( strcmp( pState->mode, *ppMode ) == 0 )
+                {
+                    break;
+                }
+            }
+
+            if ( *ppMode == NULL )
+            {
+                fprintf( stderr, "unsupported mode: %s\n", pState->mode );
+                result = EINVAL;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunScenario                                                               */
+/*!
+    Run a benchmark scenario
+
+    The RunScenario function builds the statement list for the specified
+    scenario and runs it in each of the selected evaluation modes.  The
+    tree interpreter runs first, so the other modes can be compared with
+    its throughput.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pState
+        pointer to the benchmark state
+
+@param[in]
+    pScenario
+        pointer to the scenario to run
+
+@retval EOK the scenario was run
+@retval EINVAL invalid arguments
+@retval ENOMEM the scenario could not be built
+
+==============================================================================*/
+static int RunScenario( VARSERVER_HANDLE hVarServer,
+                        VarBenchState *pState,
+                        Scenario *pScenario )
+{
+    int result = EINVAL;
+    int rc;
+    Statement *pStatements;
+    char **ppMode;
+
+    if ( ( pState != NULL ) &&
+         ( pScenario != NULL ) )
+    {
+        SetDeclarations( NULL );
+        pState->reference = 0.0;
+
+        pStatements = pScenario->build( hVarServer );
+        if ( pStatements != NULL )
+        {
+            result = EOK;
+
+            for ( ppMode = modes; *ppMode != NULL; ppMode++ )
+            {
+                if ( SelectMode( pState, *ppMode ) == true )
+                {
+                    rc = RunMode( hVarServer,
+                                  pState,
+                                  pScenario->name,
+                                  *ppMode,
+                                  pStatements );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunMode                                                                   */
+/*!
+    Run a statement list in a single evaluation mode
+
+    The RunMode function evaluates the statement list for the configured
+    number of iterations, recording the latency of each evaluation,
+    and reports the results.  Warm-up evaluations required by the mode
+    are not timed or counted.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pState
+        pointer to the benchmark state
+
+@param[in]
+    name
+        name of the scenario
+
+@param[in]
+    mode
+        evaluation mode
+
+@param[in]
+    pStatements
+        pointer to the statement list to evaluate
+
+@retval EOK the statement list was evaluated
+@retval EINVAL invalid arguments
+@retval ENOMEM memory allocation failure
+@retval other error returned by the evaluation
+
+==============================================================================*/
+static int RunMode( VARSERVER_HANDLE hVarServer,
+                    VarBenchState *pState,
+                    char *name,
+                    char *mode,
+                    Statement *pStatements )
+{
+    int result = EINVAL;
+    uint64_t *pSamples;
+    BenchTarget target;
+    MockStats stats;
+    uint64_t start;
+    double opsps;
+    size_t i;
+    int rc;
+
+    if ( ( pState != NULL ) &&
+         ( mode != NULL ) &&
+         ( pStatements != NULL ) )
+    {
+        rc = Prepare( &target, mode, pStatements );
+        for ( i = 0; ( rc == EOK ) && ( i < target.warmup ); i++ )
+        {
+            rc = Evaluate( hVarServer, &target );
+        }
+
+        pSamples = malloc( pState->iterations * sizeof( uint64_t ) );
+        if ( ( pSamples != NULL ) &&
+             ( rc == EOK ) )
+        {
+            result = EOK;
+
+            MOCK_ResetStats();
+
+            for ( i = 0; i < pState->iterations; i++ )
+            {
+                start = TimeNow();
+
+                rc = Evaluate( hVarServer, &target );
+
+                pSamples[i] = TimeNow() - start;
+
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            MOCK_GetStats( &stats );
+            opsps = Report( name,
+                            mode,
+                            pSamples,
+                            pState->iterations,
+                            &stats,
+                            pState->reference );
+            if ( mode == modes[0] )
+            {
+                pState->reference = opsps;
+            }
+        }
+        else
+        {
+            result = ( rc != EOK ) ? rc : ENOMEM;
+        }
+
+        free( pSamples );
+        Release( &target );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VerifyScenario                                                            */
+/*!
+    Verify the results of a scenario in every evaluation mode
+
+    The VerifyScenario function builds the statement list for the
+    specified scenario and evaluates it VERIFY_ITERATIONS times with the
+    tree interpreter.  Each selected mode then evaluates it the same
+    number of times from the same initial variable values, and must
+    produce the same variable values.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pState
+        pointer to the benchmark state
+
+@param[in]
+    pScenario
+        pointer to the scenario to verify
+
+@retval EOK every mode produced the same results
+@retval EINVAL invalid arguments
+@retval ENOMEM memory allocation failure
+@retval EIO a mode produced different results
+@retval other error returned by an evaluation
+
+==============================================================================*/
+static int VerifyScenario( VARSERVER_HANDLE hVarServer,
+                           VarBenchState *pState,
+                           Scenario *pScenario )
+{
+    int result = EINVAL;
+    Statement *pStatements;
+    MockSnapshot *pInitial = NULL;
+    MockSnapshot *pExpected = NULL;
+    BenchTarget target;
+    char **ppMode;
+    size_t i;
+    int rc;
+
+    if ( ( pState != NULL ) &&
+         ( pScenario != NULL ) )
+    {
+        SetDeclarations( NULL );
+
+        result = ENOMEM;
+        pStatements = pScenario->build( hVarServer );
+        if ( pStatements != NULL )
+        {
+            pInitial = MOCK_Save();
+        }
+
+        if ( ( pInitial != NULL ) &&
+             ( Prepare( &target, modes[0], pStatements ) == EOK ) )
+        {
+            /* the tree interpreter produces the expected results */
+            result = EOK;
+            for ( i = 0; i < VERIFY_ITERATIONS; i++ )
+            {
+                rc = Evaluate( hVarServer, &target );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+
+            Release( &target );
+            pExpected = MOCK_Save();
+        }
+
+        for ( ppMode = &modes[1];
+              ( result == EOK ) && ( *ppMode != NULL );
+              ppMode++ )
+        {
+            if ( SelectMode( pState, *ppMode ) == true )
+            {
+                rc = VerifyMode( hVarServer,
+                                 pScenario->name,
+                                 *ppMode,
+                                 pStatements,
+                                 pInitial,
+                                 pExpected );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+        }
+
+        MOCK_FreeSnapshot( pExpected );
+        MOCK_FreeSnapshot( pInitial );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VerifyMode                                                                */
+/*!
+    Verify the results of a statement list in a single evaluation mode
+
+    The VerifyMode function restores the initial variable values,
+    evaluates the statement list VERIFY_ITERATIONS times in the
+    specified mode, and compares the resulting variable values with the
+    expected values.  The outcome is printed.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    name
+        name of the scenario
+
+@param[in]
+    mode
+        evaluation mode
+
+@param[in]
+    pStatements
+        pointer to the statement list to evaluate
+
+@param[in]
+    pInitial
+        pointer to the initial variable values
+
+@param[in]
+    pExpected
+        pointer to the expected variable values
+
+@retval EOK the mode produced the expected values
+@retval EINVAL invalid arguments
+@retval EIO the mode produced different values
+@retval other error returned by the evaluation
+
+==============================================================================*/
+static int VerifyMode( VARSERVER_HANDLE hVarServer,
+                       char *name,
+                       char *mode,
+                       Statement *pStatements,
+                       MockSnapshot *pInitial,
+                       MockSnapshot *pExpected )
+{
+    int result = EINVAL;
+    BenchTarget target;
+    VAR_HANDLE hVar;
+    size_t i;
+
+    if ( ( pInitial != NULL ) &&
+         ( pExpected != NULL ) )
+    {
+        MOCK_Restore( pInitial );
+
+        result = Prepare( &target, mode, pStatements );
+        for ( i = 0; ( result == EOK ) && ( i < VERIFY_ITERATIONS ); i++ )
+        {
+            result = Evaluate( hVarServer, &target );
+        }
+
+        Release( &target );
+
+        hVar = MOCK_Compare( pExpected );
+        if ( result != EOK )
+        {
+            printf( "%-8s %-8s failed: %s\n", name, mode, strerror( result ) );
+        }
+        else if ( hVar != VAR_INVALID )
+        {
+            printf( "%-8s %-8s mismatch: %s\n", name, mode, MOCK_Name( hVar ) );
+            result = EIO;
+        }
+        else
+        {
+            printf( "%-8s %-8s ok\n", name, mode );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SelectMode                                                                */
+/*!
+    Determine if an evaluation mode was selected
+
+@param[in]
+    pState
+        pointer to the benchmark state
+
+@param[in]
+    mode
+        evaluation mode
+
+@retval true the mode was selected with -m, or no mode was selected
+@retval false another mode was selected
+
+==============================================================================*/
+static bool SelectMode( VarBenchState *pState, char *mode )
+{
+    return ( pState->mode == NULL ) || ( strcmp( pState->mode, mode ) == 0 );
+}
+
+/*============================================================================*/
+/*  Prepare                                                                   */
+/*!
+    Prepare a statement list for evaluation in an evaluation mode
+
+    The Prepare function compiles the statement list for the program
+    and jit modes, and creates an executor and a schedule for the
+    parallel mode.  The program mode disables native code.  The jit mode
+    sets the native code threshold to BENCH_JIT_THRESHOLD and requests
+    that many warm-up evaluations, so the program is running as native
+    code before it is timed.
+
+@param[out]
+    pTarget
+        pointer to the target to initialize.  It must be released with
+        Release() even if it could not be prepared.
+
+@param[in]
+    mode
+        evaluation mode
+
+@param[in]
+    pStatements
+        pointer to the statement list
+
+@retval EOK the statement list was prepared
+@retval ENOTSUP the mode is not supported
+@retval ENOMEM the statement list could not be prepared
+
+==============================================================================*/
+static int Prepare( BenchTarget *pTarget, char *mode, Statement *pStatements )
+{
+    int result = ENOMEM;
+
+    memset( pTarget, 0, sizeof( BenchTarget ) );
+    pTarget->mode = mode;
+    pTarget->pStatements = pStatements;
+
+    if ( strcmp( mode, "tree" ) == 0 )
+    {
+        result = EOK;
+    }
+    else if ( strcmp( mode, "program" ) == 0 )
+    {
+        VarActionSetJitThreshold( 0 );
+        pTarget->pProgram = CompileStatement( pStatements );
+        if ( pTarget->pProgram != NULL )
+        {
+            result = EOK;
+        }
+    }
+#ifdef VARACTION_JIT
+    else if ( strcmp( mode, "jit" ) == 0 )
+    {
+        VarActionSetJitThreshold( BENCH_JIT_THRESHOLD );
+        pTarget->warmup = BENCH_JIT_THRESHOLD;
+        pTarget->pProgram = CompileStatement( pStatements );
+        if ( pTarget->pProgram != NULL )
+        {
+            result = EOK;
+        }
+    }
+#endif
+    else if ( strcmp( mode, "parallel" ) == 0 )
+    {
+        pTarget->pExecutor = VarActionCreateExecutor( BENCH_THREADS );
+        pTarget->pSchedule = VarActionCreateSchedule( pStatements );
+        if ( ( pTarget->pExecutor != NULL ) &&
+             ( pTarget->pSchedule != NULL ) )
+        {
+            result = EOK;
+        }
+    }
+    else
+    {
+        result = ENOTSUP;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Evaluate                                                                  */
+/*!
+    Evaluate a prepared statement list once
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pTarget
+        pointer to the target prepared with Prepare()
+
+@retval EOK the statement list was evaluated
+@retval other error returned by the evaluation
+
+==============================================================================*/
+static int Evaluate( VARSERVER_HANDLE hVarServer, BenchTarget *pTarget )
+{
+    int result;
+
+    if ( pTarget->pProgram != NULL )
+    {
+        result = ExecProgram( hVarServer, pTarget->pProgram );
+    }
+    else if ( pTarget->pSchedule != NULL )
+    {
+        result = VarActionExecute( pTarget->pExecutor,
+                                   hVarServer,
+                                   pTarget->pSchedule );
+    }
+    else
+    {
+        result = ProcessCompoundStatement( hVarServer,
+                                           pTarget->pStatements );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Release                                                                   */
+/*!
+    Release the resources of a prepared statement list
+
+    The statement list itself is not affected.
+
+@param[in]
+    pTarget
+        pointer to the target prepared with Prepare()
+
+==============================================================================*/
+static void Release( BenchTarget *pTarget )
+{
+    FreeProgram( pTarget->pProgram );
+    VarActionFreeSchedule( pTarget->pSchedule );
+    VarActionFreeExecutor( pTarget->pExecutor );
+    memset( pTarget, 0, sizeof( BenchTarget ) );
+}
+
+/*============================================================================*/
+/*  Report                                                                    */
+/*!
+    Report the results of a benchmark run
+
+    The throughput is printed relative to the reference throughput of
+    the tree interpreter, or as "-" if there is no reference.
+
+@param[in]
+    name
+        name of the scenario
+
+@param[in]
+    mode
+        evaluation mode
+
+@param[in]
+    pSamples
+        pointer to the evaluation latencies in nanoseconds
+
+@param[in]
+    n
+        number of samples
+
+@param[in]
+    pStats
+        pointer to the mock variable server request counters
+
+@param[in]
+    reference
+        throughput of the tree interpreter, or 0 if it is not known
+
+@retval throughput in evaluations per second
+
+==============================================================================*/
+static double Report( char *name,
+                      char *mode,
+                      uint64_t *pSamples,
+                      size_t n,
+                      MockStats *pStats,
+                      double reference )
+{
+    uint64_t total = 0;
+    double opsps = 0.0;
+    char ratio[16];
+    size_t i;
+
+    if ( ( pSamples != NULL ) &&
+         ( pStats != NULL ) &&
+         ( n > 0 ) )
+    {
+        for ( i = 0; i < n; i++ )
+        {
+            total += pSamples[i];
+        }
+
+        if ( total > 0 )
+        {
+            opsps = (double)n * 1e9 / (double)total;
+        }
+
+        if ( reference > 0.0 )
+        {
+            snprintf( ratio, sizeof( ratio ), "%.2fx", opsps / reference );
+        }
+        else
+        {
+            snprintf( ratio, sizeof( ratio ), "-" );
+        }
+
+        qsort( pSamples, n, sizeof( uint64_t ), CompareSamples );
+
+        printf( "%-8s %-8s %12.0f %8s %10llu %10llu %10llu %10llu %10llu "
+                "%8llu %8llu\n",
+                name,
+                mode,
+                opsps,
+                ratio,
+                (unsigned long long)Percentile( pSamples, n, 50.0 ),
+                (unsigned long long)Percentile( pSamples, n, 90.0 ),
+                (unsigned long long)Percentile( pSamples, n, 99.0 ),
+                (unsigned long long)Percentile( pSamples, n, 99.9 ),
+                (unsigned long long)pSamples[n-1],
+                (unsigned long long)( pStats->gets / n ),
+                (unsigned long long)( pStats->sets / n ) );
+    }
+
+    return opsps;
+}
+
+/*============================================================================*/
+/*  CompareSamples                                                            */
+/*!
+    Compare two latency samples for qsort
+
+@param[in]
+    p1
+        pointer to the first sample
+
+@param[in]
+    p2
+        pointer to the second sample
+
+@retval -1 the first sample is smaller
+@retval 0 the samples are equal
+@retval 1 the first sample is larger
+
+==============================================================================*/
+static int CompareSamples( const void *p1, const void *p2 )
+{
+    uint64_t a = *(const uint64_t *)p1;
+    uint64_t b = *(const uint64_t *)p2;
+
+    return ( a < b ) ? -1 : ( a > b ) ? 1 : 0;
+}
+
+/*============================================================================*/
+/*  Percentile                                                                */
+/*!
+    Get a percentile from a sorted sample list
+
+@param[in]
+    pSamples
+        pointer to the sorted samples
+
+@param[in]
+    n
+        number of samples
+
+@param[in]
+    pct
+        percentile to get (0.0 - 100.0)
+
+@retval the sample at the requested percentile
+
+==============================================================================*/
+static uint64_t Percentile( uint64_t *pSamples, size_t n, double pct )
+{
+    size_t idx;
+
+    idx = (size_t)( ( pct / 100.0 ) * (double)( n - 1 ) + 0.5 );
+    if ( idx >= n )
+    {
+        idx = n - 1;
+    }
+
+    return pSamples[idx];
+}
+
+/*============================================================================*/
+/*  TimeNow                                                                   */
+/*!
+    Get the monotonic time in nanoseconds
+
+@retval monotonic time in nanoseconds
+
+==============================================================================*/
+static uint64_t TimeNow( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*============================================================================*/
+/*  NewStatement                                                              */
+/*!
+    Create a new statement
+
+@param[in]
+    pVariable
+        pointer to the statement expression
+
+@param[in]
+    lineno
+        statement line number
+
+@retval pointer to the new statement
+@retval NULL if the statement could not be created
+
+==============================================================================*/
+static Statement *NewStatement( Variable *pVariable, int lineno )
+{
+    Statement *pStatement;
+
+    pStatement = calloc( 1, sizeof( Statement ) );
+    if ( pStatement != NULL )
+    {
+        pStatement->pVariable = pVariable;
+        pStatement->lineno = lineno;
+    }
+
+    return pStatement;
+}
+
+/*============================================================================*/
+/*  Append                                                                    */
+/*!
+    Append a statement to a statement list
+
+@param[in]
+    pStatements
+        pointer to the statement list (may be NULL)
+
+@param[in]
+    pStatement
+        pointer to the statement to append
+
+@retval pointer to the head of the statement list
+
+==============================================================================*/
+static Statement *Append( Statement *pStatements, Statement *pStatement )
+{
+    Statement *p = pStatements;
+
+    if ( p == NULL )
+    {
+        pStatements = pStatement;
+    }
+    else
+    {
+        while ( p->pNext != NULL )
+        {
+            p = p->pNext;
+        }
+
+        p->pNext = pStatement;
+    }
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  SysVar                                                                    */
+/*!
+    Create a mock system variable and its identifier node
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    name
+        name of the system variable
+
+@param[in]
+    pVarObject
+        pointer to the initial value of the system variable
+
+@param[in]
+    lvalue
+        true if the variable is assigned by the scenario
+
+@retval pointer to the identifier node
+@retval NULL if the variable could not be created
+
+==============================================================================*/
+static Variable *SysVar( VARSERVER_HANDLE hVarServer,
+                         char *name,
+                         VarObject *pVarObject,
+                         bool lvalue )
+{
+    Variable *pVariable = NULL;
+
+    if ( VAR_FindByName( hVarServer, name ) == VAR_INVALID )
+    {
+        MOCK_Create( name, pVarObject );
+    }
+
+    pVariable = NewIdentifier( hVarServer, name, false );
+    if ( pVariable != NULL )
+    {
+        pVariable->lvalue = lvalue;
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  BuildArith                                                                */
+/*!
+    Build the arithmetic scenario
+
+    /bench/x = ( /bench/a + /bench/b ) * /bench/c - /bench/d / 2
+    /bench/x += /bench/e << 2
+    /bench/y = (float)/bench/a * 1.5 + /bench/f
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval pointer to the scenario statement list
+
+==============================================================================*/
+static Statement *BuildArith( VARSERVER_HANDLE hVarServer )
+{
+    Statement *pStatements = NULL;
+    VarObject obj;
+    Variable *a, *b, *c, *d, *e, *f, *x, *y;
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.type = VARTYPE_UINT32;
+    obj.len = sizeof( uint32_t );
+
+    obj.val.ul = 7;
+    a = SysVar( hVarServer, "/bench/a", &obj, false );
+    obj.val.ul = 11;
+    b = SysVar( hVarServer, "/bench/b", &obj, false );
+    obj.val.ul = 3;
+    c = SysVar( hVarServer, "/bench/c", &obj, false );
+    obj.val.ul = 40;
+    d = SysVar( hVarServer, "/bench/d", &obj, false );
+    obj.val.ul = 5;
+    e = SysVar( hVarServer, "/bench/e", &obj, false );
+    obj.val.ul = 0;
+    x = SysVar( hVarServer, "/bench/x", &obj, true );
+
+    obj.type = VARTYPE_FLOAT;
+    obj.len = sizeof( float );
+    obj.val.f = 0.25;
+    f = SysVar( hVarServer, "/bench/f", &obj, false );
+    obj.val.f = 0.0;
+    y = SysVar( hVarServer, "/bench/y", &obj, true );
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_ASSIGN, x,
+            CreateVariable( VA_SUB,
+                CreateVariable( VA_MUL,
+                    CreateVariable( VA_ADD, a, b ),
+                    c ),
+                CreateVariable( VA_DIV, d, NewNumber( "2L" ) ) ) ),
+        1 ) );
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_PLUS_EQUALS, x,
+            CreateVariable( VA_LSHIFT, e, NewNumber( "2L" ) ) ),
+        2 ) );
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_ASSIGN, y,
+            CreateVariable( VA_ADD,
+                CreateVariable( VA_MUL,
+                    CreateVariable( VA_TOFLOAT, a, NULL ),
+                    NewFloat( "1.5" ) ),
+                f ) ),
+        3 ) );
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  BuildString                                                               */
+/*!
+    Build the string concatenation scenario
+
+    string s;
+    s = "alpha" + "beta";
+    /bench/s = s + "gamma";
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval pointer to the scenario statement list
+
+==============================================================================*/
+static Statement *BuildString( VARSERVER_HANDLE hVarServer )
+{
+    Statement *pStatements = NULL;
+    Variable *pDeclaration;
+    Variable *s;
+    Variable *out;
+    VarObject obj;
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.type = VARTYPE_STR;
+    obj.val.str = "";
+    out = SysVar( hVarServer, "/bench/s", &obj, true );
+
+    pDeclaration = CreateDeclaration( VA_STRING,
+                                      NewIdentifier( hVarServer, "s", true ) );
+    SetDeclarations( pDeclaration );
+
+    s = NewIdentifier( hVarServer, "s", false );
+    if ( s != NULL )
+    {
+        s->lvalue = true;
+    }
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_ASSIGN, s,
+            CreateVariable( VA_ADD,
+                NewString( "alpha" ),
+                NewString( "beta" ) ) ),
+        1 ) );
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_ASSIGN, out,
+            CreateVariable( VA_ADD,
+                NewIdentifier( hVarServer, "s", false ),
+                NewString( "gamma" ) ) ),
+        2 ) );
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  BuildNested                                                               */
+/*!
+    Build the nested if/else scenario
+
+    Builds NESTED_DEPTH levels of
+
+    if ( /bench/n > level ) { <next level> } else { /bench/z += level }
+
+    where the innermost level assigns /bench/z = /bench/n, so each
+    evaluation takes the deepest path.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval pointer to the scenario statement list
+
+==============================================================================*/
+static Statement *BuildNested( VARSERVER_HANDLE hVarServer )
+{
+    Statement *pStatements;
+    Variable *n;
+    Variable *z;
+    VarObject obj;
+    char level[16];
+    int i;
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.type = VARTYPE_UINT32;
+    obj.len = sizeof( uint32_t );
+    obj.val.ul = NESTED_DEPTH + 1;
+    n = SysVar( hVarServer, "/bench/n", &obj, false );
+    obj.val.ul = 0;
+    z = SysVar( hVarServer, "/bench/z", &obj, true );
+
+    pStatements = NewStatement( CreateVariable( VA_ASSIGN, z, n ),
+                                NESTED_DEPTH + 1 );
+
+    for ( i = NESTED_DEPTH; i > 0; i-- )
+    {
+        snprintf( level, sizeof( level ), "%dL", i );
+
+        pStatements = NewStatement(
+            CreateVariable( VA_IF,
+                CreateVariable( VA_GT, n, NewNumber( level ) ),
+                CreateVariable( VA_ELSE,
+                    pStatements,
+                    NewStatement(
+                        CreateVariable( VA_PLUS_EQUALS,
+                                        z,
+                                        NewNumber( level ) ),
+                        i ) ) ),
+            i );
+    }
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  BuildTimer                                                                */
+/*!
+    Build the timer scenario
+
+    create_timer( 1, 60000 );
+    delete_timer( 1 );
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval pointer to the scenario statement list
+
+==============================================================================*/
+static Statement *BuildTimer( VARSERVER_HANDLE hVarServer )
+{
+    Statement *pStatements = NULL;
+
+    (void)hVarServer;
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_CREATE_TIMER,
+                        NewNumber( "1" ),
+                        NewNumber( "60000L" ) ),
+        1 ) );
+
+    pStatements = Append( pStatements, NewStatement(
+        CreateVariable( VA_DELETE_TIMER, NewNumber( "1" ), NULL ),
+        2 ) );
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  BuildRandom                                                               */
+/*!
+    Build the random scenario
+
+    Builds RANDOM_STATEMENTS generated statements from RANDOM_SEED.  Each
+    statement assigns an expression to an output variable, or is an
+    if/else statement whose condition compares two expressions.  The
+    expressions combine the input variables and constants of a single
+    type using the operations which compiled programs perform inline,
+    so the -v option compares the native code with the tree interpreter
+    and the compiled program.  Input variables are only read and output
+    variables are only written.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval pointer to the scenario statement list
+
+==============================================================================*/
+static Statement *BuildRandom( VARSERVER_HANDLE hVarServer )
+{
+    Statement *pStatements = NULL;
+    int i;
+
+    randomState = RANDOM_SEED;
+
+    for ( i = 0; i < RANDOM_STATEMENTS; i++ )
+    {
+        pStatements = Append( pStatements,
+                              RandomStatement( hVarServer,
+                                               RANDOM_DEPTH,
+                                               i + 1 ) );
+    }
+
+    return pStatements;
+}
+
+/*============================================================================*/
+/*  RandomStatement                                                           */
+/*!
+    Generate a random statement
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    depth
+        maximum if/else nesting depth
+
+@param[in]
+    lineno
+        statement line number
+
+@retval pointer to the new statement
+@retval NULL if the statement could not be created
+
+==============================================================================*/
+static Statement *RandomStatement( VARSERVER_HANDLE hVarServer,
+                                   int depth,
+                                   int lineno )
+{
+    Variable *pVariable;
+    int type;
+
+    if ( ( depth > 0 ) && ( Random() % 4 == 0 ) )
+    {
+        pVariable = CreateVariable( VA_IF,
+            RandomCondition( hVarServer, depth ),
+            CreateVariable( VA_ELSE,
+                RandomStatement( hVarServer, depth - 1, lineno ),
+                RandomStatement( hVarServer, depth - 1, lineno ) ) );
+    }
+    else
+    {
+        type = randomTypes[Random() % 3];
+        pVariable = CreateVariable( VA_ASSIGN,
+                                    RandomVar( hVarServer, type, true ),
+                                    RandomExpr( hVarServer,
+                                                type,
+                                                RANDOM_DEPTH ) );
+    }
+
+    return NewStatement( pVariable, lineno );
+}
+
+/*============================================================================*/
+/*  RandomCondition                                                           */
+/*!
+    Generate a random condition
+
+    The condition compares two expressions of the same type, or combines
+    two conditions with a boolean operation.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    depth
+        maximum nesting depth
+
+@retval pointer to the condition
+@retval NULL if the condition could not be created
+
+==============================================================================*/
+static Variable *RandomCondition( VARSERVER_HANDLE hVarServer, int depth )
+{
+    static const int compare[] = { VA_EQUALS, VA_GT, VA_LT, VA_GTE, VA_LTE };
+    Variable *pVariable;
+    int type;
+
+    if ( ( depth > 1 ) && ( Random() % 4 == 0 ) )
+    {
+        pVariable = CreateVariable( ( Random() % 2 ) ? VA_AND : VA_OR,
+                                    RandomCondition( hVarServer, depth - 1 ),
+                                    RandomCondition( hVarServer, depth - 1 ) );
+    }
+    else
+    {
+        type = randomTypes[Random() % 3];
+        pVariable = CreateVariable( compare[Random() % 5],
+                                    RandomExpr( hVarServer, type, depth - 1 ),
+                                    RandomExpr( hVarServer, type, depth - 1 ) );
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  RandomExpr                                                                */
+/*!
+    Generate a random expression
+
+    Integer expressions use addition, subtraction, multiplication and the
+    bitwise operations.  Floating point expressions use addition,
+    subtraction and multiplication.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    type
+        type of the expression
+
+@param[in]
+    depth
+        maximum nesting depth
+
+@retval pointer to the expression
+@retval NULL if the expression could not be created
+
+==============================================================================*/
+static Variable *RandomExpr( VARSERVER_HANDLE hVarServer,
+                             int type,
+                             int depth )
+{
+    static const int ops[] =
+        { VA_ADD, VA_SUB, VA_MUL, VA_BAND, VA_BOR, VA_XOR };
+    Variable *pVariable;
+    char number[32];
+    uint32_t r;
+
+    r = Random();
+    if ( ( depth > 0 ) && ( r % 3 != 0 ) )
+    {
+        pVariable = CreateVariable(
+                        ops[Random() % ( ( type == VARTYPE_FLOAT ) ? 3 : 6 )],
+                        RandomExpr( hVarServer, type, depth - 1 ),
+                        RandomExpr( hVarServer, type, depth - 1 ) );
+    }
+    else if ( r % 2 == 0 )
+    {
+        pVariable = RandomVar( hVarServer, type, false );
+    }
+    else if ( type == VARTYPE_UINT16 )
+    {
+        snprintf( number, sizeof( number ), "%uU", Random() % 65536 );
+        pVariable = NewNumber( number );
+    }
+    else if ( type == VARTYPE_UINT32 )
+    {
+        snprintf( number, sizeof( number ), "%uL", Random() % 0x7fffffff );
+        pVariable = NewNumber( number );
+    }
+    else
+    {
+        snprintf( number, sizeof( number ), "%.3f",
+                  (float)( Random() % 20000 ) / 100.0 - 100.0 );
+        pVariable = NewFloat( number );
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  RandomVar                                                                 */
+/*!
+    Get a random input or output variable of the random scenario
+
+    The variables are created with a random initial value the first time
+    they are used.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    type
+        type of the variable
+
+@param[in]
+    output
+        true for an output variable, false for an input variable
+
+@retval pointer to the identifier node
+@retval NULL if the variable could not be created
+
+==============================================================================*/
+static Variable *RandomVar( VARSERVER_HANDLE hVarServer,
+                            int type,
+                            bool output )
+{
+    VarObject obj;
+    char name[64];
+    uint32_t r;
+
+    r = Random();
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.type = type;
+    if ( type == VARTYPE_UINT16 )
+    {
+        obj.len = sizeof( uint16_t );
+        obj.val.ui = r % 65536;
+    }
+    else if ( type == VARTYPE_UINT32 )
+    {
+        obj.len = sizeof( uint32_t );
+        obj.val.ul = r;
+    }
+    else
+    {
+        obj.len = sizeof( float );
+        obj.val.f = (float)( r % 2000 ) / 10.0 - 100.0;
+    }
+
+    snprintf( name,
+              sizeof( name ),
+              "/bench/random/%s/%s%u",
+              ( type == VARTYPE_UINT16 ) ? "u16"
+                : ( type == VARTYPE_UINT32 ) ? "u32" : "f",
+              output ? "out" : "in",
+              (unsigned)( ( r >> 16 ) % RANDOM_VARS ) );
+
+    return SysVar( hVarServer, name, &obj, output );
+}
+
+/*============================================================================*/
+/*  Random                                                                    */
+/*!
+    Get the next value from the random scenario generator
+
+    A xorshift generator is used rather than rand() so the scenario is
+    the same on every C library.
+
+@retval pseudo-random 32 bit value
+
+==============================================================================*/
+static uint32_t Random( void )
+{
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return randomState;
+}
+
+/*! @}
+ * end of varbench group */
@@ -29,6 +29,7 @@ SOFTWARE.
         Includes
 ==============================================================================*/
 
+#include <time.h>
 #include <varserver/varserver.h>
 
 /*==============================================================================
@@ -88,19 +89,153 @@ typedef enum {
     VA_OP_MAX
 } VarOperation;
 
+/*! evaluate the right operand of && and || only when it decides the result */
+#define VA_OPT_SHORT_CIRCUIT    ( 1 << 0 )
+
+/*! fetch all system variables read by a compound statement before it runs */
+#define VA_OPT_PREFETCH         ( 1 << 1 )
+
+/*! keep system variable values until a modified notification is received */
+#define VA_OPT_CACHE            ( 1 << 2 )
+
+/*! publish system variable writes once at the end of a compound statement */
+#define VA_OPT_DEFER_WRITES     ( 1 << 3 )
+
+/*! optimize variable trees as they are created */
+#define VA_OPT_OPTIMIZE         ( 1 << 4 )
+
+/*! record per-operation and per-statement evaluation statistics */
+#define VA_OPT_PROFILE          ( 1 << 5 )
+
+/*! manage timers with a timer wheel delivered through VarActionTimerFd()
+ *  instead of one POSIX timer and signal per timer */
+#define VA_OPT_TIMER_WHEEL      ( 1 << 6 )
+
+/*! record system variables by name while parsing, and look up all of
+ *  their handles together before they are first evaluated */
+#define VA_OPT_LAZY_RESOLVE     ( 1 << 7 )
+
+/*! run script statements in a bounded pool of child processes without
+ *  waiting for them to complete */
+#define VA_OPT_ASYNC_SCRIPTS    ( 1 << 8 )
+
+/*! record end-to-end action latency histograms */
+#define VA_OPT_LATENCY          ( 1 << 9 )
+
+/*! latency from a timer expiry to the end of the evaluation */
+#define VA_LATENCY_TIMER        ( 0 )
+
+/*! latency from a system variable change to the end of the evaluation */
+#define VA_LATENCY_CHANGE       ( 1 )
+
+/*! latency from an application trigger to the end of the evaluation */
+#define VA_LATENCY_EXTERNAL     ( 2 )
+
+/*! time from the start to the end of each outermost evaluation */
+#define VA_LATENCY_EVALUATION   ( 3 )
+
+/*! latency from a trigger to the start of the evaluation */
+#define VA_LATENCY_DISPATCH     ( 4 )
+
+/*! duration of each variable server get request */
+#define VA_LATENCY_GET          ( 5 )
+
+/*! duration of each variable server set request */
+#define VA_LATENCY_SET          ( 6 )
+
+/*! number of latency histograms */
+#define VA_LATENCY_MAX          ( 7 )
+
+/*! the variable node was allocated from an arena */
+#define VF_ARENA                ( 1 << 0 )
+
+/*! the string value was allocated from an arena */
+#define VF_ARENA_STR            ( 1 << 1 )
+
+/*! the string value is a heap buffer owned by the variable node */
+#define VF_HEAP_STR             ( 1 << 2 )
+
+/*! the string value is stored in the node's inline string buffer */
+#define VF_INLINE_STR           ( 1 << 3 )
+
+/*! the string value references storage owned by another node or by the
+ *  variable server, and is copied before it is modified */
+#define VF_BORROWED_STR         ( 1 << 4 )
+
+/*! the string value is an interned string constant, so it is equal to
+ *  another interned string only if they are the same pointer */
+#define VF_INTERNED_STR         ( 1 << 5 )
+
+/*! the node is a common subexpression referenced by more than one
+ *  parent, and is only evaluated when its inputs change */
+#define VF_SHARED               ( 1 << 6 )
+
+/*! the system variable is read from the shared value region */
+#define VF_SHM_VALUE            ( 1 << 7 )
+
+/*! size of the inline string buffer in a Variable node */
+#define VA_SSO_SIZE             ( 24 )
+
 /*! the Variable object is used to track values of external
- * variables and partial values within a calculation */
+ * variables and partial values within a calculation.
+ *
+ * The fields read while a tree is evaluated are at the start of the
+ * node, in its first 64 bytes, so evaluating a node touches as few
+ * cache lines as possible.  Naming, parsing, notification and string
+ * storage fields follow. */
 typedef struct _variable
 {
     /*! variable operation */
     int operation;
 
-    /*! line number */
-    int lineno;
+    /*! allocation flags (VF_ARENA, VF_ARENA_STR, VF_HEAP_STR,
+     *  VF_INLINE_STR, VF_BORROWED_STR, VF_INTERNED_STR, VF_SHARED,
+     *  VF_SHM_VALUE) */
+    uint8_t flags;
+
+    /*! indicates if the variable is an L-Value */
+    bool lvalue;
+
+    /*! true if obj holds a fetched system variable value which
+     *  does not need to be retrieved again by GetVar */
+    bool valid;
+
+    /*! true if a deferred write of this variable has not been published */
+    bool pending;
+
+    /*! type specialized operation function selected when the node was
+     *  created, or NULL to use the generic operation function */
+    int (*fn)( VARSERVER_HANDLE hVarServer,
+               struct _variable *pVariable,
+               struct _variable *pLeft,
+               struct _variable *pRight );
+
+    /*! variable object containing the variable type and value */
+    VarObject obj;
+
+    /*! pointer to the left hand side of the variable tree */
+    struct _variable *left;
+
+    /*! pointer to the right hand side of the variable tree */
+    struct _variable *right;
+
+    /*! handle to an external variable (may be NULL) */
+    VAR_HANDLE hVar;
+
+    /*! generation stamp used to de-duplicate variables while
+     *  collecting the system variables used by a statement list */
+    uint32_t mark;
+
+    /*! clock value when a VF_SHARED node was last evaluated, or when a
+     *  variable was last written within a compound statement */
+    uint64_t stamp;
 
     /*! pointer to the variable name (may be NULL) */
     char *id;
 
+    /*! line number */
+    int lineno;
+
     /*! indicate if the variable is local */
     bool local;
 
@@ -108,9 +243,6 @@ typedef struct _variable
      *  used to check for used-before-assigned errors */
     bool assigned;
 
-    /*! indicates if the variable is an L-Value */
-    bool lvalue;
-
     /*! true if we have requested a calc notification for this variable */
     bool calcNotification;
 
@@ -120,17 +252,11 @@ typedef struct _variable
     /*! buffer size (for string variables) */
     size_t bufsize;
 
-    /*! handle to an external variable (may be NULL) */
-    VAR_HANDLE hVar;
-
-    /*! variable object containing the variable type and value */
-    VarObject obj;
-
-    /*! pointer to the left hand side of the variable tree */
-    struct _variable *left;
+    /*! inline buffer for short string values */
+    char sso[VA_SSO_SIZE];
 
-    /*! pointer to the right hand side of the variable tree */
-    struct _variable *right;
+    /*! precompiled format plan of a VA_TOSTRING node (may be NULL) */
+    struct _formatPlan *pFormat;
 
     /*! pointer to the next variable in a declaration list */
     struct _variable *pNext;
@@ -153,6 +279,119 @@ typedef struct _statement
     struct _statement *pNext;
 } Statement;
 
+/*! compiled statement program */
+typedef struct _varProgram VarProgram;
+
+/*! arena allocator for parse tree nodes */
+typedef struct _varArena VarArena;
+
+/*! rule set loaded from a binary image */
+typedef struct _varImage VarImage;
+
+/*! evaluation context holding the symbol tables, timers and evaluation
+ *  state used to build and evaluate a set of statements */
+typedef struct _varActionContext VarActionContext;
+
+/*! parallel statement executor */
+typedef struct _varExecutor VarExecutor;
+
+/*! statement dependency schedule used by the parallel executor */
+typedef struct _varSchedule VarSchedule;
+
+/*! variable to statement dependency index used for incremental evaluation */
+typedef struct _varDependencies VarDependencies;
+
+/*! expression compiled for batch evaluation over many instances */
+typedef struct _varBatch VarBatch;
+
+/*! script running asynchronously in a child process */
+typedef struct _varScript VarScript;
+
+/*! one generation of a rule set: its context, arena, statements and
+ *  compiled program */
+typedef struct _varRuleSet VarRuleSet;
+
+/*! publication point for the active rule set.  A thread inside
+ *  VarActionEnterRules() for it, including one running
+ *  VarActionEvaluateRules(), cannot publish to it: doing so fails
+ *  with EDEADLK */
+typedef struct _varActiveRules VarActiveRules;
+
+/*! evaluation profile statistics */
+typedef struct _varProfileStats
+{
+    /*! number of evaluations */
+    uint64_t calls;
+
+    /*! cumulative evaluation time in nanoseconds */
+    uint64_t totalns;
+
+    /*! maximum evaluation time in nanoseconds */
+    uint64_t maxns;
+
+    /*! number of variable server get requests */
+    uint64_t gets;
+
+    /*! number of variable server set requests */
+    uint64_t sets;
+
+} VarProfileStats;
+
+/*! latency histogram summary.  Percentiles are the upper bound of the
+ *  histogram bucket which contains them, within 1/16 of the value */
+typedef struct _varLatencyStats
+{
+    /*! number of measurements */
+    uint64_t count;
+
+    /*! minimum latency in nanoseconds */
+    uint64_t minns;
+
+    /*! mean latency in nanoseconds */
+    uint64_t meanns;
+
+    /*! median latency in nanoseconds */
+    uint64_t p50ns;
+
+    /*! 90th percentile latency in nanoseconds */
+    uint64_t p90ns;
+
+    /*! 99th percentile latency in nanoseconds */
+    uint64_t p99ns;
+
+    /*! 99.9th percentile latency in nanoseconds */
+    uint64_t p999ns;
+
+    /*! maximum latency in nanoseconds */
+    uint64_t maxns;
+
+} VarLatencyStats;
+
+/*! multi-variable get function used to prefetch system variables.
+ *  Gets the values of n variables into the specified objects and returns
+ *  EOK if all of the variables were retrieved */
+typedef int (*VarBatchGetFn)( VARSERVER_HANDLE hVarServer,
+                              VAR_HANDLE *phVars,
+                              VarObject **ppObjs,
+                              size_t n );
+
+/*! multi-variable find function used to resolve system variable names.
+ *  Looks up the handles of n variables, setting the handle of each
+ *  variable which was not found to VAR_INVALID, and returns EOK if the
+ *  request was completed */
+typedef int (*VarBatchFindFn)( VARSERVER_HANDLE hVarServer,
+                               char **ppNames,
+                               VAR_HANDLE *phVars,
+                               size_t n );
+
+/*! multi-variable set function used to publish deferred writes.
+ *  Sets the values of n variables from the specified objects and returns
+ *  EOK if all of the variables were set */
+typedef int (*VarBatchSetFn)( VARSERVER_HANDLE hVarServer,
+                              VAR_HANDLE *phVars,
+                              VarObject **ppObjs,
+                              size_t n );
+
 /*==============================================================================
         Public Function Declarations
 ==============================================================================*/
@@ -188,5 +427,119 @@ Variable *FindVariable( char *id );
 void SetDeclarations( Variable *pVariable );
 
 void SetTimer( int id );
+int VarActionTimerFd( void );
+int VarActionNextTimer( uint16_t *pId );
+int VarActionBindTimer( uint16_t id, Statement *pStatements );
+int VarActionDispatchPending( VARSERVER_HANDLE hVarServer );
+
+void VarActionSetOptions( uint32_t options );
+uint32_t VarActionGetOptions( void );
+
+void VarActionSetBatchGet( VarBatchGetFn fn );
+int PrefetchStatements( VARSERVER_HANDLE hVarServer, Statement *pStatements );
+void ReleasePrefetch( void );
+
+int VarActionEnableCache( VARSERVER_HANDLE hVarServer );
+void VarActionDisableCache( void );
+void VarActionNotifyModified( VAR_HANDLE hVar );
+
+void VarActionSetBatchSet( VarBatchSetFn fn );
+
+void VarActionSetBatchFind( VarBatchFindFn fn );
+int ResolveAll( VARSERVER_HANDLE hVarServer, Statement *pStatements );
+
+VarProgram *CompileStatement( Statement *pStatements );
+int ExecProgram( VARSERVER_HANDLE hVarServer, VarProgram *pProgram );
+void FreeProgram( VarProgram *pProgram );
+void VarActionSetJitThreshold( uint32_t count );
+
+VarArena *VarActionCreateArena( size_t blocksize );
+VarArena *VarActionSetArena( VarArena *pArena );
+void *VarActionArenaAlloc( VarArena *pArena, size_t size );
+void VarActionFreeArena( VarArena *pArena );
+
+int VarActionSaveImage( Statement *pStatements, const char *path );
+VarImage *VarActionLoadImage( VARSERVER_HANDLE hVarServer, const char *path );
+Statement *VarActionImageStatements( VarImage *pImage );
+void VarActionFreeImage( VarImage *pImage );
+
+Variable *OptimizeVariable( Variable *pVariable );
+
+int VarActionGetOperationProfile( int op, VarProfileStats *pStats );
+int VarActionGetStatementProfile( int lineno, VarProfileStats *pStats );
+void VarActionResetProfile( void );
+int VarActionPrintProfile( int fd );
+
+int VarActionTrigger( int source, const struct timespec *pWhen );
+int VarActionGetLatency( int id, VarLatencyStats *pStats );
+int VarActionGetStatementLatency( int lineno, VarLatencyStats *pStats );
+void VarActionResetLatency( void );
+int VarActionPrintLatency( int fd );
+int VarActionExportLatency( VARSERVER_HANDLE hVarServer, const char *prefix );
+int VarActionSetLatencyExport( VARSERVER_HANDLE hVarServer,
+                               const char *prefix,
+                               uint32_t intervalms );
+
+VarActionContext *VarActionCreateContext( void );
+VarActionContext *VarActionSetContext( VarActionContext *pContext );
+void VarActionFreeContext( VarActionContext *pContext );
+int ProcessCompoundStatementCtx( VarActionContext *pContext,
+                                 VARSERVER_HANDLE hVarServer,
+                                 Statement *pStatements );
+int ExecProgramCtx( VarActionContext *pContext,
+                    VARSERVER_HANDLE hVarServer,
+                    VarProgram *pProgram );
+
+VarExecutor *VarActionCreateExecutor( size_t nThreads );
+void VarActionFreeExecutor( VarExecutor *pExecutor );
+VarSchedule *VarActionCreateSchedule( Statement *pStatements );
+void VarActionFreeSchedule( VarSchedule *pSchedule );
+int VarActionExecute( VarExecutor *pExecutor,
+                      VARSERVER_HANDLE hVarServer,
+                      VarSchedule *pSchedule );
+
+VarDependencies *VarActionCreateDependencies( Statement *pStatements );
+void VarActionFreeDependencies( VarDependencies *pDeps );
+int VarActionMarkChanged( VarDependencies *pDeps, VAR_HANDLE hVar );
+int VarActionEvaluateChanged( VARSERVER_HANDLE hVarServer,
+                              VarDependencies *pDeps );
+int VarActionOnChanged( VARSERVER_HANDLE hVarServer,
+                        VarDependencies *pDeps,
+                        VAR_HANDLE hVar );
+
+int VarActionShareExpressions( Statement *pStatements );
+
+VarBatch *VarActionCreateBatch( Variable *pExpression, size_t lanes );
+int VarActionSetBatchInput( VarBatch *pBatch,
+                            Variable *pVariable,
+                            const void *pValues );
+int VarActionExecuteBatch( VarBatch *pBatch, size_t n );
+const void *VarActionBatchResult( VarBatch *pBatch, VarType *pType );
+const uint8_t *VarActionBatchMask( VarBatch *pBatch );
+void VarActionFreeBatch( VarBatch *pBatch );
+
+VarScript *VarActionRunScript( const char *script );
+int VarActionScriptStatus( VarScript *pScript, int *pStatus );
+int VarActionWaitScript( VarScript *pScript, int *pStatus );
+void VarActionFreeScript( VarScript *pScript );
+int VarActionSetScriptPool( size_t size );
+void VarActionWaitScripts( void );
+
+VarRuleSet *VarActionCreateRuleSet( VarActionContext *pContext,
+                                    VarArena *pArena,
+                                    Statement *pStatements );
+void VarActionFreeRuleSet( VarRuleSet *pRuleSet );
+Statement *VarActionRuleSetStatements( VarRuleSet *pRuleSet );
+VarActionContext *VarActionRuleSetContext( VarRuleSet *pRuleSet );
+VarActiveRules *VarActionCreateActiveRules( VarRuleSet *pRuleSet );
+void VarActionFreeActiveRules( VarActiveRules *pActive );
+int VarActionPublishRuleSet( VarActiveRules *pActive, VarRuleSet *pRuleSet );
+VarRuleSet *VarActionEnterRules( VarActiveRules *pActive, int *pToken );
+void VarActionLeaveRules( VarActiveRules *pActive, int token );
+int VarActionEvaluateRules( VarActiveRules *pActive,
+                            VARSERVER_HANDLE hVarServer );
+
+int VarActionAttachValues( const char *name );
+void VarActionDetachValues( void );
 
 #endif
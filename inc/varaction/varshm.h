@@ -0,0 +1,125 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+
+#ifndef VARSHM_H
+#define VARSHM_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*============================================================================
+        Definitions
+============================================================================*/
+
+/*! shared value region identifier ("VSHM") */
+#define VARSHM_MAGIC            ( 0x4D485356u )
+
+/*! shared value region layout version */
+#define VARSHM_VERSION          ( 1 )
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! shared value region header, at offset zero of the region */
+typedef struct _varShmHeader
+{
+    /*! VARSHM_MAGIC */
+    uint32_t magic;
+
+    /*! VARSHM_VERSION */
+    uint32_t version;
+
+    /*! number of slots following the header */
+    uint32_t count;
+
+    /*! size of each slot in bytes */
+    uint32_t slotsize;
+
+} VarShmHeader;
+
+/*! shared value slot for one system variable.  Slot n holds the value
+ *  of the variable with handle n.  The sequence number is odd while
+ *  the slot is being written, and the type of a slot which does not
+ *  hold a numeric value is VARTYPE_INVALID */
+typedef struct _varShmSlot
+{
+    /*! sequence number, incremented before and after each write */
+    atomic_uint_least32_t seq;
+
+    /*! variable type (VARTYPE_UINT16, VARTYPE_UINT32 or VARTYPE_FLOAT) */
+    atomic_uint_least32_t type;
+
+    /*! value bits: the uint16 or uint32 value, or the float bit pattern */
+    atomic_uint_least32_t value;
+
+    /*! reserved, set to zero */
+    uint32_t reserved;
+
+} VarShmSlot;
+
+/*============================================================================
+        Inline Functions
+============================================================================*/
+
+/*============================================================================*/
+/*  VarShmWrite                                                               */
+/*!
+    Write a value to a shared value slot
+
+    The VarShmWrite function is used by the variable server to publish
+    a value.  Only one writer may update a slot at a time.
+
+@param[in]
+    pSlot
+        pointer to the slot to write
+
+@param[in]
+    type
+        variable type of the value
+
+@param[in]
+    value
+        value bits
+
+==============================================================================*/
+static inline void VarShmWrite( VarShmSlot *pSlot,
+                                uint32_t type,
+                                uint32_t value )
+{
+    uint32_t seq = atomic_load_explicit( &pSlot->seq, memory_order_relaxed );
+
+    atomic_store_explicit( &pSlot->seq, seq + 1, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    atomic_store_explicit( &pSlot->type, type, memory_order_relaxed );
+    atomic_store_explicit( &pSlot->value, value, memory_order_relaxed );
+    atomic_store_explicit( &pSlot->seq, seq + 2, memory_order_release );
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARCONTEXT_H
+#define VARCONTEXT_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <varaction/varaction.h>
+#include "varsymtab.h"
+#include "varintern.h"
+#include "varprefetch.h"
+#include "vartimerwheel.h"
+
+/*============================================================================
+        Definitions
+============================================================================*/
+
+/*! Maximum number of timers allowed */
+#define MAX_TIMERS ( 255 )
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! evaluation context.  Holds all of the mutable state used to build
+ *  and evaluate a set of statements so independent contexts can be
+ *  evaluated concurrently on different threads */
+struct _varActionContext
+{
+    /*! local variable declarations */
+    Variable *pDeclarations;
+
+    /*! first system variable referenced in this context */
+    Variable *pFirstSysvar;
+
+    /*! last system variable referenced in this context */
+    Variable *pLastSysvar;
+
+    /*! local variable index */
+    SymbolTable locals;
+
+    /*! declaration list indexed in the local variable index */
+    Variable *pIndexedDeclarations;
+
+    /*! last declaration added to the local variable index */
+    Variable *pLastIndexed;
+
+    /*! system variable index by name */
+    SymbolTable sysvars;
+
+    /*! system variable index by handle */
+    SymbolTable handles;
+
+    /*! number of system variables which do not have a handle: those
+     *  created since handles were last resolved, and those which could
+     *  not be found */
+    size_t unresolved;
+
+    /*! number of system variables which could not be found when
+     *  handles were last resolved */
+    size_t failed;
+
+    /*! monotonic time in nanoseconds after which system variables
+     *  which could not be found are looked up again */
+    uint64_t retryns;
+
+    /*! interned string constants */
+    InternTable strings;
+
+    /*! evaluation options */
+    uint32_t options;
+
+    /*! compound statement nesting depth */
+    int depth;
+
+    /*! shared expression clock, advanced at the start of each outermost
+     *  compound statement and by each variable write */
+    uint64_t clock;
+
+    /*! clock value at the start of the outermost compound statement, or
+     *  zero if shared expression values are not being reused */
+    uint64_t epoch;
+
+    /*! arena used to allocate parse tree nodes */
+    VarArena *pArena;
+
+    /*! prefetch generation counter */
+    uint32_t generation;
+
+    /*! system variables prefetched for the outermost compound statement */
+    SysvarList prefetch;
+
+    /*! list of the system variables prefetched for the current
+     *  evaluation, or NULL if none were prefetched */
+    SysvarList *pPrefetched;
+
+    /*! true if system variable writes are being deferred */
+    bool defer;
+
+    /*! system variables with unpublished deferred writes */
+    SysvarList writes;
+
+    /*! per-operation profile statistics */
+    VarProfileStats operations[VA_OP_MAX];
+
+    /*! per-statement profile statistics indexed by line number */
+    VarProfileStats *pStatements;
+
+    /*! number of per-statement profile entries allocated */
+    size_t nStatements;
+
+    /*! variable server get requests since the last profile mark */
+    uint64_t gets;
+
+    /*! variable server set requests since the last profile mark */
+    uint64_t sets;
+
+    /*! monotonic time of the pending latency trigger in nanoseconds,
+     *  or zero if there is no pending trigger */
+    uint64_t triggerns;
+
+    /*! latency histogram of the pending trigger source */
+    int trigger;
+
+    /*! monotonic time at the start of the outermost evaluation in
+     *  nanoseconds, or zero if its latency is not being recorded */
+    uint64_t startns;
+
+    /*! array of timers */
+    timer_t timers[MAX_TIMERS];
+
+    /*! the currently active (fired) timer */
+    uint16_t activeTimer;
+
+    /*! timer wheel used when VA_OPT_TIMER_WHEEL is set (may be NULL) */
+    TimerWheel *pWheel;
+
+    /*! statement lists bound to each timer identifier */
+    Statement **ppTimerActions;
+
+    /*! number of timer identifiers in ppTimerActions */
+    size_t nTimerActions;
+};
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+VarActionContext *GetContext( void );
+
+#endif
@@ -0,0 +1,127 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+
+#ifndef VARFORMAT_H
+#define VARFORMAT_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Definitions
+============================================================================*/
+
+/*! maximum length of a normalized conversion specification */
+#define FORMAT_SPEC_SIZE    ( 32 )
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! argument class of a conversion specification */
+typedef enum _formatClass
+{
+    /*! the format has no conversion specification */
+    FORMAT_NONE,
+
+    /*! no format was specified: %d for integers and %f for floats */
+    FORMAT_DEFAULT,
+
+    /*! signed integer conversion (d, i, c) */
+    FORMAT_SIGNED,
+
+    /*! unsigned integer conversion (o, u, x, X) */
+    FORMAT_UNSIGNED,
+
+    /*! floating point conversion (f, F, e, E, g, G, a, A) */
+    FORMAT_FLOAT
+
+} FormatClass;
+
+/*! precompiled format plan.  A format string is split into the literal
+ *  text before and after its single conversion specification, with %%
+ *  escapes already resolved, so the literal text is copied rather than
+ *  parsed on every conversion */
+struct _formatPlan
+{
+    /*! the format string the plan was compiled from */
+    const char *pFormat;
+
+    /*! copy of the format string, used to detect a changed format */
+    char *source;
+
+    /*! literal text before the conversion */
+    char *prefix;
+
+    /*! length of the literal text before the conversion */
+    size_t prefixLen;
+
+    /*! literal text after the conversion */
+    char *suffix;
+
+    /*! length of the literal text after the conversion */
+    size_t suffixLen;
+
+    /*! normalized conversion specification passed to snprintf() */
+    char spec[FORMAT_SPEC_SIZE];
+
+    /*! argument class of the conversion */
+    FormatClass cls;
+
+    /*! true if the conversion takes a long long argument */
+    bool wide;
+
+    /*! true if the conversion is a plain %d, %i, %u or %f which is
+     *  formatted without snprintf() */
+    bool fast;
+};
+
+/*! precompiled format plan */
+typedef struct _formatPlan FormatPlan;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+int CompileFormat( const char *pFormat, FormatPlan **ppPlan );
+
+void FreeFormat( FormatPlan *pPlan );
+
+void PrepareFormat( Variable *pVariable );
+
+int GetFormat( Variable *pResult,
+               Variable *pRight,
+               const FormatPlan **ppPlan );
+
+int FormatValue( const FormatPlan *pPlan,
+                 Variable *pResult,
+                 VarObject *pValue );
+
+#endif
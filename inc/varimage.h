@@ -0,0 +1,151 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+
+#ifndef VARIMAGE_H
+#define VARIMAGE_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Definitions
+============================================================================*/
+
+/*! image file magic number ("VAIM" in a little endian file) */
+#define VA_IMAGE_MAGIC          ( 0x4D494156u )
+
+/*! image file format version */
+#define VA_IMAGE_VERSION        ( 1 )
+
+/*! the node is a local variable */
+#define VA_IMAGE_LOCAL          ( 1 << 0 )
+
+/*! the node is an l-value */
+#define VA_IMAGE_LVALUE         ( 1 << 1 )
+
+/*! the local variable has been assigned */
+#define VA_IMAGE_ASSIGNED       ( 1 << 2 )
+
+/*! the left and right references of the node are statement lists */
+#define VA_IMAGE_BLOCKS         ( 1 << 3 )
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! image file header.  All offsets are from the start of the file, and
+ *  all references are indexes plus one, with zero for none, so the
+ *  image does not depend on where it is loaded */
+typedef struct _imageHeader
+{
+    /*! VA_IMAGE_MAGIC */
+    uint32_t magic;
+
+    /*! VA_IMAGE_VERSION */
+    uint32_t version;
+
+    /*! total size of the image */
+    uint32_t size;
+
+    /*! reference to the first statement of the rule set */
+    uint32_t root;
+
+    /*! number of node records */
+    uint32_t nNodes;
+
+    /*! offset of the node records */
+    uint32_t nodes;
+
+    /*! number of statement records */
+    uint32_t nStatements;
+
+    /*! offset of the statement records */
+    uint32_t statements;
+
+    /*! size of the string table */
+    uint32_t stringsSize;
+
+    /*! offset of the string table */
+    uint32_t strings;
+
+} ImageHeader;
+
+/*! image node record.  A node only refers to nodes before it, so the
+ *  nodes are rebuilt in a single forward pass */
+typedef struct _imageNode
+{
+    /*! variable operation */
+    uint16_t operation;
+
+    /*! variable type */
+    uint8_t type;
+
+    /*! VA_IMAGE_xxx attributes */
+    uint8_t attributes;
+
+    /*! line number */
+    int32_t lineno;
+
+    /*! reference to the identifier in the string table */
+    uint32_t id;
+
+    /*! reference to the left node, or statement list for VA_IMAGE_BLOCKS */
+    uint32_t left;
+
+    /*! reference to the right node, or statement list for VA_IMAGE_BLOCKS */
+    uint32_t right;
+
+    /*! constant value, or string table reference for string constants */
+    uint32_t value;
+
+    /*! length of the constant value */
+    uint32_t len;
+
+} ImageNode;
+
+/*! image statement record.  The statements of a list are consecutive,
+ *  and a statement only refers to later statements, through its next
+ *  reference and the IF blocks of its tree */
+typedef struct _imageStatement
+{
+    /*! reference to the root node of the statement */
+    uint32_t node;
+
+    /*! reference to the script in the string table */
+    uint32_t script;
+
+    /*! line number */
+    int32_t lineno;
+
+    /*! reference to the next statement in the list */
+    uint32_t next;
+
+} ImageStatement;
+
+#endif
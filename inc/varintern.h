@@ -0,0 +1,76 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+
+#ifndef VARINTERN_H
+#define VARINTERN_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! interned string */
+typedef struct _internEntry
+{
+    /*! hash of the string */
+    uint32_t hash;
+
+    /*! length of the string */
+    size_t len;
+
+    /*! pointer to the interned copy of the string (NULL if unused) */
+    char *str;
+
+} InternEntry;
+
+/*! open addressed table of interned string constants */
+typedef struct _internTable
+{
+    /*! pointer to the entry array */
+    InternEntry *pEntries;
+
+    /*! number of entries allocated (zero or a power of 2) */
+    size_t size;
+
+    /*! number of entries in use */
+    size_t n;
+
+} InternTable;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+char *InternString( InternTable *pTable, const char *str, size_t len );
+
+void ClearStrings( InternTable *pTable );
+
+#endif
@@ -0,0 +1,75 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VAROPS_H
+#define VAROPS_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! operation function */
+typedef int (*opfn)( VARSERVER_HANDLE hVarServer,
+                     Variable *pVariable,
+                     Variable *pLeft,
+                     Variable *pRight );
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+opfn GetOperation( int op );
+
+char *GetOperationName( int op );
+
+bool ShortCircuit( Variable *pVariable, Variable *pLeft );
+
+bool EnterCompound( void );
+
+void LeaveCompound( void );
+
+int ResultType( Variable *pVariable );
+
+Variable *OptimizeNode( Variable *pVariable );
+
+void RegisterSysvar( Variable *pVariable );
+
+Variable *CreateSysvar( VARSERVER_HANDLE hVarServer,
+                        const char *id,
+                        VAR_HANDLE hVar,
+                        int type );
+
+Variable *FindHandleVariable( VAR_HANDLE hVar );
+
+void SetSysvarHandle( VARSERVER_HANDLE hVarServer,
+                      Variable *pVariable,
+                      VAR_HANDLE hVar );
+
+#endif
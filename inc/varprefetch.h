@@ -0,0 +1,78 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARPREFETCH_H
+#define VARPREFETCH_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! list of distinct system variables */
+typedef struct _sysvarList
+{
+    /*! pointer to the array of system variables */
+    Variable **ppVars;
+
+    /*! number of variables in the list */
+    size_t n;
+
+    /*! number of variable pointers allocated */
+    size_t size;
+
+    /*! handle array passed to the batch get function */
+    VAR_HANDLE *phVars;
+
+    /*! object array passed to the batch get function */
+    VarObject **ppObjs;
+
+} SysvarList;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+int CollectSysvars( Statement *pStatements, SysvarList *pList );
+
+int CollectSysvarsFromVariable( Variable *pVariable, SysvarList *pList );
+
+void ResetSysvars( SysvarList *pList );
+
+int FetchSysvars( VARSERVER_HANDLE hVarServer, SysvarList *pList );
+
+void ReleaseSysvars( SysvarList *pList );
+
+int RefetchSysvars( VARSERVER_HANDLE hVarServer );
+
+void FreeSysvars( SysvarList *pList );
+
+int AddSysvar( SysvarList *pList, Variable *pVariable );
+
+#endif
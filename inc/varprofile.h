@@ -0,0 +1,70 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARPROFILE_H
+#define VARPROFILE_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stdint.h>
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! snapshot of the clock and request counters taken when a
+ *  profiled operation or statement starts */
+typedef struct _profileMark
+{
+    /*! monotonic time in nanoseconds */
+    uint64_t ns;
+
+    /*! number of variable server get requests */
+    uint64_t gets;
+
+    /*! number of variable server set requests */
+    uint64_t sets;
+
+} ProfileMark;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+void ProfileStart( ProfileMark *pMark );
+
+void ProfileOperation( int op, ProfileMark *pMark );
+
+void ProfileStatement( int lineno, ProfileMark *pMark );
+
+void ProfileGets( size_t n );
+
+void ProfileSets( size_t n );
+
+void ProfileMerge( VarActionContext *pContext, VarActionContext *pSource );
+
+#endif
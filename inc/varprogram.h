@@ -0,0 +1,179 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARPROGRAM_H
+#define VARPROGRAM_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <varaction/varaction.h>
+#include "varops.h"
+#include "varprefetch.h"
+#include "varswitch.h"
+
+/*============================================================================
+        Definitions
+============================================================================*/
+
+/*! instruction result is the result of a statement */
+#define VI_ROOT                 ( 1 << 0 )
+
+/*! instruction result is the condition of an IF statement */
+#define VI_COND                 ( 1 << 1 )
+
+/*! register zero always refers to a NULL operand */
+#define VP_NOREG                ( 0 )
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! program instruction opcodes */
+typedef enum _varOpcode
+{
+    VP_END = 0,
+    VP_CALL,
+    VP_JMP,
+    VP_JMPF,
+    VP_SWITCH,
+    VP_STATEMENT,
+    VP_SCRIPT,
+    VP_AND_SC,
+    VP_OR_SC,
+    VP_ASSIGN_U16,
+    VP_ASSIGN_U32,
+    VP_ASSIGN_F,
+    VP_ADD_U16,
+    VP_ADD_U32,
+    VP_ADD_F,
+    VP_SUB_U16,
+    VP_SUB_U32,
+    VP_SUB_F,
+    VP_MUL_U16,
+    VP_MUL_U32,
+    VP_MUL_F,
+    VP_BAND_U16,
+    VP_BAND_U32,
+    VP_BOR_U16,
+    VP_BOR_U32,
+    VP_XOR_U16,
+    VP_XOR_U32,
+    VP_EQ_U16,
+    VP_EQ_U32,
+    VP_EQ_F,
+    VP_GT_U16,
+    VP_GT_U32,
+    VP_GT_F,
+    VP_LT_U16,
+    VP_LT_U32,
+    VP_LT_F,
+    VP_GTE_U16,
+    VP_GTE_U32,
+    VP_GTE_F,
+    VP_LTE_U16,
+    VP_LTE_U32,
+    VP_LTE_F,
+    VP_OPCODE_MAX
+} VarOpcode;
+
+/*! program instruction */
+typedef struct _varInstruction
+{
+    /*! instruction opcode */
+    uint16_t opcode;
+
+    /*! variable operation this instruction was compiled from */
+    uint16_t operation;
+
+    /*! instruction flags */
+    uint32_t flags;
+
+    /*! result register */
+    uint32_t dst;
+
+    /*! left operand register */
+    uint32_t a;
+
+    /*! right operand register, or the dispatch table index of a
+     *  VP_SWITCH instruction */
+    uint32_t b;
+
+    /*! jump target (instruction index) */
+    uint32_t target;
+
+    /*! operation function for VP_CALL instructions */
+    opfn fn;
+
+    /*! statement for VP_STATEMENT and VP_SCRIPT instructions */
+    Statement *pStatement;
+
+} VarInstruction;
+
+/*! compiled program */
+struct _varProgram
+{
+    /*! pointer to the instruction array */
+    VarInstruction *pCode;
+
+    /*! number of instructions in the program */
+    size_t ncode;
+
+    /*! number of instructions allocated */
+    size_t codesize;
+
+    /*! pointer to the register array */
+    Variable **pRegs;
+
+    /*! number of registers in use */
+    size_t nregs;
+
+    /*! number of registers allocated */
+    size_t regsize;
+
+    /*! dispatch tables referenced by VP_SWITCH instructions */
+    VarSwitch **ppSwitches;
+
+    /*! number of dispatch tables */
+    size_t nswitches;
+
+    /*! system variables read by the program */
+    SysvarList sysvars;
+
+    /*! number of times the program has been executed, up to the
+     *  native code threshold */
+    uint32_t runs;
+
+    /*! native code compiled from the program (may be NULL) */
+    struct _varJitCode *pNative;
+};
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+void ReportProgramError( VarInstruction *pInstruction, int rc );
+
+#endif
@@ -37,6 +37,14 @@ SOFTWARE.
 
 int AllocateString( Variable *pVariable, size_t len );
 
+void ShareString( Variable *pResult, Variable *pSource );
+
+void ReferenceString( Variable *pVariable );
+
+void ReleaseString( Variable *pVariable );
+
+int CompareStrings( Variable *pLeft, Variable *pRight, bool equality );
+
 int AssignString( Variable *pResult,
                   Variable *pLeft,
                   Variable *pRight );
@@ -0,0 +1,102 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+
+#ifndef VARSWITCH_H
+#define VARSWITCH_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! one case of an IF/ELSE chain compiled into a dispatch table */
+typedef struct _varCase
+{
+    /*! VA_EQUALS node of the case's IF condition */
+    Variable *pCond;
+
+    /*! constant compared against the switch variable */
+    Variable *pConst;
+
+    /*! statements run when the case matches */
+    Statement *pBlock;
+
+} VarCase;
+
+/*! IF/ELSE chain compiled into a dispatch table */
+typedef struct _varSwitch
+{
+    /*! variable compared by every case */
+    Variable *pVariable;
+
+    /*! cases in the order they appear in the chain */
+    VarCase *pCases;
+
+    /*! number of cases */
+    size_t ncases;
+
+    /*! statements run when no case matches (may be NULL) */
+    Statement *pDefault;
+
+    /*! true for string constants, false for integer constants */
+    bool strings;
+
+    /*! smallest integer constant */
+    uint32_t base;
+
+    /*! hash seed for string constants */
+    uint32_t seed;
+
+    /*! number of table slots */
+    uint32_t size;
+
+    /*! table of case number plus one for each slot, or zero for none */
+    uint32_t *pSlots;
+
+    /*! instruction index for each case, then the default block, then
+     *  the end of the chain */
+    uint32_t *pTargets;
+
+    /*! native code address for each entry of pTargets (may be NULL) */
+    void **ppNative;
+
+} VarSwitch;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+VarSwitch *NewSwitch( Variable *pVariable );
+
+size_t SelectCase( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch );
+
+void FreeSwitch( VarSwitch *pSwitch );
+
+#endif
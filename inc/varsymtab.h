@@ -0,0 +1,82 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARSYMTAB_H
+#define VARSYMTAB_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <varaction/varaction.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! symbol table entry */
+typedef struct _symbolEntry
+{
+    /*! hash of the entry key */
+    uint32_t hash;
+
+    /*! pointer to the variable (NULL if the entry is unused) */
+    Variable *pVariable;
+
+} SymbolEntry;
+
+/*! open addressed hash index of variables by name or by handle */
+typedef struct _symbolTable
+{
+    /*! pointer to the entry array */
+    SymbolEntry *pEntries;
+
+    /*! number of entries allocated (zero or a power of 2) */
+    size_t size;
+
+    /*! number of entries in use */
+    size_t n;
+
+    /*! true if an insertion failed, so the table is not a complete index */
+    bool incomplete;
+
+} SymbolTable;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+uint32_t HashIdentifier( const char *id );
+
+int AddSymbol( SymbolTable *pTable, Variable *pVariable );
+
+Variable *FindSymbol( SymbolTable *pTable, const char *id );
+
+int AddHandle( SymbolTable *pTable, Variable *pVariable );
+
+Variable *FindHandle( SymbolTable *pTable, VAR_HANDLE hVar );
+
+void ClearSymbols( SymbolTable *pTable );
+
+#endif
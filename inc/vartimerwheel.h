@@ -0,0 +1,66 @@
+/*============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+============================================================================*/
+
+#ifndef VARTIMERWHEEL_H
+#define VARTIMERWHEEL_H
+
+/*============================================================================
+        Includes
+============================================================================*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*============================================================================
+        Type Definitions
+============================================================================*/
+
+/*! hierarchical timer wheel */
+typedef struct _timerWheel TimerWheel;
+
+/*============================================================================
+        Public Function Declarations
+============================================================================*/
+
+TimerWheel *CreateTimerWheel( void );
+
+void FreeTimerWheel( TimerWheel *pWheel );
+
+int ArmWheelTimer( TimerWheel *pWheel,
+                   uint16_t id,
+                   uint32_t timeoutms,
+                   bool periodic );
+
+int CancelWheelTimer( TimerWheel *pWheel, uint16_t id );
+
+int NextWheelTimer( TimerWheel *pWheel, uint16_t *pId );
+
+size_t PollWheel( TimerWheel *pWheel );
+
+int PopWheelTimer( TimerWheel *pWheel, uint16_t *pId );
+
+int GetWheelFd( TimerWheel *pWheel );
+
+#endif
@@ -37,7 +37,6 @@ SOFTWARE.
     The Variable Action Script Support functions provide functions
     for embedding var/action scripts into other applications.
 
-
 */
 /*============================================================================*/
 
@@ -56,21 +55,26 @@ SOFTWARE.
 #include <syslog.h>
 #include <varaction/varaction.h>
 #include "varassign.h"
+#include "varstrings.h"
+#include "varformat.h"
 #include "varbitwise.h"
 #include "varboolean.h"
 #include "varcompare.h"
 #include "varmath.h"
 #include "vartypecast.h"
 #include "vartimer.h"
-
-/*==============================================================================
-       Type defintions
-==============================================================================*/
-
-typedef int (*opfn)( VARSERVER_HANDLE hVarServer, \
-                     Variable *pVariable, \
-                     Variable *pLeft, \
-                     Variable *pRight );
+#include "varops.h"
+#include "varprefetch.h"
+#include "varresolve.h"
+#include "varwrite.h"
+#include "varsymtab.h"
+#include "vararena.h"
+#include "varspecial.h"
+#include "varprofile.h"
+#include "varcontext.h"
+#include "varcse.h"
+#include "varvalues.h"
+#include "varlatency.h"
 
 /*==============================================================================
        File Scoped Variables
@@ -79,13 +83,6 @@ typedef int (*opfn)( VARSERVER_HANDLE hVarServer, \
 /*! operation map maps operation identifiers to their functions */
 static opfn va_op[VA_OP_MAX] = {};
 
-/*! pointer to the declaration list for the current action */
-static Variable *g_pDeclarations = NULL;
-
-/*! pointer to all system variables used across all actions */
-static Variable *g_pFirstSysvar = NULL;
-static Variable *g_pLastSysvar = NULL;
-
 static char *opname[] = {
     "Illegal",
     "Assign",
@@ -156,6 +153,10 @@ static int Unsupported( VARSERVER_HANDLE hVarServer,
                         Variable *pLeft,
                         Variable *pRight );
 
+static int CacheVariable( VARSERVER_HANDLE hVarServer, Variable *pVariable );
+
+static void IndexDeclarations( void );
+
 /*==============================================================================
        Function definitions
 ==============================================================================*/
@@ -210,7 +211,7 @@ void InitVarAction( void )
     va_op[VA_GTE] = GreaterThanOrEqual;
     va_op[VA_LTE] = LessThanOrEqual;
     va_op[VA_AND_EQUALS] = AndEquals;
-    va_op[VA_OR_EQUALS] = AndEquals;
+    va_op[VA_OR_EQUALS] = OrEquals;
     va_op[VA_XOR_EQUALS] = XorEquals;
     va_op[VA_DIV_EQUALS] = DivEquals;
     va_op[VA_TIMES_EQUALS] = TimesEquals;
@@ -256,14 +257,37 @@ void InitVarAction( void )
 int ProcessCompoundStatement( VARSERVER_HANDLE hVarServer,
                               Statement *pStatements )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     Statement *pStatement;
     int rc;
+    bool outer;
+    bool prefetch;
+    bool defer;
 
     if ( ( hVarServer != NULL ) &&
          ( pStatements != NULL ) )
     {
         result = EOK;
+
+        /* look up system variables recorded since the last resolution */
+        ResolvePending( hVarServer, pStatements );
+
+        outer = EnterCompound();
+        prefetch = outer && ( pContext->options & VA_OPT_PREFETCH );
+        if ( prefetch == true )
+        {
+            /* variables which cannot be prefetched are retrieved
+             * (and their errors reported) when they are used */
+            (void)PrefetchStatements( hVarServer, pStatements );
+        }
+
+        defer = outer && ( pContext->options & VA_OPT_DEFER_WRITES );
+        if ( defer == true )
+        {
+            BeginWrites();
+        }
+
         pStatement = pStatements;
         while( pStatement != NULL )
         {
@@ -275,6 +299,25 @@ int ProcessCompoundStatement( VARSERVER_HANDLE hVarServer,
 
             pStatement = pStatement->pNext;
         }
+
+        LeaveCompound();
+
+        if ( defer == true )
+        {
+            rc = FlushWrites( hVarServer );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+
+        /* the evaluation is complete once its writes are published */
+        LatencyComplete();
+
+        if ( prefetch == true )
+        {
+            ReleasePrefetch();
+        }
     }
 
     return result;
@@ -288,6 +331,12 @@ int ProcessCompoundStatement( VARSERVER_HANDLE hVarServer,
     The ProcessStatement function processes a single statement within
     an action.
 
+    Before a script runs, the deferred writes of the statements before
+    it are published so the script sees them.  After it runs, the
+    prefetched system variables are retrieved again and shared
+    expression values are discarded, since the script may have changed
+    any system variable.
+
 @param[in]
     hVarServer
         handle to the variable server
@@ -302,24 +351,54 @@ int ProcessCompoundStatement( VARSERVER_HANDLE hVarServer,
 ==============================================================================*/
 int ProcessStatement( VARSERVER_HANDLE hVarServer, Statement *pStatement )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
+    bool profile;
+    ProfileMark mark;
     int rc;
 
     if ( ( hVarServer != NULL ) &&
          ( pStatement != NULL ) )
     {
+        profile = ( pContext->options & VA_OPT_PROFILE ) ? true : false;
+        if ( profile == true )
+        {
+            ProfileStart( &mark );
+        }
+
         if( pStatement->pVariable != NULL )
         {
             result = ProcessVariable( hVarServer, pStatement->pVariable );
         }
         else if ( pStatement->script != NULL )
         {
+            /* the script must see the writes made before it */
+            rc = PublishWrites( hVarServer );
+
             result = ProcessScript( pStatement->script );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            /* the script may have changed system variables */
+            InvalidateShared();
+            (void)RefetchSysvars( hVarServer );
         }
         else
         {
             result = ENOTSUP;
         }
+
+        if ( profile == true )
+        {
+            ProfileStatement( pStatement->lineno, &mark );
+        }
+
+        if ( pContext->options & VA_OPT_LATENCY )
+        {
+            LatencyStatement( pStatement->lineno );
+        }
     }
 
     return result;
@@ -331,7 +410,9 @@ int ProcessStatement( VARSERVER_HANDLE hVarServer, Statement *pStatement )
     Process a script
 
     The ProcessScript function executes a script statement using the
-    system() function.
+    system() function.  If the VA_OPT_ASYNC_SCRIPTS option is set, the
+    script is started in the asynchronous script pool instead, and
+    ProcessScript returns without waiting for it to complete.
 
 @param[in]
     script
@@ -339,16 +420,35 @@ int ProcessStatement( VARSERVER_HANDLE hVarServer, Statement *pStatement )
 
 @retval EINVAL invalid argument
 @retval EOK the script was successfully processed
+@retval other the asynchronous script could not be queued
 
 ==============================================================================*/
 int ProcessScript( char *script )
 {
     int result = EINVAL;
+    VarScript *pScript;
 
     if ( script != NULL )
     {
-        system( script );
-        result = EOK;
+        if ( VarActionGetOptions() & VA_OPT_ASYNC_SCRIPTS )
+        {
+            pScript = VarActionRunScript( script );
+            if ( pScript != NULL )
+            {
+                /* nobody waits for the status of a script statement */
+                VarActionFreeScript( pScript );
+                result = EOK;
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+        else
+        {
+            system( script );
+            result = EOK;
+        }
     }
 
     return result;
@@ -390,6 +490,12 @@ int ProcessVariable( VARSERVER_HANDLE hVarServer, Variable *pVariable )
         {
             result = ProcessIF( hVarServer, left, right );
         }
+        else if ( ( pVariable->flags & VF_SHARED ) &&
+                  ( SharedCurrent( pVariable ) == true ) )
+        {
+            /* the shared expression already holds its value */
+            result = EOK;
+        }
         else
         {
             result = ProcessExpr( hVarServer, pVariable );
@@ -505,12 +611,15 @@ int ProcessIF( VARSERVER_HANDLE hVarServer, Variable *left, Variable *right )
 ==============================================================================*/
 int ProcessExpr( VARSERVER_HANDLE hVarServer, Variable *pVariable )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     Variable *left;
     Variable *right;
     int lrc;
     int rrc;
     int op;
+    bool decided = false;
+    ProfileMark mark;
     int (*fn)( VARSERVER_HANDLE hVarServer, Variable *pVariable,
                Variable *pLeft, Variable *pRight ) = NULL;
 
@@ -519,18 +628,44 @@ int ProcessExpr( VARSERVER_HANDLE hVarServer, Variable *pVariable )
     {
         left = pVariable->left;
         right = pVariable->right;
+        op = pVariable->operation;
 
-        /* recursively calculate the left side of the expression tree */
-        lrc = ProcessVariable( hVarServer, right );
+        if ( ( ( op == VA_AND ) || ( op == VA_OR ) ) &&
+             ( pContext->options & VA_OPT_SHORT_CIRCUIT ) )
+        {
+            /* evaluate the left side first, and only evaluate the
+             * right side if the left side does not decide the result */
+            lrc = ProcessVariable( hVarServer, left );
+            decided = ShortCircuit( pVariable, left );
+            if ( decided == false )
+            {
+                rrc = ProcessVariable( hVarServer, right );
+            }
+        }
+        else
+        {
+            /* recursively calculate the right side of the expression tree */
+            rrc = ProcessVariable( hVarServer, right );
 
-        /* recursively calculate the right side of the expression tree */
-        rrc = ProcessVariable( hVarServer, left );
+            /* recursively calculate the left side of the expression tree */
+            lrc = ProcessVariable( hVarServer, left );
+        }
 
-        op = pVariable->operation;
-        if ( op < VA_OP_MAX )
+        if ( decided == true )
         {
-            fn = va_op[op];
-            if ( fn != NULL )
+            result = EOK;
+        }
+        else if ( op < VA_OP_MAX )
+        {
+            fn = ( pVariable->fn != NULL ) ? pVariable->fn : va_op[op];
+            if ( ( fn != NULL ) &&
+                 ( pContext->options & VA_OPT_PROFILE ) )
+            {
+                ProfileStart( &mark );
+                result = fn( hVarServer, pVariable, left, right );
+                ProfileOperation( op, &mark );
+            }
+            else if ( fn != NULL )
             {
                 result = fn( hVarServer, pVariable, left, right );
             }
@@ -540,6 +675,11 @@ int ProcessExpr( VARSERVER_HANDLE hVarServer, Variable *pVariable )
                          "Illegal function %s\n",
                          opname[pVariable->operation] );
             }
+
+            if ( ( result == EOK ) && ( pContext->epoch != 0 ) )
+            {
+                StampShared( pContext, pVariable );
+            }
         }
         else
         {
@@ -554,6 +694,221 @@ int ProcessExpr( VARSERVER_HANDLE hVarServer, Variable *pVariable )
     return result;
 }
 
+/*============================================================================*/
+/*  ShortCircuit                                                              */
+/*!
+    Check if a logical operation is decided by its left operand
+
+    The ShortCircuit function checks if the already evaluated left
+    operand of a VA_AND or VA_OR node decides the result of the operation.
+    i.e. the left operand of an AND is false, or the left operand of
+    an OR is true.  If it does, the result is stored in the node
+    so the right operand does not need to be evaluated.
+
+    Only 16 and 32 bit left operands can decide the result, other types
+    are left for the operation function to report.
+
+@param[in]
+    pVariable
+        pointer to the VA_AND or VA_OR node
+
+@param[in]
+    pLeft
+        pointer to the evaluated left operand
+
+@retval true the result was decided by the left operand
+@retval false the right operand must be evaluated
+
+==============================================================================*/
+bool ShortCircuit( Variable *pVariable, Variable *pLeft )
+{
+    bool decided = false;
+    bool val = false;
+
+    if ( pLeft != NULL )
+    {
+        switch( pLeft->obj.type )
+        {
+            case VARTYPE_UINT32:
+                val = ( pLeft->obj.val.ul != 0 );
+                decided = true;
+                break;
+
+            case VARTYPE_UINT16:
+                val = ( pLeft->obj.val.ui != 0 );
+                decided = true;
+                break;
+
+            default:
+                break;
+        }
+
+        if ( decided == true )
+        {
+            /* false && x is false, and true || x is true */
+            decided = ( pVariable->operation == VA_AND ) ? ( val == false )
+                                                         : ( val == true );
+        }
+
+        if ( decided == true )
+        {
+            pVariable->obj.val.ui = val;
+            pVariable->obj.type = VARTYPE_UINT16;
+            pVariable->obj.len = sizeof(uint16_t);
+        }
+    }
+
+    return decided;
+}
+
+/*============================================================================*/
+/*  EnterCompound                                                             */
+/*!
+    Enter a compound statement
+
+    The EnterCompound function records entry into a compound statement
+    so that per-block processing (such as prefetching) is only
+    performed by the outermost compound statement.
+
+@retval true this is the outermost compound statement
+@retval false this compound statement is nested in another one
+
+==============================================================================*/
+bool EnterCompound( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    bool outer = ( pContext->depth++ == 0 );
+
+    if ( outer == true )
+    {
+        /* shared values from earlier executions are not reused */
+        pContext->epoch = ++pContext->clock;
+
+        LatencyBegin();
+    }
+
+    return outer;
+}
+
+/*============================================================================*/
+/*  LeaveCompound                                                             */
+/*!
+    Leave a compound statement
+
+    The LeaveCompound function records exit from a compound statement
+    entered with EnterCompound()
+
+==============================================================================*/
+void LeaveCompound( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pContext->depth > 0 )
+    {
+        pContext->depth--;
+    }
+
+    if ( pContext->depth == 0 )
+    {
+        pContext->epoch = 0;
+    }
+}
+
+/*============================================================================*/
+/*  VarActionSetOptions                                                       */
+/*!
+    Set the evaluation options
+
+    The VarActionSetOptions function sets the evaluation options
+    which control how statements are processed.  The options are
+    a bitwise OR of the VA_OPT_xxx definitions.
+
+@param[in]
+    options
+        the new evaluation options
+
+==============================================================================*/
+void VarActionSetOptions( uint32_t options )
+{
+    VarActionContext *pContext = GetContext();
+
+    pContext->options = options;
+}
+
+/*============================================================================*/
+/*  VarActionGetOptions                                                       */
+/*!
+    Get the evaluation options
+
+    The VarActionGetOptions function gets the current evaluation options
+
+@retval the current evaluation options
+
+==============================================================================*/
+uint32_t VarActionGetOptions( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    return pContext->options;
+}
+
+/*============================================================================*/
+/*  GetOperation                                                              */
+/*!
+    Get the function which implements an operation
+
+    The GetOperation function looks up the function which implements
+    the specified operation in the operation map.  It is used by
+    the statement compiler to bind operations to instructions ahead of time.
+
+@param[in]
+    op
+        the operation identifier to look up
+
+@retval pointer to the operation function
+@retval NULL if the operation identifier is invalid
+
+==============================================================================*/
+opfn GetOperation( int op )
+{
+    opfn fn = NULL;
+
+    if ( ( op >= 0 ) && ( op < VA_OP_MAX ) )
+    {
+        fn = va_op[op];
+    }
+
+    return fn;
+}
+
+/*============================================================================*/
+/*  GetOperationName                                                          */
+/*!
+    Get the name of an operation
+
+    The GetOperationName function gets the human readable name of
+    the specified operation for use in diagnostic output.
+
+@param[in]
+    op
+        the operation identifier to look up
+
+@retval pointer to the operation name
+
+==============================================================================*/
+char *GetOperationName( int op )
+{
+    char *name = "Unknown";
+
+    if ( ( op >= 0 ) && ( op < VA_OP_MAX ) )
+    {
+        name = opname[op];
+    }
+
+    return name;
+}
+
 /*============================================================================*/
 /*  GetVar                                                                    */
 /*!
@@ -587,18 +942,47 @@ static int GetVar( VARSERVER_HANDLE hVarServer,
                    Variable *pLeft,
                    Variable *pRight )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
+    uint64_t start;
 
     if ( ( hVarServer != NULL ) &&
          ( pVariable != NULL ) &&
          ( pVariable->hVar != VAR_INVALID ) &&
          ( pVariable->operation == VA_SYSVAR ) )
     {
-        if ( pVariable->lvalue == false )
+        if ( ( pVariable->valid == true ) ||
+             ( pVariable->pending == true ) )
+        {
+            /* the value was prefetched, is cached, or has been
+             * written but not yet published */
+            result = EOK;
+        }
+        else if ( ( pVariable->lvalue == false ) &&
+                  ( pVariable->flags & VF_SHM_VALUE ) &&
+                  ( ReadSharedValue( pVariable ) == EOK ) )
+        {
+            /* read from the shared value region without a request */
+            result = EOK;
+        }
+        else if ( pVariable->lvalue == false )
         {
+            /* string values are referenced from the variable server */
+            ReleaseString( pVariable );
+            start = LatencyStart();
             result = VAR_Get( hVarServer,
                               pVariable->hVar,
                               &(pVariable->obj) );
+            LatencyRequest( VA_LATENCY_GET, start );
+            ReferenceString( pVariable );
+            ProfileGets( 1 );
+            if ( ( result == EOK ) &&
+                 ( pVariable->modifiedNotification == true ) &&
+                 ( pContext->options & VA_OPT_CACHE ) )
+            {
+                /* the value remains valid until it is modified */
+                pVariable->valid = true;
+            }
         }
         else
         {
@@ -658,7 +1042,6 @@ static int Unsupported( VARSERVER_HANDLE hVarServer,
     return result;
 }
 
-
 /*============================================================================*/
 /*  NOP                                                                       */
 /*!
@@ -760,6 +1143,10 @@ Variable *CreateDeclaration( uintptr_t type_specifier, Variable *pVariable )
 
     The CreateVariable function creates a varaiable operation node
 
+    When the VA_OPT_OPTIMIZE option is set the node is optimized as it
+    is created, so the returned node may be a constant or one of the
+    operands.
+
 @param[in]
     op
         operation to perform
@@ -778,7 +1165,8 @@ Variable *CreateDeclaration( uintptr_t type_specifier, Variable *pVariable )
 ==============================================================================*/
 Variable *CreateVariable( uintptr_t op, void *left, void *right )
 {
-    Variable *var = (Variable *)calloc( 1, sizeof( Variable ) );
+    VarActionContext *pContext = GetContext();
+    Variable *var = AllocVariable();
     if ( var != NULL )
     {
         var->left = left;
@@ -792,8 +1180,12 @@ Variable *CreateVariable( uintptr_t op, void *left, void *right )
                 break;
 
             case VA_STRING:
+                var->obj.type = VARTYPE_STR;
+                break;
+
             case VA_TOSTRING:
                 var->obj.type = VARTYPE_STR;
+                PrepareFormat( var );
                 break;
 
             case VA_IF:
@@ -808,12 +1200,20 @@ Variable *CreateVariable( uintptr_t op, void *left, void *right )
                 var->obj.type = TypeCheck( left, right );
                 break;
         }
+
+        if ( pContext->options & VA_OPT_OPTIMIZE )
+        {
+            /* the subtrees have already been optimized */
+            var = OptimizeNode( var );
+        }
+
+        /* bind the operation for the type of the left operand */
+        var->fn = SelectOperation( var );
     }
 
     return (void *)var;
 }
 
-
 /*============================================================================*/
 /*  NewNumber                                                                 */
 /*!
@@ -863,7 +1263,7 @@ Variable *NewNumber( void *number )
         n = strtol( num, NULL, base );
 
         /* allocate memory for the number */
-        var = (Variable *)calloc( 1, sizeof( Variable ) );
+        var = AllocVariable();
         if ( var != NULL )
         {
             var->operation = VA_NUM;
@@ -909,7 +1309,9 @@ Variable *NewNumber( void *number )
     Create a new constant string
 
     The NewSting function creates a new constant string which is
-    stored in a Variable object
+    stored in a Variable object.  The string is interned so all
+    constants with the same value share the same storage.  If it cannot
+    be interned, short strings are stored in the node's inline buffer.
 
 @param[in]
     str
@@ -921,18 +1323,40 @@ Variable *NewNumber( void *number )
 ==============================================================================*/
 Variable *NewString( void *str )
 {
+    VarActionContext *pContext = GetContext();
     Variable *var = NULL;
+    bool arena;
+    size_t len;
 
     if ( str != NULL )
     {
-        var = (Variable *)calloc( 1, sizeof( Variable ) );
+        var = AllocVariable();
         if ( var != NULL )
         {
             var->operation = VA_STRING;
-            var->obj.val.str = strdup(str);
-            var->obj.len = strlen(str);
+            len = strlen( str );
+            var->obj.val.str = InternString( &pContext->strings, str, len );
+            if ( var->obj.val.str != NULL )
+            {
+                var->flags |= VF_INTERNED_STR;
+                var->bufsize = len;
+            }
+            else if ( len < VA_SSO_SIZE )
+            {
+                memcpy( var->sso, str, len + 1 );
+                var->obj.val.str = var->sso;
+                var->flags |= VF_INLINE_STR;
+                var->bufsize = VA_SSO_SIZE;
+            }
+            else
+            {
+                var->obj.val.str = AllocString( str, &arena );
+                var->flags |= ( arena == true ) ? VF_ARENA_STR : VF_HEAP_STR;
+                var->bufsize = len;
+            }
+
+            var->obj.len = len;
             var->obj.type = VARTYPE_STR;
-            var->bufsize = var->obj.len;
         }
     }
 
@@ -963,7 +1387,7 @@ Variable *NewFloat( void *fstr )
     {
         f = atof( fstr );
 
-        var = (Variable *)calloc( 1, sizeof( Variable ) );
+        var = AllocVariable();
         if ( var != NULL )
         {
             var->operation = VA_FLOATNUM;
@@ -1005,9 +1429,11 @@ Variable *NewIdentifier( VARSERVER_HANDLE hVarServer,
                          void *id,
                          bool declaration )
 {
+    VarActionContext *pContext = GetContext();
     Variable *var = NULL;
     VAR_HANDLE hVar;
     int result;
+    bool arena;
 
     if ( id != NULL )
     {
@@ -1020,13 +1446,32 @@ Variable *NewIdentifier( VARSERVER_HANDLE hVarServer,
             }
         }
 
-        if ( var == NULL )
+        if ( ( var == NULL ) &&
+             ( declaration == false ) &&
+             ( pContext->options & VA_OPT_LAZY_RESOLVE ) )
         {
-            /* allocate memory for the new variable */
-            var = (Variable *)calloc( 1, sizeof( Variable ) );
+            /* record the name now and look up its handle with the
+             * other unresolved system variables before it is used */
+            var = CreateSysvar( hVarServer, id, VAR_INVALID, VARTYPE_INVALID );
+        }
+        else if ( var == NULL )
+        {
+            /* allocate memory for the new variable.  System variables
+             * are shared by all actions so they are never allocated
+             * from an arena */
+            var = ( declaration == true ) ? AllocVariable()
+                                          : calloc( 1, sizeof( Variable ) );
             if ( var != NULL )
             {
-                var->id = strdup( id );
+                if ( declaration == true )
+                {
+                    var->id = AllocString( id, &arena );
+                }
+                else
+                {
+                    var->id = strdup( id );
+                }
+
                 var->local = declaration;
                 var->assigned = false;
 
@@ -1038,23 +1483,24 @@ Variable *NewIdentifier( VARSERVER_HANDLE hVarServer,
                         var->hVar = hVar;
                         var->operation = VA_SYSVAR;
 
+                        if ( pContext->options & VA_OPT_CACHE )
+                        {
+                            /* register before getting the value so
+                             * no modifications are missed */
+                            (void)CacheVariable( hVarServer, var );
+                        }
+
                         result = VAR_Get( hVarServer,
                                           var->hVar,
                                           &(var->obj) );
                         if( result == EOK )
                         {
-                            if ( g_pFirstSysvar == NULL )
-                            {
-                                /* add variable at the beginning of the list */
-                                g_pFirstSysvar = var;
-                                g_pLastSysvar = var;
-                            }
-                            else
-                            {
-                                /* add variable at the end of the list */
-                                g_pLastSysvar->pNext = var;
-                                g_pLastSysvar = var;
-                            }
+                            ReferenceString( var );
+                            var->valid = var->modifiedNotification &&
+                                         ( pContext->options & VA_OPT_CACHE );
+
+                            RegisterSysvar( var );
+                            BindSharedValue( var );
                         }
                         else
                         {
@@ -1079,6 +1525,163 @@ Variable *NewIdentifier( VARSERVER_HANDLE hVarServer,
     return var;
 }
 
+/*============================================================================*/
+/*  RegisterSysvar                                                            */
+/*!
+    Add a system variable node to the current context
+
+    The RegisterSysvar function appends a system variable node to the
+    system variable list of the current context, and adds it to the
+    system variable indexes so it is shared by every reference to it.
+
+@param[in]
+    pVariable
+        pointer to the system variable node
+
+==============================================================================*/
+void RegisterSysvar( Variable *pVariable )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pVariable != NULL )
+    {
+        if ( pContext->pFirstSysvar == NULL )
+        {
+            /* add variable at the beginning of the list */
+            pContext->pFirstSysvar = pVariable;
+            pContext->pLastSysvar = pVariable;
+        }
+        else
+        {
+            /* add variable at the end of the list */
+            pContext->pLastSysvar->pNext = pVariable;
+            pContext->pLastSysvar = pVariable;
+        }
+
+        (void)AddSymbol( &pContext->sysvars, pVariable );
+        (void)AddHandle( &pContext->handles, pVariable );
+    }
+}
+
+/*============================================================================*/
+/*  CreateSysvar                                                              */
+/*!
+    Create a system variable node
+
+    The CreateSysvar function creates a system variable node with the
+    specified name and handle, requests a modified notification for it
+    if the VA_OPT_CACHE option is set, and adds it to the current context.
+    Its value is not retrieved until it is evaluated.
+
+    A node created with a VAR_INVALID handle is counted as unresolved,
+    and its handle is looked up by ResolveAll().
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    id
+        name of the system variable
+
+@param[in]
+    hVar
+        handle of the system variable, or VAR_INVALID if the handle
+        has not been looked up
+
+@param[in]
+    type
+        expected type of the system variable (may be VARTYPE_INVALID)
+
+@retval pointer to the new system variable node
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+Variable *CreateSysvar( VARSERVER_HANDLE hVarServer,
+                        const char *id,
+                        VAR_HANDLE hVar,
+                        int type )
+{
+    VarActionContext *pContext = GetContext();
+    Variable *var;
+
+    var = calloc( 1, sizeof( Variable ) );
+    if ( var != NULL )
+    {
+        var->id = strdup( id );
+        if ( var->id != NULL )
+        {
+            var->hVar = hVar;
+            var->operation = VA_SYSVAR;
+            var->obj.type = type;
+
+            if ( hVar == VAR_INVALID )
+            {
+                pContext->unresolved++;
+            }
+            else if ( pContext->options & VA_OPT_CACHE )
+            {
+                (void)CacheVariable( hVarServer, var );
+            }
+
+            RegisterSysvar( var );
+            BindSharedValue( var );
+        }
+        else
+        {
+            free( var );
+            var = NULL;
+        }
+    }
+
+    return var;
+}
+
+/*============================================================================*/
+/*  SetSysvarHandle                                                           */
+/*!
+    Set the handle of an unresolved system variable node
+
+    The SetSysvarHandle function sets the handle of a system variable
+    node created without one, adds it to the system variable handle
+    index, and requests a modified notification for it if the
+    VA_OPT_CACHE option is set.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pVariable
+        pointer to the system variable node
+
+@param[in]
+    hVar
+        handle of the system variable
+
+==============================================================================*/
+void SetSysvarHandle( VARSERVER_HANDLE hVarServer,
+                      Variable *pVariable,
+                      VAR_HANDLE hVar )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( ( pVariable != NULL ) &&
+         ( pVariable->hVar == VAR_INVALID ) &&
+         ( hVar != VAR_INVALID ) )
+    {
+        pVariable->hVar = hVar;
+        (void)AddHandle( &pContext->handles, pVariable );
+
+        if ( pContext->options & VA_OPT_CACHE )
+        {
+            (void)CacheVariable( hVarServer, pVariable );
+        }
+
+        BindSharedValue( pVariable );
+    }
+}
+
 /*============================================================================*/
 /*  CheckUseBeforeAssign                                                      */
 /*!
@@ -1160,7 +1763,6 @@ int TypeCheck( Variable *pVar1, Variable *pVar2 )
     return result;
 }
 
-
 /*============================================================================*/
 /*  FindLocalVariable                                                         */
 /*!
@@ -1180,18 +1782,28 @@ int TypeCheck( Variable *pVar1, Variable *pVar2 )
 ==============================================================================*/
 Variable *FindLocalVariable( char *id )
 {
+    VarActionContext *pContext = GetContext();
     Variable *pVariable = NULL;
 
-    pVariable = g_pDeclarations;
-    while( pVariable != NULL )
+    IndexDeclarations();
+
+    if ( pContext->locals.incomplete == false )
     {
-        if( strcmp( pVariable->id, id ) == 0 )
+        pVariable = FindSymbol( &pContext->locals, id );
+    }
+    else
+    {
+        /* the index is incomplete, so search the list */
+        pVariable = pContext->pDeclarations;
+        while( pVariable != NULL )
         {
-            break;
-        }
-
-        pVariable = pVariable->pNext;
+            if( strcmp( pVariable->id, id ) == 0 )
+            {
+                break;
+            }
 
+            pVariable = pVariable->pNext;
+        }
     }
 
     return pVariable;
@@ -1215,17 +1827,65 @@ Variable *FindLocalVariable( char *id )
 ==============================================================================*/
 Variable *FindVariable( char *id )
 {
+    VarActionContext *pContext = GetContext();
     Variable *pVariable = NULL;
 
-    pVariable = g_pFirstSysvar;
-    while( pVariable != NULL )
+    if ( pContext->sysvars.incomplete == false )
     {
-        if ( strcmp( pVariable->id, id ) == 0 )
+        pVariable = FindSymbol( &pContext->sysvars, id );
+    }
+    else
+    {
+        /* the index is incomplete, so search the list */
+        pVariable = pContext->pFirstSysvar;
+        while( pVariable != NULL )
         {
-            break;
+            if ( strcmp( pVariable->id, id ) == 0 )
+            {
+                break;
+            }
+
+            pVariable = pVariable->pNext;
         }
+    }
 
-        pVariable = pVariable->pNext;
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  FindHandleVariable                                                        */
+/*!
+    Search for a system variable by its handle
+
+    The FindHandleVariable function looks up the system variable node
+    with the specified handle in the current context.
+
+@param[in]
+    hVar
+        handle of the system variable to search for
+
+@retval pointer to the Variable that we found
+@retval NULL if no variable was found
+
+==============================================================================*/
+Variable *FindHandleVariable( VAR_HANDLE hVar )
+{
+    VarActionContext *pContext = GetContext();
+    Variable *pVariable;
+
+    if ( pContext->handles.incomplete == false )
+    {
+        pVariable = FindHandle( &pContext->handles, hVar );
+    }
+    else
+    {
+        /* the index is incomplete, so search the list */
+        pVariable = pContext->pFirstSysvar;
+        while ( ( pVariable != NULL ) &&
+                ( pVariable->hVar != hVar ) )
+        {
+            pVariable = pVariable->pNext;
+        }
     }
 
     return pVariable;
@@ -1247,7 +1907,189 @@ Variable *FindVariable( char *id )
 ==============================================================================*/
 void SetDeclarations( Variable *pVariable )
 {
-    g_pDeclarations = pVariable;
+    VarActionContext *pContext = GetContext();
+
+    pContext->pDeclarations = pVariable;
+
+    /* the declarations are re-indexed on the next search */
+    ClearSymbols( &pContext->locals );
+    pContext->pIndexedDeclarations = NULL;
+    pContext->pLastIndexed = NULL;
+}
+
+/*============================================================================*/
+/*  IndexDeclarations                                                         */
+/*!
+    Bring the declaration index up to date
+
+    The IndexDeclarations function adds any declarations which have been
+    appended to the declaration list since it was last indexed.  If the
+    head of the declaration list has changed, the whole list is
+    re-indexed.
+
+==============================================================================*/
+static void IndexDeclarations( void )
+{
+    VarActionContext *pContext = GetContext();
+    Variable *pVariable;
+
+    if ( pContext->pIndexedDeclarations != pContext->pDeclarations )
+    {
+        ClearSymbols( &pContext->locals );
+        pContext->pIndexedDeclarations = pContext->pDeclarations;
+        pContext->pLastIndexed = NULL;
+    }
+
+    pVariable = ( pContext->pLastIndexed != NULL )
+                    ? pContext->pLastIndexed->pNext
+                    : pContext->pDeclarations;
+    while ( pVariable != NULL )
+    {
+        (void)AddSymbol( &pContext->locals, pVariable );
+        pContext->pLastIndexed = pVariable;
+        pVariable = pVariable->pNext;
+    }
+}
+
+/*============================================================================*/
+/*  VarActionEnableCache                                                      */
+/*!
+    Enable the system variable value cache
+
+    The VarActionEnableCache function enables the VA_OPT_CACHE option
+    and requests a modified notification for each system variable which
+    has been referenced so far.  System variables referenced afterwards
+    are registered when they are created.
+
+    While the cache is enabled, a system variable value retrieved by
+    GetVar remains valid until VarActionNotifyModified() is called for it,
+    so the host must pass its modified notifications to that function.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EINVAL invalid argument
+@retval EOK the cache was enabled
+@retval other a notification request failed.  That variable is not cached
+
+==============================================================================*/
+int VarActionEnableCache( VARSERVER_HANDLE hVarServer )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    int rc;
+    Variable *pVariable;
+
+    if ( hVarServer != NULL )
+    {
+        result = EOK;
+        pContext->options |= VA_OPT_CACHE;
+
+        pVariable = pContext->pFirstSysvar;
+        while ( pVariable != NULL )
+        {
+            rc = CacheVariable( hVarServer, pVariable );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            pVariable = pVariable->pNext;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionDisableCache                                                     */
+/*!
+    Disable the system variable value cache
+
+    The VarActionDisableCache function disables the VA_OPT_CACHE option
+    and invalidates all cached values, so each system variable is
+    retrieved from the variable server every time it is read.
+    Modified notifications which have already been requested remain
+    registered.
+
+==============================================================================*/
+void VarActionDisableCache( void )
+{
+    VarActionContext *pContext = GetContext();
+    Variable *pVariable;
+
+    pContext->options &= ~VA_OPT_CACHE;
+
+    pVariable = pContext->pFirstSysvar;
+    while ( pVariable != NULL )
+    {
+        pVariable->valid = false;
+        pVariable = pVariable->pNext;
+    }
+}
+
+/*============================================================================*/
+/*  VarActionNotifyModified                                                   */
+/*!
+    Handle a system variable modified notification
+
+    The VarActionNotifyModified function invalidates the cached value of
+    the specified system variable so it is retrieved from the variable
+    server the next time it is read.
+
+@param[in]
+    hVar
+        handle of the system variable which was modified
+
+==============================================================================*/
+void VarActionNotifyModified( VAR_HANDLE hVar )
+{
+    Variable *pVariable = FindHandleVariable( hVar );
+
+    if ( pVariable != NULL )
+    {
+        pVariable->valid = false;
+    }
+}
+
+/*============================================================================*/
+/*  CacheVariable                                                             */
+/*!
+    Request a modified notification for a system variable
+
+    The CacheVariable function requests a modified notification for
+    the specified system variable if one has not already been requested,
+    and invalidates its value so it is refreshed on the next read.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pVariable
+        pointer to the system variable
+
+@retval EOK the notification is registered
+@retval other the notification request failed
+
+==============================================================================*/
+static int CacheVariable( VARSERVER_HANDLE hVarServer, Variable *pVariable )
+{
+    int result = EOK;
+
+    if ( pVariable->modifiedNotification == false )
+    {
+        result = VAR_Notify( hVarServer, pVariable->hVar, NOTIFY_MODIFIED );
+        if ( result == EOK )
+        {
+            pVariable->modifiedNotification = true;
+        }
+    }
+
+    pVariable->valid = false;
+
+    return result;
 }
 
 /*============================================================================*/
@@ -1269,6 +2111,5 @@ void SetTimer( int id )
     VASetActiveTimer( id );
 }
 
-
 /*! @}
  * end of varaction group */
@@ -0,0 +1,472 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup vararena vararena
+ * @brief Variable Action Script Arena Allocator functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file vararena.c
+
+    Variable Action Script Arena Allocator functions
+
+    The Variable Action Script Arena Allocator functions provide a bump
+    allocator for parse tree nodes and string constants.  While an arena
+    is selected with VarActionSetArena(), CreateVariable(), NewNumber(),
+    NewString(), NewFloat() and NewIdentifier() allocate from it, so the
+    nodes of a statement are adjacent in memory and a whole rule set
+    can be released with a single call to VarActionFreeArena().
+
+    Nodes are allocated from node slabs which contain only Variable
+    objects, so when the arena is released the string buffers which
+    were allocated on the heap for its nodes (flagged with VF_HEAP_STR),
+    and the format plans of its string conversions, can be released
+    as well.  Other allocations are made from separate
+    blocks.
+
+    System variables are shared by all rule sets, so they are always
+    allocated on the heap.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "vararena.h"
+#include "varcontext.h"
+#include "varformat.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! default arena block size */
+#define VAR_ARENA_DEFAULT_BLOCKSIZE    ( 64 * 1024 )
+
+/*! number of Variable nodes in each node slab */
+#define VAR_ARENA_SLAB_NODES    ( 256 )
+
+/*! allocation alignment */
+#define VAR_ARENA_ALIGN     ( sizeof( max_align_t ) )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! arena memory block */
+typedef struct _arenaBlock
+{
+    /*! pointer to the previously allocated block */
+    struct _arenaBlock *pPrev;
+
+    /*! number of bytes used in the block */
+    size_t used;
+
+    /*! number of bytes available in the block */
+    size_t size;
+
+    /*! block memory */
+    max_align_t data[];
+
+} ArenaBlock;
+
+/*! arena allocator */
+struct _varArena
+{
+    /*! pointer to the block currently being allocated from */
+    ArenaBlock *pBlock;
+
+    /*! pointer to the node slab currently being allocated from */
+    ArenaBlock *pNodes;
+
+    /*! size of each block */
+    size_t blocksize;
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static ArenaBlock *NewBlock( size_t size );
+
+static void FreeBlocks( ArenaBlock *pBlock, bool nodes );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionCreateArena                                                      */
+/*!
+    Create an arena allocator
+
+    The VarActionCreateArena function creates an arena which allocates
+    memory in blocks of the specified size.
+
+@param[in]
+    blocksize
+        size of each arena block, or zero to use the default size
+
+@retval pointer to the new arena
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+VarArena *VarActionCreateArena( size_t blocksize )
+{
+    VarArena *pArena;
+
+    pArena = calloc( 1, sizeof( VarArena ) );
+    if ( pArena != NULL )
+    {
+        pArena->blocksize = ( blocksize != 0 ) ? blocksize
+                                               : VAR_ARENA_DEFAULT_BLOCKSIZE;
+    }
+
+    return pArena;
+}
+
+/*============================================================================*/
+/*  VarActionSetArena                                                         */
+/*!
+    Select the arena used by the node constructors
+
+    The VarActionSetArena function selects the arena which the node
+    constructors allocate from.  Setting the arena to NULL allocates
+    each node on the heap.
+
+@param[in]
+    pArena
+        pointer to the arena to select (may be NULL)
+
+@retval pointer to the previously selected arena (may be NULL)
+
+==============================================================================*/
+VarArena *VarActionSetArena( VarArena *pArena )
+{
+    VarActionContext *pContext = GetContext();
+    VarArena *pPrev = pContext->pArena;
+
+    pContext->pArena = pArena;
+
+    return pPrev;
+}
+
+/*============================================================================*/
+/*  VarActionArenaAlloc                                                       */
+/*!
+    Allocate memory from an arena
+
+    The VarActionArenaAlloc function allocates zeroed memory from the
+    specified arena.  Allocations larger than a quarter of the block
+    size are given their own block.  The memory is released when the
+    arena is freed.
+
+@param[in]
+    pArena
+        pointer to the arena
+
+@param[in]
+    size
+        number of bytes to allocate
+
+@retval pointer to the allocated memory
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+void *VarActionArenaAlloc( VarArena *pArena, size_t size )
+{
+    void *p = NULL;
+    ArenaBlock *pBlock;
+
+    if ( ( pArena != NULL ) &&
+         ( size > 0 ) )
+    {
+        size = ( size + VAR_ARENA_ALIGN - 1 ) & ~( VAR_ARENA_ALIGN - 1 );
+
+        pBlock = pArena->pBlock;
+        if ( size > pArena->blocksize / 4 )
+        {
+            /* large allocation in its own block behind the current one */
+            pBlock = NewBlock( size );
+            if ( pBlock != NULL )
+            {
+                if ( pArena->pBlock != NULL )
+                {
+                    pBlock->pPrev = pArena->pBlock->pPrev;
+                    pArena->pBlock->pPrev = pBlock;
+                }
+                else
+                {
+                    pArena->pBlock = pBlock;
+                }
+
+                pBlock->used = size;
+                p = pBlock->data;
+            }
+        }
+        else
+        {
+            if ( ( pBlock == NULL ) ||
+                 ( pBlock->size - pBlock->used < size ) )
+            {
+                pBlock = NewBlock( pArena->blocksize );
+                if ( pBlock != NULL )
+                {
+                    pBlock->pPrev = pArena->pBlock;
+                    pArena->pBlock = pBlock;
+                }
+            }
+
+            if ( pBlock != NULL )
+            {
+                p = (char *)pBlock->data + pBlock->used;
+                pBlock->used += size;
+            }
+        }
+    }
+
+    return p;
+}
+
+/*============================================================================*/
+/*  VarActionFreeArena                                                        */
+/*!
+    Release an arena and everything allocated from it
+
+    The VarActionFreeArena function releases all of the memory allocated
+    from the arena, and the arena itself.  If the arena is selected it is
+    deselected.  Heap string buffers owned by the arena's nodes are
+    released as well.
+
+    The caller must not use any node allocated from the arena afterwards,
+    including a declaration list passed to SetDeclarations().
+
+@param[in]
+    pArena
+        pointer to the arena to release
+
+==============================================================================*/
+void VarActionFreeArena( VarArena *pArena )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pArena != NULL )
+    {
+        if ( pContext->pArena == pArena )
+        {
+            pContext->pArena = NULL;
+        }
+
+        FreeBlocks( pArena->pNodes, true );
+        FreeBlocks( pArena->pBlock, false );
+
+        free( pArena );
+    }
+}
+
+/*============================================================================*/
+/*  AllocVariable                                                             */
+/*!
+    Allocate a Variable node
+
+    The AllocVariable function allocates a zeroed Variable node from the
+    node slabs of the selected arena, or from the heap if no arena is
+    selected.  Arena nodes are flagged with VF_ARENA.
+
+@retval pointer to the new Variable
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+Variable *AllocVariable( void )
+{
+    VarActionContext *pContext = GetContext();
+    Variable *pVariable = NULL;
+    ArenaBlock *pSlab;
+
+    if ( pContext->pArena != NULL )
+    {
+        pSlab = pContext->pArena->pNodes;
+        if ( ( pSlab == NULL ) ||
+             ( pSlab->size - pSlab->used < sizeof( Variable ) ) )
+        {
+            pSlab = NewBlock( VAR_ARENA_SLAB_NODES * sizeof( Variable ) );
+            if ( pSlab != NULL )
+            {
+                pSlab->pPrev = pContext->pArena->pNodes;
+                pContext->pArena->pNodes = pSlab;
+            }
+        }
+
+        if ( pSlab != NULL )
+        {
+            pVariable = (Variable *)( (char *)pSlab->data + pSlab->used );
+            pSlab->used += sizeof( Variable );
+            pVariable->flags = VF_ARENA;
+        }
+    }
+    else
+    {
+        pVariable = calloc( 1, sizeof( Variable ) );
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  AllocString                                                               */
+/*!
+    Duplicate a string constant
+
+    The AllocString function copies a string into the selected arena,
+    or onto the heap if no arena is selected.
+
+@param[in]
+    str
+        pointer to the NUL terminated string to copy
+
+@param[out]
+    pArena
+        set to true if the copy was allocated from an arena
+
+@retval pointer to the copy of the string
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+char *AllocString( const char *str, bool *pArena )
+{
+    VarActionContext *pContext = GetContext();
+    char *p;
+    size_t len;
+
+    *pArena = false;
+
+    if ( pContext->pArena != NULL )
+    {
+        len = strlen( str ) + 1;
+        p = VarActionArenaAlloc( pContext->pArena, len );
+        if ( p != NULL )
+        {
+            memcpy( p, str, len );
+            *pArena = true;
+        }
+    }
+    else
+    {
+        p = strdup( str );
+    }
+
+    return p;
+}
+
+/*============================================================================*/
+/*  NewBlock                                                                  */
+/*!
+    Allocate an arena block
+
+    The NewBlock function allocates a zeroed arena block with the
+    specified number of usable bytes.
+
+@param[in]
+    size
+        number of usable bytes in the block
+
+@retval pointer to the new block
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+static ArenaBlock *NewBlock( size_t size )
+{
+    ArenaBlock *pBlock;
+
+    pBlock = calloc( 1, sizeof( ArenaBlock ) + size );
+    if ( pBlock != NULL )
+    {
+        pBlock->size = size;
+    }
+
+    return pBlock;
+}
+
+/*============================================================================*/
+/*  FreeBlocks                                                                */
+/*!
+    Release a chain of arena blocks
+
+    The FreeBlocks function releases each block in a chain of arena
+    blocks.  The heap string buffers owned by the nodes in a chain of
+    node slabs are released first.
+
+@param[in]
+    pBlock
+        pointer to the most recently allocated block in the chain
+
+@param[in]
+    nodes
+        true if the blocks are node slabs
+
+==============================================================================*/
+static void FreeBlocks( ArenaBlock *pBlock, bool nodes )
+{
+    ArenaBlock *pPrev;
+    Variable *pVariable;
+    size_t i;
+
+    while ( pBlock != NULL )
+    {
+        if ( nodes == true )
+        {
+            pVariable = (Variable *)pBlock->data;
+            for ( i = 0; i < pBlock->used / sizeof( Variable ); i++ )
+            {
+                if ( pVariable[i].flags & VF_HEAP_STR )
+                {
+                    free( pVariable[i].obj.val.str );
+                }
+
+                FreeFormat( pVariable[i].pFormat );
+            }
+        }
+
+        pPrev = pBlock->pPrev;
+        free( pBlock );
+        pBlock = pPrev;
+    }
+}
+
+/*! @}
+ * end of vararena group */
@@ -56,6 +56,7 @@ SOFTWARE.
 #include <errno.h>
 #include <syslog.h>
 #include "varassign.h"
+#include "varwrite.h"
 #include "varstrings.h"
 
 /*==============================================================================
@@ -151,9 +152,7 @@ int Assign( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -244,9 +243,7 @@ int PlusEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -333,9 +330,7 @@ int MinusEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -422,9 +417,7 @@ int TimesEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -512,9 +505,7 @@ int DivEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -594,9 +585,7 @@ int AndEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -676,9 +665,7 @@ int OrEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -758,9 +745,7 @@ int XorEquals( VARSERVER_HANDLE hVarServer,
             if ( pLeft->operation == VA_SYSVAR )
             {
                 /* set the sysvar */
-                result = VAR_Set( hVarServer,
-                                  pLeft->hVar,
-                                  &(pLeft->obj) );
+                result = SetVar( hVarServer, pLeft );
             }
         }
     }
@@ -868,7 +853,7 @@ int Inc( VARSERVER_HANDLE hVarServer,
              ( pVar->operation == VA_SYSVAR ) )
         {
             /* update the sysvar */
-            result = VAR_Set( hVarServer, pVar->hVar, &(pVar->obj) );
+            result = SetVar( hVarServer, pVar );
         }
     }
 
@@ -976,7 +961,7 @@ int Dec( VARSERVER_HANDLE hVarServer,
              ( pVar->operation == VA_SYSVAR ) )
         {
             /* update the sysvar */
-            result = VAR_Set( hVarServer, pVar->hVar, &(pVar->obj) );
+            result = SetVar( hVarServer, pVar );
         }
     }
 
@@ -0,0 +1,1386 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varbatch varbatch
+ * @brief Variable Action Script Batch Evaluation functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varbatch.c
+
+    Variable Action Script Batch Evaluation functions
+
+    The Batch Evaluation functions evaluate one expression for many
+    instances at once.  Each variable in the expression is bound to an
+    array holding its value for every instance (lane), and the expression
+    is evaluated one operation at a time across all of the lanes, instead
+    of once per instance tree.
+
+    VarActionCreateBatch() translates the expression tree into a list of
+    column operations.  Each node has a column of lane values: variables
+    use the caller's arrays, constants are repeated in every lane, and
+    each operation writes its own column.  The operations are simple
+    loops over arrays of a single type, which the compiler vectorizes
+    for the baseline instruction set of the target (SSE2 on x86-64, NEON
+    on AArch64).  With glibc on x86-64 the loops are also compiled for
+    AVX2, and the version for the running processor is selected when
+    the library is loaded.  Lanes are processed in blocks so the
+    intermediate columns stay in the cache.
+
+    The arithmetic, bitwise, comparison and logical operations are
+    supported for uint16, uint32 and float operands of the same type,
+    with the same results as the scalar operation functions.  An integer
+    division by zero produces zero in its lane.  The condition of an IF
+    expression is evaluated, and the lane mask records the lanes for
+    which it is true.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <varaction/varaction.h>
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! number of lanes evaluated by each pass over the operations */
+#define BATCH_BLOCK_SIZE        ( 512 )
+
+/*! initial number of columns and operations allocated for a batch */
+#define BATCH_INITIAL_SIZE      ( 16 )
+
+/*! column index used for the missing operand of a unary operation */
+#define BATCH_NONE              ( UINT32_MAX )
+
+/*! apply an expression to each lane of a block */
+#define BATCH_LOOP( expr )      for ( i = 0; i < n; i++ ) { expr; }
+
+/*! compile the lane loops for AVX2 as well as the baseline instruction
+ *  set.  The clones are selected by an indirect function, which needs
+ *  glibc */
+#if defined( __x86_64__ ) && defined( __GLIBC__ ) && defined( __has_attribute )
+#if __has_attribute( target_clones )
+#define BATCH_TARGETS \
+    __attribute__(( target_clones( "avx2", "default" ) ))
+#endif
+#endif
+
+#ifndef BATCH_TARGETS
+#define BATCH_TARGETS
+#endif
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! column of lane values */
+typedef struct _batchColumn
+{
+    /*! variable node bound to the column, or NULL for a computed or
+     *  constant column */
+    Variable *pVariable;
+
+    /*! type of the lane values */
+    int type;
+
+    /*! pointer to the lane values */
+    void *pValues;
+
+} BatchColumn;
+
+/*! column operation */
+typedef struct _batchStep
+{
+    /*! variable operation */
+    int operation;
+
+    /*! type of the operands */
+    int type;
+
+    /*! result column */
+    uint32_t dst;
+
+    /*! left operand column */
+    uint32_t a;
+
+    /*! right operand column, or BATCH_NONE */
+    uint32_t b;
+
+} BatchStep;
+
+/*! expression compiled for batch evaluation */
+struct _varBatch
+{
+    /*! maximum number of lanes */
+    size_t lanes;
+
+    /*! pointer to the column array */
+    BatchColumn *pColumns;
+
+    /*! number of columns */
+    size_t ncolumns;
+
+    /*! number of columns allocated */
+    size_t columnsize;
+
+    /*! pointer to the operation array */
+    BatchStep *pSteps;
+
+    /*! number of operations */
+    size_t nsteps;
+
+    /*! number of operations allocated */
+    size_t stepsize;
+
+    /*! result column */
+    uint32_t result;
+
+    /*! lane mask, non-zero for lanes with a non-zero result */
+    uint8_t *pMask;
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int CompileNode( VarBatch *pBatch,
+                        Variable *pVariable,
+                        uint32_t *pColumn );
+static int CompileConstant( VarBatch *pBatch,
+                            Variable *pVariable,
+                            uint32_t *pColumn );
+static int CompileInput( VarBatch *pBatch,
+                         Variable *pVariable,
+                         uint32_t *pColumn );
+static int CompileOperation( VarBatch *pBatch,
+                             Variable *pVariable,
+                             uint32_t *pColumn );
+static int ResultType( int operation, int type );
+static int AddColumn( VarBatch *pBatch,
+                      Variable *pVariable,
+                      int type,
+                      uint32_t *pColumn );
+static int AddStep( VarBatch *pBatch, BatchStep *pStep );
+static size_t TypeSize( int type );
+static void ExecStep( VarBatch *pBatch,
+                      BatchStep *pStep,
+                      size_t start,
+                      size_t n );
+static void ExecUint16( int operation,
+                        void *pDst,
+                        const void *pLeft,
+                        const void *pRight,
+                        size_t n );
+static void ExecUint32( int operation,
+                        void *pDst,
+                        const void *pLeft,
+                        const void *pRight,
+                        size_t n );
+static void ExecFloat( int operation,
+                       void *pDst,
+                       const void *pLeft,
+                       const void *pRight,
+                       size_t n );
+static void ExecMask( VarBatch *pBatch, size_t start, size_t n );
+static void *Lane( BatchColumn *pColumn, size_t index );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionCreateBatch                                                      */
+/*!
+    Compile an expression for batch evaluation
+
+    The VarActionCreateBatch function translates an expression tree into
+    column operations which evaluate it for up to the specified number
+    of instances at once.  The system and local variable nodes in the
+    expression are the batch inputs, which are bound to arrays of
+    instance values with VarActionSetBatchInput().
+
+    If the expression is an IF statement, its condition is compiled.
+
+@param[in]
+    pExpression
+        pointer to the expression tree
+
+@param[in]
+    lanes
+        maximum number of instances evaluated at once
+
+@retval pointer to the compiled batch
+@retval NULL if the batch could not be created, with errno set to
+        ENOTSUP if the expression uses an unsupported operation or type,
+        ENOMEM if memory could not be allocated, or EINVAL for an
+        invalid argument
+
+==============================================================================*/
+VarBatch *VarActionCreateBatch( Variable *pExpression, size_t lanes )
+{
+    VarBatch *pBatch = NULL;
+    int result = EINVAL;
+
+    if ( ( pExpression != NULL ) &&
+         ( lanes > 0 ) )
+    {
+        result = ENOMEM;
+        pBatch = calloc( 1, sizeof( VarBatch ) );
+        if ( pBatch != NULL )
+        {
+            pBatch->lanes = lanes;
+            pBatch->pMask = calloc( lanes, sizeof( uint8_t ) );
+            if ( pBatch->pMask != NULL )
+            {
+                if ( pExpression->operation == VA_IF )
+                {
+                    pExpression = pExpression->left;
+                }
+
+                result = CompileNode( pBatch, pExpression, &pBatch->result );
+            }
+        }
+    }
+
+    if ( result != EOK )
+    {
+        VarActionFreeBatch( pBatch );
+        pBatch = NULL;
+        errno = result;
+    }
+
+    return pBatch;
+}
+
+/*============================================================================*/
+/*  VarActionSetBatchInput                                                    */
+/*!
+    Bind a batch input to an array of instance values
+
+    The VarActionSetBatchInput function sets the array which holds the
+    value of a variable for each instance.  The array element type must
+    match the type of the variable: uint16_t, uint32_t or float.  The
+    array is not copied, and must remain valid while the batch is
+    executed.
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@param[in]
+    pVariable
+        pointer to the system or local variable node used in the
+        expression
+
+@param[in]
+    pValues
+        pointer to the array of instance values
+
+@retval EINVAL invalid argument
+@retval ENOENT the variable is not used by the expression
+@retval EOK the input was bound
+
+==============================================================================*/
+int VarActionSetBatchInput( VarBatch *pBatch,
+                            Variable *pVariable,
+                            const void *pValues )
+{
+    int result = EINVAL;
+    size_t i;
+
+    if ( ( pBatch != NULL ) &&
+         ( pVariable != NULL ) &&
+         ( pValues != NULL ) )
+    {
+        result = ENOENT;
+        for ( i = 0; i < pBatch->ncolumns; i++ )
+        {
+            if ( pBatch->pColumns[i].pVariable == pVariable )
+            {
+                pBatch->pColumns[i].pValues = (void *)pValues;
+                result = EOK;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionExecuteBatch                                                     */
+/*!
+    Evaluate a batch expression for a number of instances
+
+    The VarActionExecuteBatch function evaluates the expression for the
+    first n instances of its input arrays, and stores the result and
+    lane mask of each instance.
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@param[in]
+    n
+        number of instances to evaluate
+
+@retval EINVAL invalid argument, too many instances, or an unbound input
+@retval EOK the batch was evaluated
+
+==============================================================================*/
+int VarActionExecuteBatch( VarBatch *pBatch, size_t n )
+{
+    int result = EINVAL;
+    size_t start;
+    size_t count;
+    size_t i;
+
+    if ( ( pBatch != NULL ) &&
+         ( n <= pBatch->lanes ) )
+    {
+        result = EOK;
+        for ( i = 0; i < pBatch->ncolumns; i++ )
+        {
+            if ( pBatch->pColumns[i].pValues == NULL )
+            {
+                result = EINVAL;
+            }
+        }
+
+        for ( start = 0; ( result == EOK ) && ( start < n ); start += count )
+        {
+            count = n - start;
+            if ( count > BATCH_BLOCK_SIZE )
+            {
+                count = BATCH_BLOCK_SIZE;
+            }
+
+            for ( i = 0; i < pBatch->nsteps; i++ )
+            {
+                ExecStep( pBatch, &pBatch->pSteps[i], start, count );
+            }
+
+            ExecMask( pBatch, start, count );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionBatchResult                                                      */
+/*!
+    Get the per-instance results of a batch
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@param[out]
+    pType
+        pointer to the location to store the type of the results
+        (may be NULL)
+
+@retval pointer to the array of results, one per instance
+@retval NULL invalid argument
+
+==============================================================================*/
+const void *VarActionBatchResult( VarBatch *pBatch, VarType *pType )
+{
+    const void *pResult = NULL;
+
+    if ( pBatch != NULL )
+    {
+        pResult = pBatch->pColumns[pBatch->result].pValues;
+        if ( pType != NULL )
+        {
+            *pType = pBatch->pColumns[pBatch->result].type;
+        }
+    }
+
+    return pResult;
+}
+
+/*============================================================================*/
+/*  VarActionBatchMask                                                        */
+/*!
+    Get the lane mask of a batch
+
+    The lane mask holds a non-zero value for each instance whose result
+    is non-zero, that is, whose IF condition is true.
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@retval pointer to the array of lane mask values, one per instance
+@retval NULL invalid argument
+
+==============================================================================*/
+const uint8_t *VarActionBatchMask( VarBatch *pBatch )
+{
+    return ( pBatch != NULL ) ? pBatch->pMask : NULL;
+}
+
+/*============================================================================*/
+/*  VarActionFreeBatch                                                        */
+/*!
+    Free a batch
+
+    The input arrays and the expression tree are not affected.
+
+@param[in]
+    pBatch
+        pointer to the batch to free (may be NULL)
+
+==============================================================================*/
+void VarActionFreeBatch( VarBatch *pBatch )
+{
+    size_t i;
+
+    if ( pBatch != NULL )
+    {
+        for ( i = 0; i < pBatch->ncolumns; i++ )
+        {
+            if ( pBatch->pColumns[i].pVariable == NULL )
+            {
+                free( pBatch->pColumns[i].pValues );
+            }
+        }
+
+        free( pBatch->pColumns );
+        free( pBatch->pSteps );
+        free( pBatch->pMask );
+        free( pBatch );
+    }
+}
+
+/*============================================================================*/
+/*  CompileNode                                                               */
+/*!
+    Compile an expression node
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pVariable
+        pointer to the expression node
+
+@param[out]
+    pColumn
+        pointer to the location to store the node's column index
+
+@retval ENOTSUP unsupported operation or type
+@retval ENOMEM memory allocation failure
+@retval EOK the node was successfully compiled
+
+==============================================================================*/
+static int CompileNode( VarBatch *pBatch,
+                        Variable *pVariable,
+                        uint32_t *pColumn )
+{
+    int result = ENOTSUP;
+
+    if ( pVariable != NULL )
+    {
+        switch( pVariable->operation )
+        {
+            case VA_NUM:
+            case VA_FLOATNUM:
+                result = CompileConstant( pBatch, pVariable, pColumn );
+                break;
+
+            case VA_SYSVAR:
+            case VA_LOCALVAR:
+                result = CompileInput( pBatch, pVariable, pColumn );
+                break;
+
+            default:
+                result = CompileOperation( pBatch, pVariable, pColumn );
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileConstant                                                           */
+/*!
+    Compile a constant into a column holding its value in every lane
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pVariable
+        pointer to the constant node
+
+@param[out]
+    pColumn
+        pointer to the location to store the column index
+
+@retval ENOTSUP unsupported type
+@retval ENOMEM memory allocation failure
+@retval EOK the constant was successfully compiled
+
+==============================================================================*/
+static int CompileConstant( VarBatch *pBatch,
+                            Variable *pVariable,
+                            uint32_t *pColumn )
+{
+    int result;
+    size_t size = TypeSize( pVariable->obj.type );
+    uint8_t *p;
+    size_t i;
+
+    result = ( size > 0 ) ? AddColumn( pBatch,
+                                       NULL,
+                                       pVariable->obj.type,
+                                       pColumn )
+                          : ENOTSUP;
+    if ( result == EOK )
+    {
+        p = pBatch->pColumns[*pColumn].pValues;
+        for ( i = 0; i < pBatch->lanes; i++ )
+        {
+            memcpy( &p[i * size], &pVariable->obj.val, size );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileInput                                                              */
+/*!
+    Compile a variable into an input column
+
+    Each variable node has one input column, however many times it is
+    used in the expression.
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pVariable
+        pointer to the system or local variable node
+
+@param[out]
+    pColumn
+        pointer to the location to store the column index
+
+@retval ENOTSUP unsupported type
+@retval ENOMEM memory allocation failure
+@retval EOK the variable was successfully compiled
+
+==============================================================================*/
+static int CompileInput( VarBatch *pBatch,
+                         Variable *pVariable,
+                         uint32_t *pColumn )
+{
+    int result = ENOTSUP;
+    size_t i;
+
+    for ( i = 0; i < pBatch->ncolumns; i++ )
+    {
+        if ( pBatch->pColumns[i].pVariable == pVariable )
+        {
+            *pColumn = i;
+            result = EOK;
+            break;
+        }
+    }
+
+    if ( ( result != EOK ) &&
+         ( TypeSize( pVariable->obj.type ) > 0 ) )
+    {
+        result = AddColumn( pBatch, pVariable, pVariable->obj.type, pColumn );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileOperation                                                          */
+/*!
+    Compile an operation into a column operation
+
+    Both operands of a binary operation must have the same type.
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pVariable
+        pointer to the operation node
+
+@param[out]
+    pColumn
+        pointer to the location to store the result column index
+
+@retval ENOTSUP unsupported operation or type
+@retval ENOMEM memory allocation failure
+@retval EOK the operation was successfully compiled
+
+==============================================================================*/
+static int CompileOperation( VarBatch *pBatch,
+                             Variable *pVariable,
+                             uint32_t *pColumn )
+{
+    int result;
+    BatchStep step;
+    int type;
+
+    step.operation = pVariable->operation;
+    step.b = BATCH_NONE;
+
+    result = CompileNode( pBatch, pVariable->left, &step.a );
+    if ( ( result == EOK ) && ( step.operation != VA_NOT ) )
+    {
+        result = CompileNode( pBatch, pVariable->right, &step.b );
+        if ( ( result == EOK ) &&
+             ( pBatch->pColumns[step.a].type !=
+               pBatch->pColumns[step.b].type ) )
+        {
+            result = ENOTSUP;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        step.type = pBatch->pColumns[step.a].type;
+        type = ResultType( step.operation, step.type );
+        result = ( type != VARTYPE_INVALID )
+                 ? AddColumn( pBatch, NULL, type, &step.dst )
+                 : ENOTSUP;
+    }
+
+    if ( result == EOK )
+    {
+        result = AddStep( pBatch, &step );
+        *pColumn = step.dst;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResultType                                                                */
+/*!
+    Get the result type of an operation
+
+@param[in]
+    operation
+        the variable operation
+
+@param[in]
+    type
+        the type of the operands
+
+@retval the type of the result
+@retval VARTYPE_INVALID the operation is not supported for the type
+
+==============================================================================*/
+static int ResultType( int operation, int type )
+{
+    int result = VARTYPE_INVALID;
+
+    switch( operation )
+    {
+        case VA_ADD:
+        case VA_SUB:
+        case VA_MUL:
+        case VA_DIV:
+            result = type;
+            break;
+
+        case VA_BAND:
+        case VA_BOR:
+        case VA_XOR:
+        case VA_LSHIFT:
+        case VA_RSHIFT:
+            if ( type != VARTYPE_FLOAT )
+            {
+                result = type;
+            }
+            break;
+
+        case VA_EQUALS:
+        case VA_NOTEQUALS:
+        case VA_GT:
+        case VA_LT:
+        case VA_GTE:
+        case VA_LTE:
+        case VA_NOT:
+            result = VARTYPE_UINT16;
+            break;
+
+        case VA_AND:
+        case VA_OR:
+            if ( type != VARTYPE_FLOAT )
+            {
+                result = VARTYPE_UINT16;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddColumn                                                                 */
+/*!
+    Add a column to a batch
+
+    Columns which are not bound to a variable are allocated with one
+    value for each lane.
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pVariable
+        pointer to the variable bound to the column, or NULL
+
+@param[in]
+    type
+        type of the lane values
+
+@param[out]
+    pColumn
+        pointer to the location to store the column index
+
+@retval ENOMEM memory allocation failure
+@retval EOK the column was added
+
+==============================================================================*/
+static int AddColumn( VarBatch *pBatch,
+                      Variable *pVariable,
+                      int type,
+                      uint32_t *pColumn )
+{
+    int result = EOK;
+    size_t columnsize;
+    BatchColumn *pColumns;
+    BatchColumn *pNew;
+
+    if ( pBatch->ncolumns >= pBatch->columnsize )
+    {
+        columnsize = ( pBatch->columnsize == 0 ) ? BATCH_INITIAL_SIZE
+                                                 : pBatch->columnsize * 2;
+        pColumns = realloc( pBatch->pColumns,
+                            columnsize * sizeof( BatchColumn ) );
+        if ( pColumns != NULL )
+        {
+            pBatch->pColumns = pColumns;
+            pBatch->columnsize = columnsize;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pNew = &pBatch->pColumns[pBatch->ncolumns];
+        pNew->pVariable = pVariable;
+        pNew->type = type;
+        pNew->pValues = NULL;
+
+        if ( pVariable == NULL )
+        {
+            pNew->pValues = calloc( pBatch->lanes, TypeSize( type ) );
+            if ( pNew->pValues == NULL )
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            *pColumn = pBatch->ncolumns++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddStep                                                                   */
+/*!
+    Append a column operation to a batch
+
+@param[in]
+    pBatch
+        pointer to the batch being compiled
+
+@param[in]
+    pStep
+        pointer to the operation to append
+
+@retval ENOMEM memory allocation failure
+@retval EOK the operation was appended
+
+==============================================================================*/
+static int AddStep( VarBatch *pBatch, BatchStep *pStep )
+{
+    int result = EOK;
+    size_t stepsize;
+    BatchStep *pSteps;
+
+    if ( pBatch->nsteps >= pBatch->stepsize )
+    {
+        stepsize = ( pBatch->stepsize == 0 ) ? BATCH_INITIAL_SIZE
+                                             : pBatch->stepsize * 2;
+        pSteps = realloc( pBatch->pSteps, stepsize * sizeof( BatchStep ) );
+        if ( pSteps != NULL )
+        {
+            pBatch->pSteps = pSteps;
+            pBatch->stepsize = stepsize;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pBatch->pSteps[pBatch->nsteps++] = *pStep;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TypeSize                                                                  */
+/*!
+    Get the size of a lane value
+
+@param[in]
+    type
+        type of the lane value
+
+@retval the size of the value in bytes
+@retval 0 the type cannot be evaluated in a batch
+
+==============================================================================*/
+static size_t TypeSize( int type )
+{
+    size_t size;
+
+    switch( type )
+    {
+        case VARTYPE_UINT16:
+            size = sizeof( uint16_t );
+            break;
+
+        case VARTYPE_UINT32:
+            size = sizeof( uint32_t );
+            break;
+
+        case VARTYPE_FLOAT:
+            size = sizeof( float );
+            break;
+
+        default:
+            size = 0;
+            break;
+    }
+
+    return size;
+}
+
+/*============================================================================*/
+/*  ExecStep                                                                  */
+/*!
+    Evaluate a column operation for a block of lanes
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@param[in]
+    pStep
+        pointer to the operation
+
+@param[in]
+    start
+        index of the first lane
+
+@param[in]
+    n
+        number of lanes
+
+==============================================================================*/
+static void ExecStep( VarBatch *pBatch,
+                      BatchStep *pStep,
+                      size_t start,
+                      size_t n )
+{
+    void *pDst = Lane( &pBatch->pColumns[pStep->dst], start );
+    void *pLeft = Lane( &pBatch->pColumns[pStep->a], start );
+    void *pRight = ( pStep->b != BATCH_NONE )
+                   ? Lane( &pBatch->pColumns[pStep->b], start )
+                   : NULL;
+
+    switch( pStep->type )
+    {
+        case VARTYPE_UINT16:
+            ExecUint16( pStep->operation, pDst, pLeft, pRight, n );
+            break;
+
+        case VARTYPE_UINT32:
+            ExecUint32( pStep->operation, pDst, pLeft, pRight, n );
+            break;
+
+        default:
+            ExecFloat( pStep->operation, pDst, pLeft, pRight, n );
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  ExecUint16                                                                */
+/*!
+    Evaluate an operation on uint16 lanes
+
+    Shift counts are limited to 31, and integer division by zero
+    produces zero.
+
+@param[in]
+    operation
+        the variable operation
+
+@param[out]
+    pDst
+        pointer to the result lanes
+
+@param[in]
+    pLeft
+        pointer to the left operand lanes
+
+@param[in]
+    pRight
+        pointer to the right operand lanes (NULL for VA_NOT)
+
+@param[in]
+    n
+        number of lanes
+
+==============================================================================*/
+BATCH_TARGETS
+static void ExecUint16( int operation,
+                        void *pDst,
+                        const void *pLeft,
+                        const void *pRight,
+                        size_t n )
+{
+    uint16_t * restrict d = pDst;
+    const uint16_t * restrict l = pLeft;
+    const uint16_t * restrict r = pRight;
+    size_t i;
+
+    switch( operation )
+    {
+        case VA_ADD:
+            BATCH_LOOP( d[i] = (uint16_t)( l[i] + r[i] ) );
+            break;
+
+        case VA_SUB:
+            BATCH_LOOP( d[i] = (uint16_t)( l[i] - r[i] ) );
+            break;
+
+        case VA_MUL:
+            BATCH_LOOP( d[i] = (uint16_t)( (uint32_t)l[i] * r[i] ) );
+            break;
+
+        case VA_DIV:
+            BATCH_LOOP( d[i] = ( r[i] != 0 ) ? l[i] / r[i] : 0 );
+            break;
+
+        case VA_BAND:
+            BATCH_LOOP( d[i] = l[i] & r[i] );
+            break;
+
+        case VA_BOR:
+            BATCH_LOOP( d[i] = l[i] | r[i] );
+            break;
+
+        case VA_XOR:
+            BATCH_LOOP( d[i] = l[i] ^ r[i] );
+            break;
+
+        case VA_LSHIFT:
+            BATCH_LOOP( d[i] = (uint16_t)( (uint32_t)l[i] << ( r[i] & 31 ) ) );
+            break;
+
+        case VA_RSHIFT:
+            BATCH_LOOP( d[i] = (uint16_t)( (uint32_t)l[i] >> ( r[i] & 31 ) ) );
+            break;
+
+        case VA_EQUALS:
+            BATCH_LOOP( d[i] = ( l[i] == r[i] ) );
+            break;
+
+        case VA_NOTEQUALS:
+            BATCH_LOOP( d[i] = ( l[i] != r[i] ) );
+            break;
+
+        case VA_GT:
+            BATCH_LOOP( d[i] = ( l[i] > r[i] ) );
+            break;
+
+        case VA_LT:
+            BATCH_LOOP( d[i] = ( l[i] < r[i] ) );
+            break;
+
+        case VA_GTE:
+            BATCH_LOOP( d[i] = ( l[i] >= r[i] ) );
+            break;
+
+        case VA_LTE:
+            BATCH_LOOP( d[i] = ( l[i] <= r[i] ) );
+            break;
+
+        case VA_AND:
+            BATCH_LOOP( d[i] = ( l[i] != 0 ) & ( r[i] != 0 ) );
+            break;
+
+        case VA_OR:
+            BATCH_LOOP( d[i] = ( l[i] != 0 ) | ( r[i] != 0 ) );
+            break;
+
+        case VA_NOT:
+            BATCH_LOOP( d[i] = ( l[i] == 0 ) );
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  ExecUint32                                                                */
+/*!
+    Evaluate an operation on uint32 lanes
+
+    Comparison and logical results are stored as uint16 lanes.  Shift
+    counts are limited to 31, and integer division by zero produces zero.
+
+@param[in]
+    operation
+        the variable operation
+
+@param[out]
+    pDst
+        pointer to the result lanes
+
+@param[in]
+    pLeft
+        pointer to the left operand lanes
+
+@param[in]
+    pRight
+        pointer to the right operand lanes (NULL for VA_NOT)
+
+@param[in]
+    n
+        number of lanes
+
+==============================================================================*/
+BATCH_TARGETS
+static void ExecUint32( int operation,
+                        void *pDst,
+                        const void *pLeft,
+                        const void *pRight,
+                        size_t n )
+{
+    uint32_t * restrict d = pDst;
+    uint16_t * restrict flag = pDst;
+    const uint32_t * restrict l = pLeft;
+    const uint32_t * restrict r = pRight;
+    size_t i;
+
+    switch( operation )
+    {
+        case VA_ADD:
+            BATCH_LOOP( d[i] = l[i] + r[i] );
+            break;
+
+        case VA_SUB:
+            BATCH_LOOP( d[i] = l[i] - r[i] );
+            break;
+
+        case VA_MUL:
+            BATCH_LOOP( d[i] = l[i] * r[i] );
+            break;
+
+        case VA_DIV:
+            BATCH_LOOP( d[i] = ( r[i] != 0 ) ? l[i] / r[i] : 0 );
+            break;
+
+        case VA_BAND:
+            BATCH_LOOP( d[i] = l[i] & r[i] );
+            break;
+
+        case VA_BOR:
+            BATCH_LOOP( d[i] = l[i] | r[i] );
+            break;
+
+        case VA_XOR:
+            BATCH_LOOP( d[i] = l[i] ^ r[i] );
+            break;
+
+        case VA_LSHIFT:
+            BATCH_LOOP( d[i] = l[i] << ( r[i] & 31 ) );
+            break;
+
+        case VA_RSHIFT:
+            BATCH_LOOP( d[i] = l[i] >> ( r[i] & 31 ) );
+            break;
+
+        case VA_EQUALS:
+            BATCH_LOOP( flag[i] = ( l[i] == r[i] ) );
+            break;
+
+        case VA_NOTEQUALS:
+            BATCH_LOOP( flag[i] = ( l[i] != r[i] ) );
+            break;
+
+        case VA_GT:
+            BATCH_LOOP( flag[i] = ( l[i] > r[i] ) );
+            break;
+
+        case VA_LT:
+            BATCH_LOOP( flag[i] = ( l[i] < r[i] ) );
+            break;
+
+        case VA_GTE:
+            BATCH_LOOP( flag[i] = ( l[i] >= r[i] ) );
+            break;
+
+        case VA_LTE:
+            BATCH_LOOP( flag[i] = ( l[i] <= r[i] ) );
+            break;
+
+        case VA_AND:
+            BATCH_LOOP( flag[i] = ( l[i] != 0 ) & ( r[i] != 0 ) );
+            break;
+
+        case VA_OR:
+            BATCH_LOOP( flag[i] = ( l[i] != 0 ) | ( r[i] != 0 ) );
+            break;
+
+        case VA_NOT:
+            BATCH_LOOP( flag[i] = ( l[i] == 0 ) );
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  ExecFloat                                                                 */
+/*!
+    Evaluate an operation on float lanes
+
+    Comparison and logical results are stored as uint16 lanes.
+
+@param[in]
+    operation
+        the variable operation
+
+@param[out]
+    pDst
+        pointer to the result lanes
+
+@param[in]
+    pLeft
+        pointer to the left operand lanes
+
+@param[in]
+    pRight
+        pointer to the right operand lanes (NULL for VA_NOT)
+
+@param[in]
+    n
+        number of lanes
+
+==============================================================================*/
+BATCH_TARGETS
+static void ExecFloat( int operation,
+                       void *pDst,
+                       const void *pLeft,
+                       const void *pRight,
+                       size_t n )
+{
+    float * restrict d = pDst;
+    uint16_t * restrict flag = pDst;
+    const float * restrict l = pLeft;
+    const float * restrict r = pRight;
+    size_t i;
+
+    switch( operation )
+    {
+        case VA_ADD:
+            BATCH_LOOP( d[i] = l[i] + r[i] );
+            break;
+
+        case VA_SUB:
+            BATCH_LOOP( d[i] = l[i] - r[i] );
+            break;
+
+        case VA_MUL:
+            BATCH_LOOP( d[i] = l[i] * r[i] );
+            break;
+
+        case VA_DIV:
+            BATCH_LOOP( d[i] = l[i] / r[i] );
+            break;
+
+        case VA_EQUALS:
+            BATCH_LOOP( flag[i] = ( l[i] == r[i] ) );
+            break;
+
+        case VA_NOTEQUALS:
+            BATCH_LOOP( flag[i] = ( l[i] != r[i] ) );
+            break;
+
+        case VA_GT:
+            BATCH_LOOP( flag[i] = ( l[i] > r[i] ) );
+            break;
+
+        case VA_LT:
+            BATCH_LOOP( flag[i] = ( l[i] < r[i] ) );
+            break;
+
+        case VA_GTE:
+            BATCH_LOOP( flag[i] = ( l[i] >= r[i] ) );
+            break;
+
+        case VA_LTE:
+            BATCH_LOOP( flag[i] = ( l[i] <= r[i] ) );
+            break;
+
+        case VA_NOT:
+            BATCH_LOOP( flag[i] = ( l[i] == 0.0f ) );
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  ExecMask                                                                  */
+/*!
+    Calculate the lane mask for a block of lanes
+
+@param[in]
+    pBatch
+        pointer to the batch
+
+@param[in]
+    start
+        index of the first lane
+
+@param[in]
+    n
+        number of lanes
+
+==============================================================================*/
+static void ExecMask( VarBatch *pBatch, size_t start, size_t n )
+{
+    BatchColumn *pColumn = &pBatch->pColumns[pBatch->result];
+    uint8_t * restrict m = &pBatch->pMask[start];
+    const uint16_t *u16 = Lane( pColumn, start );
+    const uint32_t *u32 = Lane( pColumn, start );
+    const float *f = Lane( pColumn, start );
+    size_t i;
+
+    switch( pColumn->type )
+    {
+        case VARTYPE_UINT16:
+            BATCH_LOOP( m[i] = ( u16[i] != 0 ) );
+            break;
+
+        case VARTYPE_UINT32:
+            BATCH_LOOP( m[i] = ( u32[i] != 0 ) );
+            break;
+
+        default:
+            BATCH_LOOP( m[i] = ( f[i] != 0.0f ) );
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  Lane                                                                      */
+/*!
+    Get the address of a lane value in a column
+
+@param[in]
+    pColumn
+        pointer to the column
+
+@param[in]
+    index
+        index of the lane
+
+@retval pointer to the lane value
+
+==============================================================================*/
+static void *Lane( BatchColumn *pColumn, size_t index )
+{
+    return (uint8_t *)pColumn->pValues + ( index * TypeSize( pColumn->type ) );
+}
+
+/*! @}
+ * end of varbatch group */
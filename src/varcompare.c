@@ -53,6 +53,7 @@ SOFTWARE.
 #include <errno.h>
 #include <syslog.h>
 #include "varcompare.h"
+#include "varstrings.h"
 
 /*==============================================================================
        Function declarations
@@ -65,7 +66,9 @@ SOFTWARE.
 
     The Equals function performs a comparison of its two arguments.
 
-    If the arguments are strings, the strcmp() function is used.
+    If the arguments are strings, they are compared with CompareStrings(),
+    which rejects strings of different lengths, and different interned
+    strings, without comparing their bytes.
     If the arguments are numbers, they are directly compared.
 
     result = left == right
@@ -121,32 +124,7 @@ int Equals( VARSERVER_HANDLE hVarServer,
                 break;
 
             case VARTYPE_STR:
-                if( ( pLeft->obj.val.str == NULL ) &&
-                    ( pRight->obj.val.str == NULL ) )
-                {
-                    /* both strings are empty */
-                    val = true;
-                }
-                else if ( ( pLeft->obj.val.str == NULL ) ||
-                          ( pRight->obj.val.str == NULL ) )
-                {
-                    /* one of the strings is empty and the other is not */
-                    val = false;
-                }
-                else
-                {
-                    if (strcmp( pLeft->obj.val.str, pRight->obj.val.str ) == 0 )
-                    {
-                        /* strings match */
-                        val = true;
-                    }
-                    else
-                    {
-                        /* strings don't match */
-                        val = false;
-                    }
-                }
-
+                val = ( CompareStrings( pLeft, pRight, true ) == 0 );
                 break;
 
             default:
@@ -209,10 +187,10 @@ int NotEquals( VARSERVER_HANDLE hVarServer,
 
     /* perform equals evaluation and invert the result */
     result = Equals( hVarServer, pResult, pLeft, pRight );
-    if( pResult == EOK )
+    if( result == EOK )
     {
         /* invert the result */
-        pResult->obj.val.ui == true ? false : true;
+        pResult->obj.val.ui = ( pResult->obj.val.ui == 0 ) ? true : false;
     }
 
     return result;
@@ -0,0 +1,321 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varcontext varcontext
+ * @brief Variable action evaluation contexts
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varcontext.c
+
+    Variable action evaluation contexts
+
+    An evaluation context owns all of the mutable state used to build
+    and evaluate a set of statements: the local declaration and system
+    variable symbol tables, the node arena, the evaluation options,
+    the prefetch and deferred write lists, the profile statistics and
+    the timers.
+
+    Each thread has a current context which is used by all of the
+    varaction functions called on that thread.  Threads which have not
+    selected a context use the default context, which preserves the
+    behavior of single threaded applications.
+
+    Intermediate results are stored in the parse tree nodes, and each
+    context has its own system variable nodes, so the statements built
+    in a context must only be evaluated in that context.  A context may
+    be used by only one thread at a time, but independent contexts can
+    be evaluated concurrently on different threads.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include "varcontext.h"
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! context used by threads which have not selected a context */
+static VarActionContext g_defaultContext;
+
+/*! the current context of the calling thread (NULL for the default) */
+static __thread VarActionContext *g_pContext = NULL;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static void FreeSysvarNodes( Variable *pVariable );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  GetContext                                                                */
+/*!
+    Get the current evaluation context
+
+    The GetContext function gets the evaluation context selected by
+    the calling thread, or the default context if the thread has not
+    selected one.
+
+@retval pointer to the current evaluation context
+
+==============================================================================*/
+VarActionContext *GetContext( void )
+{
+    return ( g_pContext != NULL ) ? g_pContext : &g_defaultContext;
+}
+
+/*============================================================================*/
+/*  VarActionCreateContext                                                    */
+/*!
+    Create an evaluation context
+
+    The VarActionCreateContext function creates a new, empty evaluation
+    context.  Select the context with VarActionSetContext() before
+    building the statements which will be evaluated in it.
+
+@retval pointer to the new context
+@retval NULL if the context could not be created
+
+==============================================================================*/
+VarActionContext *VarActionCreateContext( void )
+{
+    return calloc( 1, sizeof( VarActionContext ) );
+}
+
+/*============================================================================*/
+/*  VarActionSetContext                                                       */
+/*!
+    Select the evaluation context for the calling thread
+
+    The VarActionSetContext function selects the evaluation context used
+    by subsequent varaction calls on the calling thread.
+
+@param[in]
+    pContext
+        pointer to the context to select, or NULL to select the
+        default context
+
+@retval pointer to the previously selected context (may be NULL)
+
+==============================================================================*/
+VarActionContext *VarActionSetContext( VarActionContext *pContext )
+{
+    VarActionContext *pPrev = g_pContext;
+
+    g_pContext = ( pContext == &g_defaultContext ) ? NULL : pContext;
+
+    return pPrev;
+}
+
+/*============================================================================*/
+/*  VarActionFreeContext                                                      */
+/*!
+    Free an evaluation context
+
+    The VarActionFreeContext function deletes the timers of the context
+    and releases its symbol tables, interned string constants, lists,
+    statistics and system variable nodes.  The statements built in the
+    context must not be evaluated after it has been freed, and the
+    context must not be selected by any other thread.  The default
+    context cannot be freed.
+
+@param[in]
+    pContext
+        pointer to the context to free
+
+==============================================================================*/
+void VarActionFreeContext( VarActionContext *pContext )
+{
+    int i;
+
+    if ( ( pContext != NULL ) &&
+         ( pContext != &g_defaultContext ) )
+    {
+        if ( g_pContext == pContext )
+        {
+            g_pContext = NULL;
+        }
+
+        for ( i = 0; i < MAX_TIMERS; i++ )
+        {
+            if ( pContext->timers[i] != 0 )
+            {
+                timer_delete( pContext->timers[i] );
+            }
+        }
+
+        FreeTimerWheel( pContext->pWheel );
+        ClearSymbols( &pContext->locals );
+        ClearSymbols( &pContext->sysvars );
+        ClearSymbols( &pContext->handles );
+        ClearStrings( &pContext->strings );
+        FreeSysvars( &pContext->prefetch );
+        FreeSysvars( &pContext->writes );
+        FreeSysvarNodes( pContext->pFirstSysvar );
+        free( pContext->pStatements );
+        free( pContext->ppTimerActions );
+        free( pContext );
+    }
+}
+
+/*============================================================================*/
+/*  ProcessCompoundStatementCtx                                               */
+/*!
+    Process a compound statement in an evaluation context
+
+    The ProcessCompoundStatementCtx function selects the specified
+    context on the calling thread, processes the statements, and
+    restores the previously selected context.
+
+@param[in]
+    pContext
+        pointer to the context the statements were built in
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pStatements
+        pointer to the statement list to process
+
+@retval EOK the statements were processed successfully
+@retval EINVAL invalid arguments
+@retval other error returned by ProcessCompoundStatement
+
+==============================================================================*/
+int ProcessCompoundStatementCtx( VarActionContext *pContext,
+                                 VARSERVER_HANDLE hVarServer,
+                                 Statement *pStatements )
+{
+    int result = EINVAL;
+    VarActionContext *pPrev;
+
+    if ( pContext != NULL )
+    {
+        pPrev = VarActionSetContext( pContext );
+        result = ProcessCompoundStatement( hVarServer, pStatements );
+        (void)VarActionSetContext( pPrev );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ExecProgramCtx                                                            */
+/*!
+    Execute a compiled program in an evaluation context
+
+    The ExecProgramCtx function selects the specified context on the
+    calling thread, executes the program, and restores the previously
+    selected context.
+
+@param[in]
+    pContext
+        pointer to the context the program's statements were built in
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pProgram
+        pointer to the program to execute
+
+@retval EOK the program was executed successfully
+@retval EINVAL invalid arguments
+@retval other error returned by ExecProgram
+
+==============================================================================*/
+int ExecProgramCtx( VarActionContext *pContext,
+                    VARSERVER_HANDLE hVarServer,
+                    VarProgram *pProgram )
+{
+    int result = EINVAL;
+    VarActionContext *pPrev;
+
+    if ( pContext != NULL )
+    {
+        pPrev = VarActionSetContext( pContext );
+        result = ExecProgram( hVarServer, pProgram );
+        (void)VarActionSetContext( pPrev );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FreeSysvarNodes                                                           */
+/*!
+    Free the system variable nodes of a context
+
+    The FreeSysvarNodes function frees each node in a system variable
+    list, along with its identifier and any string buffer it owns.
+
+@param[in]
+    pVariable
+        pointer to the first system variable in the list
+
+==============================================================================*/
+static void FreeSysvarNodes( Variable *pVariable )
+{
+    Variable *pNext;
+
+    while ( pVariable != NULL )
+    {
+        pNext = pVariable->pNext;
+
+        if ( pVariable->flags & VF_HEAP_STR )
+        {
+            free( pVariable->obj.val.str );
+        }
+
+        free( pVariable->id );
+        free( pVariable );
+
+        pVariable = pNext;
+    }
+}
+
+/*! @}
+ * end of varcontext group */
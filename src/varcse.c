@@ -0,0 +1,785 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varcse varcse
+ * @brief Variable Action Script Common Subexpression functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varcse.c
+
+    Variable Action Script Common Subexpression functions
+
+    The Common Subexpression functions merge structurally identical
+    expressions within a statement list into a single shared node, which
+    is evaluated at most once while its inputs are unchanged.
+
+    VarActionShareExpressions() visits the variable trees of a statement
+    list, including the statements in the then and else blocks of IF
+    statements, from the leaves up.  Each arithmetic, bitwise, comparison
+    and type cast node whose operands are system variables, local
+    variables, constants or other such nodes is looked up in a hash table
+    keyed by its operation and its (already shared) operands.  A node
+    which matches an earlier node is replaced by the earlier node, which
+    is marked VF_SHARED, and is released.
+
+    Shared values are stamped with a clock which advances at the start of
+    each outermost compound statement and each time a variable is
+    written.  A shared node is reused while it was evaluated within the
+    current outermost compound statement and none of the variables it
+    reads have been written since.  Values are not reused outside of a
+    compound statement, while a compiled program is executed, or across
+    a script statement, which may change system variables.
+
+    Call VarActionShareExpressions() before compiling the statements, or
+    building a dependency index or image from them.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "varcse.h"
+#include "varstrings.h"
+#include "varformat.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of slots in the expression table (a power of two) */
+#define CSE_INITIAL_SIZE        ( 64 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! open addressed table of the distinct expressions in a statement list */
+typedef struct _cseTable
+{
+    /*! pointer to the array of slots */
+    Variable **ppSlots;
+
+    /*! number of slots (a power of two) */
+    size_t size;
+
+    /*! number of slots in use */
+    size_t n;
+
+} CseTable;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int ShareStatements( CseTable *pTable, Statement *pStatements );
+static int ShareNode( CseTable *pTable,
+                      Variable *pVariable,
+                      Variable **ppShared );
+static bool IsShareable( int operation );
+static bool IsLeaf( Variable *pVariable );
+static bool IsConstant( Variable *pVariable );
+static size_t Hash( Variable *pVariable );
+static bool Match( Variable *p1, Variable *p2 );
+static int Lookup( CseTable *pTable,
+                   Variable *pVariable,
+                   Variable **ppShared );
+static int Grow( CseTable *pTable );
+static bool Unchanged( Variable *pVariable, uint64_t stamp );
+static void Discard( Variable *pVariable );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionShareExpressions                                                 */
+/*!
+    Merge the common subexpressions of a statement list
+
+    The VarActionShareExpressions function replaces each repeated
+    side-effect free expression in a statement list with a single shared
+    node, so the expression, and the system variables it reads, are
+    evaluated once per compound statement execution instead of once for
+    each copy.
+
+    Statement evaluation results are unchanged.  Duplicate nodes which
+    were not allocated from an arena are freed.
+
+@param[in]
+    pStatements
+        pointer to the statement list to transform
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval EOK the expressions were successfully shared
+
+==============================================================================*/
+int VarActionShareExpressions( Statement *pStatements )
+{
+    int result = EINVAL;
+    CseTable table;
+
+    if ( pStatements != NULL )
+    {
+        table.size = CSE_INITIAL_SIZE;
+        table.n = 0;
+        table.ppSlots = calloc( table.size, sizeof( Variable * ) );
+        if ( table.ppSlots != NULL )
+        {
+            result = ShareStatements( &table, pStatements );
+            free( table.ppSlots );
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SharedCurrent                                                             */
+/*!
+    Check if the value of a shared node can be reused
+
+    The SharedCurrent function checks if a VF_SHARED node has been
+    evaluated within the current outermost compound statement, and none
+    of the variables it reads have been written since.
+
+@param[in]
+    pVariable
+        pointer to the shared node
+
+@retval true the node holds its current value
+@retval false the node must be evaluated
+
+==============================================================================*/
+bool SharedCurrent( Variable *pVariable )
+{
+    VarActionContext *pContext = GetContext();
+    bool result = false;
+
+    if ( ( pContext->epoch != 0 ) &&
+         ( pVariable->stamp >= pContext->epoch ) )
+    {
+        result = Unchanged( pVariable->left, pVariable->stamp ) &&
+                 Unchanged( pVariable->right, pVariable->stamp );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StampShared                                                               */
+/*!
+    Record the evaluation of a node
+
+    The StampShared function is called after a node has been evaluated
+    successfully within a compound statement.  A shared node is stamped
+    with the current clock, and the target of an assignment is stamped
+    with a new clock value, so shared nodes which read it are evaluated
+    again.
+
+@param[in]
+    pContext
+        pointer to the current evaluation context
+
+@param[in]
+    pVariable
+        pointer to the node which was evaluated
+
+==============================================================================*/
+void StampShared( VarActionContext *pContext, Variable *pVariable )
+{
+    switch( pVariable->operation )
+    {
+        case VA_ASSIGN:
+        case VA_AND_EQUALS:
+        case VA_OR_EQUALS:
+        case VA_XOR_EQUALS:
+        case VA_DIV_EQUALS:
+        case VA_TIMES_EQUALS:
+        case VA_PLUS_EQUALS:
+        case VA_MINUS_EQUALS:
+        case VA_INC:
+        case VA_DEC:
+            if ( pVariable->left != NULL )
+            {
+                pVariable->left->stamp = ++pContext->clock;
+            }
+            break;
+
+        default:
+            if ( pVariable->flags & VF_SHARED )
+            {
+                pVariable->stamp = pContext->clock;
+            }
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  InvalidateShared                                                          */
+/*!
+    Discard the values of all shared nodes
+
+    The InvalidateShared function is called when system variables may
+    have been changed outside of the statements being evaluated, so
+    every shared node is evaluated again when it is next used.
+
+==============================================================================*/
+void InvalidateShared( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pContext->epoch != 0 )
+    {
+        pContext->epoch = ++pContext->clock;
+    }
+}
+
+/*============================================================================*/
+/*  SuspendShared                                                             */
+/*!
+    Stop reusing shared values until the outermost compound statement ends
+
+    The SuspendShared function is called by ExecProgram(), whose inline
+    instructions write variables without stamping them.
+
+==============================================================================*/
+void SuspendShared( void )
+{
+    GetContext()->epoch = 0;
+}
+
+/*============================================================================*/
+/*  ShareStatements                                                           */
+/*!
+    Share the expressions of a statement list
+
+@param[in]
+    pTable
+        pointer to the expression table
+
+@param[in]
+    pStatements
+        pointer to the statement list (may be NULL)
+
+@retval ENOMEM memory allocation failure
+@retval EOK the expressions were successfully shared
+
+==============================================================================*/
+static int ShareStatements( CseTable *pTable, Statement *pStatements )
+{
+    int result = EOK;
+    Statement *pStatement = pStatements;
+    Variable *pShared;
+
+    while ( ( pStatement != NULL ) && ( result == EOK ) )
+    {
+        if ( pStatement->pVariable != NULL )
+        {
+            /* the root of a statement is never replaced */
+            result = ShareNode( pTable, pStatement->pVariable, &pShared );
+        }
+
+        pStatement = pStatement->pNext;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ShareNode                                                                 */
+/*!
+    Share the expressions of a variable tree
+
+    The ShareNode function shares the operands of a node, and then looks
+    up the node itself if it is a shareable expression.
+
+@param[in]
+    pTable
+        pointer to the expression table
+
+@param[in]
+    pVariable
+        pointer to the node to share
+
+@param[out]
+    ppShared
+        pointer to the location to store the node which should replace
+        pVariable in its parent, or NULL if pVariable is not a shareable
+        expression
+
+@retval ENOMEM memory allocation failure
+@retval EOK the expressions were successfully shared
+
+==============================================================================*/
+static int ShareNode( CseTable *pTable,
+                      Variable *pVariable,
+                      Variable **ppShared )
+{
+    int result = EOK;
+    Variable *pLeft = NULL;
+    Variable *pRight = NULL;
+
+    *ppShared = NULL;
+
+    if ( IsLeaf( pVariable ) == true )
+    {
+        if ( IsConstant( pVariable ) == true )
+        {
+            result = Lookup( pTable, pVariable, ppShared );
+        }
+        else
+        {
+            *ppShared = pVariable;
+        }
+    }
+    else if ( pVariable->operation == VA_ELSE )
+    {
+        /* the ELSE node references the then and else compound statements */
+        result = ShareStatements( pTable, (Statement *)pVariable->left );
+        if ( result == EOK )
+        {
+            result = ShareStatements( pTable, (Statement *)pVariable->right );
+        }
+    }
+    else
+    {
+        if ( pVariable->left != NULL )
+        {
+            result = ShareNode( pTable, pVariable->left, &pLeft );
+            if ( pLeft != NULL )
+            {
+                pVariable->left = pLeft;
+            }
+        }
+
+        if ( ( result == EOK ) && ( pVariable->right != NULL ) )
+        {
+            result = ShareNode( pTable, pVariable->right, &pRight );
+            if ( pRight != NULL )
+            {
+                pVariable->right = pRight;
+            }
+        }
+
+        if ( ( result == EOK ) &&
+             ( IsShareable( pVariable->operation ) == true ) &&
+             ( ( pVariable->left == NULL ) || ( pLeft != NULL ) ) &&
+             ( ( pVariable->right == NULL ) || ( pRight != NULL ) ) )
+        {
+            result = Lookup( pTable, pVariable, ppShared );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  IsShareable                                                               */
+/*!
+    Check if an operation is free of side effects
+
+    The arithmetic, bitwise, comparison and type cast operations only
+    compute their result from their operands.
+
+@param[in]
+    operation
+        the variable operation
+
+@retval true the operation can be shared
+@retval false the operation cannot be shared
+
+==============================================================================*/
+static bool IsShareable( int operation )
+{
+    bool result;
+
+    switch( operation )
+    {
+        case VA_MUL:
+        case VA_DIV:
+        case VA_ADD:
+        case VA_SUB:
+        case VA_BAND:
+        case VA_BOR:
+        case VA_XOR:
+        case VA_LSHIFT:
+        case VA_RSHIFT:
+        case VA_EQUALS:
+        case VA_NOTEQUALS:
+        case VA_GT:
+        case VA_LT:
+        case VA_GTE:
+        case VA_LTE:
+        case VA_TOFLOAT:
+        case VA_TOINT:
+        case VA_TOSHORT:
+        case VA_TOSTRING:
+            result = true;
+            break;
+
+        default:
+            result = false;
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  IsLeaf                                                                    */
+/*!
+    Check if a node is a variable or a constant
+
+@param[in]
+    pVariable
+        pointer to the node to check
+
+@retval true the node is a variable or a constant
+@retval false the node is an operation
+
+==============================================================================*/
+static bool IsLeaf( Variable *pVariable )
+{
+    return ( pVariable->operation == VA_SYSVAR ) ||
+           ( pVariable->operation == VA_LOCALVAR ) ||
+           ( IsConstant( pVariable ) == true );
+}
+
+/*============================================================================*/
+/*  IsConstant                                                                */
+/*!
+    Check if a node is a constant which can be shared
+
+    Numeric constants are shared by value.  String constants are only
+    shared if they are interned, so equal strings have the same storage
+    and no string is released with a duplicate node.
+
+@param[in]
+    pVariable
+        pointer to the node to check
+
+@retval true the node is a shareable constant
+@retval false the node is not a shareable constant
+
+==============================================================================*/
+static bool IsConstant( Variable *pVariable )
+{
+    return ( pVariable->operation == VA_NUM ) ||
+           ( pVariable->operation == VA_FLOATNUM ) ||
+           ( ( pVariable->operation == VA_STRING ) &&
+             ( pVariable->flags & VF_INTERNED_STR ) );
+}
+
+/*============================================================================*/
+/*  Hash                                                                      */
+/*!
+    Calculate the hash of an expression
+
+    Operations are hashed by their operation and their shared operand
+    nodes.  Constants are hashed by their type and value.
+
+@param[in]
+    pVariable
+        pointer to the expression node
+
+@retval the hash value
+
+==============================================================================*/
+static size_t Hash( Variable *pVariable )
+{
+    size_t h = (size_t)pVariable->operation * 0x9E3779B97F4A7C15ULL;
+
+    switch( pVariable->operation )
+    {
+        case VA_NUM:
+        case VA_FLOATNUM:
+            h = ( h ^ pVariable->obj.type ) * 0x100000001B3ULL;
+            h = ( h ^ pVariable->obj.val.ul ) * 0x100000001B3ULL;
+            break;
+
+        case VA_STRING:
+            h = ( h ^ (uintptr_t)pVariable->obj.val.str ) * 0x100000001B3ULL;
+            break;
+
+        default:
+            h = ( h ^ (uintptr_t)pVariable->left ) * 0x100000001B3ULL;
+            h = ( h ^ (uintptr_t)pVariable->right ) * 0x100000001B3ULL;
+            break;
+    }
+
+    return h ^ ( h >> 29 );
+}
+
+/*============================================================================*/
+/*  Match                                                                     */
+/*!
+    Check if two expressions are identical
+
+@param[in]
+    p1
+        pointer to the first expression node
+
+@param[in]
+    p2
+        pointer to the second expression node
+
+@retval true the expressions are identical
+@retval false the expressions are different
+
+==============================================================================*/
+static bool Match( Variable *p1, Variable *p2 )
+{
+    bool result = false;
+
+    if ( p1->operation == p2->operation )
+    {
+        switch( p1->operation )
+        {
+            case VA_NUM:
+            case VA_FLOATNUM:
+                result = ( p1->obj.type == p2->obj.type ) &&
+                         ( p1->obj.len == p2->obj.len ) &&
+                         ( p1->obj.len <= sizeof( p1->obj.val ) ) &&
+                         ( memcmp( &p1->obj.val,
+                                   &p2->obj.val,
+                                   p1->obj.len ) == 0 );
+                break;
+
+            case VA_STRING:
+                result = ( p1->obj.val.str == p2->obj.val.str );
+                break;
+
+            default:
+                result = ( p1->left == p2->left ) &&
+                         ( p1->right == p2->right ) &&
+                         ( p1->fn == p2->fn );
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Lookup                                                                    */
+/*!
+    Find or add an expression in the expression table
+
+    The Lookup function searches the expression table for an expression
+    identical to pVariable.  If one is found, it is marked as shared and
+    pVariable is released.  Otherwise pVariable is added to the table.
+
+@param[in]
+    pTable
+        pointer to the expression table
+
+@param[in]
+    pVariable
+        pointer to the expression node
+
+@param[out]
+    ppShared
+        pointer to the location to store the node which represents the
+        expression
+
+@retval ENOMEM memory allocation failure
+@retval EOK the expression was found or added
+
+==============================================================================*/
+static int Lookup( CseTable *pTable,
+                   Variable *pVariable,
+                   Variable **ppShared )
+{
+    int result = EOK;
+    size_t i;
+    Variable *pEntry;
+
+    if ( ( pTable->n + 1 ) * 2 > pTable->size )
+    {
+        result = Grow( pTable );
+    }
+
+    if ( result == EOK )
+    {
+        i = Hash( pVariable ) & ( pTable->size - 1 );
+        while ( ( ( pEntry = pTable->ppSlots[i] ) != NULL ) &&
+                ( Match( pEntry, pVariable ) == false ) )
+        {
+            i = ( i + 1 ) & ( pTable->size - 1 );
+        }
+
+        if ( pEntry == NULL )
+        {
+            pTable->ppSlots[i] = pVariable;
+            pTable->n++;
+            *ppShared = pVariable;
+        }
+        else
+        {
+            if ( ( pEntry != pVariable ) &&
+                 ( IsConstant( pEntry ) == false ) )
+            {
+                pEntry->flags |= VF_SHARED;
+            }
+
+            if ( pEntry != pVariable )
+            {
+                Discard( pVariable );
+            }
+
+            *ppShared = pEntry;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Grow                                                                      */
+/*!
+    Double the number of slots in the expression table
+
+@param[in]
+    pTable
+        pointer to the expression table
+
+@retval ENOMEM memory allocation failure
+@retval EOK the table was successfully resized
+
+==============================================================================*/
+static int Grow( CseTable *pTable )
+{
+    int result = ENOMEM;
+    Variable **ppSlots;
+    size_t size = pTable->size * 2;
+    size_t i;
+    size_t j;
+
+    ppSlots = calloc( size, sizeof( Variable * ) );
+    if ( ppSlots != NULL )
+    {
+        for ( i = 0; i < pTable->size; i++ )
+        {
+            if ( pTable->ppSlots[i] != NULL )
+            {
+                j = Hash( pTable->ppSlots[i] ) & ( size - 1 );
+                while ( ppSlots[j] != NULL )
+                {
+                    j = ( j + 1 ) & ( size - 1 );
+                }
+
+                ppSlots[j] = pTable->ppSlots[i];
+            }
+        }
+
+        free( pTable->ppSlots );
+        pTable->ppSlots = ppSlots;
+        pTable->size = size;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Unchanged                                                                 */
+/*!
+    Check if the variables read by an expression are unchanged
+
+@param[in]
+    pVariable
+        pointer to the expression node (may be NULL)
+
+@param[in]
+    stamp
+        clock value when the shared node was evaluated
+
+@retval true no variable read by the expression was written after stamp
+@retval false a variable read by the expression was written after stamp
+
+==============================================================================*/
+static bool Unchanged( Variable *pVariable, uint64_t stamp )
+{
+    bool result = true;
+
+    if ( pVariable != NULL )
+    {
+        if ( ( pVariable->operation == VA_SYSVAR ) ||
+             ( pVariable->operation == VA_LOCALVAR ) )
+        {
+            result = ( pVariable->stamp <= stamp );
+        }
+        else if ( IsConstant( pVariable ) == false )
+        {
+            result = Unchanged( pVariable->left, stamp ) &&
+                     Unchanged( pVariable->right, stamp );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Discard                                                                   */
+/*!
+    Release a duplicate node
+
+    The Discard function releases a node which has been replaced by an
+    identical shared node.  Its operands are referenced by the shared
+    node.  Nodes allocated from an arena are released with their arena.
+
+@param[in]
+    pVariable
+        pointer to the node to release
+
+==============================================================================*/
+static void Discard( Variable *pVariable )
+{
+    if ( ( pVariable->flags & VF_ARENA ) == 0 )
+    {
+        ReleaseString( pVariable );
+        FreeFormat( pVariable->pFormat );
+        free( pVariable );
+    }
+}
+
+/*! @}
+ * end of varcse group */
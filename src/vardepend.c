@@ -0,0 +1,907 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup vardepend vardepend
+ * @brief Variable Action Script Dependency Index functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file vardepend.c
+
+    Variable Action Script Dependency Index functions
+
+    The Dependency Index functions evaluate only the statements of a
+    statement list which are affected by a change to a system variable,
+    instead of the whole statement list.
+
+    A dependency index is built once for each statement list.  It records
+    the statements which read each system variable and local variable,
+    and the variables each statement writes.  A statement reads a variable
+    node if the node is used anywhere in the statement, including the
+    condition and the then and else blocks of an IF statement, except as
+    the target of an assignment.
+
+    When a system variable changes, the statements which read it are
+    marked.  The marked statements are evaluated in program order, and
+    each statement which is evaluated marks the later statements which
+    read a variable it writes, so the effects of a change propagate
+    through the statement list in the same order as a full evaluation.
+    Earlier statements which read a variable written by a later statement
+    are not evaluated until that variable is reported as changed.
+
+    Statements which do not read any variable, such as statements which
+    only test timers, are never marked.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "varops.h"
+#include "varresolve.h"
+#include "varwrite.h"
+#include "varcontext.h"
+#include "varlatency.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of entries allocated in an access list */
+#define DEPEND_INITIAL_SIZE     ( 64 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! variable access made by a statement */
+typedef struct _depAccess
+{
+    /*! pointer to the accessed variable node */
+    Variable *pVariable;
+
+    /*! index of the statement which accesses the variable */
+    size_t statement;
+
+    /*! true if the variable is written */
+    bool write;
+
+} DepAccess;
+
+/*! list of variable accesses collected while building the index */
+typedef struct _depAccessList
+{
+    /*! pointer to the array of accesses */
+    DepAccess *pAccesses;
+
+    /*! number of accesses in the list */
+    size_t n;
+
+    /*! number of accesses allocated */
+    size_t size;
+
+} DepAccessList;
+
+/*! indexed variable */
+typedef struct _depResource
+{
+    /*! pointer to the variable node */
+    Variable *pVariable;
+
+    /*! index of the first reader in the reader array */
+    size_t first;
+
+    /*! number of statements which read the variable */
+    size_t nReaders;
+
+} DepResource;
+
+/*! variable to statement dependency index */
+struct _varDependencies
+{
+    /*! pointer to the statement list */
+    Statement *pStatements;
+
+    /*! statements in program order */
+    Statement **ppStatements;
+
+    /*! number of statements */
+    size_t n;
+
+    /*! indexed variables ordered by node address */
+    DepResource *pResources;
+
+    /*! number of indexed variables */
+    size_t nResources;
+
+    /*! statement indexes reading each variable, in program order */
+    size_t *pReaders;
+
+    /*! start of each statement's writes in pWrites (n + 1 entries) */
+    size_t *pWriteStart;
+
+    /*! indexes of the variables written by each statement */
+    size_t *pWrites;
+
+    /*! statements marked for evaluation */
+    bool *pMarked;
+
+    /*! index of the first marked statement, or n if none are marked */
+    size_t next;
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int CollectStatement( Statement *pStatement,
+                             size_t index,
+                             DepAccessList *pList );
+static int CollectVariable( Variable *pVariable,
+                            size_t index,
+                            bool write,
+                            DepAccessList *pList );
+static int AddAccess( DepAccessList *pList,
+                      Variable *pVariable,
+                      size_t index,
+                      bool write );
+static int CompareAccess( const void *p1, const void *p2 );
+static int CompareResource( const void *pKey, const void *pElement );
+static int BuildIndex( VarDependencies *pDeps, DepAccessList *pList );
+static void MarkReaders( VarDependencies *pDeps,
+                         DepResource *pResource,
+                         size_t after );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionCreateDependencies                                               */
+/*!
+    Create a dependency index for a statement list
+
+    The VarActionCreateDependencies function determines the variables
+    read and written by each statement in the list and builds the index
+    used by VarActionOnChanged() to evaluate only the affected statements.
+
+    The index must be rebuilt if the statement list is changed.
+
+@param[in]
+    pStatements
+        pointer to the statement list
+
+@retval pointer to the new dependency index
+@retval NULL if the index could not be created
+
+==============================================================================*/
+VarDependencies *VarActionCreateDependencies( Statement *pStatements )
+{
+    VarDependencies *pDeps;
+    Statement *pStatement;
+    DepAccessList accesses;
+    int result = EOK;
+    size_t i;
+
+    memset( &accesses, 0, sizeof( DepAccessList ) );
+
+    pDeps = calloc( 1, sizeof( VarDependencies ) );
+    if ( pDeps != NULL )
+    {
+        pDeps->pStatements = pStatements;
+
+        for ( pStatement = pStatements;
+              pStatement != NULL;
+              pStatement = pStatement->pNext )
+        {
+            pDeps->n++;
+        }
+
+        pDeps->next = pDeps->n;
+        pDeps->ppStatements = calloc( pDeps->n + 1, sizeof( Statement * ) );
+        pDeps->pMarked = calloc( pDeps->n + 1, sizeof( bool ) );
+        if ( ( pDeps->ppStatements == NULL ) ||
+             ( pDeps->pMarked == NULL ) )
+        {
+            result = ENOMEM;
+        }
+
+        pStatement = pStatements;
+        for ( i = 0; ( result == EOK ) && ( i < pDeps->n ); i++ )
+        {
+            pDeps->ppStatements[i] = pStatement;
+            result = CollectStatement( pStatement, i, &accesses );
+            pStatement = pStatement->pNext;
+        }
+
+        if ( result == EOK )
+        {
+            result = BuildIndex( pDeps, &accesses );
+        }
+
+        if ( result != EOK )
+        {
+            VarActionFreeDependencies( pDeps );
+            pDeps = NULL;
+        }
+    }
+
+    free( accesses.pAccesses );
+
+    return pDeps;
+}
+
+/*============================================================================*/
+/*  VarActionFreeDependencies                                                 */
+/*!
+    Free a dependency index
+
+    The VarActionFreeDependencies function releases a dependency index.
+    The statement list is not affected.
+
+@param[in]
+    pDeps
+        pointer to the dependency index to free
+
+==============================================================================*/
+void VarActionFreeDependencies( VarDependencies *pDeps )
+{
+    if ( pDeps != NULL )
+    {
+        free( pDeps->ppStatements );
+        free( pDeps->pResources );
+        free( pDeps->pReaders );
+        free( pDeps->pWriteStart );
+        free( pDeps->pWrites );
+        free( pDeps->pMarked );
+        free( pDeps );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionMarkChanged                                                      */
+/*!
+    Record a change to a system variable
+
+    The VarActionMarkChanged function marks the statements which read the
+    specified system variable for evaluation by VarActionEvaluateChanged(),
+    and invalidates the cached value of the variable so its new value is
+    retrieved.  Several changes can be marked before the statements are
+    evaluated, and each affected statement is evaluated once.
+
+@param[in]
+    pDeps
+        pointer to the dependency index
+
+@param[in]
+    hVar
+        handle of the system variable which changed
+
+@retval EINVAL invalid argument
+@retval ENOENT the system variable is not used in the current context
+@retval EOK the statements which read the variable were marked
+
+==============================================================================*/
+int VarActionMarkChanged( VarDependencies *pDeps, VAR_HANDLE hVar )
+{
+    int result = EINVAL;
+    Variable *pVariable;
+    DepResource *pResource;
+
+    if ( pDeps != NULL )
+    {
+        pVariable = FindHandleVariable( hVar );
+        if ( pVariable != NULL )
+        {
+            result = EOK;
+            pVariable->valid = false;
+
+            pResource = bsearch( pVariable,
+                                 pDeps->pResources,
+                                 pDeps->nResources,
+                                 sizeof( DepResource ),
+                                 CompareResource );
+            if ( pResource != NULL )
+            {
+                MarkReaders( pDeps, pResource, 0 );
+            }
+
+            LatencyTrigger( VA_LATENCY_CHANGE, 0 );
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionEvaluateChanged                                                  */
+/*!
+    Evaluate the statements affected by the marked changes
+
+    The VarActionEvaluateChanged function evaluates the marked statements
+    in program order as a single compound statement.  Each statement
+    which is evaluated marks the later statements which read a variable
+    it writes.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pDeps
+        pointer to the dependency index
+
+@retval EINVAL invalid argument
+@retval EOK the statements were processed successfully
+@retval other error from the last statement which failed
+
+==============================================================================*/
+int VarActionEvaluateChanged( VARSERVER_HANDLE hVarServer,
+                              VarDependencies *pDeps )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    DepResource *pResource;
+    size_t i;
+    size_t j;
+    bool outer;
+    bool defer;
+    int rc;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pDeps != NULL ) )
+    {
+        result = EOK;
+
+        ResolvePending( hVarServer, pDeps->pStatements );
+
+        outer = EnterCompound();
+        defer = outer && ( pContext->options & VA_OPT_DEFER_WRITES );
+        if ( defer == true )
+        {
+            BeginWrites();
+        }
+
+        for ( i = pDeps->next; i < pDeps->n; i++ )
+        {
+            if ( pDeps->pMarked[i] == true )
+            {
+                pDeps->pMarked[i] = false;
+
+                rc = ProcessStatement( hVarServer, pDeps->ppStatements[i] );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+
+                /* the statement may have changed the variables it writes */
+                for ( j = pDeps->pWriteStart[i];
+                      j < pDeps->pWriteStart[i + 1];
+                      j++ )
+                {
+                    pResource = &pDeps->pResources[pDeps->pWrites[j]];
+                    MarkReaders( pDeps, pResource, i + 1 );
+                }
+            }
+        }
+
+        pDeps->next = pDeps->n;
+
+        LeaveCompound();
+
+        if ( defer == true )
+        {
+            rc = FlushWrites( hVarServer );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+
+        LatencyComplete();
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionOnChanged                                                        */
+/*!
+    Evaluate the statements affected by a change to a system variable
+
+    The VarActionOnChanged function marks the statements which read the
+    specified system variable, and evaluates them along with the
+    statements which depend on them.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pDeps
+        pointer to the dependency index
+
+@param[in]
+    hVar
+        handle of the system variable which changed
+
+@retval EINVAL invalid argument
+@retval ENOENT the system variable is not used in the current context
+@retval EOK the statements were processed successfully
+@retval other error from the last statement which failed
+
+==============================================================================*/
+int VarActionOnChanged( VARSERVER_HANDLE hVarServer,
+                        VarDependencies *pDeps,
+                        VAR_HANDLE hVar )
+{
+    int result;
+
+    result = VarActionMarkChanged( pDeps, hVar );
+    if ( result == EOK )
+    {
+        result = VarActionEvaluateChanged( hVarServer, pDeps );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CollectStatement                                                          */
+/*!
+    Collect the variable accesses of a statement
+
+@param[in]
+    pStatement
+        pointer to the statement
+
+@param[in]
+    index
+        index of the top level statement which contains it
+
+@param[in,out]
+    pList
+        pointer to the access list
+
+@retval EOK the accesses were collected
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int CollectStatement( Statement *pStatement,
+                             size_t index,
+                             DepAccessList *pList )
+{
+    return CollectVariable( pStatement->pVariable, index, false, pList );
+}
+
+/*============================================================================*/
+/*  CollectVariable                                                           */
+/*!
+    Collect the variable accesses of a variable tree
+
+@param[in]
+    pVariable
+        pointer to the variable tree (may be NULL)
+
+@param[in]
+    index
+        index of the top level statement which contains it
+
+@param[in]
+    write
+        true if the variable tree is the target of an assignment
+
+@param[in,out]
+    pList
+        pointer to the access list
+
+@retval EOK the accesses were collected
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int CollectVariable( Variable *pVariable,
+                            size_t index,
+                            bool write,
+                            DepAccessList *pList )
+{
+    int result = EOK;
+    Statement *pStatement;
+
+    if ( pVariable != NULL )
+    {
+        switch( pVariable->operation )
+        {
+            case VA_SYSVAR:
+            case VA_LOCALVAR:
+                /* an l-value read after an assignment uses the value
+                 * written by the assignment */
+                result = AddAccess( pList, pVariable, index, write );
+                break;
+
+            case VA_ASSIGN:
+            case VA_AND_EQUALS:
+            case VA_OR_EQUALS:
+            case VA_XOR_EQUALS:
+            case VA_DIV_EQUALS:
+            case VA_TIMES_EQUALS:
+            case VA_PLUS_EQUALS:
+            case VA_MINUS_EQUALS:
+            case VA_INC:
+            case VA_DEC:
+                result = CollectVariable( pVariable->left,
+                                          index,
+                                          true,
+                                          pList );
+                if ( result == EOK )
+                {
+                    result = CollectVariable( pVariable->right,
+                                              index,
+                                              false,
+                                              pList );
+                }
+                break;
+
+            case VA_ELSE:
+                /* the ELSE node references the then and else
+                 * compound statements */
+                for ( pStatement = (Statement *)pVariable->left;
+                      ( result == EOK ) && ( pStatement != NULL );
+                      pStatement = pStatement->pNext )
+                {
+                    result = CollectStatement( pStatement, index, pList );
+                }
+
+                for ( pStatement = (Statement *)pVariable->right;
+                      ( result == EOK ) && ( pStatement != NULL );
+                      pStatement = pStatement->pNext )
+                {
+                    result = CollectStatement( pStatement, index, pList );
+                }
+                break;
+
+            default:
+                result = CollectVariable( pVariable->left,
+                                          index,
+                                          false,
+                                          pList );
+                if ( result == EOK )
+                {
+                    result = CollectVariable( pVariable->right,
+                                              index,
+                                              false,
+                                              pList );
+                }
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddAccess                                                                 */
+/*!
+    Add a variable access to an access list
+
+@param[in,out]
+    pList
+        pointer to the access list
+
+@param[in]
+    pVariable
+        pointer to the accessed variable node
+
+@param[in]
+    index
+        index of the statement which accesses the variable
+
+@param[in]
+    write
+        true if the variable is written
+
+@retval EOK the access was added
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int AddAccess( DepAccessList *pList,
+                      Variable *pVariable,
+                      size_t index,
+                      bool write )
+{
+    int result = EOK;
+    DepAccess *pAccesses;
+    size_t size;
+
+    if ( pList->n >= pList->size )
+    {
+        size = ( pList->size == 0 ) ? DEPEND_INITIAL_SIZE : pList->size * 2;
+        pAccesses = realloc( pList->pAccesses, size * sizeof( DepAccess ) );
+        if ( pAccesses != NULL )
+        {
+            pList->pAccesses = pAccesses;
+            pList->size = size;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pList->pAccesses[pList->n].pVariable = pVariable;
+        pList->pAccesses[pList->n].statement = index;
+        pList->pAccesses[pList->n].write = write;
+        pList->n++;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompareAccess                                                             */
+/*!
+    Order variable accesses by variable, statement and access type
+
+@param[in]
+    p1
+        pointer to the first access
+
+@param[in]
+    p2
+        pointer to the second access
+
+@retval negative, zero or positive as the first access orders before,
+        with or after the second
+
+==============================================================================*/
+static int CompareAccess( const void *p1, const void *p2 )
+{
+    const DepAccess *pAccess1 = p1;
+    const DepAccess *pAccess2 = p2;
+    uintptr_t v1 = (uintptr_t)pAccess1->pVariable;
+    uintptr_t v2 = (uintptr_t)pAccess2->pVariable;
+    int result;
+
+    if ( v1 != v2 )
+    {
+        result = ( v1 < v2 ) ? -1 : 1;
+    }
+    else if ( pAccess1->statement != pAccess2->statement )
+    {
+        result = ( pAccess1->statement < pAccess2->statement ) ? -1 : 1;
+    }
+    else
+    {
+        result = (int)pAccess1->write - (int)pAccess2->write;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompareResource                                                           */
+/*!
+    Compare a variable node with an indexed variable
+
+@param[in]
+    pKey
+        pointer to the variable node
+
+@param[in]
+    pElement
+        pointer to the indexed variable
+
+@retval negative, zero or positive as the node orders before,
+        with or after the indexed variable
+
+==============================================================================*/
+static int CompareResource( const void *pKey, const void *pElement )
+{
+    uintptr_t v1 = (uintptr_t)pKey;
+    uintptr_t v2 = (uintptr_t)( (const DepResource *)pElement )->pVariable;
+
+    return ( v1 < v2 ) ? -1 : ( v1 > v2 ) ? 1 : 0;
+}
+
+/*============================================================================*/
+/*  BuildIndex                                                                */
+/*!
+    Build the dependency index from the collected accesses
+
+    The BuildIndex function sorts the accesses by variable, and builds
+    the list of distinct statements which read each variable and the
+    list of distinct variables written by each statement.
+
+@param[in,out]
+    pDeps
+        pointer to the dependency index
+
+@param[in,out]
+    pList
+        pointer to the collected accesses
+
+@retval EOK the index was built
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int BuildIndex( VarDependencies *pDeps, DepAccessList *pList )
+{
+    int result = EOK;
+    DepAccess *pAccess;
+    DepResource *pResource = NULL;
+    size_t nReaders = 0;
+    size_t nWrites = 0;
+    size_t *pFill;
+    size_t i;
+
+    if ( pList->n > 0 )
+    {
+        qsort( pList->pAccesses,
+               pList->n,
+               sizeof( DepAccess ),
+               CompareAccess );
+    }
+
+    pDeps->pResources = calloc( pList->n + 1, sizeof( DepResource ) );
+    pDeps->pReaders = calloc( pList->n + 1, sizeof( size_t ) );
+    pDeps->pWriteStart = calloc( pDeps->n + 1, sizeof( size_t ) );
+    pDeps->pWrites = calloc( pList->n + 1, sizeof( size_t ) );
+    pFill = calloc( pDeps->n + 1, sizeof( size_t ) );
+    if ( ( pDeps->pResources == NULL ) ||
+         ( pDeps->pReaders == NULL ) ||
+         ( pDeps->pWriteStart == NULL ) ||
+         ( pDeps->pWrites == NULL ) ||
+         ( pFill == NULL ) )
+    {
+        result = ENOMEM;
+    }
+
+    for ( i = 0; ( result == EOK ) && ( i < pList->n ); i++ )
+    {
+        pAccess = &pList->pAccesses[i];
+        if ( ( pResource == NULL ) ||
+             ( pResource->pVariable != pAccess->pVariable ) )
+        {
+            pResource = &pDeps->pResources[pDeps->nResources++];
+            pResource->pVariable = pAccess->pVariable;
+            pResource->first = nReaders;
+        }
+
+        /* reads sort before writes, so the first access of each
+         * statement records whether it reads the variable */
+        if ( ( pAccess->write == false ) &&
+             ( ( i == 0 ) ||
+               ( pList->pAccesses[i - 1].pVariable != pAccess->pVariable ) ||
+               ( pList->pAccesses[i - 1].statement != pAccess->statement ) ) )
+        {
+            pDeps->pReaders[nReaders++] = pAccess->statement;
+            pResource->nReaders++;
+        }
+
+        /* count one write per statement and variable */
+        if ( ( pAccess->write == true ) &&
+             ( ( i + 1 == pList->n ) ||
+               ( pList->pAccesses[i + 1].pVariable != pAccess->pVariable ) ||
+               ( pList->pAccesses[i + 1].statement != pAccess->statement ) ) )
+        {
+            pDeps->pWriteStart[pAccess->statement + 1]++;
+            nWrites++;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        /* convert the write counts to offsets, then fill in the
+         * written variables in the same order */
+        for ( i = 0; i < pDeps->n; i++ )
+        {
+            pDeps->pWriteStart[i + 1] += pDeps->pWriteStart[i];
+            pFill[i] = pDeps->pWriteStart[i];
+        }
+
+        pResource = NULL;
+        for ( i = 0; i < pList->n; i++ )
+        {
+            pAccess = &pList->pAccesses[i];
+            if ( ( pResource == NULL ) ||
+                 ( pResource->pVariable != pAccess->pVariable ) )
+            {
+                pResource = ( pResource == NULL ) ? pDeps->pResources
+                                                  : pResource + 1;
+            }
+
+            if ( ( pAccess->write == true ) &&
+                 ( ( i + 1 == pList->n ) ||
+                   ( pList->pAccesses[i + 1].pVariable !=
+                     pAccess->pVariable ) ||
+                   ( pList->pAccesses[i + 1].statement !=
+                     pAccess->statement ) ) )
+            {
+                pDeps->pWrites[pFill[pAccess->statement]++] =
+                    pResource - pDeps->pResources;
+            }
+        }
+    }
+
+    free( pFill );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MarkReaders                                                               */
+/*!
+    Mark the statements which read a variable
+
+@param[in,out]
+    pDeps
+        pointer to the dependency index
+
+@param[in]
+    pResource
+        pointer to the indexed variable
+
+@param[in]
+    after
+        index of the first statement which may be marked
+
+==============================================================================*/
+static void MarkReaders( VarDependencies *pDeps,
+                         DepResource *pResource,
+                         size_t after )
+{
+    size_t *pReaders = &pDeps->pReaders[pResource->first];
+    size_t i;
+
+    for ( i = 0; i < pResource->nReaders; i++ )
+    {
+        if ( pReaders[i] >= after )
+        {
+            pDeps->pMarked[pReaders[i]] = true;
+            if ( pReaders[i] < pDeps->next )
+            {
+                pDeps->next = pReaders[i];
+            }
+        }
+    }
+}
+
+/*! @}
+ * end of vardepend group */
@@ -0,0 +1,194 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup vardispatch vardispatch
+ * @brief Timer event dispatch
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file vardispatch.c
+
+    Timer event dispatch
+
+    The timer event dispatch functions integrate the timer wheel with
+    an application event loop.  Statement lists are bound to timer
+    identifiers with VarActionBindTimer().  When the descriptor returned
+    by VarActionTimerFd() becomes readable, VarActionDispatchPending()
+    processes every expired timer in one batch.  The active timer is set
+    to each timer in turn while its statements are evaluated, so
+    expirations which occur close together are not lost.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "vartimer.h"
+#include "vartimerwheel.h"
+#include "varcontext.h"
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionBindTimer                                                        */
+/*!
+    Bind a statement list to a timer
+
+    The VarActionBindTimer function binds a statement list to a timer
+    of the current context.  The statements are evaluated by
+    VarActionDispatchPending() each time the timer expires.  Statements
+    bound to timer 0 are evaluated for expired timers which do not have
+    their own statements.
+
+@param[in]
+    id
+        timer identifier, or 0 for the default statements
+
+@param[in]
+    pStatements
+        pointer to the statement list, or NULL to remove the binding
+
+@retval EOK the statements were bound
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+int VarActionBindTimer( uint16_t id, Statement *pStatements )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EOK;
+    Statement **ppActions;
+    size_t n;
+
+    if ( (size_t)id >= pContext->nTimerActions )
+    {
+        n = (size_t)id + 1;
+        ppActions = realloc( pContext->ppTimerActions,
+                             n * sizeof( Statement * ) );
+        if ( ppActions != NULL )
+        {
+            memset( &ppActions[pContext->nTimerActions],
+                    0,
+                    ( n - pContext->nTimerActions ) * sizeof( Statement * ) );
+            pContext->ppTimerActions = ppActions;
+            pContext->nTimerActions = n;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pContext->ppTimerActions[id] = pStatements;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionDispatchPending                                                  */
+/*!
+    Dispatch the expired timers of the current context
+
+    The VarActionDispatchPending function advances the timer wheel of
+    the current context once and, for each timer which has expired, sets
+    the active timer and evaluates the statements bound to it.  Timers
+    which expire while the statements are being evaluated are dispatched
+    by the next call.  The active timer is cleared when all of the
+    expired timers have been dispatched.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EOK the expired timers were dispatched
+@retval EINVAL invalid argument
+@retval other error from the last statement list which failed
+
+==============================================================================*/
+int VarActionDispatchPending( VARSERVER_HANDLE hVarServer )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    Statement *pStatements;
+    uint16_t id;
+    size_t n;
+    int rc;
+
+    if ( hVarServer != NULL )
+    {
+        result = EOK;
+
+        /* only the timers which have expired now are dispatched */
+        n = PollWheel( pContext->pWheel );
+        while ( n-- > 0 )
+        {
+            if ( PopWheelTimer( pContext->pWheel, &id ) == EOK )
+            {
+                pStatements = NULL;
+                if ( id < pContext->nTimerActions )
+                {
+                    pStatements = pContext->ppTimerActions[id];
+                }
+
+                if ( ( pStatements == NULL ) &&
+                     ( pContext->nTimerActions > 0 ) )
+                {
+                    pStatements = pContext->ppTimerActions[0];
+                }
+
+                if ( pStatements != NULL )
+                {
+                    VASetActiveTimer( id );
+                    rc = ProcessCompoundStatement( hVarServer, pStatements );
+                    if ( rc != EOK )
+                    {
+                        result = rc;
+                    }
+                }
+            }
+        }
+
+        VASetActiveTimer( 0 );
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of vardispatch group */
@@ -0,0 +1,1703 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varexec varexec
+ * @brief Parallel statement executor
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varexec.c
+
+    Parallel statement executor
+
+    The parallel statement executor evaluates the statements of a
+    statement list across a fixed pool of worker threads.
+
+    A schedule is built once for each statement list.  The schedule
+    records the variables each statement reads and writes: a variable
+    node is written if it is the target of an assignment or is an
+    l-value, and is read otherwise.  Each statement depends on the
+    earlier statements which write a variable it accesses, or which
+    read a variable it writes, so conflicting statements run in program
+    order while independent statements run concurrently.
+
+    Statements which use timers or run scripts are pinned to the
+    calling thread.  Scripts are also ordered with respect to every
+    other statement.
+
+    A shared expression (VarActionShareExpressions()) is written each
+    time it is evaluated, so statements which contain the same shared
+    expression run in program order.  Shared values are not reused while
+    a schedule runs, or for the rest of the enclosing compound statement.
+
+    Each worker owns a task queue.  Statements which become ready are
+    pushed onto the queue of the worker which completed their last
+    dependency, and idle workers steal from the other queues.  A worker
+    which finds no task sleeps on a condition variable until another
+    task is queued or the schedule completes.  The calling thread works
+    alongside the pool using its current context, and each worker
+    thread has its own context.
+
+    The system variables read by the schedule are fetched before the
+    workers start.  If they cannot be fetched the statements are
+    processed sequentially instead.  The variable server handle is not
+    thread safe, so system variable writes are always deferred while a
+    schedule runs, whether or not VA_OPT_DEFER_WRITES is set.  Each
+    worker collects its writes in its own write set, and the calling
+    thread publishes them when every statement has completed, or before
+    a script runs so the script sees them.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "varops.h"
+#include "varprefetch.h"
+#include "varresolve.h"
+#include "varwrite.h"
+#include "varprofile.h"
+#include "varcontext.h"
+#include "varcse.h"
+#include "varlatency.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! no statement index */
+#define EXEC_NONE   ( (size_t)-1 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! variable access made by a statement */
+typedef struct _execAccess
+{
+    /*! pointer to the accessed variable or resource */
+    void *pResource;
+
+    /*! true if the variable or resource is written */
+    bool write;
+
+} ExecAccess;
+
+/*! list of variable accesses */
+typedef struct _execAccessList
+{
+    /*! pointer to the array of accesses */
+    ExecAccess *pAccesses;
+
+    /*! number of accesses in the list */
+    size_t n;
+
+    /*! number of accesses allocated */
+    size_t size;
+
+} ExecAccessList;
+
+/*! resource ordering state used while building a schedule */
+typedef struct _execResource
+{
+    /*! pointer to the variable or resource */
+    void *pResource;
+
+    /*! index of the last statement which wrote the resource */
+    size_t writer;
+
+    /*! indexes of the statements which read it since the last write */
+    size_t *pReaders;
+
+    /*! number of readers */
+    size_t nReaders;
+
+    /*! number of reader indexes allocated */
+    size_t size;
+
+} ExecResource;
+
+/*! schedule task */
+typedef struct _execTask
+{
+    /*! pointer to the statement to process */
+    Statement *pStatement;
+
+    /*! indexes of the tasks which depend on this task */
+    size_t *pSuccessors;
+
+    /*! number of dependent tasks */
+    size_t nSuccessors;
+
+    /*! number of dependent task indexes allocated */
+    size_t size;
+
+    /*! number of tasks this task depends on */
+    size_t nPredecessors;
+
+    /*! number of dependencies not yet completed in the current run */
+    atomic_size_t waiting;
+
+    /*! true if the task must run on the calling thread */
+    bool pinned;
+
+    /*! true if the task runs a script, so it is ordered with respect to
+     *  every other task */
+    bool script;
+
+    /*! result of processing the statement in the current run */
+    int result;
+
+} ExecTask;
+
+/*! statement schedule */
+struct _varSchedule
+{
+    /*! pointer to the statement list */
+    Statement *pStatements;
+
+    /*! pointer to the array of tasks in program order */
+    ExecTask *pTasks;
+
+    /*! number of tasks */
+    size_t n;
+
+};
+
+/*! task queue.  The owner pushes and pops at the tail, and other
+ *  workers steal from the head */
+typedef struct _execQueue
+{
+    /*! mutex protecting the queue */
+    pthread_mutex_t lock;
+
+    /*! ring buffer of task indexes */
+    size_t *pItems;
+
+    /*! index of the first task */
+    size_t head;
+
+    /*! number of tasks in the queue */
+    size_t n;
+
+    /*! number of task indexes allocated */
+    size_t size;
+
+} ExecQueue;
+
+/*! executor worker */
+typedef struct _execWorker
+{
+    /*! pointer to the executor */
+    struct _varExecutor *pExecutor;
+
+    /*! worker index.  Worker 0 is the calling thread */
+    size_t index;
+
+    /*! worker thread */
+    pthread_t thread;
+
+    /*! evaluation context used by the worker */
+    VarActionContext *pContext;
+
+    /*! worker task queue */
+    ExecQueue queue;
+
+} ExecWorker;
+
+/*! parallel statement executor */
+struct _varExecutor
+{
+    /*! pointer to the array of workers */
+    ExecWorker *pWorkers;
+
+    /*! number of workers, including the calling thread */
+    size_t nWorkers;
+
+    /*! number of worker threads started */
+    size_t nThreads;
+
+    /*! queue of tasks which must run on the calling thread */
+    ExecQueue pinned;
+
+    /*! mutex protecting the run state */
+    pthread_mutex_t lock;
+
+    /*! signalled when a run starts or the executor shuts down */
+    pthread_cond_t start;
+
+    /*! signalled when a worker thread finishes a run */
+    pthread_cond_t done;
+
+    /*! run counter */
+    uint64_t run;
+
+    /*! number of worker threads which have finished the current run */
+    size_t finished;
+
+    /*! true if the worker threads should exit */
+    bool shutdown;
+
+    /*! schedule being run */
+    VarSchedule *pSchedule;
+
+    /*! handle to the variable server for the current run */
+    VARSERVER_HANDLE hVarServer;
+
+    /*! number of tasks not yet completed in the current run */
+    atomic_size_t remaining;
+
+    /*! number of task completions in the current run, which an idle
+     *  worker samples before looking for a task */
+    atomic_uint_fast64_t completions;
+
+    /*! number of workers waiting for a task */
+    atomic_size_t idle;
+
+    /*! mutex protecting the ready condition */
+    pthread_mutex_t idleLock;
+
+    /*! signalled when a task completes while workers are idle */
+    pthread_cond_t ready;
+
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int CollectAccesses( Statement *pStatement,
+                            ExecAccessList *pList,
+                            bool *pPinned );
+static int CollectVariableAccesses( Variable *pVariable,
+                                    bool write,
+                                    ExecAccessList *pList,
+                                    bool *pPinned );
+static int AddAccess( ExecAccessList *pList, void *pResource, bool write );
+static int AddDependency( VarSchedule *pSchedule, size_t from, size_t to );
+static int OrderAccess( VarSchedule *pSchedule,
+                        ExecResource **ppResources,
+                        size_t *pnResources,
+                        ExecAccess *pAccess,
+                        size_t index );
+static void *WorkerThread( void *arg );
+static void RunTasks( ExecWorker *pWorker );
+static bool NextTask( ExecWorker *pWorker, size_t *pIndex );
+static void CompleteTask( ExecWorker *pWorker, size_t index );
+static void WaitTask( VarExecutor *pExecutor, uint_fast64_t completions );
+static int PublishWorkerWrites( VarExecutor *pExecutor );
+static int InitQueue( ExecQueue *pQueue );
+static int ReserveQueue( ExecQueue *pQueue, size_t size );
+static void PushTask( ExecQueue *pQueue, size_t index );
+static bool PopTask( ExecQueue *pQueue, size_t *pIndex );
+static bool StealTask( ExecQueue *pQueue, size_t *pIndex );
+static void FreeQueue( ExecQueue *pQueue );
+static int RunSchedule( VarExecutor *pExecutor,
+                        VARSERVER_HANDLE hVarServer,
+                        VarSchedule *pSchedule );
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! resource representing the timers of the calling context */
+static int g_timerResource;
+
+/*! resource accessed by every statement, and written by scripts */
+static int g_barrierResource;
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionCreateExecutor                                                   */
+/*!
+    Create a parallel statement executor
+
+    The VarActionCreateExecutor function starts a pool of worker threads
+    which evaluate schedules with VarActionExecute().  The calling thread
+    also evaluates statements while a schedule is run.
+
+@param[in]
+    nThreads
+        number of worker threads to start
+
+@retval pointer to the new executor
+@retval NULL if the executor could not be created
+
+==============================================================================*/
+VarExecutor *VarActionCreateExecutor( size_t nThreads )
+{
+    VarExecutor *pExecutor;
+    ExecWorker *pWorker;
+    bool ok;
+    size_t i;
+
+    pExecutor = calloc( 1, sizeof( VarExecutor ) );
+    if ( pExecutor != NULL )
+    {
+        pExecutor->nWorkers = nThreads + 1;
+        pExecutor->pWorkers = calloc( pExecutor->nWorkers,
+                                      sizeof( ExecWorker ) );
+
+        pthread_mutex_init( &pExecutor->lock, NULL );
+        pthread_cond_init( &pExecutor->start, NULL );
+        pthread_cond_init( &pExecutor->done, NULL );
+        pthread_mutex_init( &pExecutor->idleLock, NULL );
+        pthread_cond_init( &pExecutor->ready, NULL );
+
+        ok = ( pExecutor->pWorkers != NULL ) &&
+             ( InitQueue( &pExecutor->pinned ) == EOK );
+
+        for ( i = 0; ( ok == true ) && ( i < pExecutor->nWorkers ); i++ )
+        {
+            pWorker = &pExecutor->pWorkers[i];
+            pWorker->pExecutor = pExecutor;
+            pWorker->index = i;
+            ok = ( InitQueue( &pWorker->queue ) == EOK );
+
+            if ( ( ok == true ) && ( i > 0 ) )
+            {
+                /* the calling thread uses its own context */
+                pWorker->pContext = VarActionCreateContext();
+                ok = ( pWorker->pContext != NULL ) &&
+                     ( pthread_create( &pWorker->thread,
+                                       NULL,
+                                       WorkerThread,
+                                       pWorker ) == 0 );
+                if ( ok == true )
+                {
+                    pExecutor->nThreads++;
+                }
+            }
+        }
+
+        if ( ok == false )
+        {
+            VarActionFreeExecutor( pExecutor );
+            pExecutor = NULL;
+        }
+    }
+
+    return pExecutor;
+}
+
+/*============================================================================*/
+/*  VarActionFreeExecutor                                                     */
+/*!
+    Free a parallel statement executor
+
+    The VarActionFreeExecutor function stops the worker threads and
+    releases the resources used by the executor.
+
+@param[in]
+    pExecutor
+        pointer to the executor to free
+
+==============================================================================*/
+void VarActionFreeExecutor( VarExecutor *pExecutor )
+{
+    size_t i;
+
+    if ( pExecutor != NULL )
+    {
+        pthread_mutex_lock( &pExecutor->lock );
+        pExecutor->shutdown = true;
+        pthread_cond_broadcast( &pExecutor->start );
+        pthread_mutex_unlock( &pExecutor->lock );
+
+        if ( pExecutor->pWorkers != NULL )
+        {
+            /* worker threads are started in order */
+            for ( i = 1; i <= pExecutor->nThreads; i++ )
+            {
+                pthread_join( pExecutor->pWorkers[i].thread, NULL );
+            }
+
+            /* worker 0 uses the calling thread's context */
+            for ( i = 0; i < pExecutor->nWorkers; i++ )
+            {
+                if ( i > 0 )
+                {
+                    VarActionFreeContext( pExecutor->pWorkers[i].pContext );
+                }
+
+                FreeQueue( &pExecutor->pWorkers[i].queue );
+            }
+        }
+
+        FreeQueue( &pExecutor->pinned );
+        pthread_cond_destroy( &pExecutor->ready );
+        pthread_mutex_destroy( &pExecutor->idleLock );
+        pthread_cond_destroy( &pExecutor->done );
+        pthread_cond_destroy( &pExecutor->start );
+        pthread_mutex_destroy( &pExecutor->lock );
+        free( pExecutor->pWorkers );
+        free( pExecutor );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionCreateSchedule                                                   */
+/*!
+    Create a schedule for a statement list
+
+    The VarActionCreateSchedule function determines the variables
+    accessed by each statement in the list and builds the dependency
+    graph used to evaluate the statements in parallel.
+
+    The schedule must be rebuilt if the statement list is changed.
+
+@param[in]
+    pStatements
+        pointer to the statement list
+
+@retval pointer to the new schedule
+@retval NULL if the schedule could not be created
+
+==============================================================================*/
+VarSchedule *VarActionCreateSchedule( Statement *pStatements )
+{
+    VarSchedule *pSchedule;
+    Statement *pStatement;
+    ExecAccessList accesses;
+    ExecAccess *pAccess;
+    ExecResource *pResources = NULL;
+    size_t nResources = 0;
+    size_t i;
+    size_t j;
+    int result = EOK;
+
+    memset( &accesses, 0, sizeof( ExecAccessList ) );
+
+    pSchedule = calloc( 1, sizeof( VarSchedule ) );
+    if ( pSchedule != NULL )
+    {
+        pSchedule->pStatements = pStatements;
+
+        for ( pStatement = pStatements;
+              pStatement != NULL;
+              pStatement = pStatement->pNext )
+        {
+            pSchedule->n++;
+        }
+
+        if ( pSchedule->n > 0 )
+        {
+            pSchedule->pTasks = calloc( pSchedule->n, sizeof( ExecTask ) );
+            if ( pSchedule->pTasks == NULL )
+            {
+                result = ENOMEM;
+            }
+        }
+
+        pStatement = pStatements;
+        for ( i = 0; ( result == EOK ) && ( i < pSchedule->n ); i++ )
+        {
+            pSchedule->pTasks[i].pStatement = pStatement;
+
+            accesses.n = 0;
+            result = CollectAccesses( pStatement,
+                                      &accesses,
+                                      &pSchedule->pTasks[i].pinned );
+            if ( ( result == EOK ) &&
+                 ( pStatement->script == NULL ) )
+            {
+                result = AddAccess( &accesses, &g_barrierResource, false );
+            }
+
+            for ( j = 0; ( result == EOK ) && ( j < accesses.n ); j++ )
+            {
+                pAccess = &accesses.pAccesses[j];
+                if ( ( pAccess->pResource == &g_barrierResource ) &&
+                     ( pAccess->write == true ) )
+                {
+                    /* the statement or a nested statement runs a script */
+                    pSchedule->pTasks[i].script = true;
+                }
+
+                result = OrderAccess( pSchedule,
+                                      &pResources,
+                                      &nResources,
+                                      pAccess,
+                                      i );
+            }
+
+            pStatement = pStatement->pNext;
+        }
+
+        for ( i = 0; i < nResources; i++ )
+        {
+            free( pResources[i].pReaders );
+        }
+
+        free( pResources );
+        free( accesses.pAccesses );
+
+        if ( result != EOK )
+        {
+            VarActionFreeSchedule( pSchedule );
+            pSchedule = NULL;
+        }
+    }
+
+    return pSchedule;
+}
+
+/*============================================================================*/
+/*  VarActionFreeSchedule                                                     */
+/*!
+    Free a statement schedule
+
+    The VarActionFreeSchedule function releases a schedule created with
+    VarActionCreateSchedule().  The statements are not affected.
+
+@param[in]
+    pSchedule
+        pointer to the schedule to free
+
+==============================================================================*/
+void VarActionFreeSchedule( VarSchedule *pSchedule )
+{
+    size_t i;
+
+    if ( pSchedule != NULL )
+    {
+        if ( pSchedule->pTasks != NULL )
+        {
+            for ( i = 0; i < pSchedule->n; i++ )
+            {
+                free( pSchedule->pTasks[i].pSuccessors );
+            }
+        }
+
+        free( pSchedule->pTasks );
+        free( pSchedule );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionExecute                                                          */
+/*!
+    Evaluate a statement schedule in parallel
+
+    The VarActionExecute function evaluates the statements of a schedule
+    using the executor's worker threads and the calling thread.  The
+    evaluation options of the calling thread's context are used by all
+    of the workers, and their profile statistics are merged into it.
+    System variable writes are deferred, and are published from the
+    calling thread when all of the statements have been evaluated, or
+    before a script statement runs.
+
+    The schedule must have been built in the calling thread's context,
+    and only one schedule can be executed at a time by an executor.
+
+@param[in]
+    pExecutor
+        pointer to the executor
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pSchedule
+        pointer to the schedule to evaluate
+
+@retval EOK the statements were processed successfully
+@retval EINVAL invalid arguments
+@retval other error from the last statement which failed
+
+==============================================================================*/
+int VarActionExecute( VarExecutor *pExecutor,
+                      VARSERVER_HANDLE hVarServer,
+                      VarSchedule *pSchedule )
+{
+    int result = EINVAL;
+
+    if ( ( pExecutor != NULL ) &&
+         ( hVarServer != NULL ) &&
+         ( pSchedule != NULL ) )
+    {
+        ResolvePending( hVarServer, pSchedule->pStatements );
+
+        if ( pSchedule->n == 0 )
+        {
+            result = EOK;
+        }
+        else if ( ( pExecutor->nThreads == 0 ) ||
+                  ( PrefetchStatements( hVarServer,
+                                        pSchedule->pStatements ) != EOK ) )
+        {
+            /* values fetched while evaluating are written to the
+             * shared variable nodes, so the statements cannot be
+             * evaluated concurrently */
+            ReleasePrefetch();
+            result = ProcessCompoundStatement( hVarServer,
+                                               pSchedule->pStatements );
+        }
+        else
+        {
+            result = RunSchedule( pExecutor, hVarServer, pSchedule );
+            ReleasePrefetch();
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RunSchedule                                                               */
+/*!
+    Run a prefetched schedule across the worker pool
+
+@param[in]
+    pExecutor
+        pointer to the executor
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pSchedule
+        pointer to the schedule to evaluate
+
+@retval EOK the statements were processed successfully
+@retval ENOMEM the task queues could not be allocated
+@retval other error from the last statement which failed
+
+==============================================================================*/
+static int RunSchedule( VarExecutor *pExecutor,
+                        VARSERVER_HANDLE hVarServer,
+                        VarSchedule *pSchedule )
+{
+    VarActionContext *pContext = GetContext();
+    VarActionContext *pPrev;
+    ExecWorker *pWorker;
+    ExecTask *pTask;
+    size_t next = 0;
+    size_t i;
+    int result;
+    int rc;
+
+    result = ReserveQueue( &pExecutor->pinned, pSchedule->n );
+    for ( i = 0; ( result == EOK ) && ( i < pExecutor->nWorkers ); i++ )
+    {
+        result = ReserveQueue( &pExecutor->pWorkers[i].queue, pSchedule->n );
+    }
+
+    if ( result == EOK )
+    {
+        /* nested compound statements are not outermost */
+        (void)EnterCompound();
+
+        /* worker contexts have their own clocks, so shared expression
+         * values are not reused until the outermost compound statement
+         * ends */
+        SuspendShared();
+
+        /* the variable server handle cannot be used by the workers, so
+         * their writes are published from this thread */
+        BeginWrites();
+
+        pExecutor->pWorkers[0].pContext = pContext;
+        for ( i = 1; i < pExecutor->nWorkers; i++ )
+        {
+            pWorker = &pExecutor->pWorkers[i];
+            pWorker->pContext->options = pContext->options;
+            pWorker->pContext->depth = 1;
+            pWorker->pContext->defer = true;
+            pWorker->pContext->startns = pContext->startns;
+            pWorker->pContext->triggerns = pContext->triggerns;
+        }
+
+        /* distribute the tasks which are ready to start */
+        atomic_store( &pExecutor->remaining, pSchedule->n );
+        atomic_store( &pExecutor->completions, 0 );
+        for ( i = 0; i < pSchedule->n; i++ )
+        {
+            pTask = &pSchedule->pTasks[i];
+            pTask->result = EOK;
+            atomic_store( &pTask->waiting, pTask->nPredecessors );
+            if ( pTask->nPredecessors == 0 )
+            {
+                if ( pTask->pinned == true )
+                {
+                    PushTask( &pExecutor->pinned, i );
+                }
+                else
+                {
+                    PushTask( &pExecutor->pWorkers[next].queue, i );
+                    next = ( next + 1 ) % pExecutor->nWorkers;
+                }
+            }
+        }
+
+        pthread_mutex_lock( &pExecutor->lock );
+        pExecutor->pSchedule = pSchedule;
+        pExecutor->hVarServer = hVarServer;
+        pExecutor->finished = 0;
+        pExecutor->run++;
+        pthread_cond_broadcast( &pExecutor->start );
+        pthread_mutex_unlock( &pExecutor->lock );
+
+        RunTasks( &pExecutor->pWorkers[0] );
+
+        /* wait for the worker threads to leave the run */
+        pthread_mutex_lock( &pExecutor->lock );
+        while ( pExecutor->finished < pExecutor->nThreads )
+        {
+            pthread_cond_wait( &pExecutor->done, &pExecutor->lock );
+        }
+
+        pExecutor->pSchedule = NULL;
+        pthread_mutex_unlock( &pExecutor->lock );
+
+        LeaveCompound();
+
+        /* report the last error in program order */
+        for ( i = 0; i < pSchedule->n; i++ )
+        {
+            if ( pSchedule->pTasks[i].result != EOK )
+            {
+                result = pSchedule->pTasks[i].result;
+            }
+        }
+
+        for ( i = 1; i < pExecutor->nWorkers; i++ )
+        {
+            pWorker = &pExecutor->pWorkers[i];
+
+            /* each deferred variable is in exactly one write set */
+            pPrev = VarActionSetContext( pWorker->pContext );
+            rc = FlushWrites( hVarServer );
+            (void)VarActionSetContext( pPrev );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+
+            ProfileMerge( pContext, pWorker->pContext );
+        }
+
+        rc = FlushWrites( hVarServer );
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+
+        LatencyComplete();
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WorkerThread                                                              */
+/*!
+    Executor worker thread
+
+    The WorkerThread function selects the worker's context and runs
+    tasks each time a schedule is started, until the executor shuts down.
+
+@param[in]
+    arg
+        pointer to the ExecWorker
+
+@retval NULL
+
+==============================================================================*/
+static void *WorkerThread( void *arg )
+{
+    ExecWorker *pWorker = (ExecWorker *)arg;
+    VarExecutor *pExecutor = pWorker->pExecutor;
+    uint64_t run = 0;
+    bool running = true;
+
+    (void)VarActionSetContext( pWorker->pContext );
+
+    while ( running == true )
+    {
+        pthread_mutex_lock( &pExecutor->lock );
+        while ( ( pExecutor->shutdown == false ) &&
+                ( pExecutor->run == run ) )
+        {
+            pthread_cond_wait( &pExecutor->start, &pExecutor->lock );
+        }
+
+        run = pExecutor->run;
+        running = ( pExecutor->shutdown == false );
+        pthread_mutex_unlock( &pExecutor->lock );
+
+        if ( running == true )
+        {
+            RunTasks( pWorker );
+
+            pthread_mutex_lock( &pExecutor->lock );
+            pExecutor->finished++;
+            pthread_cond_signal( &pExecutor->done );
+            pthread_mutex_unlock( &pExecutor->lock );
+        }
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  RunTasks                                                                  */
+/*!
+    Run tasks until the schedule is complete
+
+    Tasks are only queued when another task completes, so a worker which
+    finds no task waits until the number of completed tasks changes.
+
+@param[in]
+    pWorker
+        pointer to the worker running the tasks
+
+==============================================================================*/
+static void RunTasks( ExecWorker *pWorker )
+{
+    VarExecutor *pExecutor = pWorker->pExecutor;
+    ExecTask *pTask;
+    size_t index;
+    uint_fast64_t completions;
+    int rc;
+
+    while ( atomic_load( &pExecutor->remaining ) > 0 )
+    {
+        completions = atomic_load( &pExecutor->completions );
+
+        if ( NextTask( pWorker, &index ) == true )
+        {
+            pTask = &pExecutor->pSchedule->pTasks[index];
+
+            rc = EOK;
+            if ( pTask->script == true )
+            {
+                /* the script must see the writes of the earlier statements */
+                rc = PublishWorkerWrites( pExecutor );
+            }
+
+            pTask->result = ProcessStatement( pExecutor->hVarServer,
+                                              pTask->pStatement );
+            if ( rc != EOK )
+            {
+                pTask->result = rc;
+            }
+
+            CompleteTask( pWorker, index );
+        }
+        else
+        {
+            WaitTask( pExecutor, completions );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  WaitTask                                                                  */
+/*!
+    Wait for a task to become ready
+
+    The WaitTask function blocks an idle worker until a task completes,
+    which may have queued new tasks or completed the schedule.  The
+    worker registers as idle before it checks the completion count, and
+    CompleteTask() checks for idle workers after advancing it, so either
+    the worker sees the new count or it is woken.
+
+@param[in]
+    pExecutor
+        pointer to the executor
+
+@param[in]
+    completions
+        completion count sampled before the worker looked for a task
+
+==============================================================================*/
+static void WaitTask( VarExecutor *pExecutor, uint_fast64_t completions )
+{
+    pthread_mutex_lock( &pExecutor->idleLock );
+    atomic_fetch_add( &pExecutor->idle, 1 );
+
+    while ( ( atomic_load( &pExecutor->completions ) == completions ) &&
+            ( atomic_load( &pExecutor->remaining ) > 0 ) )
+    {
+        pthread_cond_wait( &pExecutor->ready, &pExecutor->idleLock );
+    }
+
+    atomic_fetch_sub( &pExecutor->idle, 1 );
+    pthread_mutex_unlock( &pExecutor->idleLock );
+}
+
+/*============================================================================*/
+/*  PublishWorkerWrites                                                       */
+/*!
+    Publish the deferred writes of the worker threads
+
+    The PublishWorkerWrites function is called on the calling thread
+    before a task which runs a script.  Scripts are ordered with respect
+    to every other task, so no worker is evaluating a statement and
+    their write sets can be published.  ProcessStatement() publishes the
+    calling thread's own write set.
+
+@param[in]
+    pExecutor
+        pointer to the executor
+
+@retval EOK the writes were published
+@retval other error from the last write set which could not be published
+
+==============================================================================*/
+static int PublishWorkerWrites( VarExecutor *pExecutor )
+{
+    VarActionContext *pPrev;
+    size_t i;
+    int result = EOK;
+    int rc;
+
+    for ( i = 1; i < pExecutor->nWorkers; i++ )
+    {
+        pPrev = VarActionSetContext( pExecutor->pWorkers[i].pContext );
+        rc = PublishWrites( pExecutor->hVarServer );
+        (void)VarActionSetContext( pPrev );
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  NextTask                                                                  */
+/*!
+    Get the next task for a worker
+
+    The NextTask function gets a task from the pinned queue (calling
+    thread only), then the worker's own queue, and otherwise steals a
+    task from another worker.
+
+@param[in]
+    pWorker
+        pointer to the worker
+
+@param[out]
+    pIndex
+        pointer to the location to store the task index
+
+@retval true a task was found
+@retval false no task is ready
+
+==============================================================================*/
+static bool NextTask( ExecWorker *pWorker, size_t *pIndex )
+{
+    VarExecutor *pExecutor = pWorker->pExecutor;
+    bool found = false;
+    size_t i;
+    size_t victim;
+
+    if ( pWorker->index == 0 )
+    {
+        found = PopTask( &pExecutor->pinned, pIndex );
+    }
+
+    if ( found == false )
+    {
+        found = PopTask( &pWorker->queue, pIndex );
+    }
+
+    for ( i = 1; ( found == false ) && ( i < pExecutor->nWorkers ); i++ )
+    {
+        victim = ( pWorker->index + i ) % pExecutor->nWorkers;
+        found = StealTask( &pExecutor->pWorkers[victim].queue, pIndex );
+    }
+
+    return found;
+}
+
+/*============================================================================*/
+/*  CompleteTask                                                              */
+/*!
+    Complete a task
+
+    The CompleteTask function releases the tasks which depend on the
+    completed task, queueing those which have no remaining dependencies,
+    and wakes the idle workers.
+
+@param[in]
+    pWorker
+        pointer to the worker which ran the task
+
+@param[in]
+    index
+        index of the completed task
+
+==============================================================================*/
+static void CompleteTask( ExecWorker *pWorker, size_t index )
+{
+    VarExecutor *pExecutor = pWorker->pExecutor;
+    ExecTask *pTasks = pExecutor->pSchedule->pTasks;
+    ExecTask *pTask = &pTasks[index];
+    size_t next;
+    size_t i;
+
+    for ( i = 0; i < pTask->nSuccessors; i++ )
+    {
+        next = pTask->pSuccessors[i];
+        if ( atomic_fetch_sub( &pTasks[next].waiting, 1 ) == 1 )
+        {
+            PushTask( pTasks[next].pinned ? &pExecutor->pinned
+                                          : &pWorker->queue,
+                      next );
+        }
+    }
+
+    atomic_fetch_sub( &pExecutor->remaining, 1 );
+    atomic_fetch_add( &pExecutor->completions, 1 );
+
+    if ( atomic_load( &pExecutor->idle ) > 0 )
+    {
+        pthread_mutex_lock( &pExecutor->idleLock );
+        pthread_cond_broadcast( &pExecutor->ready );
+        pthread_mutex_unlock( &pExecutor->idleLock );
+    }
+}
+
+/*============================================================================*/
+/*  CollectAccesses                                                           */
+/*!
+    Collect the variable accesses of a statement
+
+    The CollectAccesses function adds the variables accessed by a
+    statement, including the statements of nested compound statements,
+    to the access list.
+
+@param[in]
+    pStatement
+        pointer to the statement
+
+@param[in,out]
+    pList
+        pointer to the access list
+
+@param[out]
+    pPinned
+        set to true if the statement must run on the calling thread
+
+@retval EOK the accesses were collected
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int CollectAccesses( Statement *pStatement,
+                            ExecAccessList *pList,
+                            bool *pPinned )
+{
+    int result = EOK;
+
+    if ( pStatement != NULL )
+    {
+        if ( pStatement->script != NULL )
+        {
+            /* scripts may have any side effect */
+            *pPinned = true;
+            result = AddAccess( pList, &g_barrierResource, true );
+        }
+
+        if ( result == EOK )
+        {
+            result = CollectVariableAccesses( pStatement->pVariable,
+                                              false,
+                                              pList,
+                                              pPinned );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CollectVariableAccesses                                                   */
+/*!
+    Collect the variable accesses of a variable tree
+
+@param[in]
+    pVariable
+        pointer to the variable tree
+
+@param[in]
+    write
+        true if the variable tree is the target of an assignment
+
+@param[in,out]
+    pList
+        pointer to the access list
+
+@param[out]
+    pPinned
+        set to true if the tree must be evaluated on the calling thread
+
+@retval EOK the accesses were collected
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int CollectVariableAccesses( Variable *pVariable,
+                                    bool write,
+                                    ExecAccessList *pList,
+                                    bool *pPinned )
+{
+    int result = EOK;
+    Statement *pStatement;
+
+    if ( pVariable != NULL )
+    {
+        switch( pVariable->operation )
+        {
+            case VA_SYSVAR:
+            case VA_LOCALVAR:
+                result = AddAccess( pList,
+                                    pVariable,
+                                    write || pVariable->lvalue );
+                break;
+
+            case VA_ASSIGN:
+            case VA_AND_EQUALS:
+            case VA_OR_EQUALS:
+            case VA_XOR_EQUALS:
+            case VA_DIV_EQUALS:
+            case VA_TIMES_EQUALS:
+            case VA_PLUS_EQUALS:
+            case VA_MINUS_EQUALS:
+            case VA_INC:
+            case VA_DEC:
+                result = CollectVariableAccesses( pVariable->left,
+                                                  true,
+                                                  pList,
+                                                  pPinned );
+                if ( result == EOK )
+                {
+                    result = CollectVariableAccesses( pVariable->right,
+                                                      false,
+                                                      pList,
+                                                      pPinned );
+                }
+                break;
+
+            case VA_CREATE_TICK:
+            case VA_CREATE_TIMER:
+            case VA_DELETE_TIMER:
+            case VA_ACTIVE_TIMER:
+            case VA_TIMER:
+                /* timers belong to the calling thread's context */
+                *pPinned = true;
+                result = AddAccess( pList, &g_timerResource, true );
+                if ( result == EOK )
+                {
+                    result = CollectVariableAccesses( pVariable->left,
+                                                      false,
+                                                      pList,
+                                                      pPinned );
+                }
+
+                if ( result == EOK )
+                {
+                    result = CollectVariableAccesses( pVariable->right,
+                                                      false,
+                                                      pList,
+                                                      pPinned );
+                }
+                break;
+
+            case VA_ELSE:
+                /* the ELSE node references the then and else
+                 * compound statements */
+                for ( pStatement = (Statement *)pVariable->left;
+                      ( result == EOK ) && ( pStatement != NULL );
+                      pStatement = pStatement->pNext )
+                {
+                    result = CollectAccesses( pStatement, pList, pPinned );
+                }
+
+                for ( pStatement = (Statement *)pVariable->right;
+                      ( result == EOK ) && ( pStatement != NULL );
+                      pStatement = pStatement->pNext )
+                {
+                    result = CollectAccesses( pStatement, pList, pPinned );
+                }
+                break;
+
+            default:
+                if ( pVariable->flags & VF_SHARED )
+                {
+                    /* evaluating a shared expression writes its value */
+                    result = AddAccess( pList, pVariable, true );
+                }
+
+                if ( result == EOK )
+                {
+                    result = CollectVariableAccesses( pVariable->left,
+                                                      false,
+                                                      pList,
+                                                      pPinned );
+                }
+
+                if ( result == EOK )
+                {
+                    result = CollectVariableAccesses( pVariable->right,
+                                                      false,
+                                                      pList,
+                                                      pPinned );
+                }
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddAccess                                                                 */
+/*!
+    Add a variable access to an access list
+
+@param[in]
+    pList
+        pointer to the access list
+
+@param[in]
+    pResource
+        pointer to the accessed variable or resource
+
+@param[in]
+    write
+        true if the variable or resource is written
+
+@retval EOK the access was added
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int AddAccess( ExecAccessList *pList, void *pResource, bool write )
+{
+    int result = EOK;
+    ExecAccess *pAccesses;
+    size_t size;
+
+    if ( pList->n == pList->size )
+    {
+        size = ( pList->size == 0 ) ? 16 : pList->size * 2;
+        pAccesses = realloc( pList->pAccesses, size * sizeof( ExecAccess ) );
+        if ( pAccesses != NULL )
+        {
+            pList->pAccesses = pAccesses;
+            pList->size = size;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pList->pAccesses[pList->n].pResource = pResource;
+        pList->pAccesses[pList->n].write = write;
+        pList->n++;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  OrderAccess                                                               */
+/*!
+    Order a statement's access to a resource
+
+    The OrderAccess function makes the statement depend on the last
+    statement which wrote the resource, and if the statement writes the
+    resource, on each statement which read it since the last write.
+
+@param[in]
+    pSchedule
+        pointer to the schedule being built
+
+@param[in,out]
+    ppResources
+        pointer to the resource ordering array
+
+@param[in,out]
+    pnResources
+        pointer to the number of resources in the array
+
+@param[in]
+    pAccess
+        pointer to the access
+
+@param[in]
+    index
+        index of the accessing statement
+
+@retval EOK the access was ordered
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int OrderAccess( VarSchedule *pSchedule,
+                        ExecResource **ppResources,
+                        size_t *pnResources,
+                        ExecAccess *pAccess,
+                        size_t index )
+{
+    int result = EOK;
+    ExecResource *pResource = NULL;
+    ExecResource *pResources;
+    size_t *pReaders;
+    size_t size;
+    size_t i;
+
+    for ( i = 0; i < *pnResources; i++ )
+    {
+        if ( (*ppResources)[i].pResource == pAccess->pResource )
+        {
+            pResource = &(*ppResources)[i];
+            break;
+        }
+    }
+
+    if ( pResource == NULL )
+    {
+        pResources = realloc( *ppResources,
+                              ( *pnResources + 1 ) * sizeof( ExecResource ) );
+        if ( pResources != NULL )
+        {
+            *ppResources = pResources;
+            pResource = &pResources[(*pnResources)++];
+            memset( pResource, 0, sizeof( ExecResource ) );
+            pResource->pResource = pAccess->pResource;
+            pResource->writer = EXEC_NONE;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        if ( pResource->writer != EXEC_NONE )
+        {
+            result = AddDependency( pSchedule, pResource->writer, index );
+        }
+
+        if ( pAccess->write == true )
+        {
+            for ( i = 0; ( result == EOK ) && ( i < pResource->nReaders ); i++ )
+            {
+                result = AddDependency( pSchedule,
+                                        pResource->pReaders[i],
+                                        index );
+            }
+
+            pResource->writer = index;
+            pResource->nReaders = 0;
+        }
+        else
+        {
+            if ( pResource->nReaders == pResource->size )
+            {
+                size = ( pResource->size == 0 ) ? 8 : pResource->size * 2;
+                pReaders = realloc( pResource->pReaders,
+                                    size * sizeof( size_t ) );
+                if ( pReaders != NULL )
+                {
+                    pResource->pReaders = pReaders;
+                    pResource->size = size;
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                pResource->pReaders[pResource->nReaders++] = index;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  AddDependency                                                             */
+/*!
+    Add a dependency between two tasks
+
+    The AddDependency function makes the task at index 'to' wait for the
+    task at index 'from'.  Dependencies of a task on itself, and repeated
+    dependencies, are ignored.
+
+@param[in]
+    pSchedule
+        pointer to the schedule being built
+
+@param[in]
+    from
+        index of the earlier task
+
+@param[in]
+    to
+        index of the dependent task
+
+@retval EOK the dependency was added
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int AddDependency( VarSchedule *pSchedule, size_t from, size_t to )
+{
+    int result = EOK;
+    ExecTask *pTask = &pSchedule->pTasks[from];
+    size_t *pSuccessors;
+    size_t size;
+
+    /* dependencies are added while processing the dependent task,
+     * so a repeated dependency is always the last one added */
+    if ( ( from != to ) &&
+         ( ( pTask->nSuccessors == 0 ) ||
+           ( pTask->pSuccessors[pTask->nSuccessors - 1] != to ) ) )
+    {
+        if ( pTask->nSuccessors == pTask->size )
+        {
+            size = ( pTask->size == 0 ) ? 4 : pTask->size * 2;
+            pSuccessors = realloc( pTask->pSuccessors,
+                                   size * sizeof( size_t ) );
+            if ( pSuccessors != NULL )
+            {
+                pTask->pSuccessors = pSuccessors;
+                pTask->size = size;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            pTask->pSuccessors[pTask->nSuccessors++] = to;
+            pSchedule->pTasks[to].nPredecessors++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  InitQueue                                                                 */
+/*!
+    Initialize a task queue
+
+@param[in]
+    pQueue
+        pointer to the queue to initialize
+
+@retval EOK the queue was initialized
+@retval other error from pthread_mutex_init()
+
+==============================================================================*/
+static int InitQueue( ExecQueue *pQueue )
+{
+    memset( pQueue, 0, sizeof( ExecQueue ) );
+
+    return pthread_mutex_init( &pQueue->lock, NULL );
+}
+
+/*============================================================================*/
+/*  ReserveQueue                                                              */
+/*!
+    Reserve space in an empty task queue
+
+@param[in]
+    pQueue
+        pointer to the queue
+
+@param[in]
+    size
+        number of tasks the queue must be able to hold
+
+@retval EOK the space was reserved
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int ReserveQueue( ExecQueue *pQueue, size_t size )
+{
+    int result = EOK;
+    size_t *pItems;
+
+    if ( pQueue->size < size )
+    {
+        pItems = realloc( pQueue->pItems, size * sizeof( size_t ) );
+        if ( pItems != NULL )
+        {
+            pQueue->pItems = pItems;
+            pQueue->size = size;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    pQueue->head = 0;
+    pQueue->n = 0;
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PushTask                                                                  */
+/*!
+    Push a task onto the tail of a task queue
+
+    Each task is queued at most once per run, so the queue cannot
+    overflow once it has been reserved for the schedule.
+
+@param[in]
+    pQueue
+        pointer to the queue
+
+@param[in]
+    index
+        index of the task
+
+==============================================================================*/
+static void PushTask( ExecQueue *pQueue, size_t index )
+{
+    pthread_mutex_lock( &pQueue->lock );
+    pQueue->pItems[( pQueue->head + pQueue->n ) % pQueue->size] = index;
+    pQueue->n++;
+    pthread_mutex_unlock( &pQueue->lock );
+}
+
+/*============================================================================*/
+/*  PopTask                                                                   */
+/*!
+    Pop the most recently pushed task from a task queue
+
+@param[in]
+    pQueue
+        pointer to the queue
+
+@param[out]
+    pIndex
+        pointer to the location to store the task index
+
+@retval true a task was removed
+@retval false the queue is empty
+
+==============================================================================*/
+static bool PopTask( ExecQueue *pQueue, size_t *pIndex )
+{
+    bool found = false;
+
+    pthread_mutex_lock( &pQueue->lock );
+    if ( pQueue->n > 0 )
+    {
+        pQueue->n--;
+        *pIndex = pQueue->pItems[( pQueue->head + pQueue->n ) % pQueue->size];
+        found = true;
+    }
+    pthread_mutex_unlock( &pQueue->lock );
+
+    return found;
+}
+
+/*============================================================================*/
+/*  StealTask                                                                 */
+/*!
+    Steal the oldest task from a task queue
+
+@param[in]
+    pQueue
+        pointer to the queue
+
+@param[out]
+    pIndex
+        pointer to the location to store the task index
+
+@retval true a task was removed
+@retval false the queue is empty
+
+==============================================================================*/
+static bool StealTask( ExecQueue *pQueue, size_t *pIndex )
+{
+    bool found = false;
+
+    pthread_mutex_lock( &pQueue->lock );
+    if ( pQueue->n > 0 )
+    {
+        *pIndex = pQueue->pItems[pQueue->head];
+        pQueue->head = ( pQueue->head + 1 ) % pQueue->size;
+        pQueue->n--;
+        found = true;
+    }
+    pthread_mutex_unlock( &pQueue->lock );
+
+    return found;
+}
+
+/*============================================================================*/
+/*  FreeQueue                                                                 */
+/*!
+    Free a task queue
+
+@param[in]
+    pQueue
+        pointer to the queue
+
+==============================================================================*/
+static void FreeQueue( ExecQueue *pQueue )
+{
+    free( pQueue->pItems );
+    pthread_mutex_destroy( &pQueue->lock );
+    memset( pQueue, 0, sizeof( ExecQueue ) );
+}
+
+/*! @}
+ * end of varexec group */
@@ -0,0 +1,881 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varformat varformat
+ * @brief Variable Action Script Format Plan functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varformat.c
+
+    Variable Action Script Format Plan functions
+
+    The Variable Action Script Format Plan functions compile the format
+    string of a string conversion into a format plan once, when the
+    conversion node is created, rather than having snprintf() parse it
+    on every conversion.
+
+    A format contains at most one conversion specification of a numeric
+    type, surrounded by literal text.  The value being converted is
+    passed with the argument type the conversion expects, so a float
+    converted with %d, or an integer converted with %f, is converted
+    rather than misinterpreted.  Plain %d, %i, %u and %f conversions,
+    and conversions with no format, are formatted directly without
+    snprintf().
+
+    The output is written to a string buffer sized for it, so it is
+    never truncated.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <syslog.h>
+#include "varformat.h"
+#include "varstrings.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! size of the buffer a conversion is formatted into before it is copied
+ *  to the result.  Longer conversions are formatted in place. */
+#define FORMAT_BUFFER_SIZE  ( 64 )
+
+/*! largest magnitude formatted with %f without snprintf().  Below this
+ *  bound, the value scaled by 10^6 is exact in a double, so rounding it
+ *  to an integer matches the rounding of snprintf() */
+#define FORMAT_FIXED_MAX    ( 9.0e9 )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! plan used when a conversion has no format */
+static const FormatPlan g_defaultFormat =
+{
+    .spec = "",
+    .cls = FORMAT_DEFAULT,
+    .fast = true
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int ParseSpec( const char *pFormat, FormatPlan *pPlan, size_t *pLen );
+static int Convert( const FormatPlan *pPlan,
+                    VarObject *pValue,
+                    char *buf,
+                    size_t size );
+static long long SignedValue( VarObject *pValue );
+static unsigned long long UnsignedValue( VarObject *pValue );
+static double FloatValue( VarObject *pValue );
+static int FormatDecimal( char *buf, long long value );
+static int FormatFixed( char *buf, size_t size, double value );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CompileFormat                                                             */
+/*!
+    Compile a format string into a format plan
+
+    The CompileFormat function splits the format string into the literal
+    text before and after its conversion specification, and normalizes
+    the specification for the argument type it expects.
+
+    The plan, the copy of the format string, and the literal text are
+    allocated together and released with FreeFormat().
+
+@param[in]
+    pFormat
+        pointer to the format string
+
+@param[out]
+    ppPlan
+        pointer to a location to store a pointer to the new plan
+
+@retval EINVAL invalid argument
+@retval ENOTSUP the format contains more than one conversion, or a
+                conversion which is not of a numeric type
+@retval ENOMEM memory allocation failure
+@retval EOK the format plan was created
+
+==============================================================================*/
+int CompileFormat( const char *pFormat, FormatPlan **ppPlan )
+{
+    int result = EINVAL;
+    FormatPlan *pPlan;
+    char *out;
+    size_t *pLen;
+    size_t len;
+    size_t speclen = 0;
+    size_t i = 0;
+
+    if ( ( pFormat != NULL ) &&
+         ( ppPlan != NULL ) )
+    {
+        len = strlen( pFormat );
+        pPlan = calloc( 1, sizeof( FormatPlan ) + ( 3 * ( len + 1 ) ) );
+        if ( pPlan != NULL )
+        {
+            pPlan->pFormat = pFormat;
+            pPlan->source = (char *)( pPlan + 1 );
+            pPlan->prefix = pPlan->source + len + 1;
+            pPlan->suffix = pPlan->prefix + len + 1;
+            pPlan->cls = FORMAT_NONE;
+            memcpy( pPlan->source, pFormat, len + 1 );
+
+            out = pPlan->prefix;
+            pLen = &pPlan->prefixLen;
+            result = EOK;
+
+            while ( ( result == EOK ) &&
+                    ( pFormat[i] != '\0' ) )
+            {
+                if ( ( pFormat[i] == '%' ) && ( pFormat[i+1] == '%' ) )
+                {
+                    /* escaped percent sign */
+                    out[(*pLen)++] = '%';
+                    i += 2;
+                }
+                else if ( pFormat[i] == '%' )
+                {
+                    if ( pPlan->cls == FORMAT_NONE )
+                    {
+                        result = ParseSpec( &pFormat[i], pPlan, &speclen );
+                        out = pPlan->suffix;
+                        pLen = &pPlan->suffixLen;
+                        i += speclen;
+                    }
+                    else
+                    {
+                        /* only one value is converted */
+                        result = ENOTSUP;
+                    }
+                }
+                else
+                {
+                    out[(*pLen)++] = pFormat[i++];
+                }
+            }
+
+            if ( result == EOK )
+            {
+                *ppPlan = pPlan;
+            }
+            else
+            {
+                free( pPlan );
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FreeFormat                                                                */
+/*!
+    Free a format plan
+
+    The FreeFormat function releases a format plan created by
+    CompileFormat().
+
+@param[in]
+    pPlan
+        pointer to the plan to free (may be NULL)
+
+==============================================================================*/
+void FreeFormat( FormatPlan *pPlan )
+{
+    free( pPlan );
+}
+
+/*============================================================================*/
+/*  PrepareFormat                                                             */
+/*!
+    Compile the format of a string conversion node
+
+    The PrepareFormat function compiles the format plan of a string
+    conversion node whose format is a string constant when the node is
+    created.  A format which cannot be compiled is left for GetFormat()
+    to report when the node is evaluated.
+
+@param[in]
+    pVariable
+        pointer to the VA_TOSTRING node
+
+==============================================================================*/
+void PrepareFormat( Variable *pVariable )
+{
+    Variable *pRight;
+
+    if ( ( pVariable != NULL ) &&
+         ( pVariable->operation == VA_TOSTRING ) &&
+         ( pVariable->pFormat == NULL ) )
+    {
+        pRight = pVariable->right;
+        if ( ( pRight != NULL ) &&
+             ( pRight->operation == VA_STRING ) &&
+             ( pRight->obj.val.str != NULL ) )
+        {
+            (void)CompileFormat( pRight->obj.val.str, &pVariable->pFormat );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  GetFormat                                                                 */
+/*!
+    Get the format plan for a string conversion
+
+    The GetFormat function gets the format plan for the format operand of
+    a string conversion.  The plan compiled for the node is used while the
+    format is unchanged.  A format which is not a constant, and which has
+    changed since it was last compiled, is compiled again.
+
+@param[in]
+    pResult
+        pointer to the VA_TOSTRING node
+
+@param[in]
+    pRight
+        pointer to the format operand (may be NULL)
+
+@param[out]
+    ppPlan
+        pointer to a location to store a pointer to the plan
+
+@retval EINVAL invalid argument
+@retval ENOTSUP the format is not supported
+@retval ENOMEM memory allocation failure
+@retval EOK the format plan was retrieved
+
+==============================================================================*/
+int GetFormat( Variable *pResult,
+               Variable *pRight,
+               const FormatPlan **ppPlan )
+{
+    int result = EINVAL;
+    FormatPlan *pPlan;
+    const char *pFormat;
+
+    if ( ( pResult != NULL ) &&
+         ( ppPlan != NULL ) )
+    {
+        result = EOK;
+
+        if ( ( pRight == NULL ) ||
+             ( pRight->obj.type != VARTYPE_STR ) ||
+             ( pRight->obj.val.str == NULL ) )
+        {
+            *ppPlan = &g_defaultFormat;
+        }
+        else
+        {
+            pFormat = pRight->obj.val.str;
+            pPlan = pResult->pFormat;
+
+            if ( ( pPlan == NULL ) ||
+                 ( ( ( pPlan->pFormat != pFormat ) ||
+                     ( ( pRight->operation != VA_STRING ) &&
+                       ( ( pRight->flags & VF_INTERNED_STR ) == 0 ) ) ) &&
+                   ( strcmp( pPlan->source, pFormat ) != 0 ) ) )
+            {
+                /* the format has changed */
+                result = CompileFormat( pFormat, &pPlan );
+                if ( result == EOK )
+                {
+                    FreeFormat( pResult->pFormat );
+                    pResult->pFormat = pPlan;
+                }
+            }
+
+            if ( result == EOK )
+            {
+                pPlan->pFormat = pFormat;
+                *ppPlan = pPlan;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FormatValue                                                               */
+/*!
+    Format a value using a format plan
+
+    The FormatValue function formats a numeric value using a format
+    plan, and stores the output in the string value of the result node,
+    which is sized to fit the output.
+
+@param[in]
+    pPlan
+        pointer to the format plan
+
+@param[in]
+    pResult
+        pointer to the result node
+
+@param[in]
+    pValue
+        pointer to the value to format
+
+@retval EINVAL invalid argument
+@retval ENOTSUP the value is not numeric
+@retval ENOMEM memory allocation failure
+@retval EOK the value was formatted
+
+==============================================================================*/
+int FormatValue( const FormatPlan *pPlan,
+                 Variable *pResult,
+                 VarObject *pValue )
+{
+    int result = EINVAL;
+    char buf[FORMAT_BUFFER_SIZE];
+    size_t len;
+    char *str;
+    int n = -1;
+
+    if ( ( pPlan != NULL ) &&
+         ( pResult != NULL ) &&
+         ( pValue != NULL ) )
+    {
+        if ( ( pValue->type == VARTYPE_UINT16 ) ||
+             ( pValue->type == VARTYPE_UINT32 ) ||
+             ( pValue->type == VARTYPE_FLOAT ) )
+        {
+            n = Convert( pPlan, pValue, buf, sizeof( buf ) );
+            result = ( n >= 0 ) ? EOK : EINVAL;
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+
+        if ( result == EOK )
+        {
+            pResult->obj.type = VARTYPE_STR;
+            len = pPlan->prefixLen + n + pPlan->suffixLen;
+            result = AllocateString( pResult, len );
+        }
+
+        if ( result == EOK )
+        {
+            str = pResult->obj.val.str;
+            if ( pPlan->prefixLen > 0 )
+            {
+                memcpy( str, pPlan->prefix, pPlan->prefixLen );
+            }
+
+            if ( (size_t)n < sizeof( buf ) )
+            {
+                memcpy( &str[pPlan->prefixLen], buf, n );
+            }
+            else
+            {
+                /* format a long conversion in place */
+                (void)Convert( pPlan, pValue, &str[pPlan->prefixLen], n + 1 );
+            }
+
+            if ( pPlan->suffixLen > 0 )
+            {
+                memcpy( &str[pPlan->prefixLen + n],
+                        pPlan->suffix,
+                        pPlan->suffixLen );
+            }
+
+            str[len] = 0;
+            pResult->obj.len = len;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ParseSpec                                                                 */
+/*!
+    Parse a conversion specification
+
+    The ParseSpec function parses the conversion specification at the
+    start of the specified text, and stores the normalized specification
+    and its argument class in the format plan.  Length modifiers are
+    replaced by "ll" for conversions which take a long integer, and
+    removed otherwise.
+
+@param[in]
+    pFormat
+        pointer to the '%' which starts the specification
+
+@param[in,out]
+    pPlan
+        pointer to the format plan
+
+@param[out]
+    pLen
+        pointer to a location to store the length of the specification
+
+@retval ENOTSUP the specification is not supported
+@retval EOK the specification was parsed
+
+==============================================================================*/
+static int ParseSpec( const char *pFormat, FormatPlan *pPlan, size_t *pLen )
+{
+    int result = ENOTSUP;
+    const char *p = pFormat + 1;
+    size_t n;
+    bool wide = false;
+
+    /* flags, field width and precision */
+    p += strspn( p, "-+ #0'" );
+    p += strspn( p, "0123456789" );
+    if ( *p == '.' )
+    {
+        p++;
+        p += strspn( p, "0123456789" );
+    }
+
+    n = p - pFormat;
+
+    /* length modifiers */
+    while ( ( *p != '\0' ) && ( strchr( "hljztqL", *p ) != NULL ) )
+    {
+        if ( *p != 'h' )
+        {
+            wide = true;
+        }
+
+        p++;
+    }
+
+    /* the conversion, and room for "ll", the conversion and a NUL */
+    if ( ( *p != '\0' ) &&
+         ( n + 4 <= FORMAT_SPEC_SIZE ) )
+    {
+        if ( strchr( "di", *p ) )
+        {
+            pPlan->cls = FORMAT_SIGNED;
+            result = EOK;
+        }
+        else if ( *p == 'c' )
+        {
+            pPlan->cls = FORMAT_SIGNED;
+            wide = false;
+            result = EOK;
+        }
+        else if ( strchr( "ouxX", *p ) )
+        {
+            pPlan->cls = FORMAT_UNSIGNED;
+            result = EOK;
+        }
+        else if ( strchr( "fFeEgGaA", *p ) )
+        {
+            pPlan->cls = FORMAT_FLOAT;
+            wide = false;
+            result = EOK;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        memcpy( pPlan->spec, pFormat, n );
+        if ( wide == true )
+        {
+            pPlan->spec[n++] = 'l';
+            pPlan->spec[n++] = 'l';
+        }
+
+        pPlan->spec[n++] = *p;
+        pPlan->spec[n] = 0;
+        pPlan->wide = wide;
+        pPlan->fast = ( strcmp( pPlan->spec, "%d" ) == 0 ) ||
+                      ( strcmp( pPlan->spec, "%i" ) == 0 ) ||
+                      ( strcmp( pPlan->spec, "%u" ) == 0 ) ||
+                      ( strcmp( pPlan->spec, "%f" ) == 0 );
+
+        *pLen = ( p + 1 ) - pFormat;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Convert                                                                   */
+/*!
+    Format the conversion of a format plan
+
+    The Convert function formats the value for the conversion of a format
+    plan, without its literal text.  Like snprintf(), the output is
+    truncated to fit the buffer, and the length of the complete output
+    is returned.
+
+@param[in]
+    pPlan
+        pointer to the format plan
+
+@param[in]
+    pValue
+        pointer to the numeric value to format
+
+@param[in]
+    buf
+        pointer to the output buffer
+
+@param[in]
+    size
+        size of the output buffer
+
+@retval length of the formatted conversion
+@retval -1 if the value could not be formatted
+
+==============================================================================*/
+static int Convert( const FormatPlan *pPlan,
+                    VarObject *pValue,
+                    char *buf,
+                    size_t size )
+{
+    int n = 0;
+
+    switch( pPlan->cls )
+    {
+        case FORMAT_DEFAULT:
+            if ( pValue->type == VARTYPE_FLOAT )
+            {
+                n = FormatFixed( buf, size, pValue->val.f );
+            }
+            else
+            {
+                /* %d of the value, as an int */
+                n = FormatDecimal( buf, (int)SignedValue( pValue ) );
+            }
+            break;
+
+        case FORMAT_SIGNED:
+            if ( pPlan->fast == true )
+            {
+                n = FormatDecimal( buf, (int)SignedValue( pValue ) );
+            }
+            else if ( pPlan->wide == true )
+            {
+                n = snprintf( buf, size, pPlan->spec, SignedValue( pValue ) );
+            }
+            else
+            {
+                n = snprintf( buf,
+                              size,
+                              pPlan->spec,
+                              (int)SignedValue( pValue ) );
+            }
+            break;
+
+        case FORMAT_UNSIGNED:
+            if ( pPlan->fast == true )
+            {
+                n = FormatDecimal( buf,
+                                   (unsigned int)UnsignedValue( pValue ) );
+            }
+            else if ( pPlan->wide == true )
+            {
+                n = snprintf( buf, size, pPlan->spec, UnsignedValue( pValue ) );
+            }
+            else
+            {
+                n = snprintf( buf,
+                              size,
+                              pPlan->spec,
+                              (unsigned int)UnsignedValue( pValue ) );
+            }
+            break;
+
+        case FORMAT_FLOAT:
+            if ( pPlan->fast == true )
+            {
+                n = FormatFixed( buf, size, FloatValue( pValue ) );
+            }
+            else
+            {
+                n = snprintf( buf, size, pPlan->spec, FloatValue( pValue ) );
+            }
+            break;
+
+        case FORMAT_NONE:
+        default:
+            n = 0;
+            break;
+    }
+
+    return n;
+}
+
+/*============================================================================*/
+/*  SignedValue                                                               */
+/*!
+    Get a numeric value as a signed integer
+
+@param[in]
+    pValue
+        pointer to the numeric value
+
+@retval the value as a signed integer, with floats saturated to the
+        range of a long long
+
+==============================================================================*/
+static long long SignedValue( VarObject *pValue )
+{
+    long long value;
+    float f;
+
+    switch( pValue->type )
+    {
+        case VARTYPE_UINT16:
+            value = pValue->val.ui;
+            break;
+
+        case VARTYPE_UINT32:
+            value = pValue->val.ul;
+            break;
+
+        case VARTYPE_FLOAT:
+            f = pValue->val.f;
+            if ( f != f )
+            {
+                value = 0;
+            }
+            else if ( f >= 9.2e18f )
+            {
+                value = LLONG_MAX;
+            }
+            else if ( f <= -9.2e18f )
+            {
+                value = LLONG_MIN;
+            }
+            else
+            {
+                value = (long long)f;
+            }
+            break;
+
+        default:
+            value = 0;
+            break;
+    }
+
+    return value;
+}
+
+/*============================================================================*/
+/*  UnsignedValue                                                             */
+/*!
+    Get a numeric value as an unsigned integer
+
+@param[in]
+    pValue
+        pointer to the numeric value
+
+@retval the value as an unsigned integer
+
+==============================================================================*/
+static unsigned long long UnsignedValue( VarObject *pValue )
+{
+    return (unsigned long long)SignedValue( pValue );
+}
+
+/*============================================================================*/
+/*  FloatValue                                                                */
+/*!
+    Get a numeric value as a double
+
+@param[in]
+    pValue
+        pointer to the numeric value
+
+@retval the value as a double
+
+==============================================================================*/
+static double FloatValue( VarObject *pValue )
+{
+    double value;
+
+    switch( pValue->type )
+    {
+        case VARTYPE_UINT16:
+            value = pValue->val.ui;
+            break;
+
+        case VARTYPE_UINT32:
+            value = pValue->val.ul;
+            break;
+
+        case VARTYPE_FLOAT:
+            value = pValue->val.f;
+            break;
+
+        default:
+            value = 0.0;
+            break;
+    }
+
+    return value;
+}
+
+/*============================================================================*/
+/*  FormatDecimal                                                             */
+/*!
+    Format an integer in decimal
+
+    The FormatDecimal function formats an integer in the same way as %lld.
+
+@param[in]
+    buf
+        pointer to an output buffer of at least 21 bytes
+
+@param[in]
+    value
+        the value to format
+
+@retval length of the formatted value
+
+==============================================================================*/
+static int FormatDecimal( char *buf, long long value )
+{
+    char digits[20];
+    unsigned long long u;
+    int n = 0;
+    int i = 0;
+
+    if ( value < 0 )
+    {
+        buf[n++] = '-';
+        u = 0ULL - (unsigned long long)value;
+    }
+    else
+    {
+        u = value;
+    }
+
+    do
+    {
+        digits[i++] = '0' + ( u % 10 );
+        u /= 10;
+    } while ( u != 0 );
+
+    while ( i > 0 )
+    {
+        buf[n++] = digits[--i];
+    }
+
+    return n;
+}
+
+/*============================================================================*/
+/*  FormatFixed                                                               */
+/*!
+    Format a number in fixed point with six decimal places
+
+    The FormatFixed function formats a number in the same way as %f.
+    Values whose magnitude is below FORMAT_FIXED_MAX are formatted
+    directly, other values are formatted with snprintf().
+
+@param[in]
+    buf
+        pointer to the output buffer
+
+@param[in]
+    size
+        size of the output buffer, at least 32 bytes for direct formatting
+
+@param[in]
+    value
+        the value to format.  Direct formatting is exact for values with
+        at most 32 significant bits, which includes every float and every
+        32-bit integer.
+
+@retval length of the formatted value
+
+==============================================================================*/
+static int FormatFixed( char *buf, size_t size, double value )
+{
+    unsigned long long scaled;
+    unsigned long long frac;
+    int n = 0;
+    int i;
+
+    if ( ( size >= 32 ) &&
+         ( fabs( value ) < FORMAT_FIXED_MAX ) )
+    {
+        if ( signbit( value ) )
+        {
+            buf[n++] = '-';
+        }
+
+        /* round half to even, as snprintf() does */
+        scaled = (unsigned long long)nearbyint( fabs( value ) * 1e6 );
+        frac = scaled % 1000000ULL;
+
+        n += FormatDecimal( &buf[n], (long long)( scaled / 1000000ULL ) );
+        buf[n++] = '.';
+        for ( i = 5; i >= 0; i-- )
+        {
+            buf[n + i] = '0' + ( frac % 10 );
+            frac /= 10;
+        }
+
+        n += 6;
+    }
+    else
+    {
+        n = snprintf( buf, size, "%f", value );
+    }
+
+    return n;
+}
+
+/*! @}
+ * end of varformat group */
@@ -0,0 +1,1447 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varimage varimage
+ * @brief Variable Action Script Rule Set Image functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varimage.c
+
+    Variable Action Script Rule Set Image functions
+
+    The Variable Action Script Rule Set Image functions save a statement
+    list, with all of its variable trees, constants, identifiers and
+    system variable names, to a position independent binary image, and
+    load it again without parsing it.
+
+    The image contains fixed width node and statement records which refer
+    to each other by index, and a table of distinct strings which they
+    refer to by offset (see varimage.h).  Nodes which are shared in the
+    trees, such as local variable declarations, are saved once and remain
+    shared when the image is loaded.
+
+    An image is loaded by mapping the file into memory and rebuilding
+    the nodes from the records in a single forward pass, into one
+    allocation.  The nodes hold their operation functions and evaluation
+    state, so they cannot be evaluated in the mapped file itself, but
+    identifiers and scripts are referenced in the mapping rather than
+    copied, and string constants are interned.  Each system variable name
+    is resolved once, and shares the node of a system variable of the
+    same name which is already known to the context.  Values are not
+    retrieved until the statements are evaluated.  When the
+    VA_OPT_LAZY_RESOLVE option is set, the names are recorded with the
+    types saved in the image and their handles are looked up together
+    by ResolveAll().
+
+    The image uses the byte order and float format of the host which
+    saved it.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "varimage.h"
+#include "varcontext.h"
+#include "varintern.h"
+#include "varsymtab.h"
+#include "varformat.h"
+#include "varspecial.h"
+#include "varops.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of entries allocated in an image writer table */
+#define IMAGE_INITIAL_SIZE      ( 64 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! saved object entry, mapping a node or statement to its reference */
+typedef struct _imageRef
+{
+    /*! pointer to the saved node or statement (NULL if unused) */
+    const void *p;
+
+    /*! reference to its record */
+    uint32_t ref;
+
+} ImageRef;
+
+/*! image writer state */
+typedef struct _imageWriter
+{
+    /*! node records */
+    ImageNode *pNodes;
+
+    /*! number of node records */
+    size_t nNodes;
+
+    /*! number of node records allocated */
+    size_t nodeSize;
+
+    /*! statement records */
+    ImageStatement *pStatements;
+
+    /*! number of statement records */
+    size_t nStatements;
+
+    /*! number of statement records allocated */
+    size_t statementSize;
+
+    /*! string table */
+    char *pStrings;
+
+    /*! size of the string table */
+    size_t stringsSize;
+
+    /*! number of string table bytes allocated */
+    size_t stringsAlloc;
+
+    /*! string table index of string references */
+    uint32_t *pStringIndex;
+
+    /*! number of entries in the string table index (a power of 2) */
+    size_t stringIndexSize;
+
+    /*! number of strings in the string table */
+    size_t nStrings;
+
+    /*! index of saved nodes and statements */
+    ImageRef *pRefs;
+
+    /*! number of entries in the saved object index (a power of 2) */
+    size_t refSize;
+
+    /*! number of saved objects */
+    size_t nRefs;
+
+    /*! first error encountered */
+    int result;
+
+} ImageWriter;
+
+/*! loaded rule set image */
+struct _varImage
+{
+    /*! mapped image file */
+    void *pMap;
+
+    /*! size of the mapped image */
+    size_t size;
+
+    /*! nodes rebuilt from the image */
+    Variable *pNodes;
+
+    /*! number of nodes */
+    size_t nNodes;
+
+    /*! statements rebuilt from the image */
+    Statement *pStatements;
+
+    /*! number of statements */
+    size_t nStatements;
+
+    /*! node referred to by each node record */
+    Variable **ppRefs;
+
+    /*! lowest statement list reference in the tree of each node
+     *  record, or zero if the tree has no IF blocks */
+    uint32_t *pFirstBlock;
+
+    /*! first statement of the rule set */
+    Statement *pRoot;
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static uint32_t SaveList( ImageWriter *pWriter, Statement *pStatement );
+static uint32_t SaveNode( ImageWriter *pWriter, Variable *pVariable );
+static uint32_t SaveString( ImageWriter *pWriter, const char *str );
+static uint32_t FindRef( ImageWriter *pWriter, const void *p );
+static void AddRef( ImageWriter *pWriter, const void *p, uint32_t ref );
+static int Reserve( void **pp, size_t *pSize, size_t n, size_t size );
+static int WriteImage( ImageWriter *pWriter, uint32_t root, const char *path );
+static int WriteAll( int fd, const void *p, size_t len );
+static void FreeWriter( ImageWriter *pWriter );
+static int CheckHeader( const ImageHeader *pHeader, size_t size );
+static int LoadNodes( VARSERVER_HANDLE hVarServer, VarImage *pImage );
+static int LoadStatements( VarImage *pImage );
+static const char *ImageString( VarImage *pImage, uint32_t ref );
+static uint32_t FirstBlock( uint32_t a, uint32_t b );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionSaveImage                                                        */
+/*!
+    Save a rule set to an image file
+
+    The VarActionSaveImage function saves a statement list, including the
+    statement lists of its IF/ELSE blocks and all of their variable trees,
+    to a binary image file which can be loaded with VarActionLoadImage().
+
+    The values of variables are not saved.
+
+@param[in]
+    pStatements
+        pointer to the statement list to save
+
+@param[in]
+    path
+        path of the image file to create
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval E2BIG the rule set is too big for an image
+@retval EOK the image was saved
+@retval other error from creating or writing the file
+
+==============================================================================*/
+int VarActionSaveImage( Statement *pStatements, const char *path )
+{
+    int result = EINVAL;
+    ImageWriter writer;
+    uint32_t root;
+
+    if ( ( pStatements != NULL ) &&
+         ( path != NULL ) )
+    {
+        memset( &writer, 0, sizeof( ImageWriter ) );
+        writer.result = EOK;
+
+        root = SaveList( &writer, pStatements );
+        result = writer.result;
+        if ( result == EOK )
+        {
+            result = WriteImage( &writer, root, path );
+        }
+
+        FreeWriter( &writer );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionLoadImage                                                        */
+/*!
+    Load a rule set from an image file
+
+    The VarActionLoadImage function maps an image file created by
+    VarActionSaveImage() and rebuilds its statements in the current
+    context.  The statements are retrieved with VarActionImageStatements()
+    and remain valid until the image is freed with VarActionFreeImage().
+
+    System variables which cannot be found are reported on stderr, and
+    the image is not loaded.  When the VA_OPT_LAZY_RESOLVE option is set
+    they are reported by ResolveAll() instead.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    path
+        path of the image file to load
+
+@retval pointer to the loaded image
+@retval NULL if the image could not be loaded, with errno set to
+        EINVAL if the image is not valid, ENOENT if a system variable
+        could not be found, or the error from mapping the file
+
+==============================================================================*/
+VarImage *VarActionLoadImage( VARSERVER_HANDLE hVarServer, const char *path )
+{
+    int result = EINVAL;
+    VarImage *pImage = NULL;
+    const ImageHeader *pHeader = NULL;
+    struct stat st;
+    int fd;
+
+    if ( ( hVarServer != NULL ) &&
+         ( path != NULL ) )
+    {
+        pImage = calloc( 1, sizeof( VarImage ) );
+        fd = open( path, O_RDONLY | O_CLOEXEC );
+        if ( pImage == NULL )
+        {
+            result = ENOMEM;
+        }
+        else if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else if ( fstat( fd, &st ) != 0 )
+        {
+            result = errno;
+        }
+        else if ( (size_t)st.st_size < sizeof( ImageHeader ) )
+        {
+            result = EINVAL;
+        }
+        else
+        {
+            pImage->pMap = mmap( NULL,
+                                 st.st_size,
+                                 PROT_READ,
+                                 MAP_PRIVATE,
+                                 fd,
+                                 0 );
+            if ( pImage->pMap != MAP_FAILED )
+            {
+                pImage->size = st.st_size;
+                pHeader = pImage->pMap;
+                result = CheckHeader( pHeader, pImage->size );
+            }
+            else
+            {
+                pImage->pMap = NULL;
+                result = errno;
+            }
+        }
+
+        if ( fd != -1 )
+        {
+            close( fd );
+        }
+
+        if ( result == EOK )
+        {
+            pImage->nNodes = pHeader->nNodes;
+            pImage->nStatements = pHeader->nStatements;
+            pImage->pNodes = calloc( pImage->nNodes + 1, sizeof( Variable ) );
+            pImage->ppRefs = calloc( pImage->nNodes + 1, sizeof( Variable * ) );
+            pImage->pFirstBlock = calloc( pImage->nNodes + 1,
+                                          sizeof( uint32_t ) );
+            pImage->pStatements = calloc( pImage->nStatements + 1,
+                                          sizeof( Statement ) );
+            if ( ( pImage->pNodes == NULL ) ||
+                 ( pImage->ppRefs == NULL ) ||
+                 ( pImage->pFirstBlock == NULL ) ||
+                 ( pImage->pStatements == NULL ) )
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( result == EOK )
+        {
+            result = LoadNodes( hVarServer, pImage );
+        }
+
+        if ( result == EOK )
+        {
+            result = LoadStatements( pImage );
+        }
+
+        if ( result == EOK )
+        {
+            pImage->pRoot = &pImage->pStatements[pHeader->root - 1];
+        }
+        else
+        {
+            VarActionFreeImage( pImage );
+            pImage = NULL;
+            errno = result;
+        }
+    }
+    else
+    {
+        errno = result;
+    }
+
+    return pImage;
+}
+
+/*============================================================================*/
+/*  VarActionImageStatements                                                  */
+/*!
+    Get the statements of a loaded image
+
+@param[in]
+    pImage
+        pointer to the loaded image
+
+@retval pointer to the first statement of the rule set
+@retval NULL if the image is NULL
+
+==============================================================================*/
+Statement *VarActionImageStatements( VarImage *pImage )
+{
+    return ( pImage != NULL ) ? pImage->pRoot : NULL;
+}
+
+/*============================================================================*/
+/*  VarActionFreeImage                                                        */
+/*!
+    Free a loaded image
+
+    The VarActionFreeImage function releases the statements and nodes
+    rebuilt from an image, and unmaps the image file.  The system variable
+    nodes it refers to belong to the context and are not released.
+    The statements must not be evaluated after the image is freed.
+
+@param[in]
+    pImage
+        pointer to the image to free
+
+==============================================================================*/
+void VarActionFreeImage( VarImage *pImage )
+{
+    size_t i;
+
+    if ( pImage != NULL )
+    {
+        if ( pImage->pNodes != NULL )
+        {
+            for ( i = 0; i < pImage->nNodes; i++ )
+            {
+                if ( pImage->pNodes[i].flags & VF_HEAP_STR )
+                {
+                    free( pImage->pNodes[i].obj.val.str );
+                }
+
+                FreeFormat( pImage->pNodes[i].pFormat );
+            }
+        }
+
+        if ( pImage->pMap != NULL )
+        {
+            munmap( pImage->pMap, pImage->size );
+        }
+
+        free( pImage->pNodes );
+        free( pImage->ppRefs );
+        free( pImage->pFirstBlock );
+        free( pImage->pStatements );
+        free( pImage );
+    }
+}
+
+/*============================================================================*/
+/*  SaveList                                                                  */
+/*!
+    Save a statement list
+
+    The SaveList function saves the statements of a list as consecutive
+    statement records, and the variable trees they evaluate.
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    pStatement
+        pointer to the first statement of the list (may be NULL)
+
+@retval reference to the first statement record
+@retval 0 if the list is empty or an error occurred
+
+==============================================================================*/
+static uint32_t SaveList( ImageWriter *pWriter, Statement *pStatement )
+{
+    uint32_t ref = FindRef( pWriter, pStatement );
+    Statement *p;
+    size_t base;
+    size_t n = 0;
+    size_t i;
+    uint32_t node;
+
+    if ( ( pStatement != NULL ) &&
+         ( ref == 0 ) &&
+         ( pWriter->result == EOK ) )
+    {
+        for ( p = pStatement; p != NULL; p = p->pNext )
+        {
+            n++;
+        }
+
+        /* reserve consecutive records for the list */
+        pWriter->result = Reserve( (void **)&pWriter->pStatements,
+                                   &pWriter->statementSize,
+                                   pWriter->nStatements + n,
+                                   sizeof( ImageStatement ) );
+        if ( pWriter->result == EOK )
+        {
+            base = pWriter->nStatements;
+            pWriter->nStatements += n;
+            ref = base + 1;
+            AddRef( pWriter, pStatement, ref );
+
+            for ( i = 0, p = pStatement; p != NULL; i++, p = p->pNext )
+            {
+                /* the records may move while the tree is saved */
+                node = SaveNode( pWriter, p->pVariable );
+                pWriter->pStatements[base + i].node = node;
+                pWriter->pStatements[base + i].script =
+                    SaveString( pWriter, p->script );
+                pWriter->pStatements[base + i].lineno = p->lineno;
+                pWriter->pStatements[base + i].next =
+                    ( p->pNext != NULL ) ? base + i + 2 : 0;
+            }
+        }
+    }
+
+    return ( pWriter->result == EOK ) ? ref : 0;
+}
+
+/*============================================================================*/
+/*  SaveNode                                                                  */
+/*!
+    Save a variable tree
+
+    The SaveNode function saves the subtrees of a node, then the node
+    itself, so every node record only refers to records before it.
+    A node which has already been saved is not saved again.
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    pVariable
+        pointer to the node to save (may be NULL)
+
+@retval reference to the node record
+@retval 0 if the node is NULL or an error occurred
+
+==============================================================================*/
+static uint32_t SaveNode( ImageWriter *pWriter, Variable *pVariable )
+{
+    uint32_t ref = FindRef( pWriter, pVariable );
+    ImageNode node;
+
+    if ( ( pVariable != NULL ) &&
+         ( ref == 0 ) &&
+         ( pWriter->result == EOK ) )
+    {
+        memset( &node, 0, sizeof( ImageNode ) );
+
+        if ( pVariable->operation == VA_ELSE )
+        {
+            /* the subtrees of an ELSE node are statement lists */
+            node.left = SaveList( pWriter, (Statement *)pVariable->left );
+            node.right = SaveList( pWriter, (Statement *)pVariable->right );
+            node.attributes |= VA_IMAGE_BLOCKS;
+        }
+        else
+        {
+            node.left = SaveNode( pWriter, pVariable->left );
+            node.right = SaveNode( pWriter, pVariable->right );
+        }
+
+        node.operation = pVariable->operation;
+        node.type = pVariable->obj.type;
+        node.lineno = pVariable->lineno;
+        node.id = SaveString( pWriter, pVariable->id );
+        node.len = pVariable->obj.len;
+        node.attributes |= ( pVariable->local ? VA_IMAGE_LOCAL : 0 ) |
+                           ( pVariable->lvalue ? VA_IMAGE_LVALUE : 0 ) |
+                           ( pVariable->assigned ? VA_IMAGE_ASSIGNED : 0 );
+
+        switch( pVariable->operation )
+        {
+            case VA_NUM:
+                node.value = ( pVariable->obj.type == VARTYPE_UINT16 )
+                             ? pVariable->obj.val.ui
+                             : pVariable->obj.val.ul;
+                break;
+
+            case VA_FLOATNUM:
+                memcpy( &node.value, &pVariable->obj.val.f, sizeof( float ) );
+                break;
+
+            case VA_STRING:
+                node.value = SaveString( pWriter, pVariable->obj.val.str );
+                break;
+
+            default:
+                break;
+        }
+
+        if ( pWriter->result == EOK )
+        {
+            pWriter->result = Reserve( (void **)&pWriter->pNodes,
+                                       &pWriter->nodeSize,
+                                       pWriter->nNodes + 1,
+                                       sizeof( ImageNode ) );
+        }
+
+        if ( pWriter->result == EOK )
+        {
+            pWriter->pNodes[pWriter->nNodes++] = node;
+            ref = pWriter->nNodes;
+            AddRef( pWriter, pVariable, ref );
+        }
+    }
+
+    return ( pWriter->result == EOK ) ? ref : 0;
+}
+
+/*============================================================================*/
+/*  SaveString                                                                */
+/*!
+    Save a string to the string table
+
+    The SaveString function adds a string to the string table of the
+    image unless it is already in the table.
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    str
+        pointer to the string to save (may be NULL)
+
+@retval reference to the string in the string table
+@retval 0 if the string is NULL or an error occurred
+
+==============================================================================*/
+static uint32_t SaveString( ImageWriter *pWriter, const char *str )
+{
+    uint32_t ref = 0;
+    uint32_t *pOld;
+    size_t oldSize;
+    size_t mask;
+    size_t i;
+    size_t j;
+    size_t len;
+
+    if ( ( str != NULL ) &&
+         ( pWriter->result == EOK ) )
+    {
+        if ( ( pWriter->nStrings + 1 ) * 2 > pWriter->stringIndexSize )
+        {
+            /* double the size of the string index */
+            pOld = pWriter->pStringIndex;
+            oldSize = pWriter->stringIndexSize;
+            pWriter->stringIndexSize = ( oldSize == 0 ) ? IMAGE_INITIAL_SIZE
+                                                        : oldSize * 2;
+            pWriter->pStringIndex = calloc( pWriter->stringIndexSize,
+                                            sizeof( uint32_t ) );
+            if ( pWriter->pStringIndex != NULL )
+            {
+                mask = pWriter->stringIndexSize - 1;
+                for ( i = 0; i < oldSize; i++ )
+                {
+                    if ( pOld[i] != 0 )
+                    {
+                        j = HashIdentifier( &pWriter->pStrings[pOld[i] - 1] )
+                            & mask;
+                        while ( pWriter->pStringIndex[j] != 0 )
+                        {
+                            j = ( j + 1 ) & mask;
+                        }
+
+                        pWriter->pStringIndex[j] = pOld[i];
+                    }
+                }
+
+                free( pOld );
+            }
+            else
+            {
+                pWriter->pStringIndex = pOld;
+                pWriter->stringIndexSize = oldSize;
+                pWriter->result = ENOMEM;
+            }
+        }
+
+        if ( pWriter->result == EOK )
+        {
+            mask = pWriter->stringIndexSize - 1;
+            j = HashIdentifier( str ) & mask;
+            while ( ( pWriter->pStringIndex[j] != 0 ) &&
+                    ( strcmp( &pWriter->pStrings[pWriter->pStringIndex[j] - 1],
+                              str ) != 0 ) )
+            {
+                j = ( j + 1 ) & mask;
+            }
+
+            ref = pWriter->pStringIndex[j];
+            if ( ref == 0 )
+            {
+                len = strlen( str ) + 1;
+                pWriter->result = Reserve( (void **)&pWriter->pStrings,
+                                           &pWriter->stringsAlloc,
+                                           pWriter->stringsSize + len,
+                                           1 );
+                if ( pWriter->result == EOK )
+                {
+                    memcpy( &pWriter->pStrings[pWriter->stringsSize],
+                            str,
+                            len );
+                    ref = pWriter->stringsSize + 1;
+                    pWriter->stringsSize += len;
+                    pWriter->pStringIndex[j] = ref;
+                    pWriter->nStrings++;
+                }
+            }
+        }
+    }
+
+    return ( pWriter->result == EOK ) ? ref : 0;
+}
+
+/*============================================================================*/
+/*  FindRef                                                                   */
+/*!
+    Find the reference of a saved node or statement
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    p
+        pointer to the node or statement
+
+@retval reference to the record of the saved object
+@retval 0 if the object has not been saved
+
+==============================================================================*/
+static uint32_t FindRef( ImageWriter *pWriter, const void *p )
+{
+    uint32_t ref = 0;
+    size_t mask;
+    size_t i;
+
+    if ( ( p != NULL ) &&
+         ( pWriter->refSize > 0 ) )
+    {
+        mask = pWriter->refSize - 1;
+        i = ( (uintptr_t)p >> 4 ) * 0x9E3779B1u & mask;
+        while ( pWriter->pRefs[i].p != NULL )
+        {
+            if ( pWriter->pRefs[i].p == p )
+            {
+                ref = pWriter->pRefs[i].ref;
+                break;
+            }
+
+            i = ( i + 1 ) & mask;
+        }
+    }
+
+    return ref;
+}
+
+/*============================================================================*/
+/*  AddRef                                                                    */
+/*!
+    Record the reference of a saved node or statement
+
+    The AddRef function adds a saved object to the saved object index,
+    growing the index to keep its load factor at or below one half.
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    p
+        pointer to the node or statement
+
+@param[in]
+    ref
+        reference to its record
+
+==============================================================================*/
+static void AddRef( ImageWriter *pWriter, const void *p, uint32_t ref )
+{
+    ImageRef *pOld = pWriter->pRefs;
+    size_t oldSize = pWriter->refSize;
+    size_t mask;
+    size_t i;
+    size_t j;
+
+    if ( ( pWriter->nRefs + 1 ) * 2 > pWriter->refSize )
+    {
+        pWriter->refSize = ( oldSize == 0 ) ? IMAGE_INITIAL_SIZE : oldSize * 2;
+        pWriter->pRefs = calloc( pWriter->refSize, sizeof( ImageRef ) );
+        if ( pWriter->pRefs != NULL )
+        {
+            pWriter->nRefs = 0;
+            for ( j = 0; j < oldSize; j++ )
+            {
+                if ( pOld[j].p != NULL )
+                {
+                    AddRef( pWriter, pOld[j].p, pOld[j].ref );
+                }
+            }
+
+            free( pOld );
+        }
+        else
+        {
+            pWriter->pRefs = pOld;
+            pWriter->refSize = oldSize;
+            pWriter->result = ENOMEM;
+        }
+    }
+
+    if ( pWriter->result == EOK )
+    {
+        mask = pWriter->refSize - 1;
+        i = ( (uintptr_t)p >> 4 ) * 0x9E3779B1u & mask;
+        while ( pWriter->pRefs[i].p != NULL )
+        {
+            i = ( i + 1 ) & mask;
+        }
+
+        pWriter->pRefs[i].p = p;
+        pWriter->pRefs[i].ref = ref;
+        pWriter->nRefs++;
+    }
+}
+
+/*============================================================================*/
+/*  Reserve                                                                   */
+/*!
+    Make room for elements in a growable array
+
+@param[in,out]
+    pp
+        pointer to the array pointer
+
+@param[in,out]
+    pSize
+        pointer to the number of elements allocated
+
+@param[in]
+    n
+        number of elements required
+
+@param[in]
+    size
+        size of each element
+
+@retval E2BIG the array would be too big for an image
+@retval ENOMEM memory allocation failure
+@retval EOK the array can hold n elements
+
+==============================================================================*/
+static int Reserve( void **pp, size_t *pSize, size_t n, size_t size )
+{
+    int result = EOK;
+    size_t newSize;
+    void *p;
+
+    if ( n * size >= UINT32_MAX / 2 )
+    {
+        result = E2BIG;
+    }
+    else if ( n > *pSize )
+    {
+        newSize = ( *pSize == 0 ) ? IMAGE_INITIAL_SIZE : *pSize * 2;
+        while ( newSize < n )
+        {
+            newSize *= 2;
+        }
+
+        p = realloc( *pp, newSize * size );
+        if ( p != NULL )
+        {
+            *pp = p;
+            *pSize = newSize;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteImage                                                                */
+/*!
+    Write the image file
+
+    The WriteImage function writes the header, records and string table
+    of the image to a new file.
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+@param[in]
+    root
+        reference to the first statement of the rule set
+
+@param[in]
+    path
+        path of the file to create
+
+@retval EOK the image was written
+@retval other error from creating or writing the file
+
+==============================================================================*/
+static int WriteImage( ImageWriter *pWriter, uint32_t root, const char *path )
+{
+    int result;
+    ImageHeader header;
+    int fd;
+
+    memset( &header, 0, sizeof( ImageHeader ) );
+    header.magic = VA_IMAGE_MAGIC;
+    header.version = VA_IMAGE_VERSION;
+    header.root = root;
+    header.nNodes = pWriter->nNodes;
+    header.nodes = sizeof( ImageHeader );
+    header.nStatements = pWriter->nStatements;
+    header.statements = header.nodes + ( header.nNodes * sizeof( ImageNode ) );
+    header.stringsSize = pWriter->stringsSize;
+    header.strings = header.statements +
+                     ( header.nStatements * sizeof( ImageStatement ) );
+    header.size = header.strings + header.stringsSize;
+
+    fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+    if ( fd != -1 )
+    {
+        result = WriteAll( fd, &header, sizeof( ImageHeader ) );
+        if ( result == EOK )
+        {
+            result = WriteAll( fd,
+                               pWriter->pNodes,
+                               header.nNodes * sizeof( ImageNode ) );
+        }
+
+        if ( result == EOK )
+        {
+            result = WriteAll( fd,
+                               pWriter->pStatements,
+                               header.nStatements * sizeof( ImageStatement ) );
+        }
+
+        if ( result == EOK )
+        {
+            result = WriteAll( fd, pWriter->pStrings, header.stringsSize );
+        }
+
+        if ( ( close( fd ) != 0 ) &&
+             ( result == EOK ) )
+        {
+            result = errno;
+        }
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WriteAll                                                                  */
+/*!
+    Write a buffer to a file
+
+@param[in]
+    fd
+        file descriptor to write to
+
+@param[in]
+    p
+        pointer to the data to write
+
+@param[in]
+    len
+        number of bytes to write
+
+@retval EOK the buffer was written
+@retval other error from write()
+
+==============================================================================*/
+static int WriteAll( int fd, const void *p, size_t len )
+{
+    int result = EOK;
+    const char *buf = p;
+    ssize_t n;
+
+    while ( ( len > 0 ) &&
+            ( result == EOK ) )
+    {
+        n = write( fd, buf, len );
+        if ( n > 0 )
+        {
+            buf += n;
+            len -= n;
+        }
+        else if ( errno != EINTR )
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FreeWriter                                                                */
+/*!
+    Release the tables of an image writer
+
+@param[in]
+    pWriter
+        pointer to the image writer
+
+==============================================================================*/
+static void FreeWriter( ImageWriter *pWriter )
+{
+    free( pWriter->pNodes );
+    free( pWriter->pStatements );
+    free( pWriter->pStrings );
+    free( pWriter->pStringIndex );
+    free( pWriter->pRefs );
+}
+
+/*============================================================================*/
+/*  CheckHeader                                                               */
+/*!
+    Check the header of a mapped image
+
+    The CheckHeader function checks that the image is a supported version
+    and that its records and string table lie within the mapping.
+
+@param[in]
+    pHeader
+        pointer to the image header
+
+@param[in]
+    size
+        size of the mapped image
+
+@retval EINVAL the image is not valid
+@retval EOK the header is valid
+
+==============================================================================*/
+static int CheckHeader( const ImageHeader *pHeader, size_t size )
+{
+    int result = EINVAL;
+    const char *pStrings = (const char *)pHeader + pHeader->strings;
+    uint64_t nodesEnd;
+    uint64_t statementsEnd;
+    uint64_t stringsEnd;
+
+    nodesEnd = (uint64_t)pHeader->nodes +
+               (uint64_t)pHeader->nNodes * sizeof( ImageNode );
+    statementsEnd = (uint64_t)pHeader->statements +
+                    (uint64_t)pHeader->nStatements * sizeof( ImageStatement );
+    stringsEnd = (uint64_t)pHeader->strings + pHeader->stringsSize;
+
+    if ( ( pHeader->magic == VA_IMAGE_MAGIC ) &&
+         ( pHeader->version == VA_IMAGE_VERSION ) &&
+         ( pHeader->size == size ) &&
+         ( pHeader->nodes >= sizeof( ImageHeader ) ) &&
+         ( ( pHeader->nodes % sizeof( uint32_t ) ) == 0 ) &&
+         ( ( pHeader->statements % sizeof( uint32_t ) ) == 0 ) &&
+         ( nodesEnd <= pHeader->statements ) &&
+         ( statementsEnd <= pHeader->strings ) &&
+         ( stringsEnd <= size ) &&
+         ( pHeader->root >= 1 ) &&
+         ( pHeader->root <= pHeader->nStatements ) &&
+         ( ( pHeader->stringsSize == 0 ) ||
+           ( pStrings[pHeader->stringsSize - 1] == '\0' ) ) )
+    {
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LoadNodes                                                                 */
+/*!
+    Rebuild the nodes of an image
+
+    The LoadNodes function rebuilds each node from its record, in order.
+    System variable records are resolved to the context's node for the
+    system variable, which is created if the context does not know it.
+    All system variables which cannot be found are reported.
+
+    A node may only refer to earlier nodes, and only ELSE nodes refer to
+    statement lists.  The lowest statement list referenced from the tree
+    of each node is recorded so LoadStatements() can check it.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pImage
+        pointer to the image being loaded
+
+@retval EINVAL a record is not valid
+@retval ENOENT a system variable could not be found
+@retval ENOMEM memory allocation failure
+@retval EOK the nodes were rebuilt
+
+==============================================================================*/
+static int LoadNodes( VARSERVER_HANDLE hVarServer, VarImage *pImage )
+{
+    VarActionContext *pContext = GetContext();
+    const ImageHeader *pHeader = pImage->pMap;
+    const ImageNode *pRecords;
+    const ImageNode *pRecord;
+    Variable *pVariable;
+    const char *id;
+    const char *str;
+    VAR_HANDLE hVar;
+    int result = EOK;
+    size_t i;
+
+    pRecords = (const ImageNode *)( (const char *)pImage->pMap +
+                                    pHeader->nodes );
+
+    for ( i = 0; ( i < pImage->nNodes ) && ( result != EINVAL ); i++ )
+    {
+        pRecord = &pRecords[i];
+        id = ImageString( pImage, pRecord->id );
+
+        if ( ( pRecord->operation >= VA_OP_MAX ) ||
+             ( ( pRecord->id != 0 ) && ( id == NULL ) ) ||
+             ( ( ( pRecord->attributes & VA_IMAGE_BLOCKS ) != 0 ) !=
+               ( pRecord->operation == VA_ELSE ) ) ||
+             ( ( pRecord->attributes & VA_IMAGE_BLOCKS ) &&
+               ( ( pRecord->left > pImage->nStatements ) ||
+                 ( pRecord->right > pImage->nStatements ) ) ) ||
+             ( ( ( pRecord->attributes & VA_IMAGE_BLOCKS ) == 0 ) &&
+               ( ( pRecord->left > i ) || ( pRecord->right > i ) ) ) )
+        {
+            result = EINVAL;
+        }
+        else if ( pRecord->operation == VA_SYSVAR )
+        {
+            pVariable = ( id != NULL ) ? FindVariable( (char *)id ) : NULL;
+            if ( ( pVariable == NULL ) &&
+                 ( id != NULL ) &&
+                 ( pContext->options & VA_OPT_LAZY_RESOLVE ) )
+            {
+                /* the handle is looked up by ResolveAll() */
+                pVariable = CreateSysvar( hVarServer,
+                                          id,
+                                          VAR_INVALID,
+                                          pRecord->type );
+                if ( pVariable == NULL )
+                {
+                    result = ENOMEM;
+                }
+            }
+            else if ( ( pVariable == NULL ) && ( id != NULL ) )
+            {
+                hVar = VAR_FindByName( hVarServer, (char *)id );
+                if ( hVar != VAR_INVALID )
+                {
+                    pVariable = CreateSysvar( hVarServer,
+                                              id,
+                                              hVar,
+                                              pRecord->type );
+                    if ( pVariable == NULL )
+                    {
+                        result = ENOMEM;
+                    }
+                }
+                else
+                {
+                    fprintf( stderr,
+                             "Unresolved system variable: %s\n",
+                             id );
+                    if ( result == EOK )
+                    {
+                        result = ENOENT;
+                    }
+                }
+            }
+            else if ( pVariable == NULL )
+            {
+                result = EINVAL;
+            }
+
+            if ( ( pVariable != NULL ) &&
+                 ( pRecord->attributes & VA_IMAGE_LVALUE ) )
+            {
+                /* merge the attribute into a known system variable */
+                pVariable->lvalue = true;
+            }
+
+            pImage->ppRefs[i] = pVariable;
+        }
+        else
+        {
+            pVariable = &pImage->pNodes[i];
+            pImage->ppRefs[i] = pVariable;
+
+            pVariable->operation = pRecord->operation;
+            pVariable->lineno = pRecord->lineno;
+            pVariable->id = (char *)id;
+            pVariable->flags = VF_ARENA;
+            pVariable->local = ( pRecord->attributes & VA_IMAGE_LOCAL ) != 0;
+            pVariable->lvalue = ( pRecord->attributes & VA_IMAGE_LVALUE ) != 0;
+            pVariable->assigned =
+                ( pRecord->attributes & VA_IMAGE_ASSIGNED ) != 0;
+            pVariable->obj.type = pRecord->type;
+            pVariable->obj.len = pRecord->len;
+
+            if ( pRecord->attributes & VA_IMAGE_BLOCKS )
+            {
+                pVariable->left = ( pRecord->left != 0 )
+                    ? (Variable *)&pImage->pStatements[pRecord->left - 1]
+                    : NULL;
+                pVariable->right = ( pRecord->right != 0 )
+                    ? (Variable *)&pImage->pStatements[pRecord->right - 1]
+                    : NULL;
+
+                pImage->pFirstBlock[i] = FirstBlock( pRecord->left,
+                                                     pRecord->right );
+            }
+            else
+            {
+                pVariable->left = ( pRecord->left != 0 )
+                    ? pImage->ppRefs[pRecord->left - 1]
+                    : NULL;
+                pVariable->right = ( pRecord->right != 0 )
+                    ? pImage->ppRefs[pRecord->right - 1]
+                    : NULL;
+
+                pImage->pFirstBlock[i] = FirstBlock(
+                    ( pRecord->left != 0 )
+                        ? pImage->pFirstBlock[pRecord->left - 1] : 0,
+                    ( pRecord->right != 0 )
+                        ? pImage->pFirstBlock[pRecord->right - 1] : 0 );
+            }
+
+            switch( pRecord->operation )
+            {
+                case VA_NUM:
+                    if ( pRecord->type == VARTYPE_UINT16 )
+                    {
+                        pVariable->obj.val.ui = pRecord->value;
+                    }
+                    else
+                    {
+                        pVariable->obj.val.ul = pRecord->value;
+                    }
+                    break;
+
+                case VA_FLOATNUM:
+                    memcpy( &pVariable->obj.val.f,
+                            &pRecord->value,
+                            sizeof( float ) );
+                    break;
+
+                case VA_STRING:
+                    str = ImageString( pImage, pRecord->value );
+                    if ( str != NULL )
+                    {
+                        pVariable->obj.len = strlen( str );
+                        pVariable->obj.val.str =
+                            InternString( &pContext->strings,
+                                          str,
+                                          pVariable->obj.len );
+                        if ( pVariable->obj.val.str != NULL )
+                        {
+                            pVariable->flags |= VF_INTERNED_STR;
+                        }
+                        else
+                        {
+                            /* reference the constant in the image */
+                            pVariable->obj.val.str = (char *)str;
+                            pVariable->flags |= VF_BORROWED_STR;
+                        }
+
+                        pVariable->bufsize = pVariable->obj.len;
+                    }
+                    else
+                    {
+                        result = EINVAL;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+
+            /* bind the operation for the type of the left operand */
+            pVariable->fn = SelectOperation( pVariable );
+            PrepareFormat( pVariable );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LoadStatements                                                            */
+/*!
+    Rebuild the statements of an image
+
+    The LoadStatements function rebuilds each statement from its record.
+    The next statement of a list, and the IF blocks of a statement's
+    tree, must come after the statement, so a damaged image cannot make
+    a statement list or IF block loop back on itself.
+
+@param[in]
+    pImage
+        pointer to the image being loaded
+
+@retval EINVAL a record is not valid
+@retval EOK the statements were rebuilt
+
+==============================================================================*/
+static int LoadStatements( VarImage *pImage )
+{
+    const ImageHeader *pHeader = pImage->pMap;
+    const ImageStatement *pRecords;
+    const ImageStatement *pRecord;
+    Statement *pStatement;
+    int result = EOK;
+    size_t i;
+
+    pRecords = (const ImageStatement *)( (const char *)pImage->pMap +
+                                         pHeader->statements );
+
+    for ( i = 0; ( i < pImage->nStatements ) && ( result == EOK ); i++ )
+    {
+        pRecord = &pRecords[i];
+        pStatement = &pImage->pStatements[i];
+
+        if ( ( pRecord->node > pImage->nNodes ) ||
+             ( pRecord->next > pImage->nStatements ) ||
+             ( ( pRecord->next != 0 ) && ( pRecord->next <= i + 1 ) ) ||
+             ( ( pRecord->node != 0 ) &&
+               ( pImage->pFirstBlock[pRecord->node - 1] != 0 ) &&
+               ( pImage->pFirstBlock[pRecord->node - 1] <= i + 1 ) ) ||
+             ( ( pRecord->script != 0 ) &&
+               ( ImageString( pImage, pRecord->script ) == NULL ) ) )
+        {
+            result = EINVAL;
+        }
+        else
+        {
+            pStatement->pVariable = ( pRecord->node != 0 )
+                                    ? pImage->ppRefs[pRecord->node - 1]
+                                    : NULL;
+            pStatement->script = (char *)ImageString( pImage,
+                                                      pRecord->script );
+            pStatement->lineno = pRecord->lineno;
+            pStatement->pNext = ( pRecord->next != 0 )
+                                ? &pImage->pStatements[pRecord->next - 1]
+                                : NULL;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ImageString                                                               */
+/*!
+    Get a string from the string table of a mapped image
+
+@param[in]
+    pImage
+        pointer to the image
+
+@param[in]
+    ref
+        reference to the string
+
+@retval pointer to the string in the mapping
+@retval NULL if the reference is zero or outside the string table
+
+==============================================================================*/
+static const char *ImageString( VarImage *pImage, uint32_t ref )
+{
+    const ImageHeader *pHeader = pImage->pMap;
+    const char *str = NULL;
+
+    if ( ( ref != 0 ) &&
+         ( ref <= pHeader->stringsSize ) )
+    {
+        str = (const char *)pImage->pMap + pHeader->strings + ( ref - 1 );
+    }
+
+    return str;
+}
+
+/*============================================================================*/
+/*  FirstBlock                                                                */
+/*!
+    Get the lower of two statement list references
+
+@param[in]
+    a
+        statement list reference, or zero for none
+
+@param[in]
+    b
+        statement list reference, or zero for none
+
+@retval the lower non-zero reference
+@retval 0 if both references are zero
+
+==============================================================================*/
+static uint32_t FirstBlock( uint32_t a, uint32_t b )
+{
+    uint32_t first = a;
+
+    if ( ( b != 0 ) &&
+         ( ( a == 0 ) || ( b < a ) ) )
+    {
+        first = b;
+    }
+
+    return first;
+}
+
+/*! @}
+ * end of varimage group */
@@ -0,0 +1,298 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varintern varintern
+ * @brief Variable Action Script String Constant Interning functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varintern.c
+
+    Variable Action Script String Constant Interning functions
+
+    The Variable Action Script String Constant Interning functions keep
+    one copy of each distinct string constant, along with its length
+    and hash, so all string constants with the same value share the
+    same storage.  Two interned strings are equal only if they are the
+    same pointer, so comparisons between constants, or between
+    variables holding constants, do not need to compare the bytes.
+
+    Interned strings are owned by the table rather than by any rule set
+    arena, so they remain valid while any rule set built in the same
+    evaluation context references them, and are released when the
+    context is freed.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "varintern.h"
+#include "varsymtab.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of entries allocated in an intern table */
+#define INTERN_TABLE_INITIAL_SIZE    ( 64 )
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static InternEntry *Probe( InternTable *pTable,
+                           uint32_t hash,
+                           const char *str,
+                           size_t len );
+static int Grow( InternTable *pTable );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  InternString                                                              */
+/*!
+    Get the interned copy of a string constant
+
+    The InternString function searches the intern table for the specified
+    string and returns its interned copy, adding a copy to the table
+    if the string has not been interned before.
+
+@param[in]
+    pTable
+        pointer to the intern table
+
+@param[in]
+    str
+        pointer to the NUL terminated string
+
+@param[in]
+    len
+        length of the string
+
+@retval pointer to the interned copy of the string
+@retval NULL if the string could not be interned
+
+==============================================================================*/
+char *InternString( InternTable *pTable, const char *str, size_t len )
+{
+    char *result = NULL;
+    InternEntry *pEntry;
+    uint32_t hash;
+    int rc = EOK;
+
+    if ( ( pTable != NULL ) &&
+         ( str != NULL ) )
+    {
+        if ( ( pTable->n + 1 ) * 2 > pTable->size )
+        {
+            rc = Grow( pTable );
+        }
+
+        if ( rc == EOK )
+        {
+            hash = HashIdentifier( str );
+            pEntry = Probe( pTable, hash, str, len );
+            if ( pEntry->str == NULL )
+            {
+                pEntry->str = malloc( len + 1 );
+                if ( pEntry->str != NULL )
+                {
+                    memcpy( pEntry->str, str, len + 1 );
+                    pEntry->hash = hash;
+                    pEntry->len = len;
+                    pTable->n++;
+                }
+            }
+
+            result = pEntry->str;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ClearStrings                                                              */
+/*!
+    Release an intern table
+
+    The ClearStrings function frees the interned strings and the entry
+    array of an intern table, leaving it empty.  No variable may
+    reference an interned string once the table is cleared.
+
+@param[in]
+    pTable
+        pointer to the intern table
+
+==============================================================================*/
+void ClearStrings( InternTable *pTable )
+{
+    size_t i;
+
+    if ( pTable != NULL )
+    {
+        for ( i = 0; i < pTable->size; i++ )
+        {
+            free( pTable->pEntries[i].str );
+        }
+
+        free( pTable->pEntries );
+        memset( pTable, 0, sizeof( InternTable ) );
+    }
+}
+
+/*============================================================================*/
+/*  Probe                                                                     */
+/*!
+    Search an intern table for a string
+
+    The Probe function performs a linear probe of the intern table for
+    the specified string, rejecting entries on their hash and length
+    before comparing their bytes, and returns either the matching entry
+    or the unused entry where the string would be inserted.  The table
+    must contain at least one unused entry.
+
+@param[in]
+    pTable
+        pointer to the intern table
+
+@param[in]
+    hash
+        hash of the string
+
+@param[in]
+    str
+        pointer to the string
+
+@param[in]
+    len
+        length of the string
+
+@retval pointer to the matching or unused entry
+
+==============================================================================*/
+static InternEntry *Probe( InternTable *pTable,
+                           uint32_t hash,
+                           const char *str,
+                           size_t len )
+{
+    size_t mask = pTable->size - 1;
+    size_t i = hash & mask;
+    InternEntry *pEntry;
+
+    while ( true )
+    {
+        pEntry = &pTable->pEntries[i];
+        if ( pEntry->str == NULL )
+        {
+            break;
+        }
+
+        if ( ( pEntry->hash == hash ) &&
+             ( pEntry->len == len ) &&
+             ( memcmp( pEntry->str, str, len ) == 0 ) )
+        {
+            break;
+        }
+
+        i = ( i + 1 ) & mask;
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  Grow                                                                      */
+/*!
+    Double the size of an intern table
+
+    The Grow function allocates a new entry array twice the size of the
+    current one, and re-inserts the existing entries.
+
+@param[in]
+    pTable
+        pointer to the intern table
+
+@retval ENOMEM memory allocation failure
+@retval EOK the table was resized
+
+==============================================================================*/
+static int Grow( InternTable *pTable )
+{
+    int result = ENOMEM;
+    InternEntry *pOldEntries = pTable->pEntries;
+    size_t oldSize = pTable->size;
+    size_t size;
+    size_t i;
+    InternEntry *pEntry;
+
+    size = ( oldSize == 0 ) ? INTERN_TABLE_INITIAL_SIZE : oldSize * 2;
+
+    pTable->pEntries = calloc( size, sizeof( InternEntry ) );
+    if ( pTable->pEntries != NULL )
+    {
+        pTable->size = size;
+
+        for ( i = 0; i < oldSize; i++ )
+        {
+            if ( pOldEntries[i].str != NULL )
+            {
+                pEntry = Probe( pTable,
+                                pOldEntries[i].hash,
+                                pOldEntries[i].str,
+                                pOldEntries[i].len );
+                *pEntry = pOldEntries[i];
+            }
+        }
+
+        free( pOldEntries );
+        result = EOK;
+    }
+    else
+    {
+        /* keep the existing table */
+        pTable->pEntries = pOldEntries;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of varintern group */
@@ -0,0 +1,1278 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varjit varjit
+ * @brief Variable Action Script Native Code functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varjit.c
+
+    Variable Action Script Native Code functions
+
+    The Native Code functions translate the instructions of a compiled
+    program into x86-64 machine code, so a program which is executed
+    frequently runs without the dispatch loop of ExecProgram().
+
+    The addresses of the registers' variable nodes are part of the
+    generated code.  The inline typed uint16, uint32 and float arithmetic,
+    bitwise, comparison and local assignment instructions are translated
+    into the equivalent machine instructions.  Every other instruction
+    calls the same function as the interpreter: the node's operation
+    function, ProcessStatement(), ShortCircuit() or SelectCase(), so
+    strings, timers, scripts and system variable access behave exactly
+    as they do in the interpreter.
+
+    The code is generated into an anonymous mapping which is made
+    executable, and no longer writable, once it is complete.
+
+    Native code is only generated on x86-64 hosts.  On other hosts
+    JitCompile() fails and the program continues to be interpreted.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include "varjit.h"
+#include "varprogram.h"
+#include "varops.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! maximum number of bytes of machine code generated for an instruction */
+#define JIT_MAX_INSTRUCTION_SIZE    ( 128 )
+
+/*! number of bytes of machine code in the prologue and epilogue */
+#define JIT_FRAME_SIZE              ( 64 )
+
+/*! x86-64 register numbers */
+#define JIT_RAX                     ( 0 )
+#define JIT_RCX                     ( 1 )
+#define JIT_RDX                     ( 2 )
+#define JIT_RSI                     ( 6 )
+#define JIT_RDI                     ( 7 )
+
+/*! condition codes used with the Jcc and SETcc instructions */
+#define JIT_CC_B                    ( 0x2 )
+#define JIT_CC_AE                   ( 0x3 )
+#define JIT_CC_E                    ( 0x4 )
+#define JIT_CC_NE                   ( 0x5 )
+#define JIT_CC_BE                   ( 0x6 )
+#define JIT_CC_A                    ( 0x7 )
+#define JIT_CC_NP                   ( 0xB )
+
+/* the generated code stores the result type as a dword and the result
+ * length as a qword, and addresses the VarObject fields with 8-bit
+ * signed displacements */
+_Static_assert( sizeof( ((VarObject *)0)->type ) == 4,
+                "VarObject type must be 32 bits" );
+_Static_assert( sizeof( ((VarObject *)0)->len ) == 8,
+                "VarObject len must be 64 bits" );
+_Static_assert( offsetof( VarObject, val ) < 128,
+                "VarObject val must be within a disp8 offset" );
+_Static_assert( offsetof( VarObject, type ) < 128,
+                "VarObject type must be within a disp8 offset" );
+_Static_assert( offsetof( VarObject, len ) < 128,
+                "VarObject len must be within a disp8 offset" );
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! native code entry point */
+typedef int (*JitFn)( VARSERVER_HANDLE hVarServer );
+
+/*! jump to an instruction whose address is not yet known */
+typedef struct _jitFixup
+{
+    /*! offset of the 32-bit displacement to patch */
+    size_t pos;
+
+    /*! index of the target instruction */
+    uint32_t target;
+
+} JitFixup;
+
+/*! machine code generation state */
+typedef struct _jitBuffer
+{
+    /*! code buffer */
+    uint8_t *p;
+
+    /*! number of bytes generated */
+    size_t n;
+
+    /*! offset of the code generated for each instruction */
+    size_t *pOffsets;
+
+    /*! jumps to patch once every instruction has been generated */
+    JitFixup *pFixups;
+
+    /*! number of jumps to patch */
+    size_t nFixups;
+
+} JitBuffer;
+
+/*! native code compiled from a program */
+struct _varJitCode
+{
+    /*! executable mapping */
+    void *pMap;
+
+    /*! size of the mapping */
+    size_t size;
+
+    /*! entry point */
+    JitFn fn;
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+#if defined(__x86_64__)
+static void Generate( JitBuffer *pBuf,
+                      VarProgram *pProgram,
+                      VarInstruction *pc );
+static void GenerateCall( JitBuffer *pBuf,
+                          VarProgram *pProgram,
+                          VarInstruction *pc );
+static void GenerateArith( JitBuffer *pBuf,
+                           VarProgram *pProgram,
+                           VarInstruction *pc );
+static void GenerateCompare( JitBuffer *pBuf,
+                             VarProgram *pProgram,
+                             VarInstruction *pc );
+static void GenerateAssign( JitBuffer *pBuf,
+                            VarProgram *pProgram,
+                            VarInstruction *pc );
+static void StoreType( JitBuffer *pBuf, int type, size_t len );
+static void LoadAddress( JitBuffer *pBuf, int reg, const void *p );
+static void LoadServer( JitBuffer *pBuf );
+static void CallFunction( JitBuffer *pBuf, uintptr_t fn );
+static void StoreResult( JitBuffer *pBuf );
+static void Jump( JitBuffer *pBuf, int cc, uint32_t target );
+static void Byte( JitBuffer *pBuf, uint8_t b );
+static void Bytes( JitBuffer *pBuf, const uint8_t *p, size_t len );
+static void Imm32( JitBuffer *pBuf, uint32_t v );
+static void CallFailed( VarInstruction *pc, int rc, int *pResult );
+static void *SwitchAddress( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch );
+static bool LinkSwitches( JitBuffer *pBuf, VarProgram *pProgram );
+#endif
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  JitCompile                                                                */
+/*!
+    Compile a program into native code
+
+    The JitCompile function generates machine code which performs the
+    instructions of a compiled program.  The code refers to the program's
+    instructions and variable nodes, which must remain valid while the
+    code is in use.
+
+@param[in]
+    pProgram
+        pointer to the compiled program
+
+@retval pointer to the native code
+@retval NULL if native code could not be generated
+
+==============================================================================*/
+VarJitCode *JitCompile( VarProgram *pProgram )
+{
+    VarJitCode *pCode = NULL;
+#if defined(__x86_64__)
+    JitBuffer buf;
+    size_t size;
+    size_t i;
+    int32_t rel;
+    void *pMap;
+
+    /* push rbp; mov rbp, rsp; sub rsp, 16; mov [rbp-8], rdi;
+     * mov dword [rbp-16], 0 */
+    static const uint8_t prologue[] = {
+        0x55,
+        0x48, 0x89, 0xE5,
+        0x48, 0x83, 0xEC, 0x10,
+        0x48, 0x89, 0x7D, 0xF8,
+        0xC7, 0x45, 0xF0, 0x00, 0x00, 0x00, 0x00
+    };
+
+    if ( ( pProgram != NULL ) &&
+         ( pProgram->pCode != NULL ) &&
+         ( pProgram->ncode > 0 ) )
+    {
+        memset( &buf, 0, sizeof( JitBuffer ) );
+        size = ( pProgram->ncode * JIT_MAX_INSTRUCTION_SIZE ) +
+               JIT_FRAME_SIZE;
+
+        pMap = mmap( NULL,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1,
+                     0 );
+        buf.pOffsets = calloc( pProgram->ncode, sizeof( size_t ) );
+        buf.pFixups = calloc( pProgram->ncode, sizeof( JitFixup ) );
+        pCode = calloc( 1, sizeof( VarJitCode ) );
+
+        if ( ( pMap != MAP_FAILED ) &&
+             ( buf.pOffsets != NULL ) &&
+             ( buf.pFixups != NULL ) &&
+             ( pCode != NULL ) )
+        {
+            buf.p = pMap;
+            Bytes( &buf, prologue, sizeof( prologue ) );
+
+            for ( i = 0; i < pProgram->ncode; i++ )
+            {
+                buf.pOffsets[i] = buf.n;
+                Generate( &buf, pProgram, &pProgram->pCode[i] );
+            }
+
+            for ( i = 0; i < buf.nFixups; i++ )
+            {
+                rel = (int32_t)( buf.pOffsets[buf.pFixups[i].target] -
+                                 ( buf.pFixups[i].pos + 4 ) );
+                memcpy( &buf.p[buf.pFixups[i].pos], &rel, sizeof( rel ) );
+            }
+
+            if ( ( LinkSwitches( &buf, pProgram ) == true ) &&
+                 ( mprotect( pMap, size, PROT_READ | PROT_EXEC ) == 0 ) )
+            {
+                pCode->pMap = pMap;
+                pCode->size = size;
+                pCode->fn = (JitFn)pMap;
+                pMap = MAP_FAILED;
+            }
+            else
+            {
+                free( pCode );
+                pCode = NULL;
+            }
+        }
+        else
+        {
+            free( pCode );
+            pCode = NULL;
+        }
+
+        if ( pMap != MAP_FAILED )
+        {
+            munmap( pMap, size );
+        }
+
+        free( buf.pOffsets );
+        free( buf.pFixups );
+    }
+#else
+    (void)pProgram;
+#endif
+
+    return pCode;
+}
+
+/*============================================================================*/
+/*  JitExec                                                                   */
+/*!
+    Execute native code
+
+    The JitExec function runs the native code generated for a program.
+    It produces the same result as the dispatch loop of ExecProgram().
+
+@param[in]
+    pCode
+        pointer to the native code
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EOK the program was successfully executed
+@retval other error from the last statement which failed
+
+==============================================================================*/
+int JitExec( VarJitCode *pCode, VARSERVER_HANDLE hVarServer )
+{
+    return pCode->fn( hVarServer );
+}
+
+/*============================================================================*/
+/*  JitFree                                                                   */
+/*!
+    Free native code
+
+@param[in]
+    pCode
+        pointer to the native code to free (may be NULL)
+
+==============================================================================*/
+void JitFree( VarJitCode *pCode )
+{
+    if ( pCode != NULL )
+    {
+        munmap( pCode->pMap, pCode->size );
+        free( pCode );
+    }
+}
+
+#if defined(__x86_64__)
+
+/*============================================================================*/
+/*  Generate                                                                  */
+/*!
+    Generate the machine code for an instruction
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@param[in]
+    pc
+        pointer to the instruction
+
+==============================================================================*/
+static void Generate( JitBuffer *pBuf,
+                      VarProgram *pProgram,
+                      VarInstruction *pc )
+{
+    Variable **regs = pProgram->pRegs;
+
+    /* mov eax, [rbp-16]; leave; ret */
+    static const uint8_t epilogue[] = { 0x8B, 0x45, 0xF0, 0xC9, 0xC3 };
+
+    /* cmp word [rax], 0 */
+    static const uint8_t testFalse[] = { 0x66, 0x83, 0x38, 0x00 };
+
+    /* test eax, eax; jz +3 */
+    static const uint8_t testResult[] = { 0x85, 0xC0, 0x74, 0x03 };
+
+    /* test al, al */
+    static const uint8_t testBool[] = { 0x84, 0xC0 };
+
+    /* jmp rax */
+    static const uint8_t jumpResult[] = { 0xFF, 0xE0 };
+
+    switch( pc->opcode )
+    {
+        case VP_END:
+            Bytes( pBuf, epilogue, sizeof( epilogue ) );
+            break;
+
+        case VP_CALL:
+            GenerateCall( pBuf, pProgram, pc );
+            break;
+
+        case VP_JMP:
+            Jump( pBuf, -1, pc->target );
+            break;
+
+        case VP_JMPF:
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, testFalse, sizeof( testFalse ) );
+            Jump( pBuf, JIT_CC_E, pc->target );
+            break;
+
+        case VP_SWITCH:
+            LoadServer( pBuf );
+            LoadAddress( pBuf, JIT_RSI, pProgram->ppSwitches[pc->b] );
+            CallFunction( pBuf, (uintptr_t)SwitchAddress );
+            Bytes( pBuf, jumpResult, sizeof( jumpResult ) );
+            break;
+
+        case VP_STATEMENT:
+        case VP_SCRIPT:
+            LoadServer( pBuf );
+            LoadAddress( pBuf, JIT_RSI, pc->pStatement );
+            CallFunction( pBuf, (uintptr_t)ProcessStatement );
+            Bytes( pBuf, testResult, sizeof( testResult ) );
+            StoreResult( pBuf );
+            break;
+
+        case VP_AND_SC:
+        case VP_OR_SC:
+            LoadAddress( pBuf, JIT_RDI, regs[pc->dst] );
+            LoadAddress( pBuf, JIT_RSI, regs[pc->a] );
+            CallFunction( pBuf, (uintptr_t)ShortCircuit );
+            Bytes( pBuf, testBool, sizeof( testBool ) );
+            Jump( pBuf, JIT_CC_NE, pc->target );
+            break;
+
+        case VP_ASSIGN_U16:
+        case VP_ASSIGN_U32:
+        case VP_ASSIGN_F:
+            GenerateAssign( pBuf, pProgram, pc );
+            break;
+
+        case VP_EQ_U16:
+        case VP_EQ_U32:
+        case VP_EQ_F:
+        case VP_GT_U16:
+        case VP_GT_U32:
+        case VP_GT_F:
+        case VP_LT_U16:
+        case VP_LT_U32:
+        case VP_LT_F:
+        case VP_GTE_U16:
+        case VP_GTE_U32:
+        case VP_GTE_F:
+        case VP_LTE_U16:
+        case VP_LTE_U32:
+        case VP_LTE_F:
+            GenerateCompare( pBuf, pProgram, pc );
+            break;
+
+        default:
+            GenerateArith( pBuf, pProgram, pc );
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  GenerateCall                                                              */
+/*!
+    Generate the machine code for a VP_CALL instruction
+
+    The operation function is called with the instruction's registers.
+    If it fails, the error is reported, and a failed IF condition jumps
+    to the end of the IF statement.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@param[in]
+    pc
+        pointer to the instruction
+
+==============================================================================*/
+static void GenerateCall( JitBuffer *pBuf,
+                          VarProgram *pProgram,
+                          VarInstruction *pc )
+{
+    Variable **regs = pProgram->pRegs;
+    size_t skip;
+    int32_t rel;
+
+    /* test eax, eax; jz rel32 */
+    static const uint8_t testCall[] = { 0x85, 0xC0, 0x0F, 0x84 };
+
+    /* mov esi, eax; lea rdx, [rbp-16] */
+    static const uint8_t failArgs[] = { 0x89, 0xC6, 0x48, 0x8D, 0x55, 0xF0 };
+
+    LoadServer( pBuf );
+    LoadAddress( pBuf, JIT_RSI, regs[pc->dst] );
+    LoadAddress( pBuf, JIT_RDX, regs[pc->a] );
+    LoadAddress( pBuf, JIT_RCX, regs[pc->b] );
+    CallFunction( pBuf, (uintptr_t)pc->fn );
+
+    Bytes( pBuf, testCall, sizeof( testCall ) );
+    skip = pBuf->n;
+    Imm32( pBuf, 0 );
+
+    Bytes( pBuf, failArgs, sizeof( failArgs ) );
+    LoadAddress( pBuf, JIT_RDI, pc );
+    CallFunction( pBuf, (uintptr_t)CallFailed );
+    if ( pc->flags & VI_COND )
+    {
+        /* a failed IF condition skips both blocks */
+        Jump( pBuf, -1, pc->target );
+    }
+
+    rel = (int32_t)( pBuf->n - ( skip + 4 ) );
+    memcpy( &pBuf->p[skip], &rel, sizeof( rel ) );
+}
+
+/*============================================================================*/
+/*  GenerateArith                                                             */
+/*!
+    Generate the machine code for an inline arithmetic instruction
+
+    16-bit operations are performed in 32-bit registers, and the low
+    16 bits of the result are stored.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@param[in]
+    pc
+        pointer to the instruction
+
+==============================================================================*/
+static void GenerateArith( JitBuffer *pBuf,
+                           VarProgram *pProgram,
+                           VarInstruction *pc )
+{
+    Variable **regs = pProgram->pRegs;
+    uint8_t val = offsetof( VarObject, val );
+    int type;
+    size_t len;
+    size_t oplen;
+    const uint8_t *op;
+
+    /* movzx ecx, word [rax]; mov ecx, [rax]; movss xmm0, [rax] */
+    static const uint8_t loadU16[] = { 0x0F, 0xB7, 0x08 };
+    static const uint8_t loadU32[] = { 0x8B, 0x08 };
+    static const uint8_t loadF[] = { 0xF3, 0x0F, 0x10, 0x00 };
+
+    /* <op> ecx, [rax] */
+    static const uint8_t addI[] = { 0x03, 0x08 };
+    static const uint8_t subI[] = { 0x2B, 0x08 };
+    static const uint8_t mulI[] = { 0x0F, 0xAF, 0x08 };
+    static const uint8_t andI[] = { 0x23, 0x08 };
+    static const uint8_t orI[] = { 0x0B, 0x08 };
+    static const uint8_t xorI[] = { 0x33, 0x08 };
+
+    /* <op>ss xmm0, [rax] */
+    static const uint8_t addF[] = { 0xF3, 0x0F, 0x58, 0x00 };
+    static const uint8_t subF[] = { 0xF3, 0x0F, 0x5C, 0x00 };
+    static const uint8_t mulF[] = { 0xF3, 0x0F, 0x59, 0x00 };
+
+    switch( pc->opcode )
+    {
+        case VP_ADD_U16:
+        case VP_ADD_U32:
+            op = addI;
+            oplen = sizeof( addI );
+            break;
+
+        case VP_SUB_U16:
+        case VP_SUB_U32:
+            op = subI;
+            oplen = sizeof( subI );
+            break;
+
+        case VP_MUL_U16:
+        case VP_MUL_U32:
+            op = mulI;
+            oplen = sizeof( mulI );
+            break;
+
+        case VP_BAND_U16:
+        case VP_BAND_U32:
+            op = andI;
+            oplen = sizeof( andI );
+            break;
+
+        case VP_BOR_U16:
+        case VP_BOR_U32:
+            op = orI;
+            oplen = sizeof( orI );
+            break;
+
+        case VP_XOR_U16:
+        case VP_XOR_U32:
+            op = xorI;
+            oplen = sizeof( xorI );
+            break;
+
+        case VP_ADD_F:
+            op = addF;
+            oplen = sizeof( addF );
+            break;
+
+        case VP_SUB_F:
+            op = subF;
+            oplen = sizeof( subF );
+            break;
+
+        default:
+            op = mulF;
+            oplen = sizeof( mulF );
+            break;
+    }
+
+    switch( pc->opcode )
+    {
+        case VP_ADD_U16:
+        case VP_SUB_U16:
+        case VP_MUL_U16:
+        case VP_BAND_U16:
+        case VP_BOR_U16:
+        case VP_XOR_U16:
+            type = VARTYPE_UINT16;
+            len = sizeof( uint16_t );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadU16, sizeof( loadU16 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, op, oplen );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            /* mov [rax+val], cx */
+            Byte( pBuf, 0x66 );
+            Byte( pBuf, 0x89 );
+            Byte( pBuf, 0x48 );
+            Byte( pBuf, val );
+            break;
+
+        case VP_ADD_F:
+        case VP_SUB_F:
+        case VP_MUL_F:
+            type = VARTYPE_FLOAT;
+            len = sizeof( float );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadF, sizeof( loadF ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, op, oplen );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            /* movss [rax+val], xmm0 */
+            Byte( pBuf, 0xF3 );
+            Byte( pBuf, 0x0F );
+            Byte( pBuf, 0x11 );
+            Byte( pBuf, 0x40 );
+            Byte( pBuf, val );
+            break;
+
+        default:
+            type = VARTYPE_UINT32;
+            len = sizeof( uint32_t );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadU32, sizeof( loadU32 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, op, oplen );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            /* mov [rax+val], ecx */
+            Byte( pBuf, 0x89 );
+            Byte( pBuf, 0x48 );
+            Byte( pBuf, val );
+            break;
+    }
+
+    StoreType( pBuf, type, len );
+}
+
+/*============================================================================*/
+/*  GenerateCompare                                                           */
+/*!
+    Generate the machine code for an inline comparison instruction
+
+    The result is stored as a 16-bit value.  Float comparisons with a
+    NaN operand are false, as they are in C.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@param[in]
+    pc
+        pointer to the instruction
+
+==============================================================================*/
+static void GenerateCompare( JitBuffer *pBuf,
+                             VarProgram *pProgram,
+                             VarInstruction *pc )
+{
+    Variable **regs = pProgram->pRegs;
+    uint8_t val = offsetof( VarObject, val );
+    bool swap = false;
+    int cc;
+
+    /* movzx ecx, word [rax]; movzx edx, word [rax] */
+    static const uint8_t loadU16[] = { 0x0F, 0xB7, 0x08, 0x0F, 0xB7, 0x10 };
+
+    /* mov ecx, [rax]; mov edx, [rax] */
+    static const uint8_t loadU32[] = { 0x8B, 0x08, 0x8B, 0x10 };
+
+    /* movss xmm0, [rax]; movss xmm1, [rax] */
+    static const uint8_t loadF[] = { 0xF3, 0x0F, 0x10, 0x00,
+                                     0xF3, 0x0F, 0x10, 0x08 };
+
+    /* cmp ecx, edx; ucomiss xmm0, xmm1; ucomiss xmm1, xmm0 */
+    static const uint8_t cmpI[] = { 0x39, 0xD1 };
+    static const uint8_t cmpF[] = { 0x0F, 0x2E, 0xC1 };
+    static const uint8_t cmpSwapF[] = { 0x0F, 0x2E, 0xC8 };
+
+    /* setnp cl; and al, cl */
+    static const uint8_t ordered[] = { 0x0F, 0x9B, 0xC1, 0x20, 0xC8 };
+
+    /* movzx ecx, al */
+    static const uint8_t widen[] = { 0x0F, 0xB6, 0xC8 };
+
+    switch( pc->opcode )
+    {
+        case VP_EQ_U16:
+        case VP_EQ_U32:
+        case VP_EQ_F:
+            cc = JIT_CC_E;
+            break;
+
+        case VP_GT_U16:
+        case VP_GT_U32:
+        case VP_GT_F:
+            cc = JIT_CC_A;
+            break;
+
+        case VP_LT_U16:
+        case VP_LT_U32:
+            cc = JIT_CC_B;
+            break;
+
+        case VP_GTE_U16:
+        case VP_GTE_U32:
+        case VP_GTE_F:
+            cc = JIT_CC_AE;
+            break;
+
+        case VP_LTE_U16:
+        case VP_LTE_U32:
+            cc = JIT_CC_BE;
+            break;
+
+        case VP_LT_F:
+            /* a < b is evaluated as b > a so NaN compares false */
+            cc = JIT_CC_A;
+            swap = true;
+            break;
+
+        default:
+            /* a <= b is evaluated as b >= a */
+            cc = JIT_CC_AE;
+            swap = true;
+            break;
+    }
+
+    switch( pc->opcode )
+    {
+        case VP_EQ_F:
+        case VP_GT_F:
+        case VP_LT_F:
+        case VP_GTE_F:
+        case VP_LTE_F:
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadF, 4 );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, &loadF[4], 4 );
+            if ( swap == true )
+            {
+                Bytes( pBuf, cmpSwapF, sizeof( cmpSwapF ) );
+            }
+            else
+            {
+                Bytes( pBuf, cmpF, sizeof( cmpF ) );
+            }
+            break;
+
+        case VP_EQ_U16:
+        case VP_GT_U16:
+        case VP_LT_U16:
+        case VP_GTE_U16:
+        case VP_LTE_U16:
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadU16, 3 );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, &loadU16[3], 3 );
+            Bytes( pBuf, cmpI, sizeof( cmpI ) );
+            break;
+
+        default:
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, loadU32, 2 );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+            Bytes( pBuf, &loadU32[2], 2 );
+            Bytes( pBuf, cmpI, sizeof( cmpI ) );
+            break;
+    }
+
+    /* setcc al */
+    Byte( pBuf, 0x0F );
+    Byte( pBuf, 0x90 | cc );
+    Byte( pBuf, 0xC0 );
+
+    if ( pc->opcode == VP_EQ_F )
+    {
+        /* unordered operands are not equal */
+        Bytes( pBuf, ordered, sizeof( ordered ) );
+    }
+
+    Bytes( pBuf, widen, sizeof( widen ) );
+
+    LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+    /* mov [rax+val], cx */
+    Byte( pBuf, 0x66 );
+    Byte( pBuf, 0x89 );
+    Byte( pBuf, 0x48 );
+    Byte( pBuf, val );
+
+    StoreType( pBuf, VARTYPE_UINT16, sizeof( uint16_t ) );
+}
+
+/*============================================================================*/
+/*  GenerateAssign                                                            */
+/*!
+    Generate the machine code for an inline local assignment instruction
+
+    The value of the right operand is stored in the local variable and
+    in the result of the assignment.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@param[in]
+    pc
+        pointer to the instruction
+
+==============================================================================*/
+static void GenerateAssign( JitBuffer *pBuf,
+                            VarProgram *pProgram,
+                            VarInstruction *pc )
+{
+    Variable **regs = pProgram->pRegs;
+    uint8_t val = offsetof( VarObject, val );
+    int type;
+    size_t len;
+
+    /* movzx ecx, word [rax]; mov [rax], cx; mov [rax+val], cx */
+    static const uint8_t loadU16[] = { 0x0F, 0xB7, 0x08 };
+    static const uint8_t storeU16[] = { 0x66, 0x89, 0x08 };
+    static const uint8_t storeResultU16[] = { 0x66, 0x89, 0x48 };
+
+    /* mov ecx, [rax]; mov [rax], ecx; mov [rax+val], ecx */
+    static const uint8_t loadU32[] = { 0x8B, 0x08 };
+    static const uint8_t storeU32[] = { 0x89, 0x08 };
+    static const uint8_t storeResultU32[] = { 0x89, 0x48 };
+
+    /* movss xmm0, [rax]; movss [rax], xmm0; movss [rax+val], xmm0 */
+    static const uint8_t loadF[] = { 0xF3, 0x0F, 0x10, 0x00 };
+    static const uint8_t storeF[] = { 0xF3, 0x0F, 0x11, 0x00 };
+    static const uint8_t storeResultF[] = { 0xF3, 0x0F, 0x11, 0x40 };
+
+    LoadAddress( pBuf, JIT_RAX, &regs[pc->b]->obj.val );
+
+    switch( pc->opcode )
+    {
+        case VP_ASSIGN_U16:
+            type = VARTYPE_UINT16;
+            len = sizeof( uint16_t );
+            Bytes( pBuf, loadU16, sizeof( loadU16 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, storeU16, sizeof( storeU16 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            Bytes( pBuf, storeResultU16, sizeof( storeResultU16 ) );
+            break;
+
+        case VP_ASSIGN_U32:
+            type = VARTYPE_UINT32;
+            len = sizeof( uint32_t );
+            Bytes( pBuf, loadU32, sizeof( loadU32 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, storeU32, sizeof( storeU32 ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            Bytes( pBuf, storeResultU32, sizeof( storeResultU32 ) );
+            break;
+
+        default:
+            type = VARTYPE_FLOAT;
+            len = sizeof( float );
+            Bytes( pBuf, loadF, sizeof( loadF ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->a]->obj.val );
+            Bytes( pBuf, storeF, sizeof( storeF ) );
+            LoadAddress( pBuf, JIT_RAX, &regs[pc->dst]->obj );
+            Bytes( pBuf, storeResultF, sizeof( storeResultF ) );
+            break;
+    }
+
+    Byte( pBuf, val );
+    StoreType( pBuf, type, len );
+}
+
+/*============================================================================*/
+/*  StoreType                                                                 */
+/*!
+    Generate the machine code to store the type and length of a result
+
+    RAX holds the address of the result object.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    type
+        type of the result
+
+@param[in]
+    len
+        length of the result
+
+==============================================================================*/
+static void StoreType( JitBuffer *pBuf, int type, size_t len )
+{
+    /* mov dword [rax+type], imm32 */
+    Byte( pBuf, 0xC7 );
+    Byte( pBuf, 0x40 );
+    Byte( pBuf, offsetof( VarObject, type ) );
+    Imm32( pBuf, (uint32_t)type );
+
+    /* mov qword [rax+len], imm32 */
+    Byte( pBuf, 0x48 );
+    Byte( pBuf, 0xC7 );
+    Byte( pBuf, 0x40 );
+    Byte( pBuf, offsetof( VarObject, len ) );
+    Imm32( pBuf, (uint32_t)len );
+}
+
+/*============================================================================*/
+/*  LoadAddress                                                               */
+/*!
+    Generate the machine code to load an address into a register
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    reg
+        register number (RAX to RDI)
+
+@param[in]
+    p
+        address to load (may be NULL)
+
+==============================================================================*/
+static void LoadAddress( JitBuffer *pBuf, int reg, const void *p )
+{
+    uint64_t v = (uintptr_t)p;
+
+    /* mov reg, imm64 */
+    Byte( pBuf, 0x48 );
+    Byte( pBuf, 0xB8 + reg );
+    Bytes( pBuf, (const uint8_t *)&v, sizeof( v ) );
+}
+
+/*============================================================================*/
+/*  LoadServer                                                                */
+/*!
+    Generate the machine code to load the variable server handle into RDI
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+==============================================================================*/
+static void LoadServer( JitBuffer *pBuf )
+{
+    /* mov rdi, [rbp-8] */
+    static const uint8_t load[] = { 0x48, 0x8B, 0x7D, 0xF8 };
+
+    Bytes( pBuf, load, sizeof( load ) );
+}
+
+/*============================================================================*/
+/*  CallFunction                                                              */
+/*!
+    Generate the machine code to call a function
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    fn
+        address of the function to call
+
+==============================================================================*/
+static void CallFunction( JitBuffer *pBuf, uintptr_t fn )
+{
+    uint64_t v = fn;
+
+    /* mov rax, imm64; call rax */
+    Byte( pBuf, 0x48 );
+    Byte( pBuf, 0xB8 );
+    Bytes( pBuf, (const uint8_t *)&v, sizeof( v ) );
+    Byte( pBuf, 0xFF );
+    Byte( pBuf, 0xD0 );
+}
+
+/*============================================================================*/
+/*  StoreResult                                                               */
+/*!
+    Generate the machine code to store EAX as the program result
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+==============================================================================*/
+static void StoreResult( JitBuffer *pBuf )
+{
+    /* mov [rbp-16], eax */
+    static const uint8_t store[] = { 0x89, 0x45, 0xF0 };
+
+    Bytes( pBuf, store, sizeof( store ) );
+}
+
+/*============================================================================*/
+/*  Jump                                                                      */
+/*!
+    Generate a jump to an instruction
+
+    The displacement is patched once the target instruction has been
+    generated.
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    cc
+        condition code, or -1 for an unconditional jump
+
+@param[in]
+    target
+        index of the target instruction
+
+==============================================================================*/
+static void Jump( JitBuffer *pBuf, int cc, uint32_t target )
+{
+    if ( cc < 0 )
+    {
+        /* jmp rel32 */
+        Byte( pBuf, 0xE9 );
+    }
+    else
+    {
+        /* jcc rel32 */
+        Byte( pBuf, 0x0F );
+        Byte( pBuf, 0x80 | cc );
+    }
+
+    pBuf->pFixups[pBuf->nFixups].pos = pBuf->n;
+    pBuf->pFixups[pBuf->nFixups].target = target;
+    pBuf->nFixups++;
+    Imm32( pBuf, 0 );
+}
+
+/*============================================================================*/
+/*  Byte                                                                      */
+/*!
+    Append a byte to the code buffer
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    b
+        byte to append
+
+==============================================================================*/
+static void Byte( JitBuffer *pBuf, uint8_t b )
+{
+    pBuf->p[pBuf->n++] = b;
+}
+
+/*============================================================================*/
+/*  Bytes                                                                     */
+/*!
+    Append a byte sequence to the code buffer
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    p
+        pointer to the bytes to append
+
+@param[in]
+    len
+        number of bytes to append
+
+==============================================================================*/
+static void Bytes( JitBuffer *pBuf, const uint8_t *p, size_t len )
+{
+    memcpy( &pBuf->p[pBuf->n], p, len );
+    pBuf->n += len;
+}
+
+/*============================================================================*/
+/*  Imm32                                                                     */
+/*!
+    Append a 32-bit little endian value to the code buffer
+
+@param[in,out]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    v
+        value to append
+
+==============================================================================*/
+static void Imm32( JitBuffer *pBuf, uint32_t v )
+{
+    Bytes( pBuf, (const uint8_t *)&v, sizeof( v ) );
+}
+
+/*============================================================================*/
+/*  CallFailed                                                                */
+/*!
+    Handle a failed operation function call
+
+    The CallFailed function is called from native code when an operation
+    function fails.  It reports the error, and records it as the program
+    result if the instruction is the root of a statement or part of an
+    IF condition.
+
+@param[in]
+    pc
+        pointer to the instruction which failed
+
+@param[in]
+    rc
+        error returned by the operation function
+
+@param[in,out]
+    pResult
+        pointer to the program result
+
+==============================================================================*/
+static void CallFailed( VarInstruction *pc, int rc, int *pResult )
+{
+    ReportProgramError( pc, rc );
+
+    if ( pc->flags & ( VI_ROOT | VI_COND ) )
+    {
+        *pResult = rc;
+    }
+}
+
+/*============================================================================*/
+/*  SwitchAddress                                                             */
+/*!
+    Select the case of an IF/ELSE chain
+
+    The SwitchAddress function is called from native code for a
+    VP_SWITCH instruction.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pSwitch
+        pointer to the switch
+
+@retval native code address of the selected case
+
+==============================================================================*/
+static void *SwitchAddress( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch )
+{
+    return pSwitch->ppNative[SelectCase( hVarServer, pSwitch )];
+}
+
+/*============================================================================*/
+/*  LinkSwitches                                                              */
+/*!
+    Record the native code address of each switch target
+
+    The LinkSwitches function is called once the code for every
+    instruction has been generated.
+
+@param[in]
+    pBuf
+        pointer to the code buffer
+
+@param[in]
+    pProgram
+        pointer to the program
+
+@retval true the switch targets were recorded
+@retval false memory allocation failure
+
+==============================================================================*/
+static bool LinkSwitches( JitBuffer *pBuf, VarProgram *pProgram )
+{
+    bool result = true;
+    VarSwitch *pSwitch;
+    size_t i;
+    size_t j;
+
+    for ( i = 0; ( i < pProgram->nswitches ) && ( result == true ); i++ )
+    {
+        pSwitch = pProgram->ppSwitches[i];
+        free( pSwitch->ppNative );
+        pSwitch->ppNative = calloc( pSwitch->ncases + 2, sizeof( void * ) );
+        if ( pSwitch->ppNative != NULL )
+        {
+            for ( j = 0; j < pSwitch->ncases + 2; j++ )
+            {
+                pSwitch->ppNative[j] =
+                    &pBuf->p[pBuf->pOffsets[pSwitch->pTargets[j]]];
+            }
+        }
+        else
+        {
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+#endif
+
+/*! @}
+ * end of varjit group */
@@ -0,0 +1,1362 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varlatency varlatency
+ * @brief Variable Action Script Latency Tracing functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varlatency.c
+
+    Variable Action Script Latency Tracing functions
+
+    The Variable Action Script Latency Tracing functions record
+    end-to-end action latency histograms while the VA_OPT_LATENCY
+    option is set.
+
+    A trigger is stamped when a timer fires (VASetActiveTimer), when a
+    system variable change is marked (VarActionMarkChanged), or when the
+    application calls VarActionTrigger(), for example on receipt of a
+    modified notification.  The next outermost evaluation records the
+    time from the trigger to its start, the time from the trigger to its
+    completion (after any deferred writes have been published) in the
+    histogram of the trigger source, and its own duration.  Each
+    statement records the time from the trigger, or from the start of
+    the evaluation, to its completion, keyed by line number.  Only
+    statements evaluated through ProcessStatement() are recorded, so
+    statements compiled inline into a program appear in the trigger
+    histograms only.  Each variable server get and set request records
+    its duration.
+
+    The histograms are shared by all contexts.  Each power of two is
+    divided into 16 linear buckets, so values are recorded to within
+    1/16 of their magnitude from 1 ns up to about 18 minutes, and
+    measurements are added with relaxed atomic operations so evaluator
+    threads never lock to record them.
+
+    The histograms can be read with VarActionGetLatency() and
+    VarActionGetStatementLatency(), written as a text report with
+    VarActionPrintLatency(), or published to variable server variables
+    with VarActionExportLatency(), either on demand or periodically
+    at the end of an evaluation (VarActionSetLatencyExport()).
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "varlatency.h"
+#include "varcontext.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! number of bits of sub-bucket resolution within each power of two */
+#define LATENCY_SUB_BITS        ( 4 )
+
+/*! number of sub-buckets within each power of two */
+#define LATENCY_SUB_COUNT       ( 1 << LATENCY_SUB_BITS )
+
+/*! number of bits in the largest recorded value */
+#define LATENCY_MAX_BITS        ( 40 )
+
+/*! largest recorded value.  Longer latencies are recorded as this value */
+#define LATENCY_MAX_NS          ( ( 1ull << LATENCY_MAX_BITS ) - 1 )
+
+/*! number of buckets in a histogram */
+#define LATENCY_BUCKETS \
+    ( ( LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1 ) * LATENCY_SUB_COUNT )
+
+/*! number of line numbers in each block of the statement table */
+#define LATENCY_LINE_BLOCK      ( 256 )
+
+/*! number of blocks in the statement table */
+#define LATENCY_LINE_BLOCKS     ( 256 )
+
+/*! number of statistics exported for each histogram */
+#define LATENCY_EXPORTS         ( 6 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! latency histogram */
+typedef struct _latencyHistogram
+{
+    /*! number of measurements in each bucket */
+    atomic_uint_fast64_t counts[LATENCY_BUCKETS];
+
+    /*! sum of the measurements in nanoseconds */
+    atomic_uint_fast64_t totalns;
+
+    /*! minimum measurement plus one, or zero if there are none */
+    atomic_uint_fast64_t minns;
+
+    /*! maximum measurement in nanoseconds */
+    atomic_uint_fast64_t maxns;
+
+    /*! handles of the exported variables, used by the exporter only */
+    VAR_HANDLE hExport[LATENCY_EXPORTS];
+
+    /*! true if the exported variable handles have been looked up */
+    bool resolved;
+
+} LatencyHistogram;
+
+/*! block of the statement table */
+typedef struct _latencyLines
+{
+    /*! histograms of the lines in the block (NULL until recorded) */
+    _Atomic( LatencyHistogram * ) pHistograms[LATENCY_LINE_BLOCK];
+
+} LatencyLines;
+
+/*! latency export configuration */
+typedef struct _latencyExport
+{
+    /*! serializes the exporters */
+    pthread_mutex_t lock;
+
+    /*! variable server of the periodic export */
+    VARSERVER_HANDLE hVarServer;
+
+    /*! variable name prefix of the periodic export */
+    char prefix[128];
+
+    /*! periodic export interval in nanoseconds, or zero if disabled */
+    atomic_uint_fast64_t intervalns;
+
+    /*! monotonic time of the next periodic export */
+    atomic_uint_fast64_t nextns;
+
+    /*! variable server the exported handles were looked up on */
+    VARSERVER_HANDLE hResolved;
+
+    /*! prefix the exported handles were looked up with */
+    char resolved[128];
+
+} LatencyExport;
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! names of the latency histograms */
+static const char *histogramNames[VA_LATENCY_MAX] =
+{
+    "timer",
+    "change",
+    "external",
+    "evaluation",
+    "dispatch",
+    "get",
+    "set"
+};
+
+/*! names of the exported statistics */
+static const char *exportNames[LATENCY_EXPORTS] =
+{
+    "count",
+    "p50",
+    "p90",
+    "p99",
+    "p999",
+    "max"
+};
+
+/*! trigger source and request histograms */
+static LatencyHistogram histograms[VA_LATENCY_MAX];
+
+/*! statement histograms indexed by line number */
+static _Atomic( LatencyLines * ) lines[LATENCY_LINE_BLOCKS];
+
+/*! latency export configuration */
+static LatencyExport latencyExport = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static uint64_t Now( void );
+static void Record( LatencyHistogram *pHistogram, uint64_t ns );
+static size_t BucketIndex( uint64_t ns );
+static uint64_t BucketValue( size_t idx );
+static int Summarize( LatencyHistogram *pHistogram, VarLatencyStats *pStats );
+static uint64_t Percentile( uint64_t *pCounts,
+                            uint64_t count,
+                            uint64_t partsPer10000,
+                            uint64_t maxns );
+static LatencyHistogram *LineHistogram( int lineno, bool create );
+static void Clear( LatencyHistogram *pHistogram );
+static void PrintHistogram( int fd,
+                            const char *name,
+                            LatencyHistogram *pHistogram );
+static int Export( VARSERVER_HANDLE hVarServer, const char *prefix );
+static int ExportHistogram( VARSERVER_HANDLE hVarServer,
+                            const char *prefix,
+                            const char *name,
+                            LatencyHistogram *pHistogram );
+static void ExportPeriodic( uint64_t now );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionTrigger                                                          */
+/*!
+    Stamp the trigger of the next evaluation
+
+    The VarActionTrigger function records the time at which an event
+    which will be handled by the next outermost evaluation of the current
+    context occurred, for example when a modified notification signal
+    was received.  If a trigger is already pending, the earlier time is
+    kept.  Triggers are only recorded while the VA_OPT_LATENCY option
+    is set.
+
+@param[in]
+    source
+        trigger source: VA_LATENCY_TIMER, VA_LATENCY_CHANGE or
+        VA_LATENCY_EXTERNAL
+
+@param[in]
+    pWhen
+        pointer to the CLOCK_MONOTONIC time of the event, or NULL
+        to use the current time
+
+@retval EINVAL invalid argument
+@retval EOK the trigger was recorded
+
+==============================================================================*/
+int VarActionTrigger( int source, const struct timespec *pWhen )
+{
+    int result = EINVAL;
+    uint64_t ns = 0;
+
+    if ( ( source == VA_LATENCY_TIMER ) ||
+         ( source == VA_LATENCY_CHANGE ) ||
+         ( source == VA_LATENCY_EXTERNAL ) )
+    {
+        if ( pWhen != NULL )
+        {
+            ns = (uint64_t)pWhen->tv_sec * 1000000000ull +
+                 (uint64_t)pWhen->tv_nsec;
+        }
+
+        LatencyTrigger( source, ns );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LatencyTrigger                                                            */
+/*!
+    Stamp the trigger of the next evaluation
+
+    The LatencyTrigger function records a pending trigger in the current
+    context if the VA_OPT_LATENCY option is set and no earlier trigger
+    is pending.
+
+@param[in]
+    source
+        trigger source histogram
+
+@param[in]
+    ns
+        monotonic time of the trigger in nanoseconds, or zero to use
+        the current time
+
+==============================================================================*/
+void LatencyTrigger( int source, uint64_t ns )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pContext->options & VA_OPT_LATENCY )
+    {
+        if ( ns == 0 )
+        {
+            ns = Now();
+        }
+
+        if ( ( pContext->triggerns == 0 ) ||
+             ( ns < pContext->triggerns ) )
+        {
+            pContext->triggerns = ns;
+            pContext->trigger = source;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  LatencyBegin                                                              */
+/*!
+    Stamp the start of an outermost evaluation
+
+    The LatencyBegin function records the start time of an outermost
+    evaluation and the time since its pending trigger.
+
+==============================================================================*/
+void LatencyBegin( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    pContext->startns = 0;
+
+    if ( pContext->options & VA_OPT_LATENCY )
+    {
+        pContext->startns = Now();
+
+        if ( ( pContext->triggerns != 0 ) &&
+             ( pContext->triggerns <= pContext->startns ) )
+        {
+            Record( &histograms[VA_LATENCY_DISPATCH],
+                    pContext->startns - pContext->triggerns );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  LatencyStart                                                              */
+/*!
+    Stamp the start of a variable server request
+
+@retval monotonic time in nanoseconds
+@retval 0 the VA_OPT_LATENCY option is not set
+
+==============================================================================*/
+uint64_t LatencyStart( void )
+{
+    VarActionContext *pContext = GetContext();
+    uint64_t ns = 0;
+
+    if ( pContext->options & VA_OPT_LATENCY )
+    {
+        ns = Now();
+    }
+
+    return ns;
+}
+
+/*============================================================================*/
+/*  LatencyRequest                                                            */
+/*!
+    Record the duration of a variable server request
+
+@param[in]
+    id
+        VA_LATENCY_GET or VA_LATENCY_SET
+
+@param[in]
+    start
+        time returned by LatencyStart() before the request was made
+
+==============================================================================*/
+void LatencyRequest( int id, uint64_t start )
+{
+    uint64_t now;
+
+    if ( ( start != 0 ) &&
+         ( id >= 0 ) &&
+         ( id < VA_LATENCY_MAX ) )
+    {
+        now = Now();
+        Record( &histograms[id], now - start );
+    }
+}
+
+/*============================================================================*/
+/*  LatencyStatement                                                          */
+/*!
+    Record the latency of a statement
+
+    The LatencyStatement function records the time from the pending
+    trigger, or from the start of the evaluation if there is none,
+    to the completion of a statement.
+
+@param[in]
+    lineno
+        statement line number
+
+==============================================================================*/
+void LatencyStatement( int lineno )
+{
+    VarActionContext *pContext = GetContext();
+    LatencyHistogram *pHistogram;
+    uint64_t start;
+    uint64_t now;
+
+    if ( pContext->startns != 0 )
+    {
+        start = pContext->startns;
+        if ( ( pContext->triggerns != 0 ) &&
+             ( pContext->triggerns <= start ) )
+        {
+            start = pContext->triggerns;
+        }
+
+        pHistogram = LineHistogram( lineno, true );
+        if ( pHistogram != NULL )
+        {
+            now = Now();
+            Record( pHistogram, now - start );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  LatencyComplete                                                           */
+/*!
+    Stamp the completion of an outermost evaluation
+
+    The LatencyComplete function records the duration of the outermost
+    evaluation and the latency from its trigger, and consumes the
+    trigger.  A trigger which occurred after the evaluation started is
+    kept for the next evaluation.  It has no effect for nested
+    evaluations.
+
+==============================================================================*/
+void LatencyComplete( void )
+{
+    VarActionContext *pContext = GetContext();
+    uint64_t now;
+
+    if ( ( pContext->depth == 0 ) &&
+         ( pContext->startns != 0 ) )
+    {
+        now = Now();
+
+        Record( &histograms[VA_LATENCY_EVALUATION], now - pContext->startns );
+
+        if ( ( pContext->triggerns != 0 ) &&
+             ( pContext->triggerns <= pContext->startns ) )
+        {
+            Record( &histograms[pContext->trigger],
+                    now - pContext->triggerns );
+            pContext->triggerns = 0;
+        }
+
+        pContext->startns = 0;
+
+        ExportPeriodic( now );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionGetLatency                                                       */
+/*!
+    Get the summary of a latency histogram
+
+@param[in]
+    id
+        latency histogram identifier (VA_LATENCY_xxx)
+
+@param[out]
+    pStats
+        pointer to the summary to populate
+
+@retval EINVAL invalid argument
+@retval ENOENT no latency has been recorded in the histogram
+@retval EOK the summary was retrieved
+
+==============================================================================*/
+int VarActionGetLatency( int id, VarLatencyStats *pStats )
+{
+    int result = EINVAL;
+
+    if ( ( id >= 0 ) &&
+         ( id < VA_LATENCY_MAX ) &&
+         ( pStats != NULL ) )
+    {
+        result = Summarize( &histograms[id], pStats );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionGetStatementLatency                                              */
+/*!
+    Get the summary of the latency histogram of a statement line
+
+@param[in]
+    lineno
+        statement line number
+
+@param[out]
+    pStats
+        pointer to the summary to populate
+
+@retval EINVAL invalid argument
+@retval ENOENT no latency has been recorded for the line
+@retval EOK the summary was retrieved
+
+==============================================================================*/
+int VarActionGetStatementLatency( int lineno, VarLatencyStats *pStats )
+{
+    int result = EINVAL;
+    LatencyHistogram *pHistogram;
+
+    if ( ( lineno >= 0 ) &&
+         ( pStats != NULL ) )
+    {
+        pHistogram = LineHistogram( lineno, false );
+        if ( pHistogram != NULL )
+        {
+            result = Summarize( pHistogram, pStats );
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionResetLatency                                                     */
+/*!
+    Reset the latency histograms
+
+    The VarActionResetLatency function clears all of the trigger,
+    request and statement latency histograms.  Measurements recorded
+    concurrently with the reset may be partially retained.
+
+==============================================================================*/
+void VarActionResetLatency( void )
+{
+    LatencyHistogram *pHistogram;
+    size_t i;
+
+    for ( i = 0; i < VA_LATENCY_MAX; i++ )
+    {
+        Clear( &histograms[i] );
+    }
+
+    for ( i = 0; i < LATENCY_LINE_BLOCK * LATENCY_LINE_BLOCKS; i++ )
+    {
+        pHistogram = LineHistogram( (int)i, false );
+        if ( pHistogram != NULL )
+        {
+            Clear( pHistogram );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  VarActionPrintLatency                                                     */
+/*!
+    Write a latency report
+
+    The VarActionPrintLatency function writes a text report of each
+    latency histogram which has recorded at least one measurement to
+    the specified file descriptor.
+
+@param[in]
+    fd
+        output file descriptor
+
+@retval EINVAL invalid argument
+@retval EOK the report was written
+
+==============================================================================*/
+int VarActionPrintLatency( int fd )
+{
+    int result = EINVAL;
+    LatencyHistogram *pHistogram;
+    char name[32];
+    size_t i;
+
+    if ( fd >= 0 )
+    {
+        dprintf( fd,
+                 "%-16s %10s %10s %10s %10s %10s %10s %10s\n",
+                 "name", "count", "min_ns", "p50_ns", "p90_ns",
+                 "p99_ns", "p999_ns", "max_ns" );
+
+        for ( i = 0; i < VA_LATENCY_MAX; i++ )
+        {
+            PrintHistogram( fd, histogramNames[i], &histograms[i] );
+        }
+
+        for ( i = 0; i < LATENCY_LINE_BLOCK * LATENCY_LINE_BLOCKS; i++ )
+        {
+            pHistogram = LineHistogram( (int)i, false );
+            if ( pHistogram != NULL )
+            {
+                snprintf( name, sizeof( name ), "line %zu", i );
+                PrintHistogram( fd, name, pHistogram );
+            }
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionExportLatency                                                    */
+/*!
+    Publish the latency histograms to variable server variables
+
+    The VarActionExportLatency function sets the variables named
+    <prefix>/<histogram>/<statistic> to the summary of each latency
+    histogram, where <histogram> is one of timer, change, external,
+    evaluation, dispatch, get, set or line<N>, and <statistic> is one of
+    count, p50, p90, p99, p999 or max.  Latencies are published in
+    microseconds.  All of the values are published as VARTYPE_UINT32,
+    saturated at UINT32_MAX.  Only variables which exist when a
+    histogram is first exported are updated, so the application chooses
+    which statistics are published (for example only <prefix>/timer/p99)
+    by creating them.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    prefix
+        variable name prefix, for example "/sys/action/latency"
+
+@retval EINVAL invalid argument
+@retval EOK the latency histograms were published
+@retval other error from the last variable which could not be set
+
+==============================================================================*/
+int VarActionExportLatency( VARSERVER_HANDLE hVarServer, const char *prefix )
+{
+    int result = EINVAL;
+
+    if ( ( hVarServer != NULL ) &&
+         ( prefix != NULL ) )
+    {
+        pthread_mutex_lock( &latencyExport.lock );
+        result = Export( hVarServer, prefix );
+        pthread_mutex_unlock( &latencyExport.lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionSetLatencyExport                                                 */
+/*!
+    Publish the latency histograms periodically
+
+    The VarActionSetLatencyExport function configures the latency
+    histograms to be published as described for VarActionExportLatency()
+    at the end of the first outermost evaluation, in any context, which
+    completes after each interval has elapsed.  Since the histograms only
+    change when actions are evaluated, no timer is required.  The export
+    runs on the evaluating thread after its latencies have been recorded.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    prefix
+        variable name prefix
+
+@param[in]
+    intervalms
+        export interval in milliseconds, or zero to stop exporting
+
+@retval EINVAL invalid argument
+@retval EOK the periodic export was configured
+
+==============================================================================*/
+int VarActionSetLatencyExport( VARSERVER_HANDLE hVarServer,
+                               const char *prefix,
+                               uint32_t intervalms )
+{
+    int result = EINVAL;
+    uint64_t intervalns = (uint64_t)intervalms * 1000000ull;
+
+    if ( intervalms == 0 )
+    {
+        atomic_store( &latencyExport.intervalns, 0 );
+        result = EOK;
+    }
+    else if ( ( hVarServer != NULL ) &&
+              ( prefix != NULL ) &&
+              ( strlen( prefix ) < sizeof( latencyExport.prefix ) ) )
+    {
+        pthread_mutex_lock( &latencyExport.lock );
+
+        latencyExport.hVarServer = hVarServer;
+        strcpy( latencyExport.prefix, prefix );
+        atomic_store( &latencyExport.nextns, Now() + intervalns );
+        atomic_store( &latencyExport.intervalns, intervalns );
+
+        pthread_mutex_unlock( &latencyExport.lock );
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Now                                                                       */
+/*!
+    Get the monotonic time
+
+@retval monotonic time in nanoseconds
+
+==============================================================================*/
+static uint64_t Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*============================================================================*/
+/*  Record                                                                    */
+/*!
+    Add a measurement to a histogram
+
+    The Record function adds a measurement to a histogram using relaxed
+    atomic operations, so measurements may be recorded concurrently by
+    several threads.
+
+@param[in]
+    pHistogram
+        pointer to the histogram to update
+
+@param[in]
+    ns
+        measurement in nanoseconds
+
+==============================================================================*/
+static void Record( LatencyHistogram *pHistogram, uint64_t ns )
+{
+    uint_fast64_t value;
+
+    if ( ns > LATENCY_MAX_NS )
+    {
+        ns = LATENCY_MAX_NS;
+    }
+
+    atomic_fetch_add_explicit( &pHistogram->counts[BucketIndex( ns )],
+                               1,
+                               memory_order_relaxed );
+
+    atomic_fetch_add_explicit( &pHistogram->totalns,
+                               ns,
+                               memory_order_relaxed );
+
+    value = atomic_load_explicit( &pHistogram->maxns, memory_order_relaxed );
+    while ( ( ns > value ) &&
+            ( !atomic_compare_exchange_weak_explicit( &pHistogram->maxns,
+                                                      &value,
+                                                      ns,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed ) ) )
+    {
+        /* value has been reloaded */
+    }
+
+    value = atomic_load_explicit( &pHistogram->minns, memory_order_relaxed );
+    while ( ( ( value == 0 ) || ( ns + 1 < value ) ) &&
+            ( !atomic_compare_exchange_weak_explicit( &pHistogram->minns,
+                                                      &value,
+                                                      ns + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed ) ) )
+    {
+        /* value has been reloaded */
+    }
+}
+
+/*============================================================================*/
+/*  BucketIndex                                                               */
+/*!
+    Get the histogram bucket of a value
+
+    Values below 2 * LATENCY_SUB_COUNT have a bucket each.  Above that,
+    each power of two is divided into LATENCY_SUB_COUNT buckets.
+
+@param[in]
+    ns
+        value in nanoseconds, no larger than LATENCY_MAX_NS
+
+@retval index of the bucket which contains the value
+
+==============================================================================*/
+static size_t BucketIndex( uint64_t ns )
+{
+    size_t idx = (size_t)ns;
+    uint64_t v = ns;
+    unsigned int msb = 0;
+    unsigned int shift;
+
+    if ( ns >= LATENCY_SUB_COUNT )
+    {
+        /* find the most significant bit */
+        for ( shift = 32; shift > 0; shift /= 2 )
+        {
+            if ( ( v >> shift ) != 0 )
+            {
+                v >>= shift;
+                msb += shift;
+            }
+        }
+
+        shift = msb - LATENCY_SUB_BITS;
+        idx = ( (size_t)shift << LATENCY_SUB_BITS ) + (size_t)( ns >> shift );
+    }
+
+    return idx;
+}
+
+/*============================================================================*/
+/*  BucketValue                                                               */
+/*!
+    Get the largest value in a histogram bucket
+
+@param[in]
+    idx
+        bucket index
+
+@retval largest value in nanoseconds which is recorded in the bucket
+
+==============================================================================*/
+static uint64_t BucketValue( size_t idx )
+{
+    uint64_t value = idx;
+    unsigned int shift;
+
+    if ( idx >= LATENCY_SUB_COUNT )
+    {
+        shift = (unsigned int)( idx >> LATENCY_SUB_BITS ) - 1;
+        value = (uint64_t)( idx - ( (size_t)shift << LATENCY_SUB_BITS ) );
+        value = ( ( value + 1 ) << shift ) - 1;
+    }
+
+    return value;
+}
+
+/*============================================================================*/
+/*  Summarize                                                                 */
+/*!
+    Summarize a histogram
+
+    The Summarize function calculates the summary statistics of a
+    snapshot of the histogram buckets.
+
+@param[in]
+    pHistogram
+        pointer to the histogram
+
+@param[out]
+    pStats
+        pointer to the summary to populate
+
+@retval ENOENT the histogram is empty
+@retval EOK the summary was calculated
+
+==============================================================================*/
+static int Summarize( LatencyHistogram *pHistogram, VarLatencyStats *pStats )
+{
+    int result = ENOENT;
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t count = 0;
+    uint64_t minns;
+    size_t i;
+
+    for ( i = 0; i < LATENCY_BUCKETS; i++ )
+    {
+        counts[i] = atomic_load_explicit( &pHistogram->counts[i],
+                                          memory_order_relaxed );
+        count += counts[i];
+    }
+
+    memset( pStats, 0, sizeof( VarLatencyStats ) );
+
+    if ( count > 0 )
+    {
+        minns = atomic_load_explicit( &pHistogram->minns,
+                                      memory_order_relaxed );
+
+        pStats->count = count;
+        pStats->minns = ( minns > 0 ) ? minns - 1 : 0;
+        pStats->maxns = atomic_load_explicit( &pHistogram->maxns,
+                                              memory_order_relaxed );
+        pStats->meanns = atomic_load_explicit( &pHistogram->totalns,
+                                               memory_order_relaxed ) / count;
+        pStats->p50ns = Percentile( counts, count, 5000, pStats->maxns );
+        pStats->p90ns = Percentile( counts, count, 9000, pStats->maxns );
+        pStats->p99ns = Percentile( counts, count, 9900, pStats->maxns );
+        pStats->p999ns = Percentile( counts, count, 9990, pStats->maxns );
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Percentile                                                                */
+/*!
+    Get a percentile of a histogram snapshot
+
+@param[in]
+    pCounts
+        pointer to the bucket counts
+
+@param[in]
+    count
+        total number of measurements
+
+@param[in]
+    partsPer10000
+        percentile in hundredths of a percent
+
+@param[in]
+    maxns
+        largest measurement in nanoseconds
+
+@retval largest value of the bucket which contains the percentile,
+        limited to the largest measurement
+
+==============================================================================*/
+static uint64_t Percentile( uint64_t *pCounts,
+                            uint64_t count,
+                            uint64_t partsPer10000,
+                            uint64_t maxns )
+{
+    uint64_t value;
+    uint64_t target;
+    uint64_t seen = 0;
+    size_t i;
+
+    target = ( count * partsPer10000 + 9999 ) / 10000;
+    if ( target == 0 )
+    {
+        target = 1;
+    }
+
+    for ( i = 0; i < LATENCY_BUCKETS - 1; i++ )
+    {
+        seen += pCounts[i];
+        if ( seen >= target )
+        {
+            break;
+        }
+    }
+
+    value = BucketValue( i );
+    if ( value > maxns )
+    {
+        /* the bucket bound exceeds the largest measurement */
+        value = maxns;
+    }
+
+    return value;
+}
+
+/*============================================================================*/
+/*  LineHistogram                                                             */
+/*!
+    Get the histogram of a statement line
+
+    The LineHistogram function gets the histogram of the specified line
+    number.  Missing blocks and histograms are allocated and installed
+    with a compare and exchange, so concurrent recorders do not lock.
+
+@param[in]
+    lineno
+        statement line number
+
+@param[in]
+    create
+        true to allocate the histogram if it does not exist
+
+@retval pointer to the histogram of the line
+@retval NULL if it does not exist or could not be allocated
+
+==============================================================================*/
+static LatencyHistogram *LineHistogram( int lineno, bool create )
+{
+    LatencyHistogram *pHistogram = NULL;
+    LatencyHistogram *pExpected;
+    LatencyLines *pLines = NULL;
+    LatencyLines *pEmpty;
+    size_t block;
+    size_t offset;
+
+    if ( ( lineno >= 0 ) &&
+         ( lineno < LATENCY_LINE_BLOCK * LATENCY_LINE_BLOCKS ) )
+    {
+        block = (size_t)lineno / LATENCY_LINE_BLOCK;
+        offset = (size_t)lineno % LATENCY_LINE_BLOCK;
+
+        pLines = atomic_load( &lines[block] );
+        if ( ( pLines == NULL ) && ( create == true ) )
+        {
+            pLines = calloc( 1, sizeof( LatencyLines ) );
+            if ( pLines != NULL )
+            {
+                pEmpty = NULL;
+                if ( !atomic_compare_exchange_strong( &lines[block],
+                                                      &pEmpty,
+                                                      pLines ) )
+                {
+                    /* another thread installed the block first */
+                    free( pLines );
+                    pLines = pEmpty;
+                }
+            }
+        }
+
+        if ( pLines != NULL )
+        {
+            pHistogram = atomic_load( &pLines->pHistograms[offset] );
+            if ( ( pHistogram == NULL ) && ( create == true ) )
+            {
+                pHistogram = calloc( 1, sizeof( LatencyHistogram ) );
+                if ( pHistogram != NULL )
+                {
+                    pExpected = NULL;
+                    if ( !atomic_compare_exchange_strong(
+                                &pLines->pHistograms[offset],
+                                &pExpected,
+                                pHistogram ) )
+                    {
+                        free( pHistogram );
+                        pHistogram = pExpected;
+                    }
+                }
+            }
+        }
+    }
+
+    return pHistogram;
+}
+
+/*============================================================================*/
+/*  Clear                                                                     */
+/*!
+    Clear the measurements of a histogram
+
+@param[in]
+    pHistogram
+        pointer to the histogram to clear
+
+==============================================================================*/
+static void Clear( LatencyHistogram *pHistogram )
+{
+    size_t i;
+
+    for ( i = 0; i < LATENCY_BUCKETS; i++ )
+    {
+        atomic_store_explicit( &pHistogram->counts[i],
+                               0,
+                               memory_order_relaxed );
+    }
+
+    atomic_store_explicit( &pHistogram->totalns, 0, memory_order_relaxed );
+    atomic_store_explicit( &pHistogram->minns, 0, memory_order_relaxed );
+    atomic_store_explicit( &pHistogram->maxns, 0, memory_order_relaxed );
+}
+
+/*============================================================================*/
+/*  PrintHistogram                                                            */
+/*!
+    Write a line of the latency report
+
+    The PrintHistogram function writes a line of the latency report for
+    a histogram which has recorded at least one measurement.
+
+@param[in]
+    fd
+        output file descriptor
+
+@param[in]
+    name
+        name of the histogram
+
+@param[in]
+    pHistogram
+        pointer to the histogram to write
+
+==============================================================================*/
+static void PrintHistogram( int fd,
+                            const char *name,
+                            LatencyHistogram *pHistogram )
+{
+    VarLatencyStats stats;
+
+    if ( Summarize( pHistogram, &stats ) == EOK )
+    {
+        dprintf( fd,
+                 "%-16s %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+                 name,
+                 (unsigned long long)stats.count,
+                 (unsigned long long)stats.minns,
+                 (unsigned long long)stats.p50ns,
+                 (unsigned long long)stats.p90ns,
+                 (unsigned long long)stats.p99ns,
+                 (unsigned long long)stats.p999ns,
+                 (unsigned long long)stats.maxns );
+    }
+}
+
+/*============================================================================*/
+/*  Export                                                                    */
+/*!
+    Publish the latency histograms
+
+    The Export function publishes each latency histogram as described
+    for VarActionExportLatency().  The exported variable handles are
+    looked up again if the variable server or prefix has changed.
+    It must be called with the export lock held.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    prefix
+        variable name prefix
+
+@retval EOK the latency histograms were published
+@retval other error from the last variable which could not be set
+
+==============================================================================*/
+static int Export( VARSERVER_HANDLE hVarServer, const char *prefix )
+{
+    int result = EOK;
+    LatencyHistogram *pHistogram;
+    bool reset;
+    char name[32];
+    size_t i;
+    int rc;
+
+    reset = ( hVarServer != latencyExport.hResolved ) ||
+            ( strncmp( prefix,
+                       latencyExport.resolved,
+                       sizeof( latencyExport.resolved ) ) != 0 );
+    if ( reset == true )
+    {
+        latencyExport.hResolved = hVarServer;
+        snprintf( latencyExport.resolved,
+                  sizeof( latencyExport.resolved ),
+                  "%s",
+                  prefix );
+    }
+
+    for ( i = 0; i < VA_LATENCY_MAX; i++ )
+    {
+        if ( reset == true )
+        {
+            histograms[i].resolved = false;
+        }
+
+        rc = ExportHistogram( hVarServer,
+                              prefix,
+                              histogramNames[i],
+                              &histograms[i] );
+        if ( rc != EOK )
+        {
+            result = rc;
+        }
+    }
+
+    for ( i = 0; i < LATENCY_LINE_BLOCK * LATENCY_LINE_BLOCKS; i++ )
+    {
+        pHistogram = LineHistogram( (int)i, false );
+        if ( pHistogram != NULL )
+        {
+            if ( reset == true )
+            {
+                pHistogram->resolved = false;
+            }
+
+            snprintf( name, sizeof( name ), "line%zu", i );
+            rc = ExportHistogram( hVarServer, prefix, name, pHistogram );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ExportHistogram                                                           */
+/*!
+    Publish the summary of a latency histogram
+
+    The ExportHistogram function looks up the exported variables of
+    a histogram the first time it is exported, and sets each one which
+    exists to the corresponding summary statistic.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    prefix
+        variable name prefix
+
+@param[in]
+    name
+        name of the histogram
+
+@param[in]
+    pHistogram
+        pointer to the histogram
+
+@retval EOK the summary was published
+@retval other error from the last variable which could not be set
+
+==============================================================================*/
+static int ExportHistogram( VARSERVER_HANDLE hVarServer,
+                            const char *prefix,
+                            const char *name,
+                            LatencyHistogram *pHistogram )
+{
+    int result = EOK;
+    VarLatencyStats stats;
+    uint64_t values[LATENCY_EXPORTS];
+    char path[256];
+    VarObject obj;
+    size_t i;
+    int rc;
+
+    if ( pHistogram->resolved == false )
+    {
+        for ( i = 0; i < LATENCY_EXPORTS; i++ )
+        {
+            snprintf( path,
+                      sizeof( path ),
+                      "%s/%s/%s",
+                      prefix,
+                      name,
+                      exportNames[i] );
+            pHistogram->hExport[i] = VAR_FindByName( hVarServer, path );
+        }
+
+        pHistogram->resolved = true;
+    }
+
+    (void)Summarize( pHistogram, &stats );
+
+    values[0] = stats.count;
+    values[1] = stats.p50ns / 1000;
+    values[2] = stats.p90ns / 1000;
+    values[3] = stats.p99ns / 1000;
+    values[4] = stats.p999ns / 1000;
+    values[5] = stats.maxns / 1000;
+
+    for ( i = 0; i < LATENCY_EXPORTS; i++ )
+    {
+        if ( pHistogram->hExport[i] != VAR_INVALID )
+        {
+            obj.type = VARTYPE_UINT32;
+            obj.len = sizeof( uint32_t );
+            obj.val.ul = ( values[i] > UINT32_MAX ) ? UINT32_MAX
+                                                    : (uint32_t)values[i];
+
+            rc = VAR_Set( hVarServer, pHistogram->hExport[i], &obj );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ExportPeriodic                                                            */
+/*!
+    Publish the latency histograms if the export interval has elapsed
+
+    The ExportPeriodic function publishes the latency histograms if a
+    periodic export is configured and is due.  Only one evaluating
+    thread claims each export, and an export which is already running
+    is not waited for.
+
+@param[in]
+    now
+        current monotonic time in nanoseconds
+
+==============================================================================*/
+static void ExportPeriodic( uint64_t now )
+{
+    uint_fast64_t intervalns;
+    uint_fast64_t nextns;
+
+    intervalns = atomic_load_explicit( &latencyExport.intervalns,
+                                       memory_order_relaxed );
+    if ( intervalns != 0 )
+    {
+        nextns = atomic_load_explicit( &latencyExport.nextns,
+                                       memory_order_relaxed );
+        if ( ( now >= nextns ) &&
+             ( atomic_compare_exchange_strong( &latencyExport.nextns,
+                                               &nextns,
+                                               now + intervalns ) ) &&
+             ( pthread_mutex_trylock( &latencyExport.lock ) == 0 ) )
+        {
+            if ( atomic_load( &latencyExport.intervalns ) != 0 )
+            {
+                (void)Export( latencyExport.hVarServer,
+                              latencyExport.prefix );
+            }
+
+            pthread_mutex_unlock( &latencyExport.lock );
+        }
+    }
+}
+
+/*! @}
+ * end of varlatency group */
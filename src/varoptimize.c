@@ -0,0 +1,572 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varoptimize varoptimize
+ * @brief Variable Action Script Expression Optimization functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varoptimize.c
+
+    Variable Action Script Expression Optimization functions
+
+    The Variable Action Script Expression Optimization functions simplify
+    variable trees before they are evaluated:
+
+    - operations whose operands are all numeric constants are folded
+      into a constant by evaluating them once with their operation function
+
+    - casts of a value which already has the target type are removed
+
+    - operations with an identity operand (x*1, x/1, x+0, x-0, x|0, x^0,
+      x<<0, x>>0) are replaced by their other operand
+
+    Because constants are folded with the same operation functions that
+    evaluate the tree, folded results are identical to evaluated ones.
+    Divisions by zero and out of range shifts are never folded.
+
+    Identity simplifications are only applied when the type of the
+    remaining operand is known and matches the type of the constant.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include <varaction/varaction.h>
+#include "varops.h"
+#include "varformat.h"
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! placeholder variable server handle passed to operation functions
+ *  while folding constants.  Constant operands never access the server */
+static int g_noServer;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static void OptimizeStatements( Statement *pStatements );
+static bool Fold( Variable *pVariable );
+static bool CanFold( Variable *pVariable );
+static Variable *Simplify( Variable *pVariable );
+static bool IsConstant( Variable *pVariable );
+static bool IsFixed( Variable *pVariable, int type );
+static bool IsValue( Variable *pVariable, int type, uint32_t n );
+static void Discard( Variable *pVariable );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  OptimizeVariable                                                          */
+/*!
+    Optimize a variable tree
+
+    The OptimizeVariable function optimizes each node of a variable tree
+    from the bottom up, including the statements in the blocks of an
+    IF/ELSE node.
+
+    Nodes which are folded into a constant are updated in place.
+    Nodes which are replaced by one of their operands are released
+    (unless they were allocated from an arena), and the replacement is
+    returned to the parent.  The caller must replace its reference to
+    pVariable with the returned pointer.
+
+@param[in]
+    pVariable
+        pointer to the root of the variable tree
+
+@retval pointer to the root of the optimized tree
+
+==============================================================================*/
+Variable *OptimizeVariable( Variable *pVariable )
+{
+    if ( pVariable != NULL )
+    {
+        if ( pVariable->operation == VA_ELSE )
+        {
+            /* the subtrees of an ELSE node are statement lists */
+            OptimizeStatements( (Statement *)pVariable->left );
+            OptimizeStatements( (Statement *)pVariable->right );
+        }
+        else
+        {
+            pVariable->left = OptimizeVariable( pVariable->left );
+            pVariable->right = OptimizeVariable( pVariable->right );
+            pVariable = OptimizeNode( pVariable );
+        }
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  OptimizeNode                                                              */
+/*!
+    Optimize a single node
+
+    The OptimizeNode function optimizes a node whose subtrees have
+    already been optimized.  It is called by CreateVariable() when the
+    VA_OPT_OPTIMIZE option is set, so trees are optimized as the parser
+    builds them.
+
+@param[in]
+    pVariable
+        pointer to the node to optimize
+
+@retval pointer to the optimized node
+
+==============================================================================*/
+Variable *OptimizeNode( Variable *pVariable )
+{
+    if ( pVariable != NULL )
+    {
+        if ( Fold( pVariable ) == false )
+        {
+            pVariable = Simplify( pVariable );
+        }
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  OptimizeStatements                                                        */
+/*!
+    Optimize a statement list
+
+    The OptimizeStatements function optimizes the variable tree of
+    each statement in a statement list.
+
+@param[in]
+    pStatements
+        pointer to the statement list (may be NULL)
+
+==============================================================================*/
+static void OptimizeStatements( Statement *pStatements )
+{
+    while ( pStatements != NULL )
+    {
+        pStatements->pVariable = OptimizeVariable( pStatements->pVariable );
+        pStatements = pStatements->pNext;
+    }
+}
+
+/*============================================================================*/
+/*  Fold                                                                      */
+/*!
+    Fold a constant node
+
+    The Fold function evaluates an operation whose operands are all
+    constants using its operation function, and converts the node into
+    a constant holding the result.
+
+@param[in]
+    pVariable
+        pointer to the node to fold
+
+@retval true the node was folded into a constant
+@retval false the node was not changed
+
+==============================================================================*/
+static bool Fold( Variable *pVariable )
+{
+    bool folded = false;
+    VarObject obj;
+    opfn fn;
+    int rc;
+
+    if ( CanFold( pVariable ) == true )
+    {
+        obj = pVariable->obj;
+
+        fn = GetOperation( pVariable->operation );
+        rc = fn( (VARSERVER_HANDLE)&g_noServer,
+                 pVariable,
+                 pVariable->left,
+                 pVariable->right );
+        if ( ( rc == EOK ) &&
+             ( ( pVariable->obj.type == VARTYPE_UINT16 ) ||
+               ( pVariable->obj.type == VARTYPE_UINT32 ) ||
+               ( pVariable->obj.type == VARTYPE_FLOAT ) ) )
+        {
+            pVariable->operation = ( pVariable->obj.type == VARTYPE_FLOAT )
+                                   ? VA_FLOATNUM
+                                   : VA_NUM;
+
+            Discard( pVariable->left );
+            Discard( pVariable->right );
+            pVariable->left = NULL;
+            pVariable->right = NULL;
+            pVariable->fn = NULL;
+            folded = true;
+        }
+        else
+        {
+            /* restore the node */
+            pVariable->obj = obj;
+        }
+    }
+
+    return folded;
+}
+
+/*============================================================================*/
+/*  CanFold                                                                   */
+/*!
+    Check if a node can be folded
+
+    The CanFold function checks if a node is a pure arithmetic, bitwise,
+    logical, comparison or cast operation whose operands are numeric
+    constants, and whose evaluation is well defined.
+
+@param[in]
+    pVariable
+        pointer to the node to check
+
+@retval true the node can be folded
+@retval false the node cannot be folded
+
+==============================================================================*/
+static bool CanFold( Variable *pVariable )
+{
+    bool result = false;
+    Variable *pLeft = pVariable->left;
+    Variable *pRight = pVariable->right;
+
+    switch( pVariable->operation )
+    {
+        case VA_NOT:
+        case VA_TOFLOAT:
+        case VA_TOINT:
+        case VA_TOSHORT:
+            result = IsConstant( pLeft ) && ( pRight == NULL );
+            break;
+
+        case VA_MUL:
+        case VA_ADD:
+        case VA_SUB:
+        case VA_BAND:
+        case VA_BOR:
+        case VA_XOR:
+        case VA_AND:
+        case VA_OR:
+        case VA_EQUALS:
+        case VA_NOTEQUALS:
+        case VA_GT:
+        case VA_LT:
+        case VA_GTE:
+        case VA_LTE:
+            result = IsConstant( pLeft ) && IsConstant( pRight );
+            break;
+
+        case VA_DIV:
+            /* the operation function reads the divisor using
+             * the type of the left operand */
+            result = IsConstant( pLeft ) &&
+                     IsConstant( pRight ) &&
+                     !IsValue( pRight, pLeft->obj.type, 0 );
+            break;
+
+        case VA_LSHIFT:
+        case VA_RSHIFT:
+            result = IsConstant( pLeft ) && IsConstant( pRight );
+            if ( result == true )
+            {
+                /* shifts of the operand width or more are undefined */
+                if ( pLeft->obj.type == VARTYPE_UINT32 )
+                {
+                    result = ( pRight->obj.val.ul < 32 );
+                }
+                else if ( pLeft->obj.type == VARTYPE_UINT16 )
+                {
+                    result = ( pRight->obj.val.ui < 16 );
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Simplify                                                                  */
+/*!
+    Apply algebraic simplifications to a node
+
+    The Simplify function replaces identity casts and operations with an
+    identity operand by the operand which determines their value.
+
+@param[in]
+    pVariable
+        pointer to the node to simplify
+
+@retval pointer to the simplified node
+
+==============================================================================*/
+static Variable *Simplify( Variable *pVariable )
+{
+    Variable *pLeft = pVariable->left;
+    Variable *pRight = pVariable->right;
+    Variable *pKeep = NULL;
+    Variable *pConstant = NULL;
+    int type;
+
+    switch( pVariable->operation )
+    {
+        case VA_TOFLOAT:
+            pKeep = IsFixed( pLeft, VARTYPE_FLOAT ) ? pLeft : NULL;
+            break;
+
+        case VA_TOINT:
+            pKeep = IsFixed( pLeft, VARTYPE_UINT32 ) ? pLeft : NULL;
+            break;
+
+        case VA_TOSHORT:
+            pKeep = IsFixed( pLeft, VARTYPE_UINT16 ) ? pLeft : NULL;
+            break;
+
+        case VA_MUL:
+            /* x * 1 and 1 * x */
+            type = pLeft ? ResultType( pLeft ) : -1;
+            if ( IsFixed( pLeft, type ) && IsValue( pRight, type, 1 ) )
+            {
+                pKeep = pLeft;
+                pConstant = pRight;
+            }
+            else if ( IsFixed( pRight, type ) && IsValue( pLeft, type, 1 ) )
+            {
+                pKeep = pRight;
+                pConstant = pLeft;
+            }
+            break;
+
+        case VA_DIV:
+            /* x / 1 */
+            type = pLeft ? ResultType( pLeft ) : -1;
+            if ( IsFixed( pLeft, type ) && IsValue( pRight, type, 1 ) )
+            {
+                pKeep = pLeft;
+                pConstant = pRight;
+            }
+            break;
+
+        case VA_ADD:
+        case VA_BOR:
+        case VA_XOR:
+            /* x + 0, 0 + x, x | 0, 0 | x, x ^ 0, 0 ^ x.
+             * Floats are excluded since -0.0 + 0.0 is 0.0 */
+            type = pLeft ? ResultType( pLeft ) : -1;
+            if ( type == VARTYPE_FLOAT )
+            {
+                break;
+            }
+
+            if ( IsFixed( pLeft, type ) && IsValue( pRight, type, 0 ) )
+            {
+                pKeep = pLeft;
+                pConstant = pRight;
+            }
+            else if ( IsFixed( pRight, type ) && IsValue( pLeft, type, 0 ) )
+            {
+                pKeep = pRight;
+                pConstant = pLeft;
+            }
+            break;
+
+        case VA_SUB:
+        case VA_LSHIFT:
+        case VA_RSHIFT:
+            /* x - 0, x << 0, x >> 0 */
+            type = pLeft ? ResultType( pLeft ) : -1;
+            if ( IsFixed( pLeft, type ) && IsValue( pRight, type, 0 ) )
+            {
+                pKeep = pLeft;
+                pConstant = pRight;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if ( pKeep != NULL )
+    {
+        Discard( pConstant );
+        Discard( pVariable );
+        pVariable = pKeep;
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  IsConstant                                                                */
+/*!
+    Check if a node is a numeric constant
+
+@param[in]
+    pVariable
+        pointer to the node to check (may be NULL)
+
+@retval true the node is a numeric constant
+@retval false the node is not a numeric constant
+
+==============================================================================*/
+static bool IsConstant( Variable *pVariable )
+{
+    return ( pVariable != NULL ) &&
+           ( ( pVariable->operation == VA_NUM ) ||
+             ( pVariable->operation == VA_FLOATNUM ) );
+}
+
+/*============================================================================*/
+/*  IsFixed                                                                   */
+/*!
+    Check if a node always evaluates to a numeric type
+
+    The IsFixed function checks if the type of a node after it is
+    evaluated is known, numeric, and the same as the specified type.
+
+@param[in]
+    pVariable
+        pointer to the node to check (may be NULL)
+
+@param[in]
+    type
+        the required type
+
+@retval true the node evaluates to the required type
+@retval false the node type is unknown or different
+
+==============================================================================*/
+static bool IsFixed( Variable *pVariable, int type )
+{
+    return ( pVariable != NULL ) &&
+           ( ( type == VARTYPE_UINT16 ) ||
+             ( type == VARTYPE_UINT32 ) ||
+             ( type == VARTYPE_FLOAT ) ) &&
+           ( ResultType( pVariable ) == type );
+}
+
+/*============================================================================*/
+/*  IsValue                                                                   */
+/*!
+    Check the value of a numeric constant
+
+    The IsValue function checks if a constant holds the specified value
+    when it is read as the specified type, which is how the operation
+    functions read their right hand operand.
+
+@param[in]
+    pVariable
+        pointer to the node to check (may be NULL)
+
+@param[in]
+    type
+        type used to read the constant
+
+@param[in]
+    n
+        value to compare against
+
+@retval true the constant holds the value
+@retval false the node is not a constant, or holds a different value
+
+==============================================================================*/
+static bool IsValue( Variable *pVariable, int type, uint32_t n )
+{
+    bool result = false;
+
+    if ( IsConstant( pVariable ) == true )
+    {
+        switch( type )
+        {
+            case VARTYPE_UINT16:
+                result = ( pVariable->obj.val.ui == n );
+                break;
+
+            case VARTYPE_UINT32:
+                result = ( pVariable->obj.val.ul == n );
+                break;
+
+            case VARTYPE_FLOAT:
+                result = ( pVariable->obj.val.f == (float)n );
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Discard                                                                   */
+/*!
+    Release a node removed from a tree
+
+    The Discard function releases a node which has been removed from a
+    variable tree by an optimization.  Nodes allocated from an arena are
+    released with their arena.
+
+@param[in]
+    pVariable
+        pointer to the node to release (may be NULL)
+
+==============================================================================*/
+static void Discard( Variable *pVariable )
+{
+    if ( ( pVariable != NULL ) &&
+         ( ( pVariable->flags & VF_ARENA ) == 0 ) )
+    {
+        FreeFormat( pVariable->pFormat );
+        free( pVariable );
+    }
+}
+
+/*! @}
+ * end of varoptimize group */
@@ -0,0 +1,575 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varprefetch varprefetch
+ * @brief Variable Action Script System Variable Prefetch functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varprefetch.c
+
+    Variable Action Script System Variable Prefetch functions
+
+    The Variable Action Script System Variable Prefetch functions collect
+    the distinct system variables which are read by a statement list,
+    and retrieve all of their values before the statements are evaluated.
+
+    If a batch get function has been registered with VarActionSetBatchGet()
+    the values are retrieved with a single call, otherwise each value is
+    retrieved with VAR_Get().
+
+    Prefetched variables are marked as valid so GetVar() reads the
+    snapshot instead of making another request to the variable server.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "varprefetch.h"
+#include "varprofile.h"
+#include "varstrings.h"
+#include "varcontext.h"
+#include "varvalues.h"
+#include "varlatency.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of entries allocated in a system variable list */
+#define SYSVAR_LIST_INITIAL_SIZE    ( 16 )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! multi-variable get function (may be NULL) */
+static VarBatchGetFn g_batchGet = NULL;
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionSetBatchGet                                                      */
+/*!
+    Register a multi-variable get function
+
+    The VarActionSetBatchGet function registers a function which can
+    retrieve the values of several system variables in a single request.
+    Setting the function to NULL retrieves each variable with VAR_Get().
+
+@param[in]
+    fn
+        pointer to the batch get function (may be NULL)
+
+==============================================================================*/
+void VarActionSetBatchGet( VarBatchGetFn fn )
+{
+    g_batchGet = fn;
+}
+
+/*============================================================================*/
+/*  PrefetchStatements                                                        */
+/*!
+    Prefetch the system variables used by a statement list
+
+    The PrefetchStatements function retrieves the values of all of the
+    distinct non l-value system variables which are read by the statement
+    list (including nested compound statements).  The values remain valid
+    until ReleasePrefetch() is called.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pStatements
+        pointer to the statement list
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval EOK the system variables were successfully prefetched
+
+==============================================================================*/
+int PrefetchStatements( VARSERVER_HANDLE hVarServer, Statement *pStatements )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pStatements != NULL ) )
+    {
+        ReleaseSysvars( &pContext->prefetch );
+        ResetSysvars( &pContext->prefetch );
+
+        pContext->pPrefetched = &pContext->prefetch;
+
+        result = CollectSysvars( pStatements, &pContext->prefetch );
+        if ( result == EOK )
+        {
+            result = FetchSysvars( hVarServer, &pContext->prefetch );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReleasePrefetch                                                           */
+/*!
+    Release the prefetched system variables
+
+    The ReleasePrefetch function invalidates the values fetched by
+    PrefetchStatements() so subsequent evaluations get the system
+    variables from the variable server again.
+
+==============================================================================*/
+void ReleasePrefetch( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    ReleaseSysvars( &pContext->prefetch );
+    ResetSysvars( &pContext->prefetch );
+    pContext->pPrefetched = NULL;
+}
+
+/*============================================================================*/
+/*  RefetchSysvars                                                            */
+/*!
+    Get the prefetched system variables again
+
+    The RefetchSysvars function is called after a script, which may have
+    changed any system variable, has run during an evaluation.  The
+    values prefetched for the evaluation are discarded and retrieved
+    again, so the statements after the script see the script's changes.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EOK no values were prefetched, or they were retrieved again
+@retval other error from FetchSysvars()
+
+==============================================================================*/
+int RefetchSysvars( VARSERVER_HANDLE hVarServer )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EOK;
+
+    if ( pContext->pPrefetched != NULL )
+    {
+        ReleaseSysvars( pContext->pPrefetched );
+        result = FetchSysvars( hVarServer, pContext->pPrefetched );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResetSysvars                                                              */
+/*!
+    Start a new system variable collection
+
+    The ResetSysvars function empties a system variable list so a new
+    set of variables can be collected into it.
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+==============================================================================*/
+void ResetSysvars( SysvarList *pList )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pList != NULL )
+    {
+        pList->n = 0;
+
+        /* variables marked in a previous collection are no longer
+         * considered to be in the list */
+        if ( ++pContext->generation == 0 )
+        {
+            pContext->generation = 1;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  CollectSysvars                                                            */
+/*!
+    Collect the system variables used by a statement list
+
+    The CollectSysvars function adds the distinct non l-value system
+    variables used by each statement in the statement list to the
+    system variable list.  The then and else compound statements of IF
+    statements are included.
+
+@param[in]
+    pStatements
+        pointer to the statement list (may be NULL)
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+@retval ENOMEM memory allocation failure
+@retval EOK the system variables were successfully collected
+
+==============================================================================*/
+int CollectSysvars( Statement *pStatements, SysvarList *pList )
+{
+    int result = EOK;
+    Statement *pStatement = pStatements;
+
+    while ( ( pStatement != NULL ) && ( result == EOK ) )
+    {
+        result = CollectSysvarsFromVariable( pStatement->pVariable, pList );
+        pStatement = pStatement->pNext;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CollectSysvarsFromVariable                                                */
+/*!
+    Collect the system variables used by a variable tree
+
+    The CollectSysvarsFromVariable function adds the distinct non l-value
+    system variables in the variable tree to the system variable list.
+
+@param[in]
+    pVariable
+        pointer to the variable tree (may be NULL)
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+@retval ENOMEM memory allocation failure
+@retval EOK the system variables were successfully collected
+
+==============================================================================*/
+int CollectSysvarsFromVariable( Variable *pVariable, SysvarList *pList )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EOK;
+
+    if ( pVariable != NULL )
+    {
+        switch( pVariable->operation )
+        {
+            case VA_SYSVAR:
+                if ( ( pVariable->lvalue == false ) &&
+                     ( pVariable->hVar != VAR_INVALID ) &&
+                     ( pVariable->mark != pContext->generation ) )
+                {
+                    pVariable->mark = pContext->generation;
+                    result = AddSysvar( pList, pVariable );
+                }
+                break;
+
+            case VA_ELSE:
+                /* the ELSE node references the then and else
+                 * compound statements */
+                result = CollectSysvars( (Statement *)pVariable->left, pList );
+                if ( result == EOK )
+                {
+                    result = CollectSysvars( (Statement *)pVariable->right,
+                                             pList );
+                }
+                break;
+
+            default:
+                result = CollectSysvarsFromVariable( pVariable->left, pList );
+                if ( result == EOK )
+                {
+                    result = CollectSysvarsFromVariable( pVariable->right,
+                                                         pList );
+                }
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FetchSysvars                                                              */
+/*!
+    Fetch the values of the variables in a system variable list
+
+    The FetchSysvars function retrieves the values of the variables in
+    the system variable list using the batch get function if one is
+    registered, falling back to VAR_Get() for each variable.
+    Variables bound to the shared value region are read from it instead.
+    Variables which are already valid are not retrieved again.
+    Variables which could not be retrieved are left invalid so they
+    are retrieved (and their errors reported) when they are used.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+@retval EINVAL invalid argument
+@retval EOK the values were retrieved
+@retval other error from the last variable which could not be retrieved
+
+==============================================================================*/
+int FetchSysvars( VARSERVER_HANDLE hVarServer, SysvarList *pList )
+{
+    int result = EINVAL;
+    Variable *pVariable;
+    uint64_t start;
+    size_t i;
+    size_t n = 0;
+    int rc;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pList != NULL ) )
+    {
+        result = EOK;
+
+        /* build the request from the variables which are not valid */
+        for ( i = 0; i < pList->n; i++ )
+        {
+            pVariable = pList->ppVars[i];
+            if ( ( pVariable->valid == false ) &&
+                 ( pVariable->flags & VF_SHM_VALUE ) &&
+                 ( ReadSharedValue( pVariable ) == EOK ) )
+            {
+                /* read from the shared value region without a request */
+                pVariable->valid = true;
+            }
+            else if ( pVariable->valid == false )
+            {
+                /* string values are referenced from the variable server */
+                ReleaseString( pVariable );
+                pList->phVars[n] = pVariable->hVar;
+                pList->ppObjs[n] = &(pVariable->obj);
+                n++;
+            }
+        }
+
+        start = LatencyStart();
+        if ( ( n > 0 ) &&
+             ( g_batchGet != NULL ) &&
+             ( g_batchGet( hVarServer, pList->phVars, pList->ppObjs, n )
+                == EOK ) )
+        {
+            LatencyRequest( VA_LATENCY_GET, start );
+            ProfileGets( 1 );
+            for ( i = 0; i < pList->n; i++ )
+            {
+                if ( pList->ppVars[i]->valid == false )
+                {
+                    ReferenceString( pList->ppVars[i] );
+                    pList->ppVars[i]->valid = true;
+                }
+            }
+        }
+        else if ( n > 0 )
+        {
+            /* fall back to one request per variable */
+            for ( i = 0; i < pList->n; i++ )
+            {
+                pVariable = pList->ppVars[i];
+                if ( pVariable->valid == false )
+                {
+                    start = LatencyStart();
+                    rc = VAR_Get( hVarServer,
+                                  pVariable->hVar,
+                                  &(pVariable->obj) );
+                    LatencyRequest( VA_LATENCY_GET, start );
+                    ProfileGets( 1 );
+                    if ( rc == EOK )
+                    {
+                        ReferenceString( pVariable );
+                        pVariable->valid = true;
+                    }
+                    else
+                    {
+                        result = rc;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReleaseSysvars                                                            */
+/*!
+    Invalidate the variables in a system variable list
+
+    The ReleaseSysvars function marks each variable in the system variable
+    list as invalid so it is retrieved from the variable server the next
+    time it is used.  When the VA_OPT_CACHE option is set, variables with
+    modified notifications keep their values.
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+==============================================================================*/
+void ReleaseSysvars( SysvarList *pList )
+{
+    size_t i;
+    bool cache;
+
+    if ( pList != NULL )
+    {
+        cache = ( VarActionGetOptions() & VA_OPT_CACHE ) ? true : false;
+
+        for ( i = 0; i < pList->n; i++ )
+        {
+            /* cached values remain valid until they are modified */
+            if ( ( cache == false ) ||
+                 ( pList->ppVars[i]->modifiedNotification == false ) )
+            {
+                pList->ppVars[i]->valid = false;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  FreeSysvars                                                               */
+/*!
+    Free a system variable list
+
+    The FreeSysvars function releases the memory used by a system
+    variable list.  The variables in the list are not affected.
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+==============================================================================*/
+void FreeSysvars( SysvarList *pList )
+{
+    if ( pList != NULL )
+    {
+        free( pList->ppVars );
+        free( pList->phVars );
+        free( pList->ppObjs );
+        memset( pList, 0, sizeof( SysvarList ) );
+    }
+}
+
+/*============================================================================*/
+/*  AddSysvar                                                                 */
+/*!
+    Add a variable to a system variable list
+
+    The AddSysvar function appends a variable to the system variable list,
+    growing the list if required.
+
+@param[in]
+    pList
+        pointer to the system variable list
+
+@param[in]
+    pVariable
+        pointer to the variable to add
+
+@retval ENOMEM memory allocation failure
+@retval EOK the variable was successfully added
+
+==============================================================================*/
+int AddSysvar( SysvarList *pList, Variable *pVariable )
+{
+    int result = EOK;
+    size_t size;
+    Variable **ppVars;
+    VAR_HANDLE *phVars;
+    VarObject **ppObjs;
+
+    if ( pList->n >= pList->size )
+    {
+        size = ( pList->size == 0 ) ? SYSVAR_LIST_INITIAL_SIZE
+                                    : pList->size * 2;
+
+        ppVars = realloc( pList->ppVars, size * sizeof( Variable * ) );
+        if ( ppVars != NULL )
+        {
+            pList->ppVars = ppVars;
+        }
+
+        phVars = realloc( pList->phVars, size * sizeof( VAR_HANDLE ) );
+        if ( phVars != NULL )
+        {
+            pList->phVars = phVars;
+        }
+
+        ppObjs = realloc( pList->ppObjs, size * sizeof( VarObject * ) );
+        if ( ppObjs != NULL )
+        {
+            pList->ppObjs = ppObjs;
+        }
+
+        if ( ( ppVars != NULL ) &&
+             ( phVars != NULL ) &&
+             ( ppObjs != NULL ) )
+        {
+            pList->size = size;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pList->ppVars[pList->n++] = pVariable;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of varprefetch group */
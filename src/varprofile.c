@@ -0,0 +1,558 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varprofile varprofile
+ * @brief Variable Action Script Evaluation Profiler functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varprofile.c
+
+    Variable Action Script Evaluation Profiler functions
+
+    The Variable Action Script Evaluation Profiler functions record
+    evaluation statistics while the VA_OPT_PROFILE option is set.
+
+    For each operation, the call count, the cumulative and maximum
+    time spent in the operation function (excluding the evaluation of
+    its operands), and the number of variable server get and set
+    requests it made are recorded.
+
+    The same statistics are recorded for each statement, keyed by the
+    statement line number.  Statement times include any nested
+    statements.
+
+    The statistics can be read with VarActionGetOperationProfile() and
+    VarActionGetStatementProfile(), or written as a text report with
+    VarActionPrintProfile(), for example from a variable server print
+    handler.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include <time.h>
+#include "varops.h"
+#include "varprofile.h"
+#include "varcontext.h"
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static void Record( VarProfileStats *pStats, ProfileMark *pMark );
+static void Merge( VarProfileStats *pStats, VarProfileStats *pSource );
+static VarProfileStats *StatementStats( VarActionContext *pContext,
+                                        int lineno );
+static void PrintStats( int fd, const char *name, VarProfileStats *pStats );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  ProfileStart                                                              */
+/*!
+    Start profiling an operation or statement
+
+    The ProfileStart function records the current time and request
+    counters at the start of a profiled operation or statement.
+
+@param[out]
+    pMark
+        pointer to the mark to initialize
+
+==============================================================================*/
+void ProfileStart( ProfileMark *pMark )
+{
+    VarActionContext *pContext = GetContext();
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    pMark->ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    pMark->gets = pContext->gets;
+    pMark->sets = pContext->sets;
+}
+
+/*============================================================================*/
+/*  ProfileOperation                                                          */
+/*!
+    Record the statistics for an operation
+
+    The ProfileOperation function adds the time and requests since the
+    mark was taken to the statistics for the specified operation.
+
+@param[in]
+    op
+        operation identifier
+
+@param[in]
+    pMark
+        pointer to the mark taken with ProfileStart()
+
+==============================================================================*/
+void ProfileOperation( int op, ProfileMark *pMark )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( ( op >= 0 ) && ( op < VA_OP_MAX ) )
+    {
+        Record( &pContext->operations[op], pMark );
+    }
+}
+
+/*============================================================================*/
+/*  ProfileStatement                                                          */
+/*!
+    Record the statistics for a statement
+
+    The ProfileStatement function adds the time and requests since the
+    mark was taken to the statistics for the specified line number.
+
+@param[in]
+    lineno
+        statement line number
+
+@param[in]
+    pMark
+        pointer to the mark taken with ProfileStart()
+
+==============================================================================*/
+void ProfileStatement( int lineno, ProfileMark *pMark )
+{
+    VarProfileStats *pStats;
+
+    pStats = StatementStats( GetContext(), lineno );
+    if ( pStats != NULL )
+    {
+        Record( pStats, pMark );
+    }
+}
+
+/*============================================================================*/
+/*  ProfileMerge                                                              */
+/*!
+    Merge the profile statistics of one context into another
+
+    The ProfileMerge function adds the operation and statement statistics
+    collected in the source context to the destination context, and
+    clears the statistics of the source context.
+
+@param[in]
+    pContext
+        pointer to the context to merge the statistics into
+
+@param[in]
+    pSource
+        pointer to the context to merge the statistics from
+
+==============================================================================*/
+void ProfileMerge( VarActionContext *pContext, VarActionContext *pSource )
+{
+    VarProfileStats *pStats;
+    size_t i;
+
+    if ( ( pContext != NULL ) &&
+         ( pSource != NULL ) &&
+         ( pContext != pSource ) )
+    {
+        for ( i = 0; i < VA_OP_MAX; i++ )
+        {
+            Merge( &pContext->operations[i], &pSource->operations[i] );
+        }
+
+        for ( i = 0; i < pSource->nStatements; i++ )
+        {
+            if ( pSource->pStatements[i].calls > 0 )
+            {
+                pStats = StatementStats( pContext, (int)i );
+                if ( pStats != NULL )
+                {
+                    Merge( pStats, &pSource->pStatements[i] );
+                }
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  ProfileGets                                                               */
+/*!
+    Count variable server get requests
+
+@param[in]
+    n
+        number of requests made
+
+==============================================================================*/
+void ProfileGets( size_t n )
+{
+    VarActionContext *pContext = GetContext();
+
+    pContext->gets += n;
+}
+
+/*============================================================================*/
+/*  ProfileSets                                                               */
+/*!
+    Count variable server set requests
+
+@param[in]
+    n
+        number of requests made
+
+==============================================================================*/
+void ProfileSets( size_t n )
+{
+    VarActionContext *pContext = GetContext();
+
+    pContext->sets += n;
+}
+
+/*============================================================================*/
+/*  VarActionGetOperationProfile                                              */
+/*!
+    Get the profile statistics for an operation
+
+@param[in]
+    op
+        operation identifier
+
+@param[out]
+    pStats
+        pointer to the statistics to populate
+
+@retval EINVAL invalid argument
+@retval EOK the statistics were retrieved
+
+==============================================================================*/
+int VarActionGetOperationProfile( int op, VarProfileStats *pStats )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+
+    if ( ( op >= 0 ) &&
+         ( op < VA_OP_MAX ) &&
+         ( pStats != NULL ) )
+    {
+        *pStats = pContext->operations[op];
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionGetStatementProfile                                              */
+/*!
+    Get the profile statistics for the statements on a line
+
+@param[in]
+    lineno
+        statement line number
+
+@param[out]
+    pStats
+        pointer to the statistics to populate
+
+@retval EINVAL invalid argument
+@retval ENOENT no statement on the line has been profiled
+@retval EOK the statistics were retrieved
+
+==============================================================================*/
+int VarActionGetStatementProfile( int lineno, VarProfileStats *pStats )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+
+    if ( ( lineno >= 0 ) &&
+         ( pStats != NULL ) )
+    {
+        if ( ( (size_t)lineno < pContext->nStatements ) &&
+             ( pContext->pStatements[lineno].calls > 0 ) )
+        {
+            *pStats = pContext->pStatements[lineno];
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionResetProfile                                                     */
+/*!
+    Reset the profile statistics
+
+    The VarActionResetProfile function clears all of the operation
+    and statement statistics.
+
+==============================================================================*/
+void VarActionResetProfile( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    memset( pContext->operations, 0, sizeof( pContext->operations ) );
+
+    if ( pContext->pStatements != NULL )
+    {
+        memset( pContext->pStatements,
+                0,
+                pContext->nStatements * sizeof( VarProfileStats ) );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionPrintProfile                                                     */
+/*!
+    Write a profile report
+
+    The VarActionPrintProfile function writes a text report of the
+    statistics for each operation and statement which has been
+    profiled to the specified file descriptor.
+
+@param[in]
+    fd
+        output file descriptor
+
+@retval EINVAL invalid argument
+@retval EOK the report was written
+
+==============================================================================*/
+int VarActionPrintProfile( int fd )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    char name[32];
+    size_t i;
+
+    if ( fd >= 0 )
+    {
+        dprintf( fd,
+                 "%-16s %12s %14s %12s %10s %10s %10s\n",
+                 "name", "calls", "total_ns", "max_ns", "avg_ns",
+                 "gets", "sets" );
+
+        for ( i = 0; i < VA_OP_MAX; i++ )
+        {
+            PrintStats( fd, GetOperationName( i ), &pContext->operations[i] );
+        }
+
+        for ( i = 0; i < pContext->nStatements; i++ )
+        {
+            snprintf( name, sizeof( name ), "line %zu", i );
+            PrintStats( fd, name, &pContext->pStatements[i] );
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Record                                                                    */
+/*!
+    Add a measurement to a statistics record
+
+@param[in]
+    pStats
+        pointer to the statistics to update
+
+@param[in]
+    pMark
+        pointer to the mark taken at the start of the measurement
+
+==============================================================================*/
+static void Record( VarProfileStats *pStats, ProfileMark *pMark )
+{
+    ProfileMark now;
+    uint64_t ns;
+
+    ProfileStart( &now );
+
+    ns = now.ns - pMark->ns;
+
+    pStats->calls++;
+    pStats->totalns += ns;
+    if ( ns > pStats->maxns )
+    {
+        pStats->maxns = ns;
+    }
+
+    pStats->gets += now.gets - pMark->gets;
+    pStats->sets += now.sets - pMark->sets;
+}
+
+/*============================================================================*/
+/*  Merge                                                                     */
+/*!
+    Merge a statistics record into another
+
+    The Merge function adds the source statistics to the destination
+    statistics and clears the source statistics.
+
+@param[in]
+    pStats
+        pointer to the statistics to merge into
+
+@param[in]
+    pSource
+        pointer to the statistics to merge from
+
+==============================================================================*/
+static void Merge( VarProfileStats *pStats, VarProfileStats *pSource )
+{
+    pStats->calls += pSource->calls;
+    pStats->totalns += pSource->totalns;
+    if ( pSource->maxns > pStats->maxns )
+    {
+        pStats->maxns = pSource->maxns;
+    }
+
+    pStats->gets += pSource->gets;
+    pStats->sets += pSource->sets;
+
+    memset( pSource, 0, sizeof( VarProfileStats ) );
+}
+
+/*============================================================================*/
+/*  StatementStats                                                            */
+/*!
+    Get the statistics record for a statement line
+
+    The StatementStats function gets the statistics record for the
+    specified line number, growing the line table of the context
+    if required.
+
+@param[in]
+    pContext
+        pointer to the context
+
+@param[in]
+    lineno
+        statement line number
+
+@retval pointer to the statistics for the line
+@retval NULL if the line table could not be grown
+
+==============================================================================*/
+static VarProfileStats *StatementStats( VarActionContext *pContext,
+                                        int lineno )
+{
+    VarProfileStats *pStats = NULL;
+    VarProfileStats *pStatements;
+    size_t n;
+
+    if ( lineno >= 0 )
+    {
+        if ( (size_t)lineno >= pContext->nStatements )
+        {
+            /* grow the line table */
+            n = ( pContext->nStatements == 0 ) ? 256 : pContext->nStatements;
+            while ( n <= (size_t)lineno )
+            {
+                n *= 2;
+            }
+
+            pStatements = realloc( pContext->pStatements,
+                                   n * sizeof( VarProfileStats ) );
+            if ( pStatements != NULL )
+            {
+                memset( &pStatements[pContext->nStatements],
+                        0,
+                        ( n - pContext->nStatements ) *
+                            sizeof( VarProfileStats ) );
+                pContext->pStatements = pStatements;
+                pContext->nStatements = n;
+            }
+        }
+
+        if ( (size_t)lineno < pContext->nStatements )
+        {
+            pStats = &pContext->pStatements[lineno];
+        }
+    }
+
+    return pStats;
+}
+
+/*============================================================================*/
+/*  PrintStats                                                                */
+/*!
+    Write a line of the profile report
+
+    The PrintStats function writes a line of the profile report for
+    a statistics record which has been called at least once.
+
+@param[in]
+    fd
+        output file descriptor
+
+@param[in]
+    name
+        name of the operation or statement
+
+@param[in]
+    pStats
+        pointer to the statistics to write
+
+==============================================================================*/
+static void PrintStats( int fd, const char *name, VarProfileStats *pStats )
+{
+    if ( pStats->calls > 0 )
+    {
+        dprintf( fd,
+                 "%-16s %12llu %14llu %12llu %10llu %10llu %10llu\n",
+                 name ? name : "unknown",
+                 (unsigned long long)pStats->calls,
+                 (unsigned long long)pStats->totalns,
+                 (unsigned long long)pStats->maxns,
+                 (unsigned long long)( pStats->totalns / pStats->calls ),
+                 (unsigned long long)pStats->gets,
+                 (unsigned long long)pStats->sets );
+    }
+}
+
+/*! @}
+ * end of varprofile group */
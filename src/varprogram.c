@@ -0,0 +1,1546 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varprogram varprogram
+ * @brief Variable Action Script Program Compilation functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varprogram.c
+
+    Variable Action Script Program Compilation functions
+
+    The Variable Action Script Program Compilation functions flatten
+    a statement list and its variable trees into a contiguous array
+    of instructions which is executed by a simple dispatch loop.
+
+    Each tree node is assigned a register slot which refers to the
+    node, and each instruction references its result and operand
+    registers by index.  Operations on numeric types whose operand types
+    can be determined at compile time are executed inline, all other
+    operations call the same operation function as ProcessExpr().
+
+    IF/ELSE statements are compiled into conditional jumps so the
+    then/else compound statements are part of the same instruction array.
+
+    The distinct system variables read by the program are recorded when
+    it is compiled, so when the VA_OPT_PREFETCH option is set they can all
+    be retrieved before the program runs.
+
+    When the program is compiled with the VA_OPT_SHORT_CIRCUIT option
+    set, logical AND and OR operations jump over their right operand
+    when the left operand decides the result.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include <varaction/varaction.h>
+#include "varops.h"
+#include "varprogram.h"
+#include "varprefetch.h"
+#include "varresolve.h"
+#include "varwrite.h"
+#include "varcse.h"
+#include "varlatency.h"
+#include "varcontext.h"
+#ifdef VARACTION_JIT
+#include "varjit.h"
+#endif
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! use computed goto dispatch where the compiler supports it */
+#if defined(__GNUC__)
+#define VP_COMPUTED_GOTO
+#endif
+
+/*! initial number of instructions allocated for a program */
+#define VP_INITIAL_CODE_SIZE    ( 32 )
+
+/*! initial number of registers allocated for a program */
+#define VP_INITIAL_REG_SIZE     ( 32 )
+
+/*! default number of executions before a program is compiled to
+ *  native code */
+#define VP_JIT_THRESHOLD        ( 1000 )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! number of executions before a program is compiled to native code */
+static uint32_t jitThreshold = VP_JIT_THRESHOLD;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int CompileStatements( VarProgram *pProgram, Statement *pStatements );
+static int CompileOne( VarProgram *pProgram, Statement *pStatement );
+static int CompileIF( VarProgram *pProgram, Variable *pVariable );
+static int CompileSwitch( VarProgram *pProgram, VarSwitch *pSwitch );
+static int CompileExpr( VarProgram *pProgram,
+                        Variable *pVariable,
+                        uint32_t flags,
+                        uint32_t *pReg );
+static int CompileLogical( VarProgram *pProgram,
+                           Variable *pVariable,
+                           uint32_t flags,
+                           uint32_t *pReg );
+static bool IsCompilable( Variable *pVariable );
+static int SelectOpcode( Variable *pVariable );
+static int AddRegister( VarProgram *pProgram,
+                        Variable *pVariable,
+                        uint32_t *pReg );
+static int Emit( VarProgram *pProgram,
+                 VarInstruction *pInstruction,
+                 uint32_t *pIndex );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CompileStatement                                                          */
+/*!
+    Compile a statement list into a program
+
+    The CompileStatement function compiles a statement list (and all of the
+    compound statements nested within it) into a flat instruction array
+    which can be executed with ExecProgram().
+
+    Operation functions are bound when the program is compiled, so
+    InitVarAction() must have been called before compiling.
+
+    Statements which cannot be compiled are executed through
+    ProcessStatement() when the program is run.
+
+@param[in]
+    pStatements
+        pointer to the statement list to compile
+
+@retval pointer to the compiled program
+@retval NULL if the program could not be compiled
+
+==============================================================================*/
+VarProgram *CompileStatement( Statement *pStatements )
+{
+    VarProgram *pProgram = NULL;
+    VarInstruction end;
+    uint32_t reg;
+    int rc = ENOMEM;
+
+    if ( pStatements != NULL )
+    {
+        pProgram = calloc( 1, sizeof( VarProgram ) );
+        if ( pProgram != NULL )
+        {
+            /* reserve register zero for NULL operands */
+            rc = AddRegister( pProgram, NULL, &reg );
+            if ( rc == EOK )
+            {
+                rc = CompileStatements( pProgram, pStatements );
+            }
+
+            if ( rc == EOK )
+            {
+                ResetSysvars( &pProgram->sysvars );
+                rc = CollectSysvars( pStatements, &pProgram->sysvars );
+            }
+
+            if ( rc == EOK )
+            {
+                memset( &end, 0, sizeof( VarInstruction ) );
+                end.opcode = VP_END;
+                rc = Emit( pProgram, &end, NULL );
+            }
+
+            if ( rc != EOK )
+            {
+                FreeProgram( pProgram );
+                pProgram = NULL;
+            }
+        }
+    }
+
+    return pProgram;
+}
+
+/*============================================================================*/
+/*  FreeProgram                                                               */
+/*!
+    Free a compiled program
+
+    The FreeProgram function releases the memory used by a compiled
+    program.  The statements and variables it was compiled from are
+    not affected.
+
+@param[in]
+    pProgram
+        pointer to the program to free
+
+==============================================================================*/
+void FreeProgram( VarProgram *pProgram )
+{
+    if ( pProgram != NULL )
+    {
+#ifdef VARACTION_JIT
+        JitFree( pProgram->pNative );
+#endif
+        while ( pProgram->nswitches > 0 )
+        {
+            FreeSwitch( pProgram->ppSwitches[--pProgram->nswitches] );
+        }
+
+        free( pProgram->ppSwitches );
+        free( pProgram->pCode );
+        free( pProgram->pRegs );
+        FreeSysvars( &pProgram->sysvars );
+        free( pProgram );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionSetJitThreshold                                                  */
+/*!
+    Set the native code threshold
+
+    The VarActionSetJitThreshold function sets the number of times a
+    program is executed by the interpreter before it is compiled to
+    native code.  Programs which have already been compiled are not
+    affected.  The threshold has no effect unless the library was built
+    with VARACTION_JIT.
+
+@param[in]
+    count
+        number of executions before compiling, or 0 to disable
+        native code
+
+==============================================================================*/
+void VarActionSetJitThreshold( uint32_t count )
+{
+    jitThreshold = count;
+}
+
+/*============================================================================*/
+/*  ExecProgram                                                               */
+/*!
+    Execute a compiled program
+
+    The ExecProgram function executes a program created by
+    CompileStatement().  It produces the same results as calling
+    ProcessCompoundStatement() on the statement list the program was
+    compiled from.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pProgram
+        pointer to the program to execute
+
+@retval EINVAL invalid argument
+@retval EOK the program was successfully executed
+@retval other error from the last statement which failed
+
+==============================================================================*/
+int ExecProgram( VARSERVER_HANDLE hVarServer, VarProgram *pProgram )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    int rc;
+    VarInstruction *code;
+    VarInstruction *pc;
+    Variable **regs;
+    Variable *pDst;
+    Variable *pL;
+    Variable *pR;
+    VarSwitch *pSwitch;
+    bool outer;
+    bool prefetch;
+    bool defer;
+
+#ifdef VP_COMPUTED_GOTO
+    static void *labels[VP_OPCODE_MAX] = {
+        [VP_END] = &&L_VP_END,
+        [VP_CALL] = &&L_VP_CALL,
+        [VP_JMP] = &&L_VP_JMP,
+        [VP_JMPF] = &&L_VP_JMPF,
+        [VP_SWITCH] = &&L_VP_SWITCH,
+        [VP_STATEMENT] = &&L_VP_STATEMENT,
+        [VP_SCRIPT] = &&L_VP_SCRIPT,
+        [VP_AND_SC] = &&L_VP_AND_SC,
+        [VP_OR_SC] = &&L_VP_OR_SC,
+        [VP_ASSIGN_U16] = &&L_VP_ASSIGN_U16,
+        [VP_ASSIGN_U32] = &&L_VP_ASSIGN_U32,
+        [VP_ASSIGN_F] = &&L_VP_ASSIGN_F,
+        [VP_ADD_U16] = &&L_VP_ADD_U16,
+        [VP_ADD_U32] = &&L_VP_ADD_U32,
+        [VP_ADD_F] = &&L_VP_ADD_F,
+        [VP_SUB_U16] = &&L_VP_SUB_U16,
+        [VP_SUB_U32] = &&L_VP_SUB_U32,
+        [VP_SUB_F] = &&L_VP_SUB_F,
+        [VP_MUL_U16] = &&L_VP_MUL_U16,
+        [VP_MUL_U32] = &&L_VP_MUL_U32,
+        [VP_MUL_F] = &&L_VP_MUL_F,
+        [VP_BAND_U16] = &&L_VP_BAND_U16,
+        [VP_BAND_U32] = &&L_VP_BAND_U32,
+        [VP_BOR_U16] = &&L_VP_BOR_U16,
+        [VP_BOR_U32] = &&L_VP_BOR_U32,
+        [VP_XOR_U16] = &&L_VP_XOR_U16,
+        [VP_XOR_U32] = &&L_VP_XOR_U32,
+        [VP_EQ_U16] = &&L_VP_EQ_U16,
+        [VP_EQ_U32] = &&L_VP_EQ_U32,
+        [VP_EQ_F] = &&L_VP_EQ_F,
+        [VP_GT_U16] = &&L_VP_GT_U16,
+        [VP_GT_U32] = &&L_VP_GT_U32,
+        [VP_GT_F] = &&L_VP_GT_F,
+        [VP_LT_U16] = &&L_VP_LT_U16,
+        [VP_LT_U32] = &&L_VP_LT_U32,
+        [VP_LT_F] = &&L_VP_LT_F,
+        [VP_GTE_U16] = &&L_VP_GTE_U16,
+        [VP_GTE_U32] = &&L_VP_GTE_U32,
+        [VP_GTE_F] = &&L_VP_GTE_F,
+        [VP_LTE_U16] = &&L_VP_LTE_U16,
+        [VP_LTE_U32] = &&L_VP_LTE_U32,
+        [VP_LTE_F] = &&L_VP_LTE_F
+    };
+
+    #define VP_CASE(x)      L_##x
+    #define VP_DISPATCH()   goto *labels[pc->opcode]
+#else
+    #define VP_CASE(x)      case x
+    #define VP_DISPATCH()   goto dispatch
+#endif
+
+    /* result = left <op> right, typed for the result */
+    #define VP_ARITH( field, vtype, ctype, oper ) \
+        pDst = regs[pc->dst]; \
+        pL = regs[pc->a]; \
+        pR = regs[pc->b]; \
+        pDst->obj.val.field = pL->obj.val.field oper pR->obj.val.field; \
+        pDst->obj.type = vtype; \
+        pDst->obj.len = sizeof(ctype); \
+        pc++; \
+        VP_DISPATCH()
+
+    /* result = ( left <op> right ), stored in a 16-bit value */
+    #define VP_COMPARE( field, oper ) \
+        pDst = regs[pc->dst]; \
+        pL = regs[pc->a]; \
+        pR = regs[pc->b]; \
+        pDst->obj.val.ui = ( pL->obj.val.field oper pR->obj.val.field ); \
+        pDst->obj.type = VARTYPE_UINT16; \
+        pDst->obj.len = sizeof(uint16_t); \
+        pc++; \
+        VP_DISPATCH()
+
+    /* result <= left <= right */
+    #define VP_ASSIGN( field, vtype, ctype ) \
+        pDst = regs[pc->dst]; \
+        pL = regs[pc->a]; \
+        pR = regs[pc->b]; \
+        pDst->obj.val.field = pL->obj.val.field = pR->obj.val.field; \
+        pDst->obj.type = vtype; \
+        pDst->obj.len = sizeof(ctype); \
+        pc++; \
+        VP_DISPATCH()
+
+    if ( ( hVarServer != NULL ) &&
+         ( pProgram != NULL ) &&
+         ( pProgram->pCode != NULL ) )
+    {
+        result = EOK;
+        code = pProgram->pCode;
+        regs = pProgram->pRegs;
+        pc = code;
+
+        ResolvePending( hVarServer, NULL );
+
+        outer = EnterCompound();
+
+        /* inline instructions write variables without stamping them */
+        SuspendShared();
+
+        prefetch = outer && ( VarActionGetOptions() & VA_OPT_PREFETCH );
+        if ( prefetch == true )
+        {
+            (void)FetchSysvars( hVarServer, &pProgram->sysvars );
+            pContext->pPrefetched = &pProgram->sysvars;
+        }
+
+        defer = outer && ( VarActionGetOptions() & VA_OPT_DEFER_WRITES );
+        if ( defer == true )
+        {
+            BeginWrites();
+        }
+
+#ifdef VARACTION_JIT
+        if ( ( pProgram->pNative == NULL ) &&
+             ( jitThreshold > 0 ) &&
+             ( pProgram->runs < jitThreshold ) )
+        {
+            /* compile once, so a failure is not retried */
+            if ( ++pProgram->runs == jitThreshold )
+            {
+                pProgram->pNative = JitCompile( pProgram );
+            }
+        }
+
+        if ( pProgram->pNative != NULL )
+        {
+            result = JitExec( pProgram->pNative, hVarServer );
+
+            /* finish through the interpreter's VP_END */
+            pc = &code[pProgram->ncode - 1];
+        }
+#endif
+
+#ifdef VP_COMPUTED_GOTO
+        VP_DISPATCH();
+#else
+dispatch:
+        switch( pc->opcode )
+        {
+#endif
+        VP_CASE(VP_CALL):
+            rc = pc->fn( hVarServer,
+                         regs[pc->dst],
+                         regs[pc->a],
+                         regs[pc->b] );
+            if ( rc != EOK )
+            {
+                ReportProgramError( pc, rc );
+
+                if ( pc->flags & ( VI_ROOT | VI_COND ) )
+                {
+                    /* a failed IF condition fails its statement,
+                     * as in ProcessIF() */
+                    result = rc;
+                }
+
+                if ( pc->flags & VI_COND )
+                {
+                    /* a failed IF condition skips both blocks */
+                    pc = &code[pc->target];
+                    VP_DISPATCH();
+                }
+            }
+            pc++;
+            VP_DISPATCH();
+
+        VP_CASE(VP_JMP):
+            pc = &code[pc->target];
+            VP_DISPATCH();
+
+        VP_CASE(VP_JMPF):
+            if ( regs[pc->a]->obj.val.ui == 0 )
+            {
+                pc = &code[pc->target];
+            }
+            else
+            {
+                pc++;
+            }
+            VP_DISPATCH();
+
+        VP_CASE(VP_SWITCH):
+            pSwitch = pProgram->ppSwitches[pc->b];
+            pc = &code[pSwitch->pTargets[SelectCase( hVarServer, pSwitch )]];
+            VP_DISPATCH();
+
+        VP_CASE(VP_STATEMENT):
+            rc = ProcessStatement( hVarServer, pc->pStatement );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+            pc++;
+            VP_DISPATCH();
+
+        VP_CASE(VP_SCRIPT):
+            /* publishes deferred writes and refetches around the script */
+            rc = ProcessStatement( hVarServer, pc->pStatement );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+            pc++;
+            VP_DISPATCH();
+
+        VP_CASE(VP_AND_SC):
+        VP_CASE(VP_OR_SC):
+            if ( ShortCircuit( regs[pc->dst], regs[pc->a] ) == true )
+            {
+                /* skip the right operand and the operation */
+                pc = &code[pc->target];
+            }
+            else
+            {
+                pc++;
+            }
+            VP_DISPATCH();
+
+        VP_CASE(VP_ASSIGN_U16):
+            VP_ASSIGN( ui, VARTYPE_UINT16, uint16_t );
+
+        VP_CASE(VP_ASSIGN_U32):
+            VP_ASSIGN( ul, VARTYPE_UINT32, uint32_t );
+
+        VP_CASE(VP_ASSIGN_F):
+            VP_ASSIGN( f, VARTYPE_FLOAT, float );
+
+        VP_CASE(VP_ADD_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, + );
+
+        VP_CASE(VP_ADD_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, + );
+
+        VP_CASE(VP_ADD_F):
+            VP_ARITH( f, VARTYPE_FLOAT, float, + );
+
+        VP_CASE(VP_SUB_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, - );
+
+        VP_CASE(VP_SUB_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, - );
+
+        VP_CASE(VP_SUB_F):
+            VP_ARITH( f, VARTYPE_FLOAT, float, - );
+
+        VP_CASE(VP_MUL_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, * );
+
+        VP_CASE(VP_MUL_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, * );
+
+        VP_CASE(VP_MUL_F):
+            VP_ARITH( f, VARTYPE_FLOAT, float, * );
+
+        VP_CASE(VP_BAND_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, & );
+
+        VP_CASE(VP_BAND_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, & );
+
+        VP_CASE(VP_BOR_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, | );
+
+        VP_CASE(VP_BOR_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, | );
+
+        VP_CASE(VP_XOR_U16):
+            VP_ARITH( ui, VARTYPE_UINT16, uint16_t, ^ );
+
+        VP_CASE(VP_XOR_U32):
+            VP_ARITH( ul, VARTYPE_UINT32, uint32_t, ^ );
+
+        VP_CASE(VP_EQ_U16):
+            VP_COMPARE( ui, == );
+
+        VP_CASE(VP_EQ_U32):
+            VP_COMPARE( ul, == );
+
+        VP_CASE(VP_EQ_F):
+            VP_COMPARE( f, == );
+
+        VP_CASE(VP_GT_U16):
+            VP_COMPARE( ui, > );
+
+        VP_CASE(VP_GT_U32):
+            VP_COMPARE( ul, > );
+
+        VP_CASE(VP_GT_F):
+            VP_COMPARE( f, > );
+
+        VP_CASE(VP_LT_U16):
+            VP_COMPARE( ui, < );
+
+        VP_CASE(VP_LT_U32):
+            VP_COMPARE( ul, < );
+
+        VP_CASE(VP_LT_F):
+            VP_COMPARE( f, < );
+
+        VP_CASE(VP_GTE_U16):
+            VP_COMPARE( ui, >= );
+
+        VP_CASE(VP_GTE_U32):
+            VP_COMPARE( ul, >= );
+
+        VP_CASE(VP_GTE_F):
+            VP_COMPARE( f, >= );
+
+        VP_CASE(VP_LTE_U16):
+            VP_COMPARE( ui, <= );
+
+        VP_CASE(VP_LTE_U32):
+            VP_COMPARE( ul, <= );
+
+        VP_CASE(VP_LTE_F):
+            VP_COMPARE( f, <= );
+
+        VP_CASE(VP_END):
+#ifndef VP_COMPUTED_GOTO
+        default:
+            break;
+        }
+#endif
+        LeaveCompound();
+
+        if ( defer == true )
+        {
+            rc = FlushWrites( hVarServer );
+            if ( rc != EOK )
+            {
+                result = rc;
+            }
+        }
+
+        LatencyComplete();
+
+        if ( prefetch == true )
+        {
+            ReleaseSysvars( &pProgram->sysvars );
+            pContext->pPrefetched = NULL;
+        }
+    }
+
+    #undef VP_ASSIGN
+    #undef VP_COMPARE
+    #undef VP_ARITH
+    #undef VP_DISPATCH
+    #undef VP_CASE
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileStatements                                                         */
+/*!
+    Compile a list of statements
+
+    The CompileStatements function appends the instructions for each
+    statement in the statement list to the program.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pStatements
+        pointer to the statement list to compile (may be NULL)
+
+@retval ENOMEM memory allocation failure
+@retval EOK the statements were successfully compiled
+
+==============================================================================*/
+static int CompileStatements( VarProgram *pProgram, Statement *pStatements )
+{
+    int result = EOK;
+    Statement *pStatement = pStatements;
+
+    while ( ( pStatement != NULL ) && ( result == EOK ) )
+    {
+        result = CompileOne( pProgram, pStatement );
+        pStatement = pStatement->pNext;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileOne                                                                */
+/*!
+    Compile a single statement
+
+    The CompileOne function appends the instructions for a single
+    statement to the program.  Statements which cannot be flattened are
+    compiled into a VP_STATEMENT instruction which runs them through
+    ProcessStatement().  IF/ELSE chains which compare one variable against
+    constants are compiled into a VP_SWITCH instruction.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pStatement
+        pointer to the statement to compile
+
+@retval ENOMEM memory allocation failure
+@retval EOK the statement was successfully compiled
+
+==============================================================================*/
+static int CompileOne( VarProgram *pProgram, Statement *pStatement )
+{
+    int result;
+    Variable *pVariable = pStatement->pVariable;
+    VarInstruction instr;
+    VarSwitch *pSwitch;
+    uint32_t reg;
+
+    memset( &instr, 0, sizeof( VarInstruction ) );
+    instr.pStatement = pStatement;
+
+    if ( pVariable != NULL )
+    {
+        pSwitch = ( pVariable->operation == VA_IF ) ? NewSwitch( pVariable )
+                                                    : NULL;
+        if ( pSwitch != NULL )
+        {
+            result = CompileSwitch( pProgram, pSwitch );
+        }
+        else if ( ( pVariable->operation == VA_IF ) &&
+             ( pVariable->left != NULL ) &&
+             ( pVariable->right != NULL ) &&
+             ( pVariable->right->operation == VA_ELSE ) &&
+             ( IsCompilable( pVariable->left ) ) )
+        {
+            result = CompileIF( pProgram, pVariable );
+        }
+        else if ( ( pVariable->operation != VA_IF ) &&
+                  ( IsCompilable( pVariable ) ) )
+        {
+            result = CompileExpr( pProgram, pVariable, VI_ROOT, &reg );
+        }
+        else
+        {
+            /* fall back to the tree interpreter */
+            instr.opcode = VP_STATEMENT;
+            result = Emit( pProgram, &instr, NULL );
+        }
+    }
+    else if ( pStatement->script != NULL )
+    {
+        instr.opcode = VP_SCRIPT;
+        result = Emit( pProgram, &instr, NULL );
+    }
+    else
+    {
+        /* let ProcessStatement report the unsupported statement */
+        instr.opcode = VP_STATEMENT;
+        result = Emit( pProgram, &instr, NULL );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileIF                                                                 */
+/*!
+    Compile an IF statement
+
+    The CompileIF function compiles an IF statement into the following
+    instruction sequence:
+
+    <condition>
+    JMPF condition, else
+    <then block>
+    JMP end
+    else:
+    <else block>
+    end:
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pVariable
+        pointer to the VA_IF variable node
+
+@retval ENOMEM memory allocation failure
+@retval EOK the IF statement was successfully compiled
+
+==============================================================================*/
+static int CompileIF( VarProgram *pProgram, Variable *pVariable )
+{
+    int result;
+    Variable *pElse = pVariable->right;
+    VarInstruction instr;
+    uint32_t cond;
+    uint32_t condStart;
+    uint32_t jmpf;
+    uint32_t jmp = 0;
+    uint32_t i;
+    bool hasElse = ( pElse->right != NULL );
+
+    condStart = pProgram->ncode;
+
+    result = CompileExpr( pProgram, pVariable->left, VI_COND, &cond );
+    if ( result == EOK )
+    {
+        memset( &instr, 0, sizeof( VarInstruction ) );
+        instr.opcode = VP_JMPF;
+        instr.operation = VA_IF;
+        instr.a = cond;
+        result = Emit( pProgram, &instr, &jmpf );
+    }
+
+    if ( result == EOK )
+    {
+        result = CompileStatements( pProgram, (Statement *)pElse->left );
+    }
+
+    if ( ( result == EOK ) && ( hasElse == true ) )
+    {
+        memset( &instr, 0, sizeof( VarInstruction ) );
+        instr.opcode = VP_JMP;
+        instr.operation = VA_ELSE;
+        result = Emit( pProgram, &instr, &jmp );
+        if ( result == EOK )
+        {
+            pProgram->pCode[jmpf].target = pProgram->ncode;
+            result = CompileStatements( pProgram, (Statement *)pElse->right );
+        }
+    }
+
+    if ( result == EOK )
+    {
+        if ( hasElse == true )
+        {
+            pProgram->pCode[jmp].target = pProgram->ncode;
+        }
+        else
+        {
+            pProgram->pCode[jmpf].target = pProgram->ncode;
+        }
+
+        /* a failed condition jumps to the end of the IF statement */
+        for ( i = condStart; i < jmpf; i++ )
+        {
+            if ( pProgram->pCode[i].flags & VI_COND )
+            {
+                pProgram->pCode[i].target = pProgram->ncode;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileSwitch                                                             */
+/*!
+    Compile an IF/ELSE chain into a dispatch table
+
+    The CompileSwitch function compiles an IF/ELSE chain which compares
+    one variable against constants into the following instruction
+    sequence:
+
+    <variable>
+    SWITCH table
+    case 1:
+    <case 1 block>
+    JMP end
+    ...
+    case n:
+    <case n block>
+    JMP end
+    default:
+    <default block>
+    end:
+
+    The program takes ownership of the switch, and frees it if the
+    chain cannot be compiled.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pSwitch
+        pointer to the switch built for the chain
+
+@retval ENOMEM memory allocation failure
+@retval EOK the IF/ELSE chain was successfully compiled
+
+==============================================================================*/
+static int CompileSwitch( VarProgram *pProgram, VarSwitch *pSwitch )
+{
+    int result = ENOMEM;
+    VarInstruction instr;
+    VarSwitch **ppSwitches;
+    uint32_t *pJumps;
+    uint32_t reg;
+    uint32_t start;
+    uint32_t sw = 0;
+    uint32_t i;
+
+    start = pProgram->ncode;
+
+    pJumps = calloc( pSwitch->ncases, sizeof( uint32_t ) );
+    ppSwitches = realloc( pProgram->ppSwitches,
+                          ( pProgram->nswitches + 1 ) * sizeof( VarSwitch * ) );
+    if ( ppSwitches != NULL )
+    {
+        pProgram->ppSwitches = ppSwitches;
+        ppSwitches[pProgram->nswitches++] = pSwitch;
+        result = ( pJumps != NULL ) ? EOK : ENOMEM;
+    }
+    else
+    {
+        FreeSwitch( pSwitch );
+    }
+
+    if ( result == EOK )
+    {
+        /* read the variable once for every case */
+        result = CompileExpr( pProgram, pSwitch->pVariable, VI_COND, &reg );
+    }
+
+    if ( result == EOK )
+    {
+        memset( &instr, 0, sizeof( VarInstruction ) );
+        instr.opcode = VP_SWITCH;
+        instr.operation = VA_IF;
+        instr.a = reg;
+        instr.b = pProgram->nswitches - 1;
+        result = Emit( pProgram, &instr, &sw );
+    }
+
+    for ( i = 0; ( result == EOK ) && ( i < pSwitch->ncases ); i++ )
+    {
+        pSwitch->pTargets[i] = pProgram->ncode;
+        result = CompileStatements( pProgram, pSwitch->pCases[i].pBlock );
+        if ( result == EOK )
+        {
+            memset( &instr, 0, sizeof( VarInstruction ) );
+            instr.opcode = VP_JMP;
+            instr.operation = VA_ELSE;
+            result = Emit( pProgram, &instr, &pJumps[i] );
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pSwitch->pTargets[pSwitch->ncases] = pProgram->ncode;
+        result = CompileStatements( pProgram, pSwitch->pDefault );
+    }
+
+    if ( result == EOK )
+    {
+        pSwitch->pTargets[pSwitch->ncases + 1] = pProgram->ncode;
+
+        for ( i = 0; i < pSwitch->ncases; i++ )
+        {
+            pProgram->pCode[pJumps[i]].target = pProgram->ncode;
+        }
+
+        /* a failed variable read skips the whole chain */
+        for ( i = start; i < sw; i++ )
+        {
+            if ( pProgram->pCode[i].flags & VI_COND )
+            {
+                pProgram->pCode[i].target = pProgram->ncode;
+            }
+        }
+    }
+
+    free( pJumps );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileExpr                                                               */
+/*!
+    Compile an expression tree
+
+    The CompileExpr function compiles a variable expression tree
+    in the same order which ProcessExpr() evaluates it: right subtree,
+    left subtree, then the node itself.  Constants and local variables
+    do not generate any instructions.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pVariable
+        pointer to the expression tree to compile (may be NULL)
+
+@param[in]
+    flags
+        instruction flags to apply to the instruction for this node
+
+@param[out]
+    pReg
+        pointer to the location to store the result register index
+
+@retval ENOMEM memory allocation failure
+@retval EOK the expression was successfully compiled
+
+==============================================================================*/
+static int CompileExpr( VarProgram *pProgram,
+                        Variable *pVariable,
+                        uint32_t flags,
+                        uint32_t *pReg )
+{
+    int result = EOK;
+    VarInstruction instr;
+    uint32_t a = VP_NOREG;
+    uint32_t b = VP_NOREG;
+
+    *pReg = VP_NOREG;
+
+    if ( ( pVariable != NULL ) &&
+         ( ( pVariable->operation == VA_AND ) ||
+           ( pVariable->operation == VA_OR ) ) &&
+         ( VarActionGetOptions() & VA_OPT_SHORT_CIRCUIT ) )
+    {
+        result = CompileLogical( pProgram, pVariable, flags, pReg );
+    }
+    else if ( pVariable != NULL )
+    {
+        result = CompileExpr( pProgram, pVariable->right, 0, &b );
+        if ( result == EOK )
+        {
+            result = CompileExpr( pProgram, pVariable->left, 0, &a );
+        }
+
+        if ( result == EOK )
+        {
+            result = AddRegister( pProgram, pVariable, pReg );
+        }
+
+        if ( result == EOK )
+        {
+            switch( pVariable->operation )
+            {
+                case VA_NUM:
+                case VA_FLOATNUM:
+                case VA_LOCALVAR:
+                case VA_STRING:
+                case VA_TIMER:
+                    /* no operation required */
+                    break;
+
+                default:
+                    memset( &instr, 0, sizeof( VarInstruction ) );
+                    instr.opcode = SelectOpcode( pVariable );
+                    instr.operation = pVariable->operation;
+                    instr.flags = flags;
+                    instr.dst = *pReg;
+                    instr.a = a;
+                    instr.b = b;
+                    instr.fn = ( pVariable->fn != NULL )
+                               ? pVariable->fn
+                               : GetOperation( pVariable->operation );
+                    if ( ( instr.opcode == VP_CALL ) && ( instr.fn == NULL ) )
+                    {
+                        /* operation map is not initialized */
+                        result = ENOTSUP;
+                    }
+                    else
+                    {
+                        result = Emit( pProgram, &instr, NULL );
+                    }
+                    break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CompileLogical                                                            */
+/*!
+    Compile a short-circuit logical operation
+
+    The CompileLogical function compiles a logical AND or OR node into
+    the following instruction sequence:
+
+    <left operand>
+    AND_SC/OR_SC left, end
+    <right operand>
+    CALL And/Or
+    end:
+
+    The left operand is evaluated first, and the right operand is
+    skipped if the left operand decides the result.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pVariable
+        pointer to the VA_AND or VA_OR node
+
+@param[in]
+    flags
+        instruction flags to apply to the instruction for this node
+
+@param[out]
+    pReg
+        pointer to the location to store the result register index
+
+@retval ENOMEM memory allocation failure
+@retval EOK the operation was successfully compiled
+
+==============================================================================*/
+static int CompileLogical( VarProgram *pProgram,
+                           Variable *pVariable,
+                           uint32_t flags,
+                           uint32_t *pReg )
+{
+    int result;
+    VarInstruction instr;
+    uint32_t a = VP_NOREG;
+    uint32_t b = VP_NOREG;
+    uint32_t sc;
+
+    result = CompileExpr( pProgram, pVariable->left, 0, &a );
+    if ( result == EOK )
+    {
+        result = AddRegister( pProgram, pVariable, pReg );
+    }
+
+    if ( result == EOK )
+    {
+        memset( &instr, 0, sizeof( VarInstruction ) );
+        instr.opcode = ( pVariable->operation == VA_AND ) ? VP_AND_SC
+                                                          : VP_OR_SC;
+        instr.operation = pVariable->operation;
+        instr.dst = *pReg;
+        instr.a = a;
+        result = Emit( pProgram, &instr, &sc );
+    }
+
+    if ( result == EOK )
+    {
+        result = CompileExpr( pProgram, pVariable->right, 0, &b );
+    }
+
+    if ( result == EOK )
+    {
+        memset( &instr, 0, sizeof( VarInstruction ) );
+        instr.opcode = VP_CALL;
+        instr.operation = pVariable->operation;
+        instr.flags = flags;
+        instr.dst = *pReg;
+        instr.a = a;
+        instr.b = b;
+        instr.fn = ( pVariable->fn != NULL )
+                   ? pVariable->fn
+                   : GetOperation( pVariable->operation );
+        result = ( instr.fn != NULL ) ? Emit( pProgram, &instr, NULL )
+                                      : ENOTSUP;
+    }
+
+    if ( result == EOK )
+    {
+        pProgram->pCode[sc].target = pProgram->ncode;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  IsCompilable                                                              */
+/*!
+    Check if an expression tree can be compiled
+
+    The IsCompilable function checks that an expression tree does not
+    contain IF/ELSE nodes below its root, since these are only
+    supported at the statement level.
+
+@param[in]
+    pVariable
+        pointer to the expression tree to check
+
+@retval true the expression can be compiled
+@retval false the expression must be run by the tree interpreter
+
+==============================================================================*/
+static bool IsCompilable( Variable *pVariable )
+{
+    bool result = true;
+
+    if ( pVariable != NULL )
+    {
+        if ( ( pVariable->operation == VA_IF ) ||
+             ( pVariable->operation == VA_ELSE ) ||
+             ( pVariable->operation < 0 ) ||
+             ( pVariable->operation >= VA_OP_MAX ) )
+        {
+            result = false;
+        }
+        else
+        {
+            result = IsCompilable( pVariable->left ) &&
+                     IsCompilable( pVariable->right );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResultType                                                                */
+/*!
+    Determine the type of a node after it is evaluated
+
+    The ResultType function determines the variable type which the
+    operation function for a node will store in the node.  This may differ
+    from the type recorded by CreateVariable(), for example comparison
+    nodes always hold a 16-bit result.
+
+@param[in]
+    pVariable
+        pointer to the node to check
+
+@retval the evaluated type of the node
+@retval -1 if the type cannot be determined
+
+==============================================================================*/
+int ResultType( Variable *pVariable )
+{
+    int type = -1;
+
+    if ( pVariable != NULL )
+    {
+        switch( pVariable->operation )
+        {
+            case VA_AND:
+            case VA_OR:
+            case VA_NOT:
+            case VA_EQUALS:
+            case VA_NOTEQUALS:
+            case VA_GT:
+            case VA_LT:
+            case VA_GTE:
+            case VA_LTE:
+            case VA_TOSHORT:
+            case VA_CREATE_TICK:
+            case VA_CREATE_TIMER:
+            case VA_DELETE_TIMER:
+            case VA_ACTIVE_TIMER:
+                type = VARTYPE_UINT16;
+                break;
+
+            case VA_TOFLOAT:
+                type = VARTYPE_FLOAT;
+                break;
+
+            case VA_TOINT:
+                type = VARTYPE_UINT32;
+                break;
+
+            case VA_TOSTRING:
+                type = VARTYPE_STR;
+                break;
+
+            case VA_ASSIGN:
+            case VA_MUL:
+            case VA_DIV:
+            case VA_ADD:
+            case VA_SUB:
+            case VA_BAND:
+            case VA_BOR:
+            case VA_XOR:
+            case VA_LSHIFT:
+            case VA_RSHIFT:
+            case VA_AND_EQUALS:
+            case VA_OR_EQUALS:
+            case VA_XOR_EQUALS:
+            case VA_DIV_EQUALS:
+            case VA_TIMES_EQUALS:
+            case VA_PLUS_EQUALS:
+            case VA_MINUS_EQUALS:
+                type = ResultType( pVariable->left );
+                break;
+
+            case VA_SYSVAR:
+            case VA_NUM:
+            case VA_FLOATNUM:
+            case VA_LOCALVAR:
+            case VA_STRING:
+                type = pVariable->obj.type;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return type;
+}
+
+/*============================================================================*/
+/*  SelectOpcode                                                              */
+/*!
+    Select the instruction opcode for a node
+
+    The SelectOpcode function selects an inline typed instruction for
+    numeric operations where both operands have the same type at compile
+    time.  All other operations use the VP_CALL instruction.
+
+@param[in]
+    pVariable
+        pointer to the node to select an opcode for
+
+@retval the instruction opcode
+
+==============================================================================*/
+static int SelectOpcode( Variable *pVariable )
+{
+    int opcode = VP_CALL;
+    int ltype;
+    int rtype;
+    int idx;
+
+    /* typed opcodes are ordered uint16, uint32, float */
+    static const int arith[][3] = {
+        [VA_ADD] =  { VP_ADD_U16, VP_ADD_U32, VP_ADD_F },
+        [VA_SUB] =  { VP_SUB_U16, VP_SUB_U32, VP_SUB_F },
+        [VA_MUL] =  { VP_MUL_U16, VP_MUL_U32, VP_MUL_F },
+        [VA_BAND] = { VP_BAND_U16, VP_BAND_U32, VP_CALL },
+        [VA_BOR] =  { VP_BOR_U16, VP_BOR_U32, VP_CALL },
+        [VA_XOR] =  { VP_XOR_U16, VP_XOR_U32, VP_CALL },
+        [VA_EQUALS] = { VP_EQ_U16, VP_EQ_U32, VP_EQ_F },
+        [VA_GT] =   { VP_GT_U16, VP_GT_U32, VP_GT_F },
+        [VA_LT] =   { VP_LT_U16, VP_LT_U32, VP_LT_F },
+        [VA_GTE] =  { VP_GTE_U16, VP_GTE_U32, VP_GTE_F },
+        [VA_LTE] =  { VP_LTE_U16, VP_LTE_U32, VP_LTE_F },
+        [VA_ASSIGN] = { VP_ASSIGN_U16, VP_ASSIGN_U32, VP_ASSIGN_F },
+        [VA_OP_MAX] = { VP_CALL, VP_CALL, VP_CALL }
+    };
+
+    if ( ( pVariable->left != NULL ) &&
+         ( pVariable->right != NULL ) )
+    {
+        ltype = ResultType( pVariable->left );
+        rtype = ResultType( pVariable->right );
+
+        switch( ltype )
+        {
+            case VARTYPE_UINT16:
+                idx = 0;
+                break;
+
+            case VARTYPE_UINT32:
+                idx = 1;
+                break;
+
+            case VARTYPE_FLOAT:
+                idx = 2;
+                break;
+
+            default:
+                idx = -1;
+                break;
+        }
+
+        if ( ( idx >= 0 ) &&
+             ( ltype == rtype ) &&
+             ( pVariable->operation < VA_OP_MAX ) )
+        {
+            opcode = arith[pVariable->operation][idx];
+
+            /* uninitialized table entries select VP_END */
+            if ( opcode == VP_END )
+            {
+                opcode = VP_CALL;
+            }
+
+            /* system variable assignments must call SetVar */
+            if ( ( pVariable->operation == VA_ASSIGN ) &&
+                 ( pVariable->left->operation != VA_LOCALVAR ) )
+            {
+                opcode = VP_CALL;
+            }
+        }
+    }
+
+    return opcode;
+}
+
+/*============================================================================*/
+/*  AddRegister                                                               */
+/*!
+    Allocate a register for a node
+
+    The AddRegister function allocates a new register which refers to
+    the specified variable node.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pVariable
+        pointer to the variable node referenced by the register
+
+@param[out]
+    pReg
+        pointer to the location to store the register index
+
+@retval ENOMEM memory allocation failure
+@retval EOK the register was successfully allocated
+
+==============================================================================*/
+static int AddRegister( VarProgram *pProgram,
+                        Variable *pVariable,
+                        uint32_t *pReg )
+{
+    int result = EOK;
+    size_t regsize;
+    Variable **pRegs;
+
+    if ( pProgram->nregs >= pProgram->regsize )
+    {
+        regsize = ( pProgram->regsize == 0 ) ? VP_INITIAL_REG_SIZE
+                                             : pProgram->regsize * 2;
+        pRegs = realloc( pProgram->pRegs, regsize * sizeof( Variable * ) );
+        if ( pRegs != NULL )
+        {
+            pProgram->pRegs = pRegs;
+            pProgram->regsize = regsize;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        *pReg = pProgram->nregs;
+        pProgram->pRegs[pProgram->nregs++] = pVariable;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Emit                                                                      */
+/*!
+    Append an instruction to a program
+
+    The Emit function appends a copy of the specified instruction
+    to the program's instruction array.
+
+@param[in]
+    pProgram
+        pointer to the program being compiled
+
+@param[in]
+    pInstruction
+        pointer to the instruction to append
+
+@param[out]
+    pIndex
+        pointer to the location to store the instruction index (may be NULL)
+
+@retval ENOMEM memory allocation failure
+@retval EOK the instruction was successfully appended
+
+==============================================================================*/
+static int Emit( VarProgram *pProgram,
+                 VarInstruction *pInstruction,
+                 uint32_t *pIndex )
+{
+    int result = EOK;
+    size_t codesize;
+    VarInstruction *pCode;
+
+    if ( pProgram->ncode >= pProgram->codesize )
+    {
+        codesize = ( pProgram->codesize == 0 ) ? VP_INITIAL_CODE_SIZE
+                                               : pProgram->codesize * 2;
+        pCode = realloc( pProgram->pCode, codesize * sizeof( VarInstruction ) );
+        if ( pCode != NULL )
+        {
+            pProgram->pCode = pCode;
+            pProgram->codesize = codesize;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        if ( pIndex != NULL )
+        {
+            *pIndex = pProgram->ncode;
+        }
+
+        pProgram->pCode[pProgram->ncode++] = *pInstruction;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ReportProgramError                                                        */
+/*!
+    Report an instruction error
+
+    The ReportProgramError function reports a failed instruction using the
+    same diagnostic output as ProcessVariable().
+
+@param[in]
+    pInstruction
+        pointer to the instruction which failed
+
+@param[in]
+    rc
+        the error code returned by the instruction
+
+==============================================================================*/
+void ReportProgramError( VarInstruction *pInstruction, int rc )
+{
+    fprintf( stderr,
+             "Error processing Action: %s (%d) %s\n",
+             GetOperationName( pInstruction->operation ),
+             rc,
+             strerror( rc ) );
+}
+
+/*! @}
+ * end of varprogram group */
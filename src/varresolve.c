@@ -0,0 +1,502 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varresolve varresolve
+ * @brief Variable Action Script System Variable Resolution functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varresolve.c
+
+    Variable Action Script System Variable Resolution functions
+
+    When the VA_OPT_LAZY_RESOLVE option is set, system variables are
+    recorded by name as they are parsed, without looking up their handles
+    or values.  The System Variable Resolution functions look up all of
+    the unresolved names together, either when ResolveAll() is called or
+    before the first compound statement or program is evaluated after
+    new names were recorded.
+
+    If a batch find function has been registered with
+    VarActionSetBatchFind() the handles are looked up with a single call,
+    otherwise each handle is looked up with VAR_FindByName().  The types
+    of the resolved variables are then retrieved with one batch get
+    request, and the operations of the statements being resolved are
+    bound for those types.  If a variable was recorded with a type, for
+    example from a rule set image, and the variable server reports a
+    different type, every operation of the statements is bound again so
+    no variant specialized for the recorded type is evaluated.
+
+    Names which cannot be resolved are reported together in a single
+    diagnostic, and are retried the next time the handles are resolved.
+    Before an evaluation the handles are resolved again if new names
+    have been recorded.  Names which could not be found are also retried
+    at most once every RESOLVE_RETRY_NS, so a variable which the
+    variable server creates later is found without a request being made
+    for every evaluation.  A retry which finds no new variables is not
+    reported again.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include "varresolve.h"
+#include "varcontext.h"
+#include "varprefetch.h"
+#include "varspecial.h"
+#include "varops.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! interval (in nanoseconds) at which names which could not be found are
+ *  looked up again before an evaluation */
+#define RESOLVE_RETRY_NS        ( 1000000000ull )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! multi-variable find function (may be NULL) */
+static VarBatchFindFn g_batchFind = NULL;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static void FindHandles( VARSERVER_HANDLE hVarServer,
+                         char **ppNames,
+                         VAR_HANDLE *phVars,
+                         size_t n );
+static void BindStatements( Statement *pStatements, bool rebind );
+static void BindVariable( Variable *pVariable, bool rebind );
+static uint64_t Now( void );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionSetBatchFind                                                     */
+/*!
+    Register a multi-variable find function
+
+    The VarActionSetBatchFind function registers a function which can
+    look up the handles of several system variables with one request.
+    It is used to resolve the system variables recorded while the
+    VA_OPT_LAZY_RESOLVE option is set.
+
+@param[in]
+    fn
+        pointer to the batch find function, or NULL to look up each
+        variable with VAR_FindByName()
+
+==============================================================================*/
+void VarActionSetBatchFind( VarBatchFindFn fn )
+{
+    g_batchFind = fn;
+}
+
+/*============================================================================*/
+/*  ResolveAll                                                                */
+/*!
+    Resolve the handles of all unresolved system variables
+
+    The ResolveAll function looks up the handles of all of the system
+    variables in the current context which do not have a handle, and
+    retrieves their values to discover their types.  The operations in
+    the statement list which could not be bound for a type when they were
+    created are bound for the types of the resolved variables.  If the
+    type of a variable differs from the type it was recorded with, all
+    of the operations in the statement list are bound again.
+
+    All of the names which could not be resolved are reported in a
+    single diagnostic on stderr, unless the same number of names failed
+    the previous resolution and no names have been recorded since.
+    Statements which use them report an error when they are evaluated,
+    and the names are looked up again by later resolutions.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pStatements
+        pointer to the statement list to bind (may be NULL)
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval ENOENT one or more system variables could not be found
+@retval EOK all system variables were resolved
+
+==============================================================================*/
+int ResolveAll( VARSERVER_HANDLE hVarServer, Statement *pStatements )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    Variable *pVariable;
+    Variable **ppVars = NULL;
+    char **ppNames = NULL;
+    VAR_HANDLE *phVars = NULL;
+    VarType *pTypes = NULL;
+    SysvarList found;
+    size_t n = 0;
+    size_t nFailed = 0;
+    size_t i;
+    bool cache;
+    bool rebind = false;
+    bool report;
+
+    if ( hVarServer != NULL )
+    {
+        result = EOK;
+        memset( &found, 0, sizeof( SysvarList ) );
+
+        for ( pVariable = pContext->pFirstSysvar;
+              pVariable != NULL;
+              pVariable = pVariable->pNext )
+        {
+            if ( pVariable->hVar == VAR_INVALID )
+            {
+                n++;
+            }
+        }
+
+        if ( n > 0 )
+        {
+            ppVars = calloc( n, sizeof( Variable * ) );
+            ppNames = calloc( n, sizeof( char * ) );
+            phVars = calloc( n, sizeof( VAR_HANDLE ) );
+            pTypes = calloc( n, sizeof( VarType ) );
+            if ( ( ppVars == NULL ) ||
+                 ( ppNames == NULL ) ||
+                 ( phVars == NULL ) ||
+                 ( pTypes == NULL ) )
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if ( ( n > 0 ) && ( result == EOK ) )
+        {
+            i = 0;
+            for ( pVariable = pContext->pFirstSysvar;
+                  pVariable != NULL;
+                  pVariable = pVariable->pNext )
+            {
+                if ( pVariable->hVar == VAR_INVALID )
+                {
+                    ppVars[i] = pVariable;
+                    ppNames[i] = pVariable->id;
+                    pTypes[i] = pVariable->obj.type;
+                    i++;
+                }
+            }
+
+            FindHandles( hVarServer, ppNames, phVars, n );
+        }
+
+        if ( ( n > 0 ) && ( result == EOK ) )
+        {
+            /* record the handles, and collect the resolved
+             * variables to retrieve their types */
+            for ( i = 0; i < n; i++ )
+            {
+                if ( phVars[i] != VAR_INVALID )
+                {
+                    SetSysvarHandle( hVarServer, ppVars[i], phVars[i] );
+                    if ( AddSysvar( &found, ppVars[i] ) != EOK )
+                    {
+                        result = ENOMEM;
+                    }
+                }
+            }
+
+            /* variables which cannot be retrieved get their type
+             * when they are evaluated */
+            (void)FetchSysvars( hVarServer, &found );
+
+            for ( i = 0; i < n; i++ )
+            {
+                if ( ( phVars[i] != VAR_INVALID ) &&
+                     ( pTypes[i] != VARTYPE_INVALID ) &&
+                     ( ppVars[i]->obj.type != pTypes[i] ) )
+                {
+                    /* operations may be specialized for the old type */
+                    rebind = true;
+                }
+            }
+
+            cache = ( pContext->options & VA_OPT_CACHE ) ? true : false;
+            for ( i = 0; i < found.n; i++ )
+            {
+                /* only cached values are kept until they are used */
+                pVariable = found.ppVars[i];
+                pVariable->valid = pVariable->valid &&
+                                   pVariable->modifiedNotification &&
+                                   cache;
+            }
+
+            for ( i = 0; i < n; i++ )
+            {
+                if ( phVars[i] == VAR_INVALID )
+                {
+                    nFailed++;
+                }
+            }
+
+            /* a retry which changed nothing has already been reported */
+            report = ( nFailed != pContext->failed ) ||
+                     ( n != pContext->failed );
+
+            for ( i = 0; i < n; i++ )
+            {
+                if ( phVars[i] == VAR_INVALID )
+                {
+                    if ( ( report == true ) && ( result != ENOENT ) )
+                    {
+                        fprintf( stderr, "Unresolved system variables:" );
+                    }
+
+                    if ( report == true )
+                    {
+                        fprintf( stderr, " %s", ppNames[i] );
+                    }
+
+                    result = ENOENT;
+                }
+            }
+
+            if ( ( report == true ) && ( result == ENOENT ) )
+            {
+                fprintf( stderr, "\n" );
+            }
+        }
+
+        if ( result != ENOMEM )
+        {
+            /* names which were not found are retried later */
+            pContext->unresolved = nFailed;
+            pContext->failed = nFailed;
+            pContext->retryns = Now() + RESOLVE_RETRY_NS;
+            BindStatements( pStatements, rebind );
+        }
+
+        FreeSysvars( &found );
+        free( ppVars );
+        free( ppNames );
+        free( phVars );
+        free( pTypes );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ResolvePending                                                            */
+/*!
+    Resolve system variables recorded since the last resolution
+
+    The ResolvePending function calls ResolveAll() before the outermost
+    compound statement is evaluated if system variables have been
+    recorded without a handle since their handles were last resolved,
+    or if some system variables could not be found and RESOLVE_RETRY_NS
+    has elapsed since the last attempt.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pStatements
+        pointer to the statement list to be evaluated (may be NULL)
+
+==============================================================================*/
+void ResolvePending( VARSERVER_HANDLE hVarServer, Statement *pStatements )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( ( pContext->unresolved > 0 ) &&
+         ( pContext->depth == 0 ) &&
+         ( ( pContext->unresolved > pContext->failed ) ||
+           ( Now() >= pContext->retryns ) ) )
+    {
+        /* unresolved variables report an error when they are used */
+        (void)ResolveAll( hVarServer, pStatements );
+    }
+}
+
+/*============================================================================*/
+/*  FindHandles                                                               */
+/*!
+    Look up the handles of a list of system variables
+
+    The FindHandles function looks up the handles of the named system
+    variables using the batch find function if one is registered,
+    falling back to VAR_FindByName() for each variable.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    ppNames
+        array of system variable names
+
+@param[out]
+    phVars
+        array to receive the handles, VAR_INVALID if not found
+
+@param[in]
+    n
+        number of system variables
+
+==============================================================================*/
+static void FindHandles( VARSERVER_HANDLE hVarServer,
+                         char **ppNames,
+                         VAR_HANDLE *phVars,
+                         size_t n )
+{
+    size_t i;
+
+    if ( ( g_batchFind == NULL ) ||
+         ( g_batchFind( hVarServer, ppNames, phVars, n ) != EOK ) )
+    {
+        /* fall back to one request per variable */
+        for ( i = 0; i < n; i++ )
+        {
+            phVars[i] = VAR_FindByName( hVarServer, ppNames[i] );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  BindStatements                                                            */
+/*!
+    Bind the operations of a statement list
+
+    The BindStatements function binds the operations of each statement
+    in the statement list, including the then and else compound
+    statements of IF statements.
+
+@param[in]
+    pStatements
+        pointer to the statement list (may be NULL)
+
+@param[in]
+    rebind
+        true to bind operations which have already been bound
+
+==============================================================================*/
+static void BindStatements( Statement *pStatements, bool rebind )
+{
+    Statement *pStatement;
+
+    for ( pStatement = pStatements;
+          pStatement != NULL;
+          pStatement = pStatement->pNext )
+    {
+        BindVariable( pStatement->pVariable, rebind );
+    }
+}
+
+/*============================================================================*/
+/*  BindVariable                                                              */
+/*!
+    Bind the operations of a variable tree
+
+    The BindVariable function selects a type specialized operation for
+    each node in the variable tree which does not have one, now that the
+    types of its system variables are known.  When rebinding, the
+    operation of every node is selected again, and a node whose
+    operand types have no variant uses the generic operation.
+
+@param[in]
+    pVariable
+        pointer to the variable tree (may be NULL)
+
+@param[in]
+    rebind
+        true to bind operations which have already been bound
+
+==============================================================================*/
+static void BindVariable( Variable *pVariable, bool rebind )
+{
+    if ( pVariable != NULL )
+    {
+        if ( pVariable->operation == VA_ELSE )
+        {
+            /* the ELSE node references the then and else
+             * compound statements */
+            BindStatements( (Statement *)pVariable->left, rebind );
+            BindStatements( (Statement *)pVariable->right, rebind );
+        }
+        else
+        {
+            BindVariable( pVariable->left, rebind );
+            BindVariable( pVariable->right, rebind );
+
+            if ( ( rebind == true ) ||
+                 ( pVariable->fn == NULL ) )
+            {
+                pVariable->fn = SelectOperation( pVariable );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Now                                                                       */
+/*!
+    Get the monotonic time
+
+@retval monotonic time in nanoseconds
+
+==============================================================================*/
+static uint64_t Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*! @}
+ * end of varresolve group */
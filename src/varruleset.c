@@ -0,0 +1,665 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varruleset varruleset
+ * @brief Variable Action Script Rule Set Reload functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varruleset.c
+
+    Variable Action Script Rule Set Reload functions
+
+    The Rule Set Reload functions replace a running rule set without
+    stopping its evaluation.
+
+    A rule set bundles the evaluation context, the arena and the
+    statements built for one generation of the rules, along with the
+    program compiled from them.  A new rule set is built in a new
+    context, typically on a background thread, while the current one
+    continues to be evaluated.  VarActionPublishRuleSet() then makes it
+    the active rule set with a single atomic pointer exchange, so each
+    evaluator picks it up the next time it enters the active rules.
+
+    Evaluators never wait for a publisher.  Entering the active rules
+    increments one of two reader counts and loads the active rule set,
+    and leaving decrements the same count.  After publishing, the writer
+    flips the count which new readers increment, waits for the other
+    count to drain, and repeats once more so that a reader which sampled
+    the count index before the first flip is also waited for.  No reader
+    can then hold the old rule set, and it is freed: its program, context
+    and arena are each released with a single call.
+
+    The writer sleeps on a condition variable while it waits.  The last
+    reader to leave a count signals it, taking the wait lock only when a
+    writer is waiting, so leaving the rules is otherwise lock free.
+
+    A thread which has entered the active rules cannot publish to them,
+    since it would wait for its own reader count to drain.  Each thread
+    records the active rules it has entered, and VarActionPublishRuleSet()
+    fails with EDEADLK instead of waiting forever.  This includes
+    publishing from inside an evaluation on the evaluator thread.
+
+    As with any context, a rule set may be evaluated by only one thread
+    at a time.  Applications with several evaluator threads build one
+    rule set per thread, each published through its own active rules.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <varaction/varaction.h>
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! maximum number of different active rules a thread can have entered
+ *  at once and still be detected by VarActionPublishRuleSet() */
+#define RULESET_MAX_ENTERED     ( 4 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! one generation of a rule set */
+struct _varRuleSet
+{
+    /*! context the statements were built in */
+    VarActionContext *pContext;
+
+    /*! arena the statements were allocated from (may be NULL) */
+    VarArena *pArena;
+
+    /*! statements of the rule set */
+    Statement *pStatements;
+
+    /*! program compiled from the statements (may be NULL) */
+    VarProgram *pProgram;
+};
+
+/*! active rule set publication point */
+struct _varActiveRules
+{
+    /*! the active rule set */
+    _Atomic( VarRuleSet * ) pCurrent;
+
+    /*! index of the reader count incremented by new readers */
+    atomic_uint index;
+
+    /*! number of readers which entered with each index */
+    atomic_size_t readers[2];
+
+    /*! serializes publishers */
+    pthread_mutex_t lock;
+
+    /*! true while a publisher is waiting for a reader count to drain */
+    atomic_bool waiting;
+
+    /*! protects the drained condition */
+    pthread_mutex_t waitLock;
+
+    /*! signalled when a reader count drains while a publisher waits */
+    pthread_cond_t drained;
+};
+
+/*! active rules entered by a thread */
+typedef struct _varEnteredRules
+{
+    /*! the active rules */
+    VarActiveRules *pActive;
+
+    /*! number of times the thread has entered them without leaving */
+    int depth;
+} VarEnteredRules;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static void WaitReaders( VarActiveRules *pActive );
+static VarEnteredRules *FindEntered( VarActiveRules *pActive );
+static void TrackEnter( VarActiveRules *pActive );
+static void TrackLeave( VarActiveRules *pActive );
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! active rules entered by the calling thread */
+static __thread VarEnteredRules g_entered[RULESET_MAX_ENTERED];
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionCreateRuleSet                                                    */
+/*!
+    Create a rule set from statements built in a context
+
+    The VarActionCreateRuleSet function takes ownership of a context, an
+    arena and the statements built in them, and compiles the statements
+    into a program using the options of the context.  If the statements
+    cannot be compiled they are evaluated with the tree interpreter.
+
+@param[in]
+    pContext
+        pointer to the context the statements were built in
+
+@param[in]
+    pArena
+        pointer to the arena the statements were allocated from
+        (may be NULL)
+
+@param[in]
+    pStatements
+        pointer to the statements of the rule set
+
+@retval pointer to the rule set
+@retval NULL if the rule set could not be created, with errno set to
+        EINVAL or ENOMEM
+
+==============================================================================*/
+VarRuleSet *VarActionCreateRuleSet( VarActionContext *pContext,
+                                    VarArena *pArena,
+                                    Statement *pStatements )
+{
+    VarRuleSet *pRuleSet = NULL;
+    VarActionContext *pPrev;
+
+    if ( ( pContext != NULL ) && ( pStatements != NULL ) )
+    {
+        pRuleSet = calloc( 1, sizeof( VarRuleSet ) );
+        if ( pRuleSet != NULL )
+        {
+            pRuleSet->pContext = pContext;
+            pRuleSet->pArena = pArena;
+            pRuleSet->pStatements = pStatements;
+
+            pPrev = VarActionSetContext( pContext );
+            pRuleSet->pProgram = CompileStatement( pStatements );
+            (void)VarActionSetContext( pPrev );
+        }
+        else
+        {
+            errno = ENOMEM;
+        }
+    }
+    else
+    {
+        errno = EINVAL;
+    }
+
+    return pRuleSet;
+}
+
+/*============================================================================*/
+/*  VarActionFreeRuleSet                                                      */
+/*!
+    Free a rule set
+
+    The VarActionFreeRuleSet function frees the program, the context and
+    the arena of a rule set which is not active.
+
+@param[in]
+    pRuleSet
+        pointer to the rule set to free (may be NULL)
+
+==============================================================================*/
+void VarActionFreeRuleSet( VarRuleSet *pRuleSet )
+{
+    if ( pRuleSet != NULL )
+    {
+        FreeProgram( pRuleSet->pProgram );
+        VarActionFreeContext( pRuleSet->pContext );
+        VarActionFreeArena( pRuleSet->pArena );
+        free( pRuleSet );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionRuleSetStatements                                                */
+/*!
+    Get the statements of a rule set
+
+@param[in]
+    pRuleSet
+        pointer to the rule set
+
+@retval pointer to the statements of the rule set
+@retval NULL if the rule set is NULL
+
+==============================================================================*/
+Statement *VarActionRuleSetStatements( VarRuleSet *pRuleSet )
+{
+    return ( pRuleSet != NULL ) ? pRuleSet->pStatements : NULL;
+}
+
+/*============================================================================*/
+/*  VarActionRuleSetContext                                                   */
+/*!
+    Get the context of a rule set
+
+@param[in]
+    pRuleSet
+        pointer to the rule set
+
+@retval pointer to the context of the rule set
+@retval NULL if the rule set is NULL
+
+==============================================================================*/
+VarActionContext *VarActionRuleSetContext( VarRuleSet *pRuleSet )
+{
+    return ( pRuleSet != NULL ) ? pRuleSet->pContext : NULL;
+}
+
+/*============================================================================*/
+/*  VarActionCreateActiveRules                                                */
+/*!
+    Create an active rule set publication point
+
+@param[in]
+    pRuleSet
+        pointer to the initial active rule set (may be NULL)
+
+@retval pointer to the active rules
+@retval NULL if memory could not be allocated
+
+==============================================================================*/
+VarActiveRules *VarActionCreateActiveRules( VarRuleSet *pRuleSet )
+{
+    VarActiveRules *pActive;
+
+    pActive = calloc( 1, sizeof( VarActiveRules ) );
+    if ( pActive != NULL )
+    {
+        atomic_init( &pActive->pCurrent, pRuleSet );
+        atomic_init( &pActive->index, 0 );
+        atomic_init( &pActive->readers[0], 0 );
+        atomic_init( &pActive->readers[1], 0 );
+        atomic_init( &pActive->waiting, false );
+        pthread_mutex_init( &pActive->lock, NULL );
+        pthread_mutex_init( &pActive->waitLock, NULL );
+        pthread_cond_init( &pActive->drained, NULL );
+    }
+
+    return pActive;
+}
+
+/*============================================================================*/
+/*  VarActionFreeActiveRules                                                  */
+/*!
+    Free an active rule set publication point
+
+    The VarActionFreeActiveRules function frees the active rule set
+    along with the publication point.  No thread may be using the
+    active rules.
+
+@param[in]
+    pActive
+        pointer to the active rules (may be NULL)
+
+==============================================================================*/
+void VarActionFreeActiveRules( VarActiveRules *pActive )
+{
+    if ( pActive != NULL )
+    {
+        VarActionFreeRuleSet( atomic_load( &pActive->pCurrent ) );
+        pthread_cond_destroy( &pActive->drained );
+        pthread_mutex_destroy( &pActive->waitLock );
+        pthread_mutex_destroy( &pActive->lock );
+        free( pActive );
+    }
+}
+
+/*============================================================================*/
+/*  VarActionPublishRuleSet                                                   */
+/*!
+    Make a rule set the active rule set
+
+    The VarActionPublishRuleSet function atomically replaces the active
+    rule set, waits until no evaluator holds the previous rule set, and
+    frees it.  Evaluators are not stopped while the publisher waits.
+
+    The calling thread must not be inside VarActionEnterRules() for the
+    same active rules, for example by publishing from an operation or
+    script run by VarActionEvaluateRules().  The publisher would wait for
+    itself, so the rule set is not published and EDEADLK is returned.
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+@param[in]
+    pRuleSet
+        pointer to the new active rule set
+
+@retval EINVAL invalid argument
+@retval EDEADLK the calling thread holds the active rules
+@retval EOK the rule set was published
+
+==============================================================================*/
+int VarActionPublishRuleSet( VarActiveRules *pActive, VarRuleSet *pRuleSet )
+{
+    int result = EINVAL;
+    VarRuleSet *pOld;
+
+    if ( ( pActive != NULL ) &&
+         ( pRuleSet != NULL ) &&
+         ( FindEntered( pActive ) != NULL ) )
+    {
+        fprintf( stderr,
+                 "Cannot publish a rule set while evaluating it\n" );
+        result = EDEADLK;
+    }
+    else if ( ( pActive != NULL ) && ( pRuleSet != NULL ) )
+    {
+        pthread_mutex_lock( &pActive->lock );
+
+        pOld = atomic_exchange( &pActive->pCurrent, pRuleSet );
+        if ( pOld != pRuleSet )
+        {
+            WaitReaders( pActive );
+            VarActionFreeRuleSet( pOld );
+        }
+
+        pthread_mutex_unlock( &pActive->lock );
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionEnterRules                                                       */
+/*!
+    Get the active rule set for evaluation
+
+    The VarActionEnterRules function gets the active rule set and
+    prevents it from being freed until VarActionLeaveRules() is called
+    with the returned token.
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+@param[out]
+    pToken
+        pointer to the location to store the token for
+        VarActionLeaveRules()
+
+@retval pointer to the active rule set
+@retval NULL if there is no active rule set
+
+==============================================================================*/
+VarRuleSet *VarActionEnterRules( VarActiveRules *pActive, int *pToken )
+{
+    VarRuleSet *pRuleSet = NULL;
+    unsigned int i;
+
+    if ( ( pActive != NULL ) && ( pToken != NULL ) )
+    {
+        i = atomic_load( &pActive->index ) & 1;
+        atomic_fetch_add( &pActive->readers[i], 1 );
+        pRuleSet = atomic_load( &pActive->pCurrent );
+        *pToken = (int)i;
+        TrackEnter( pActive );
+    }
+
+    return pRuleSet;
+}
+
+/*============================================================================*/
+/*  VarActionLeaveRules                                                       */
+/*!
+    Release the rule set obtained with VarActionEnterRules()
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+@param[in]
+    token
+        token returned by VarActionEnterRules()
+
+==============================================================================*/
+void VarActionLeaveRules( VarActiveRules *pActive, int token )
+{
+    if ( pActive != NULL )
+    {
+        TrackLeave( pActive );
+
+        if ( ( atomic_fetch_sub( &pActive->readers[token & 1], 1 ) == 1 ) &&
+             ( atomic_load( &pActive->waiting ) == true ) )
+        {
+            /* the last reader of this count wakes the waiting publisher */
+            pthread_mutex_lock( &pActive->waitLock );
+            pthread_cond_broadcast( &pActive->drained );
+            pthread_mutex_unlock( &pActive->waitLock );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  VarActionEvaluateRules                                                    */
+/*!
+    Evaluate the active rule set
+
+    The VarActionEvaluateRules function evaluates the active rule set in
+    its own context, using its compiled program if it has one.
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EINVAL invalid argument
+@retval ENOENT there is no active rule set
+@retval EOK the rule set was evaluated successfully
+@retval other error returned by the evaluation
+
+==============================================================================*/
+int VarActionEvaluateRules( VarActiveRules *pActive,
+                            VARSERVER_HANDLE hVarServer )
+{
+    int result = EINVAL;
+    VarRuleSet *pRuleSet;
+    int token;
+
+    if ( ( pActive != NULL ) && ( hVarServer != NULL ) )
+    {
+        pRuleSet = VarActionEnterRules( pActive, &token );
+        if ( pRuleSet == NULL )
+        {
+            result = ENOENT;
+        }
+        else if ( pRuleSet->pProgram != NULL )
+        {
+            result = ExecProgramCtx( pRuleSet->pContext,
+                                     hVarServer,
+                                     pRuleSet->pProgram );
+        }
+        else
+        {
+            result = ProcessCompoundStatementCtx( pRuleSet->pContext,
+                                                  hVarServer,
+                                                  pRuleSet->pStatements );
+        }
+
+        VarActionLeaveRules( pActive, token );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  WaitReaders                                                               */
+/*!
+    Wait for the readers of the previous rule set
+
+    The WaitReaders function is called by a publisher after the active
+    rule set has been replaced.  It flips the reader count index and
+    waits for the count of the previous index to drain, twice, so every
+    reader which could have loaded the previous rule set has left.
+
+    The waiting flag is set before the count is checked, and a reader
+    checks the flag after decrementing the count, so either the
+    publisher sees the drained count or the last reader signals it.
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+==============================================================================*/
+static void WaitReaders( VarActiveRules *pActive )
+{
+    unsigned int i;
+    int phase;
+
+    pthread_mutex_lock( &pActive->waitLock );
+    atomic_store( &pActive->waiting, true );
+
+    for ( phase = 0; phase < 2; phase++ )
+    {
+        i = atomic_fetch_xor( &pActive->index, 1 ) & 1;
+        while ( atomic_load( &pActive->readers[i] ) != 0 )
+        {
+            pthread_cond_wait( &pActive->drained, &pActive->waitLock );
+        }
+    }
+
+    atomic_store( &pActive->waiting, false );
+    pthread_mutex_unlock( &pActive->waitLock );
+}
+
+/*============================================================================*/
+/*  FindEntered                                                               */
+/*!
+    Find active rules entered by the calling thread
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+@retval pointer to the calling thread's entry for the active rules
+@retval NULL if the calling thread has not entered them
+
+==============================================================================*/
+static VarEnteredRules *FindEntered( VarActiveRules *pActive )
+{
+    VarEnteredRules *pEntered = NULL;
+    int i;
+
+    for ( i = 0; ( i < RULESET_MAX_ENTERED ) && ( pEntered == NULL ); i++ )
+    {
+        if ( g_entered[i].pActive == pActive )
+        {
+            pEntered = &g_entered[i];
+        }
+    }
+
+    return pEntered;
+}
+
+/*============================================================================*/
+/*  TrackEnter                                                                */
+/*!
+    Record that the calling thread has entered active rules
+
+    If the thread already has RULESET_MAX_ENTERED different active rules
+    entered, the new ones are not recorded and publishing to them from
+    this thread is not detected.
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+==============================================================================*/
+static void TrackEnter( VarActiveRules *pActive )
+{
+    VarEnteredRules *pEntered;
+
+    pEntered = FindEntered( pActive );
+    if ( pEntered == NULL )
+    {
+        pEntered = FindEntered( NULL );
+        if ( pEntered != NULL )
+        {
+            pEntered->pActive = pActive;
+        }
+    }
+
+    if ( pEntered != NULL )
+    {
+        pEntered->depth++;
+    }
+}
+
+/*============================================================================*/
+/*  TrackLeave                                                                */
+/*!
+    Record that the calling thread has left active rules
+
+@param[in]
+    pActive
+        pointer to the active rules
+
+==============================================================================*/
+static void TrackLeave( VarActiveRules *pActive )
+{
+    VarEnteredRules *pEntered;
+
+    pEntered = FindEntered( pActive );
+    if ( pEntered != NULL )
+    {
+        pEntered->depth--;
+        if ( pEntered->depth <= 0 )
+        {
+            pEntered->pActive = NULL;
+            pEntered->depth = 0;
+        }
+    }
+}
+
+/*! @}
+ * end of varruleset group */
@@ -0,0 +1,916 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varscript varscript
+ * @brief Variable Action Script Asynchronous Script functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varscript.c
+
+    Variable Action Script Asynchronous Script functions
+
+    The Asynchronous Script functions run script statements in child
+    processes without blocking the calling thread.
+
+    Scripts which do not use any shell syntax are split into arguments
+    at white space and started directly with posix_spawnp().  Other
+    scripts, and scripts whose command is not found (such as shell
+    builtins), are started with /bin/sh -c, as system() would run them.
+
+    At most a configurable number of scripts run at once.  Scripts which
+    are started while the pool is full wait in a queue, in the order
+    they were started.
+
+    A reaper thread waits for the running scripts to exit, using a pidfd
+    for each child where the kernel supports it, or by checking the
+    children at a short interval otherwise.  When a script exits, its
+    wait status is recorded in its handle and the next queued script is
+    started.  The reaper only waits for the children it started, so the
+    application's own children are not affected, but the application
+    must not reap children with waitpid( -1, ... ) or ignore SIGCHLD.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <spawn.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <varaction/varaction.h>
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! default number of scripts which may run at once */
+#define SCRIPT_DEFAULT_POOL_SIZE    ( 4 )
+
+/*! interval (in milliseconds) at which children without a pidfd
+ *  are checked */
+#define SCRIPT_POLL_INTERVAL        ( 10 )
+
+/*! characters which require a script to be run by the shell */
+#define SCRIPT_SHELL_CHARS          "|&;<>()$`\\\"'*?[]#~=%{}!\n"
+
+/*! script handle states */
+#define SCRIPT_QUEUED               ( 0 )
+#define SCRIPT_RUNNING              ( 1 )
+#define SCRIPT_DONE                 ( 2 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! asynchronous script */
+struct _varScript
+{
+    /*! script command line */
+    char *script;
+
+    /*! SCRIPT_QUEUED, SCRIPT_RUNNING or SCRIPT_DONE */
+    int state;
+
+    /*! child process identifier */
+    pid_t pid;
+
+    /*! pidfd of the child process, or -1 */
+    int pidfd;
+
+    /*! wait status of the child process */
+    int status;
+
+    /*! EOK, or the error which prevented the script from running */
+    int result;
+
+    /*! true if the handle is released when the script completes */
+    bool detached;
+
+    /*! pointer to the next script in the queue or running list */
+    struct _varScript *pNext;
+};
+
+/*! script process pool */
+typedef struct _scriptPool
+{
+    /*! protects the pool and its script handles */
+    pthread_mutex_t lock;
+
+    /*! signalled when a script completes */
+    pthread_cond_t done;
+
+    /*! true once the reaper thread has been started */
+    bool started;
+
+    /*! eventfd used to wake the reaper thread */
+    int wakefd;
+
+    /*! maximum number of running scripts */
+    size_t size;
+
+    /*! number of running scripts */
+    size_t running;
+
+    /*! list of running scripts */
+    VarScript *pRunning;
+
+    /*! first queued script */
+    VarScript *pFirst;
+
+    /*! last queued script */
+    VarScript *pLast;
+
+} ScriptPool;
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! the script process pool */
+static ScriptPool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .wakefd = -1,
+    .size = SCRIPT_DEFAULT_POOL_SIZE
+};
+
+/*! process environment */
+extern char **environ;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int StartPool( void );
+static void *Reaper( void *arg );
+static void ReapScripts( void );
+static void StartQueued( void );
+static void Launch( VarScript *pScript );
+static int Spawn( const char *script, pid_t *pPid );
+static char **SplitArgs( const char *script );
+static int OpenPidfd( pid_t pid );
+static void Complete( VarScript *pScript, int status, int result );
+static void Wake( void );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionRunScript                                                        */
+/*!
+    Start a script without waiting for it to complete
+
+    The VarActionRunScript function starts a script in a child process,
+    or queues it if the maximum number of scripts are already running.
+    The returned handle is used to retrieve the completion status of the
+    script, and must be released with VarActionFreeScript().
+
+@param[in]
+    script
+        script command line
+
+@retval pointer to the script handle
+@retval NULL if the script could not be queued, with errno set to
+        EINVAL for an invalid argument, or ENOMEM or the error from
+        starting the reaper thread
+
+==============================================================================*/
+VarScript *VarActionRunScript( const char *script )
+{
+    VarScript *pScript = NULL;
+    int result = EINVAL;
+
+    if ( script != NULL )
+    {
+        result = ENOMEM;
+        pScript = calloc( 1, sizeof( VarScript ) );
+        if ( pScript != NULL )
+        {
+            pScript->script = strdup( script );
+            pScript->pidfd = -1;
+            pScript->state = SCRIPT_QUEUED;
+        }
+
+        if ( ( pScript != NULL ) && ( pScript->script != NULL ) )
+        {
+            pthread_mutex_lock( &pool.lock );
+
+            result = StartPool();
+            if ( result == EOK )
+            {
+                if ( pool.pLast != NULL )
+                {
+                    pool.pLast->pNext = pScript;
+                }
+                else
+                {
+                    pool.pFirst = pScript;
+                }
+
+                pool.pLast = pScript;
+                StartQueued();
+            }
+
+            pthread_mutex_unlock( &pool.lock );
+        }
+
+        if ( result != EOK )
+        {
+            if ( pScript != NULL )
+            {
+                free( pScript->script );
+                free( pScript );
+                pScript = NULL;
+            }
+
+            errno = result;
+        }
+    }
+    else
+    {
+        errno = result;
+    }
+
+    return pScript;
+}
+
+/*============================================================================*/
+/*  VarActionScriptStatus                                                     */
+/*!
+    Get the completion status of a script
+
+@param[in]
+    pScript
+        pointer to the script handle
+
+@param[out]
+    pStatus
+        pointer to the location to store the wait status of the script,
+        as returned by waitpid() (may be NULL)
+
+@retval EINVAL invalid argument
+@retval EINPROGRESS the script is queued or running
+@retval EOK the script has completed
+@retval other error which prevented the script from running
+
+==============================================================================*/
+int VarActionScriptStatus( VarScript *pScript, int *pStatus )
+{
+    int result = EINVAL;
+
+    if ( pScript != NULL )
+    {
+        pthread_mutex_lock( &pool.lock );
+
+        if ( pScript->state == SCRIPT_DONE )
+        {
+            result = pScript->result;
+            if ( pStatus != NULL )
+            {
+                *pStatus = pScript->status;
+            }
+        }
+        else
+        {
+            result = EINPROGRESS;
+        }
+
+        pthread_mutex_unlock( &pool.lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionWaitScript                                                       */
+/*!
+    Wait for a script to complete
+
+@param[in]
+    pScript
+        pointer to the script handle
+
+@param[out]
+    pStatus
+        pointer to the location to store the wait status of the script,
+        as returned by waitpid() (may be NULL)
+
+@retval EINVAL invalid argument
+@retval EOK the script has completed
+@retval other error which prevented the script from running
+
+==============================================================================*/
+int VarActionWaitScript( VarScript *pScript, int *pStatus )
+{
+    int result = EINVAL;
+
+    if ( pScript != NULL )
+    {
+        pthread_mutex_lock( &pool.lock );
+
+        while ( pScript->state != SCRIPT_DONE )
+        {
+            pthread_cond_wait( &pool.done, &pool.lock );
+        }
+
+        result = pScript->result;
+        if ( pStatus != NULL )
+        {
+            *pStatus = pScript->status;
+        }
+
+        pthread_mutex_unlock( &pool.lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionFreeScript                                                       */
+/*!
+    Release a script handle
+
+    A script which has not completed continues to run, and its handle
+    is released when it completes.
+
+@param[in]
+    pScript
+        pointer to the script handle (may be NULL)
+
+==============================================================================*/
+void VarActionFreeScript( VarScript *pScript )
+{
+    bool done = false;
+
+    if ( pScript != NULL )
+    {
+        pthread_mutex_lock( &pool.lock );
+
+        if ( pScript->state == SCRIPT_DONE )
+        {
+            done = true;
+        }
+        else
+        {
+            pScript->detached = true;
+        }
+
+        pthread_mutex_unlock( &pool.lock );
+
+        if ( done == true )
+        {
+            free( pScript->script );
+            free( pScript );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  VarActionSetScriptPool                                                    */
+/*!
+    Set the maximum number of scripts which run at once
+
+    If the pool is made larger, queued scripts are started immediately.
+    If it is made smaller, running scripts are not affected.
+
+@param[in]
+    size
+        maximum number of running scripts
+
+@retval EINVAL invalid pool size
+@retval EOK the pool size was set
+
+==============================================================================*/
+int VarActionSetScriptPool( size_t size )
+{
+    int result = EINVAL;
+
+    if ( size > 0 )
+    {
+        pthread_mutex_lock( &pool.lock );
+
+        pool.size = size;
+        if ( pool.started == true )
+        {
+            StartQueued();
+        }
+
+        pthread_mutex_unlock( &pool.lock );
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionWaitScripts                                                      */
+/*!
+    Wait for all queued and running scripts to complete
+
+==============================================================================*/
+void VarActionWaitScripts( void )
+{
+    pthread_mutex_lock( &pool.lock );
+
+    while ( ( pool.pRunning != NULL ) || ( pool.pFirst != NULL ) )
+    {
+        pthread_cond_wait( &pool.done, &pool.lock );
+    }
+
+    pthread_mutex_unlock( &pool.lock );
+}
+
+/*============================================================================*/
+/*  StartPool                                                                 */
+/*!
+    Start the reaper thread
+
+    The StartPool function is called with the pool lock held.
+
+@retval EOK the reaper thread is running
+@retval other error from creating the eventfd or the thread
+
+==============================================================================*/
+static int StartPool( void )
+{
+    int result = EOK;
+    pthread_t thread;
+
+    if ( pool.started == false )
+    {
+        pool.wakefd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+        if ( pool.wakefd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            result = pthread_create( &thread, NULL, Reaper, NULL );
+            if ( result == EOK )
+            {
+                pthread_detach( thread );
+                pool.started = true;
+            }
+            else
+            {
+                close( pool.wakefd );
+                pool.wakefd = -1;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Reaper                                                                    */
+/*!
+    Wait for running scripts to exit
+
+    The Reaper thread polls the pidfds of the running scripts and the
+    pool's eventfd.  Running scripts without a pidfd are checked at
+    SCRIPT_POLL_INTERVAL.
+
+@param[in]
+    arg
+        unused
+
+@retval NULL
+
+==============================================================================*/
+static void *Reaper( void *arg )
+{
+    struct pollfd *pFds = NULL;
+    struct pollfd *p;
+    size_t size = 0;
+    size_t n;
+    int timeout;
+    uint64_t count;
+    VarScript *pScript;
+
+    (void)arg;
+
+    while ( true )
+    {
+        pthread_mutex_lock( &pool.lock );
+
+        if ( pool.running + 1 > size )
+        {
+            p = realloc( pFds, ( pool.running + 1 ) * sizeof( struct pollfd ) );
+            if ( p != NULL )
+            {
+                pFds = p;
+                size = pool.running + 1;
+            }
+        }
+
+        n = 0;
+        timeout = -1;
+        if ( pFds != NULL )
+        {
+            pFds[n].fd = pool.wakefd;
+            pFds[n++].events = POLLIN;
+        }
+
+        for ( pScript = pool.pRunning;
+              pScript != NULL;
+              pScript = pScript->pNext )
+        {
+            if ( ( pScript->pidfd != -1 ) && ( n < size ) )
+            {
+                pFds[n].fd = pScript->pidfd;
+                pFds[n++].events = POLLIN;
+            }
+            else
+            {
+                timeout = SCRIPT_POLL_INTERVAL;
+            }
+        }
+
+        pthread_mutex_unlock( &pool.lock );
+
+        if ( n > 0 )
+        {
+            (void)poll( pFds, n, timeout );
+        }
+        else
+        {
+            (void)poll( NULL, 0, SCRIPT_POLL_INTERVAL );
+        }
+
+        (void)read( pool.wakefd, &count, sizeof( count ) );
+
+        pthread_mutex_lock( &pool.lock );
+        ReapScripts();
+        StartQueued();
+        pthread_mutex_unlock( &pool.lock );
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  ReapScripts                                                               */
+/*!
+    Collect the running scripts which have exited
+
+    The ReapScripts function is called with the pool lock held.
+
+==============================================================================*/
+static void ReapScripts( void )
+{
+    VarScript **ppScript = &pool.pRunning;
+    VarScript *pScript;
+    pid_t pid;
+    int status;
+
+    while ( ( pScript = *ppScript ) != NULL )
+    {
+        pid = waitpid( pScript->pid, &status, WNOHANG );
+        if ( ( pid == 0 ) || ( ( pid == -1 ) && ( errno == EINTR ) ) )
+        {
+            ppScript = &pScript->pNext;
+        }
+        else
+        {
+            *ppScript = pScript->pNext;
+            pool.running--;
+
+            if ( pScript->pidfd != -1 )
+            {
+                close( pScript->pidfd );
+                pScript->pidfd = -1;
+            }
+
+            Complete( pScript,
+                      ( pid == pScript->pid ) ? status : -1,
+                      ( pid == pScript->pid ) ? EOK : errno );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  StartQueued                                                               */
+/*!
+    Start queued scripts while the pool has room
+
+    The StartQueued function is called with the pool lock held.
+
+==============================================================================*/
+static void StartQueued( void )
+{
+    VarScript *pScript;
+    bool started = false;
+
+    while ( ( pool.pFirst != NULL ) && ( pool.running < pool.size ) )
+    {
+        pScript = pool.pFirst;
+        pool.pFirst = pScript->pNext;
+        if ( pool.pFirst == NULL )
+        {
+            pool.pLast = NULL;
+        }
+
+        pScript->pNext = NULL;
+        Launch( pScript );
+        started = true;
+    }
+
+    if ( started == true )
+    {
+        /* the reaper must poll the new children */
+        Wake();
+    }
+}
+
+/*============================================================================*/
+/*  Launch                                                                    */
+/*!
+    Start a script process
+
+    The Launch function is called with the pool lock held.  A script
+    which cannot be started is completed with the spawn error.
+
+@param[in]
+    pScript
+        pointer to the script handle
+
+==============================================================================*/
+static void Launch( VarScript *pScript )
+{
+    int result;
+
+    result = Spawn( pScript->script, &pScript->pid );
+    if ( result == EOK )
+    {
+        pScript->state = SCRIPT_RUNNING;
+        pScript->pidfd = OpenPidfd( pScript->pid );
+        pScript->pNext = pool.pRunning;
+        pool.pRunning = pScript;
+        pool.running++;
+    }
+    else
+    {
+        fprintf( stderr,
+                 "Cannot run script %s: %s\n",
+                 pScript->script,
+                 strerror( result ) );
+
+        Complete( pScript, -1, result );
+    }
+}
+
+/*============================================================================*/
+/*  Spawn                                                                     */
+/*!
+    Create the process for a script
+
+    Scripts without shell syntax are run directly.  Other scripts, and
+    scripts whose command cannot be run directly, are run with /bin/sh -c.
+
+@param[in]
+    script
+        script command line
+
+@param[out]
+    pPid
+        pointer to the location to store the process identifier
+
+@retval EOK the process was created
+@retval other error from posix_spawn()
+
+==============================================================================*/
+static int Spawn( const char *script, pid_t *pPid )
+{
+    int result;
+    char **argv;
+    char *shell[] = { "sh", "-c", (char *)script, NULL };
+    posix_spawnattr_t attr;
+    sigset_t mask;
+
+    posix_spawnattr_init( &attr );
+    sigemptyset( &mask );
+    posix_spawnattr_setsigmask( &attr, &mask );
+    posix_spawnattr_setflags( &attr, POSIX_SPAWN_SETSIGMASK );
+
+    argv = ( strpbrk( script, SCRIPT_SHELL_CHARS ) == NULL )
+           ? SplitArgs( script )
+           : NULL;
+    if ( argv != NULL )
+    {
+        result = posix_spawnp( pPid, argv[0], NULL, &attr, argv, environ );
+        free( argv );
+    }
+    else
+    {
+        result = ENOENT;
+    }
+
+    if ( result != EOK )
+    {
+        /* shell syntax, or a shell builtin such as cd or exit */
+        result = posix_spawn( pPid, "/bin/sh", NULL, &attr, shell, environ );
+    }
+
+    posix_spawnattr_destroy( &attr );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SplitArgs                                                                 */
+/*!
+    Split a script command line into arguments
+
+    The SplitArgs function splits a command line which does not contain
+    shell syntax into its white space separated arguments.  The argument
+    vector and the argument strings are allocated in a single block.
+
+@param[in]
+    script
+        script command line
+
+@retval pointer to a NULL terminated argument vector
+@retval NULL if the command line is empty or memory could not be allocated
+
+==============================================================================*/
+static char **SplitArgs( const char *script )
+{
+    char **argv = NULL;
+    size_t len = strlen( script );
+    size_t n = 0;
+    size_t i;
+    bool inArg = false;
+    char *p;
+
+    for ( i = 0; i < len; i++ )
+    {
+        if ( ( script[i] != ' ' ) && ( script[i] != '\t' ) )
+        {
+            n += ( inArg == false ) ? 1 : 0;
+            inArg = true;
+        }
+        else
+        {
+            inArg = false;
+        }
+    }
+
+    if ( n > 0 )
+    {
+        argv = malloc( ( ( n + 1 ) * sizeof( char * ) ) + len + 1 );
+    }
+
+    if ( argv != NULL )
+    {
+        p = (char *)&argv[n + 1];
+        memcpy( p, script, len + 1 );
+
+        n = 0;
+        inArg = false;
+        for ( i = 0; i < len; i++ )
+        {
+            if ( ( p[i] == ' ' ) || ( p[i] == '\t' ) )
+            {
+                p[i] = '\0';
+                inArg = false;
+            }
+            else if ( inArg == false )
+            {
+                argv[n++] = &p[i];
+                inArg = true;
+            }
+        }
+
+        argv[n] = NULL;
+    }
+
+    return argv;
+}
+
+/*============================================================================*/
+/*  OpenPidfd                                                                 */
+/*!
+    Open a pidfd for a child process
+
+@param[in]
+    pid
+        child process identifier
+
+@retval the pidfd of the process
+@retval -1 if pidfds are not supported
+
+==============================================================================*/
+static int OpenPidfd( pid_t pid )
+{
+    int fd = -1;
+
+#if defined(SYS_pidfd_open)
+    fd = (int)syscall( SYS_pidfd_open, pid, 0 );
+    if ( fd < 0 )
+    {
+        fd = -1;
+    }
+#else
+    (void)pid;
+#endif
+
+    return fd;
+}
+
+/*============================================================================*/
+/*  Complete                                                                  */
+/*!
+    Record the completion of a script
+
+    The Complete function is called with the pool lock held.  Detached
+    script handles are released.
+
+@param[in]
+    pScript
+        pointer to the script handle
+
+@param[in]
+    status
+        wait status of the script process
+
+@param[in]
+    result
+        EOK, or the error which prevented the script from running
+
+==============================================================================*/
+static void Complete( VarScript *pScript, int status, int result )
+{
+    pScript->state = SCRIPT_DONE;
+    pScript->status = status;
+    pScript->result = result;
+    pScript->pNext = NULL;
+
+    if ( pScript->detached == true )
+    {
+        free( pScript->script );
+        free( pScript );
+    }
+
+    pthread_cond_broadcast( &pool.done );
+}
+
+/*============================================================================*/
+/*  Wake                                                                      */
+/*!
+    Wake the reaper thread so it polls the current running scripts
+
+==============================================================================*/
+static void Wake( void )
+{
+    uint64_t one = 1;
+
+    if ( pool.wakefd != -1 )
+    {
+        (void)write( pool.wakefd, &one, sizeof( one ) );
+    }
+}
+
+/*! @}
+ * end of varscript group */
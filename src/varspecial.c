@@ -0,0 +1,426 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varspecial varspecial
+ * @brief Variable Action Script Type Specialized Operation functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varspecial.c
+
+    Variable Action Script Type Specialized Operation functions
+
+    The generic operation functions switch on the type of their left
+    operand every time they are called.  When the type of the left
+    operand is known while the tree is being built, SelectOperation()
+    chooses a variant of the operation which is specialized for that
+    type, and CreateVariable() stores it in the node so evaluation does
+    no type dispatch.
+
+    The variants are generated from the operation tables below for each
+    of the supported variable server types (uint16, uint32, float and
+    string), so they always perform the same operations as the generic
+    operation functions.  Like the generic functions, a variant reads its
+    right operand using the type of its left operand.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "varspecial.h"
+#include "varstrings.h"
+#include "varwrite.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! numeric types: X( suffix, value field, variable type, C type ) */
+#define VA_NUMERIC_TYPES( X, ... ) \
+    X( u16, ui, VARTYPE_UINT16, uint16_t, __VA_ARGS__ ) \
+    X( u32, ul, VARTYPE_UINT32, uint32_t, __VA_ARGS__ ) \
+    X( f,   f,  VARTYPE_FLOAT,  float,    __VA_ARGS__ )
+
+/*! integer types: X( suffix, value field, variable type, C type ) */
+#define VA_INTEGER_TYPES( X, ... ) \
+    X( u16, ui, VARTYPE_UINT16, uint16_t, __VA_ARGS__ ) \
+    X( u32, ul, VARTYPE_UINT32, uint32_t, __VA_ARGS__ )
+
+/*! arithmetic operations: X( operation, name, operator ) */
+#define VA_ARITHMETIC_OPS( X ) \
+    X( VA_MUL, Multiply, * ) \
+    X( VA_DIV, Divide,   / ) \
+    X( VA_ADD, Add,      + ) \
+    X( VA_SUB, Sub,      - )
+
+/*! integer operations: X( operation, name, operator ) */
+#define VA_INTEGER_OPS( X ) \
+    X( VA_BAND,   Band,   &  ) \
+    X( VA_BOR,    Bor,    |  ) \
+    X( VA_XOR,    Xor,    ^  ) \
+    X( VA_LSHIFT, LShift, << ) \
+    X( VA_RSHIFT, RShift, >> )
+
+/*! logical operations: X( operation, name, operator ) */
+#define VA_LOGICAL_OPS( X ) \
+    X( VA_AND, And, && ) \
+    X( VA_OR,  Or,  || )
+
+/*! comparison operations: X( operation, name, operator ) */
+#define VA_COMPARE_OPS( X ) \
+    X( VA_EQUALS,    Equals,             == ) \
+    X( VA_NOTEQUALS, NotEquals,          != ) \
+    X( VA_GT,        GreaterThan,        >  ) \
+    X( VA_LT,        LessThan,           <  ) \
+    X( VA_GTE,       GreaterThanOrEqual, >= ) \
+    X( VA_LTE,       LessThanOrEqual,    <= )
+
+/*! type slots of the variant table */
+#define VA_SLOT_u16     ( 0 )
+#define VA_SLOT_u32     ( 1 )
+#define VA_SLOT_f       ( 2 )
+#define VA_SLOT_str     ( 3 )
+#define VA_SLOTS        ( 4 )
+
+/*! define a variant which calculates result = left op right */
+#define VA_DEFINE_ARITHMETIC( suffix, field, vtype, ctype, name, op ) \
+static int name##_##suffix( VARSERVER_HANDLE hVarServer, \
+                            Variable *pResult, \
+                            Variable *pLeft, \
+                            Variable *pRight ) \
+{ \
+    (void)hVarServer; \
+    pResult->obj.val.field = pLeft->obj.val.field op pRight->obj.val.field; \
+    pResult->obj.type = vtype; \
+    pResult->obj.len = sizeof( ctype ); \
+    return EOK; \
+}
+
+/*! define a variant which calculates the 16-bit truth of left op right */
+#define VA_DEFINE_COMPARE( suffix, field, vtype, ctype, name, op ) \
+static int name##_##suffix( VARSERVER_HANDLE hVarServer, \
+                            Variable *pResult, \
+                            Variable *pLeft, \
+                            Variable *pRight ) \
+{ \
+    (void)hVarServer; \
+    pResult->obj.val.ui = ( pLeft->obj.val.field op pRight->obj.val.field ); \
+    pResult->obj.type = VARTYPE_UINT16; \
+    pResult->obj.len = sizeof( uint16_t ); \
+    return EOK; \
+}
+
+/*! define a variant which compares two strings */
+#define VA_DEFINE_COMPARE_STR( opid, name, op ) \
+static int name##_str( VARSERVER_HANDLE hVarServer, \
+                       Variable *pResult, \
+                       Variable *pLeft, \
+                       Variable *pRight ) \
+{ \
+    (void)hVarServer; \
+    pResult->obj.val.ui = ( CompareStrings( pLeft, \
+                                            pRight, \
+                                            ( opid == VA_EQUALS ) || \
+                                            ( opid == VA_NOTEQUALS ) ) \
+                            op 0 ); \
+    pResult->obj.type = VARTYPE_UINT16; \
+    pResult->obj.len = sizeof( uint16_t ); \
+    return EOK; \
+}
+
+/*! define an assignment variant: result <= left <= right */
+#define VA_DEFINE_ASSIGN( suffix, field, vtype, ctype, ... ) \
+static int Assign_##suffix( VARSERVER_HANDLE hVarServer, \
+                            Variable *pResult, \
+                            Variable *pLeft, \
+                            Variable *pRight ) \
+{ \
+    int result = EOK; \
+    pResult->obj.val.field = pLeft->obj.val.field = pRight->obj.val.field; \
+    pResult->obj.type = vtype; \
+    pResult->obj.len = sizeof( ctype ); \
+    if ( pLeft->operation == VA_SYSVAR ) \
+    { \
+        result = SetVar( hVarServer, pLeft ); \
+    } \
+    return result; \
+}
+
+/*! define the numeric variants of an operation */
+#define VA_NUMERIC_VARIANTS( opid, name, op ) \
+    VA_NUMERIC_TYPES( VA_DEFINE_ARITHMETIC, name, op )
+
+/*! define the integer variants of an operation */
+#define VA_INTEGER_VARIANTS( opid, name, op ) \
+    VA_INTEGER_TYPES( VA_DEFINE_ARITHMETIC, name, op )
+
+/*! define the integer truth variants of an operation */
+#define VA_LOGICAL_VARIANTS( opid, name, op ) \
+    VA_INTEGER_TYPES( VA_DEFINE_COMPARE, name, op )
+
+/*! define the numeric and string comparison variants of an operation */
+#define VA_COMPARE_VARIANTS( opid, name, op ) \
+    VA_NUMERIC_TYPES( VA_DEFINE_COMPARE, name, op ) \
+    VA_DEFINE_COMPARE_STR( opid, name, op )
+
+/*! variant table entry */
+#define VA_ENTRY( suffix, field, vtype, ctype, opid, name ) \
+    [opid][VA_SLOT_##suffix] = name##_##suffix,
+
+/*! variant table entries for the numeric variants of an operation */
+#define VA_NUMERIC_ENTRIES( opid, name, op ) \
+    VA_NUMERIC_TYPES( VA_ENTRY, opid, name )
+
+/*! variant table entries for the integer variants of an operation */
+#define VA_INTEGER_ENTRIES( opid, name, op ) \
+    VA_INTEGER_TYPES( VA_ENTRY, opid, name )
+
+/*! variant table entries for the comparison variants of an operation */
+#define VA_COMPARE_ENTRIES( opid, name, op ) \
+    VA_NUMERIC_TYPES( VA_ENTRY, opid, name ) \
+    [opid][VA_SLOT_str] = name##_str,
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static int Add_str( VARSERVER_HANDLE hVarServer,
+                    Variable *pResult,
+                    Variable *pLeft,
+                    Variable *pRight );
+static int Assign_str( VARSERVER_HANDLE hVarServer,
+                       Variable *pResult,
+                       Variable *pLeft,
+                       Variable *pRight );
+static int TypeSlot( int type );
+
+/*==============================================================================
+       Operation variants
+==============================================================================*/
+
+VA_ARITHMETIC_OPS( VA_NUMERIC_VARIANTS )
+VA_INTEGER_OPS( VA_INTEGER_VARIANTS )
+VA_LOGICAL_OPS( VA_LOGICAL_VARIANTS )
+VA_COMPARE_OPS( VA_COMPARE_VARIANTS )
+VA_NUMERIC_TYPES( VA_DEFINE_ASSIGN, Assign )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! operation variants indexed by operation and left operand type slot */
+static const opfn g_variants[VA_OP_MAX][VA_SLOTS] =
+{
+    VA_ARITHMETIC_OPS( VA_NUMERIC_ENTRIES )
+    VA_INTEGER_OPS( VA_INTEGER_ENTRIES )
+    VA_LOGICAL_OPS( VA_INTEGER_ENTRIES )
+    VA_COMPARE_OPS( VA_COMPARE_ENTRIES )
+    VA_NUMERIC_ENTRIES( VA_ASSIGN, Assign, = )
+    [VA_ADD][VA_SLOT_str] = Add_str,
+    [VA_ASSIGN][VA_SLOT_str] = Assign_str,
+};
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  SelectOperation                                                           */
+/*!
+    Select a type specialized operation for a node
+
+    The SelectOperation function selects the variant of a node's
+    operation which is specialized for the type of its left operand.
+    A variant is only selected for a node with both operands whose
+    left operand type is known before it is evaluated.
+
+@param[in]
+    pVariable
+        pointer to the node
+
+@retval pointer to the specialized operation function
+@retval NULL if the generic operation function must be used
+
+==============================================================================*/
+opfn SelectOperation( Variable *pVariable )
+{
+    opfn fn = NULL;
+    int slot;
+
+    if ( ( pVariable != NULL ) &&
+         ( pVariable->left != NULL ) &&
+         ( pVariable->right != NULL ) &&
+         ( pVariable->operation > VA_ILLEGAL ) &&
+         ( pVariable->operation < VA_OP_MAX ) )
+    {
+        slot = TypeSlot( ResultType( pVariable->left ) );
+        if ( slot >= 0 )
+        {
+            fn = g_variants[pVariable->operation][slot];
+        }
+    }
+
+    return fn;
+}
+
+/*============================================================================*/
+/*  Add_str                                                                   */
+/*!
+    Add two strings
+
+    The Add_str function is the string variant of the Add operation.
+
+@param[in]
+    hVarServer
+        handle to the variable server (unused)
+
+@param[in]
+    pResult
+        pointer to the result node
+
+@param[in]
+    pLeft
+        pointer to the left node
+
+@param[in]
+    pRight
+        pointer to the right node
+
+@retval EOK the strings were added
+@retval other error from AddString()
+
+==============================================================================*/
+static int Add_str( VARSERVER_HANDLE hVarServer,
+                    Variable *pResult,
+                    Variable *pLeft,
+                    Variable *pRight )
+{
+    (void)hVarServer;
+
+    return AddString( pResult, pLeft, pRight );
+}
+
+/*============================================================================*/
+/*  Assign_str                                                                */
+/*!
+    Assign a string
+
+    The Assign_str function is the string variant of the Assign operation.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pResult
+        pointer to the result node
+
+@param[in]
+    pLeft
+        pointer to the left node
+
+@param[in]
+    pRight
+        pointer to the right node
+
+@retval EOK the string was assigned
+@retval other error from AssignString() or SetVar()
+
+==============================================================================*/
+static int Assign_str( VARSERVER_HANDLE hVarServer,
+                       Variable *pResult,
+                       Variable *pLeft,
+                       Variable *pRight )
+{
+    int result;
+
+    result = AssignString( pResult, pLeft, pRight );
+    if ( ( result == EOK ) &&
+         ( pLeft->operation == VA_SYSVAR ) )
+    {
+        result = SetVar( hVarServer, pLeft );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  TypeSlot                                                                  */
+/*!
+    Map a variable type to a variant table slot
+
+@param[in]
+    type
+        variable type
+
+@retval the variant table slot for the type
+@retval -1 if the type has no variants
+
+==============================================================================*/
+static int TypeSlot( int type )
+{
+    int slot;
+
+    switch( type )
+    {
+        case VARTYPE_UINT16:
+            slot = VA_SLOT_u16;
+            break;
+
+        case VARTYPE_UINT32:
+            slot = VA_SLOT_u32;
+            break;
+
+        case VARTYPE_FLOAT:
+            slot = VA_SLOT_f;
+            break;
+
+        case VARTYPE_STR:
+            slot = VA_SLOT_str;
+            break;
+
+        default:
+            slot = -1;
+            break;
+    }
+
+    return slot;
+}
+
+/*! @}
+ * end of varspecial group */
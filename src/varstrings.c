@@ -37,6 +37,18 @@ SOFTWARE.
     The Variable Action Script String Support functions provide functions
     for handling string variables in var/action scripts.
 
+    A string node either owns its value, in its inline buffer
+    (VF_INLINE_STR) when the value is shorter than VA_SSO_SIZE or in a
+    heap buffer (VF_HEAP_STR), or it references a value it does not own:
+    a string constant, an arena string (VF_ARENA_STR), another node's
+    value, or a value returned by the variable server (VF_BORROWED_STR).
+    Referenced values are never modified; AllocateString() moves the
+    value into storage owned by the node before it is written.
+
+    String constants are interned (VF_INTERNED_STR), and the flag follows
+    the value when it is assigned to a variable, so two interned values
+    are equal only if they reference the same storage.
+
 */
 /*============================================================================*/
 
@@ -58,17 +70,25 @@ SOFTWARE.
        Function declarations
 ==============================================================================*/
 
+static int MoveString( Variable *pVariable, size_t len );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
 /*============================================================================*/
 /*  AllocateString                                                            */
 /*!
     Allocate string memory for a string of specified length
 
-    The AllocateString function allocates memory for a string of the
-    specified length in the specified variable node.
+    The AllocateString function makes sure the specified variable node
+    owns a string buffer which can hold a string of the specified length.
+    The current value of the string is preserved.
 
-    If the specified string length is less than 32, then a 32-byte buffer
-    will be allocated, otherwise a buffer of sufficient size to hold the
-    string's specified length will be allocated.
+    Strings shorter than VA_SSO_SIZE are stored in the node's inline
+    buffer.  Longer strings are stored in a heap buffer of at least
+    32 bytes.  A string which the node does not own is copied into
+    storage owned by the node.
 
 @param[in]
     pVariable
@@ -88,57 +108,45 @@ int AllocateString( Variable *pVariable, size_t len )
 {
     int result = EINVAL;
     size_t bufsize;
+    char *str;
 
     if ( pVariable != NULL )
     {
         if( pVariable->obj.type == VARTYPE_STR )
         {
-            /* calculate the string buffer size
-             * which is a minimum of 32 bytes */
-            bufsize = ( len < 32 ) ? 32 : len + 1;
-
-            /* check if we need to reallocate an existing buffer */
             if ( ( pVariable->obj.val.str != NULL ) &&
-                 ( pVariable->bufsize <= len ) )
+                 ( pVariable->flags & ( VF_HEAP_STR | VF_INLINE_STR ) ) &&
+                 ( pVariable->bufsize > len ) )
             {
-                /* re-allocate the previous buffer */
-                pVariable->obj.val.str = realloc( pVariable->obj.val.str,
-                                                  bufsize );
-                if( pVariable->obj.val.str != NULL )
-                {
-                    /* success - set the buffer size */
-                    pVariable->bufsize = bufsize;
-                    result = EOK;
-                }
-                else
-                {
-                    /* cannot allocate memory for the string */
-                    pVariable->bufsize = 0;
-                    result = ENOMEM;
-                }
+                /* the owned buffer is already big enough */
+                result = EOK;
             }
-
-            /* check if we need to allocate a new buffer */
-            if ( pVariable->obj.val.str == NULL )
+            else if ( ( pVariable->obj.val.str != NULL ) &&
+                      ( pVariable->flags & VF_HEAP_STR ) )
             {
-                /* allocate space for the new string */
-                pVariable->obj.val.str = malloc( bufsize );
-                if( pVariable->obj.val.str != NULL )
+                /* calculate the string buffer size
+                 * which is a minimum of 32 bytes */
+                bufsize = ( len < 32 ) ? 32 : len + 1;
+
+                /* re-allocate the previous buffer */
+                str = realloc( pVariable->obj.val.str, bufsize );
+                if( str != NULL )
                 {
                     /* success - set the buffer size */
+                    pVariable->obj.val.str = str;
                     pVariable->bufsize = bufsize;
                     result = EOK;
                 }
                 else
                 {
                     /* cannot allocate memory for the string */
-                    pVariable->bufsize = 0;
                     result = ENOMEM;
                 }
             }
             else
             {
-                result = EOK;
+                /* move the string into storage owned by the node */
+                result = MoveString( pVariable, len );
             }
         }
         else
@@ -151,6 +159,243 @@ int AllocateString( Variable *pVariable, size_t len )
     return result;
 }
 
+/*============================================================================*/
+/*  MoveString                                                                */
+/*!
+    Move a string into storage owned by a variable node
+
+    The MoveString function copies the string value of a variable node
+    which it does not own (or which has outgrown its inline buffer)
+    into the node's inline buffer if it fits, or into a new heap buffer.
+
+@param[in]
+    pVariable
+        pointer to the Variable node
+
+@param[in]
+    len
+        the length of the string we need to accomodate
+
+@retval ENOMEM memory allocation failure
+@retval EOK the string is stored in a buffer owned by the node
+
+==============================================================================*/
+static int MoveString( Variable *pVariable, size_t len )
+{
+    int result = ENOMEM;
+    const char *old = pVariable->obj.val.str;
+    size_t oldlen = ( old != NULL ) ? strlen( old ) : 0;
+    size_t bufsize;
+    uint8_t flags;
+    char *str;
+
+    if ( oldlen > len )
+    {
+        len = oldlen;
+    }
+
+    if ( ( len < VA_SSO_SIZE ) &&
+         ( ( pVariable->flags & VF_INLINE_STR ) == 0 ) )
+    {
+        str = pVariable->sso;
+        bufsize = VA_SSO_SIZE;
+        flags = VF_INLINE_STR;
+    }
+    else
+    {
+        /* calculate the string buffer size
+         * which is a minimum of 32 bytes */
+        bufsize = ( len < 32 ) ? 32 : len + 1;
+        str = malloc( bufsize );
+        flags = VF_HEAP_STR;
+    }
+
+    if ( str != NULL )
+    {
+        if ( old != NULL )
+        {
+            memcpy( str, old, oldlen );
+        }
+
+        str[oldlen] = 0;
+
+        pVariable->obj.val.str = str;
+        pVariable->bufsize = bufsize;
+        pVariable->flags &= ~( VF_ARENA_STR |
+                               VF_HEAP_STR |
+                               VF_INLINE_STR |
+                               VF_BORROWED_STR |
+                               VF_INTERNED_STR );
+        pVariable->flags |= flags;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ShareString                                                               */
+/*!
+    Reference the string value of another node
+
+    The ShareString function makes the result node reference the string
+    value of the source node without copying it.  The result node does
+    not own the value.
+
+@param[in]
+    pResult
+        pointer to the result node
+
+@param[in]
+    pSource
+        pointer to the node whose string value is referenced
+
+==============================================================================*/
+void ShareString( Variable *pResult, Variable *pSource )
+{
+    if ( ( pResult != NULL ) &&
+         ( pSource != NULL ) &&
+         ( pResult != pSource ) )
+    {
+        pResult->obj.val.str = pSource->obj.val.str;
+        pResult->obj.len = pSource->obj.len;
+        pResult->obj.type = VARTYPE_STR;
+        pResult->bufsize = pSource->bufsize;
+        pResult->flags &= ~( VF_ARENA_STR |
+                             VF_HEAP_STR |
+                             VF_INLINE_STR |
+                             VF_INTERNED_STR );
+        pResult->flags |= VF_BORROWED_STR |
+                          ( pSource->flags & VF_INTERNED_STR );
+    }
+}
+
+/*============================================================================*/
+/*  ReferenceString                                                           */
+/*!
+    Mark a string value as referenced
+
+    The ReferenceString function marks the string value of a node as
+    storage owned elsewhere, for example the buffer returned by VAR_Get(),
+    so it is copied rather than reallocated if the node is written.
+
+@param[in]
+    pVariable
+        pointer to the Variable node
+
+==============================================================================*/
+void ReferenceString( Variable *pVariable )
+{
+    if ( ( pVariable != NULL ) &&
+         ( pVariable->obj.type == VARTYPE_STR ) )
+    {
+        pVariable->flags &= ~( VF_ARENA_STR |
+                               VF_HEAP_STR |
+                               VF_INLINE_STR |
+                               VF_INTERNED_STR );
+        pVariable->flags |= VF_BORROWED_STR;
+        pVariable->bufsize = pVariable->obj.len;
+    }
+}
+
+/*============================================================================*/
+/*  ReleaseString                                                             */
+/*!
+    Release the string buffer owned by a node
+
+    The ReleaseString function frees the heap buffer owned by a node before
+    its value is replaced by a value it does not own.
+
+@param[in]
+    pVariable
+        pointer to the Variable node
+
+==============================================================================*/
+void ReleaseString( Variable *pVariable )
+{
+    if ( ( pVariable != NULL ) &&
+         ( pVariable->flags & VF_HEAP_STR ) )
+    {
+        free( pVariable->obj.val.str );
+        pVariable->obj.val.str = NULL;
+        pVariable->bufsize = 0;
+        pVariable->flags &= ~VF_HEAP_STR;
+    }
+}
+
+/*============================================================================*/
+/*  CompareStrings                                                            */
+/*!
+    Compare two string values
+
+    The CompareStrings function compares two string values in the same
+    way as strcmp(), where a NULL string is equal to another NULL string
+    and less than any other string.
+
+    Values which reference the same string are equal without being
+    compared.  When only equality is required, two different interned
+    strings are unequal, and strings of different lengths are rejected
+    before their bytes are compared; the non-zero result then indicates
+    a mismatch but not an order.
+
+@param[in]
+    pLeft
+        pointer to the left node
+
+@param[in]
+    pRight
+        pointer to the right node
+
+@param[in]
+    equality
+        true if only equality is required
+
+@retval <0 the left string is less than the right string
+@retval 0 the strings are equal
+@retval >0 the left string is greater than the right string
+
+==============================================================================*/
+int CompareStrings( Variable *pLeft, Variable *pRight, bool equality )
+{
+    const char *pLeftStr = pLeft->obj.val.str;
+    const char *pRightStr = pRight->obj.val.str;
+    int result;
+
+    if ( pLeftStr == pRightStr )
+    {
+        /* both operands reference the same string */
+        result = 0;
+    }
+    else if ( ( pLeftStr != NULL ) &&
+              ( pRightStr != NULL ) )
+    {
+        if ( equality == false )
+        {
+            result = strcmp( pLeftStr, pRightStr );
+        }
+        else if ( ( pLeft->flags & pRight->flags & VF_INTERNED_STR ) ||
+                  ( pLeft->obj.len != pRight->obj.len ) )
+        {
+            /* different interned strings, or different lengths */
+            result = 1;
+        }
+        else
+        {
+            result = memcmp( pLeftStr, pRightStr, pLeft->obj.len );
+        }
+    }
+    else if ( pLeftStr != NULL )
+    {
+        result = 1;
+    }
+    else
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
 /*============================================================================*/
 /*  AssignString                                                              */
 /*!
@@ -162,6 +407,10 @@ int AllocateString( Variable *pVariable, size_t len )
 
     The result string points to the left variable
 
+    A string constant or other interned string assigned to a variable
+    which does not own a string buffer is referenced rather than copied,
+    since interned strings cannot change.
+
 @param[in]
     pResult
         pointer to the result node
@@ -186,7 +435,6 @@ int AssignString( Variable *pResult,
 {
     int result = EINVAL;
     size_t len;
-    size_t bufsize;
 
     if ( ( pResult != NULL ) &&
          ( pLeft != NULL ) &&
@@ -198,26 +446,47 @@ int AssignString( Variable *pResult,
             /* get the length of the source string */
             len = pRight->obj.len;
 
-            /* (re)allocate memory in the left variable for the
-             * size of string in the right variable */
-            result = AllocateString( pLeft, len );
-            if ( result == EOK )
+            if ( pLeft->obj.val.str == pRight->obj.val.str )
+            {
+                /* the left variable already holds the value */
+                result = EOK;
+            }
+            else if ( ( ( pRight->operation == VA_STRING ) ||
+                        ( pRight->flags & VF_INTERNED_STR ) ) &&
+                      ( ( pLeft->flags & ( VF_HEAP_STR | VF_INLINE_STR ) )
+                            == 0 ) )
             {
-                /* copy the string */
-                memcpy( pLeft->obj.val.str, pRight->obj.val.str, len );
+                /* reference the string constant */
+                pLeft->obj.val.str = pRight->obj.val.str;
+                pLeft->flags &= ~( VF_ARENA_STR | VF_INTERNED_STR );
+                pLeft->flags |= VF_BORROWED_STR |
+                                ( pRight->flags & VF_INTERNED_STR );
+                pLeft->bufsize = len;
+                result = EOK;
+            }
+            else
+            {
+                /* (re)allocate memory in the left variable for the
+                 * size of string in the right variable */
+                result = AllocateString( pLeft, len );
+                if ( result == EOK )
+                {
+                    /* copy the string */
+                    memcpy( pLeft->obj.val.str, pRight->obj.val.str, len );
 
-                /* NUL terminate */
-                pLeft->obj.val.str[len] = 0;
+                    /* NUL terminate */
+                    pLeft->obj.val.str[len] = 0;
+                }
+            }
 
+            if ( result == EOK )
+            {
                 /* set string attributes */
                 pLeft->obj.len = len;
                 pLeft->obj.type = VARTYPE_STR;
 
                 /* update information in the result node */
-                pResult->obj.val.str = pLeft->obj.val.str;
-                pResult->obj.len = len;
-                pResult->obj.type = VARTYPE_STR;
-                pResult->bufsize = pLeft->bufsize;
+                ShareString( pResult, pLeft );
             }
         }
         else
@@ -290,9 +559,11 @@ int AddString( Variable *pResult,
                 if ( result == EOK )
                 {
                     /* concatenate the two strings */
-                    strcpy( pResult->obj.val.str, pLeft->obj.val.str );
-                    strcpy( &(pResult->obj.val.str[len1]),
-                            pRight->obj.val.str );
+                    memcpy( pResult->obj.val.str, pLeft->obj.val.str, len1 );
+                    memcpy( &(pResult->obj.val.str[len1]),
+                            pRight->obj.val.str,
+                            len2 );
+                    pResult->obj.val.str[len] = 0;
 
                     pResult->obj.len = len;
                 }
@@ -369,12 +640,12 @@ int ConcatString( Variable *pResult,
                 if ( result == EOK )
                 {
                     /* concatenate the two strings */
-                    strcat( pLeft->obj.val.str, pRight->obj.val.str );
+                    memmove( &(pLeft->obj.val.str[len1]),
+                             pRight->obj.val.str,
+                             len2 );
+                    pLeft->obj.val.str[len] = 0;
                     pLeft->obj.len = len;
-                    pResult->obj.len = len;
-                    pResult->obj.type = VARTYPE_STR;
-                    pResult->obj.val.str = pLeft->obj.val.str;
-                    pResult->bufsize = pLeft->bufsize;
+                    ShareString( pResult, pLeft );
                 }
             }
             else
@@ -393,4 +664,3 @@ int ConcatString( Variable *pResult,
 
 /*! @}
  * end of varstrings group */
-
@@ -0,0 +1,688 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varswitch varswitch
+ * @brief Variable Action Script IF/ELSE Chain Dispatch functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varswitch.c
+
+    Variable Action Script IF/ELSE Chain Dispatch functions
+
+    The IF/ELSE Chain Dispatch functions recognise chains of IF/ELSE
+    statements which compare the same system or local variable against
+    distinct constants, such as
+
+    if ( state == 1 ) { ... } else if ( state == 2 ) { ... } else { ... }
+
+    and build a table which selects the matching case from a single
+    read of the variable, instead of evaluating each comparison in turn.
+
+    Integer constants which fall in a dense range are looked up directly
+    in a table indexed by the value.  String constants are looked up in
+    a perfect hash table, where a seed is chosen when the table is built
+    so that every constant has its own slot, and a lookup hashes the
+    value once and confirms the match with one string comparison.
+
+    If the variable does not have the type of the constants when the
+    chain is evaluated, the case comparisons are performed in order,
+    exactly as the IF/ELSE statements would perform them.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <varaction/varaction.h>
+#include "varops.h"
+#include "varstrings.h"
+#include "varsymtab.h"
+#include "varswitch.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! minimum number of cases before a chain uses a dispatch table */
+#define SWITCH_MIN_CASES        ( 3 )
+
+/*! largest ratio of the integer range to the number of cases */
+#define SWITCH_DENSITY          ( 4 )
+
+/*! number of seeds tried for each string table size */
+#define SWITCH_SEEDS            ( 64 )
+
+/*! largest ratio of the string table size to the number of cases */
+#define SWITCH_MAX_LOAD         ( 8 )
+
+/*! multiplier used to spread a seeded string hash across the table */
+#define SWITCH_HASH_MULTIPLIER  ( 0x9E3779B1u )
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static Variable *CaseVariable( Variable *pIF );
+static Variable *NextCase( Variable *pIF, Variable *pVariable );
+static bool CaseKey( Variable *pConst, uint32_t *pKey );
+static int BuildIntegerTable( VarSwitch *pSwitch );
+static int BuildStringTable( VarSwitch *pSwitch );
+static uint32_t StringSlot( uint32_t hash, uint32_t seed, uint32_t size );
+static size_t CompareCases( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  NewSwitch                                                                 */
+/*!
+    Build a dispatch table for an IF/ELSE chain
+
+    The NewSwitch function checks if an IF statement is the head of a
+    chain of IF/ELSE statements which compare the same variable against
+    distinct integer or string constants.  Each ELSE block in the chain
+    must consist of exactly one IF statement, except for the last one,
+    which is the default block.
+
+    The instruction targets of the returned switch are not set.
+
+@param[in]
+    pVariable
+        pointer to the VA_IF node at the head of the chain
+
+@retval pointer to the switch
+@retval NULL if the chain is too short, its constants cannot be placed
+        in a table, or memory could not be allocated
+
+==============================================================================*/
+VarSwitch *NewSwitch( Variable *pVariable )
+{
+    VarSwitch *pSwitch = NULL;
+    Variable *pIF;
+    Variable *pCond;
+    Variable *pValue;
+    size_t n = 0;
+    int rc = ENOTSUP;
+
+    pValue = CaseVariable( pVariable );
+    pIF = ( pValue != NULL ) ? pVariable : NULL;
+    while ( pIF != NULL )
+    {
+        n++;
+        pIF = NextCase( pIF, pValue );
+    }
+
+    if ( ( pValue != NULL ) && ( n >= SWITCH_MIN_CASES ) )
+    {
+        rc = ENOMEM;
+        pSwitch = calloc( 1, sizeof( VarSwitch ) );
+        if ( pSwitch != NULL )
+        {
+            pSwitch->pCases = calloc( n, sizeof( VarCase ) );
+            pSwitch->pTargets = calloc( n + 2, sizeof( uint32_t ) );
+        }
+
+        if ( ( pSwitch != NULL ) &&
+             ( pSwitch->pCases != NULL ) &&
+             ( pSwitch->pTargets != NULL ) )
+        {
+            pSwitch->pVariable = pValue;
+
+            for ( pIF = pVariable; pIF != NULL; pIF = NextCase( pIF, pValue ) )
+            {
+                pCond = pIF->left;
+                pSwitch->pCases[pSwitch->ncases].pCond = pCond;
+                pSwitch->pCases[pSwitch->ncases].pConst = pCond->right;
+                pSwitch->pCases[pSwitch->ncases].pBlock =
+                    (Statement *)pIF->right->left;
+                pSwitch->pDefault = (Statement *)pIF->right->right;
+                pSwitch->ncases++;
+            }
+
+            pSwitch->strings =
+                ( pSwitch->pCases[0].pConst->operation == VA_STRING );
+
+            rc = ( pSwitch->strings == true ) ? BuildStringTable( pSwitch )
+                                              : BuildIntegerTable( pSwitch );
+        }
+    }
+
+    if ( ( rc != EOK ) && ( pSwitch != NULL ) )
+    {
+        FreeSwitch( pSwitch );
+        pSwitch = NULL;
+    }
+
+    return pSwitch;
+}
+
+/*============================================================================*/
+/*  SelectCase                                                                */
+/*!
+    Select the case of an IF/ELSE chain
+
+    The SelectCase function selects the case which matches the current
+    value of the switch variable.  The variable must already have been
+    evaluated.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pSwitch
+        pointer to the switch
+
+@retval index of the matching case
+@retval the number of cases if no case matches
+@retval the number of cases plus one if a comparison failed
+
+==============================================================================*/
+size_t SelectCase( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch )
+{
+    Variable *pVariable = pSwitch->pVariable;
+    size_t result = pSwitch->ncases;
+    uint32_t key;
+    uint32_t slot;
+    const char *str;
+
+    if ( ( pSwitch->strings == false ) &&
+         ( ( pVariable->obj.type == VARTYPE_UINT16 ) ||
+           ( pVariable->obj.type == VARTYPE_UINT32 ) ) )
+    {
+        key = ( pVariable->obj.type == VARTYPE_UINT16 )
+              ? pVariable->obj.val.ui
+              : pVariable->obj.val.ul;
+
+        /* keys below the base wrap around to large offsets */
+        key -= pSwitch->base;
+        if ( ( key < pSwitch->size ) && ( pSwitch->pSlots[key] != 0 ) )
+        {
+            result = pSwitch->pSlots[key] - 1;
+        }
+    }
+    else if ( ( pSwitch->strings == true ) &&
+              ( pVariable->obj.type == VARTYPE_STR ) )
+    {
+        str = pVariable->obj.val.str;
+        if ( str != NULL )
+        {
+            slot = StringSlot( HashIdentifier( str ),
+                               pSwitch->seed,
+                               pSwitch->size );
+            if ( ( pSwitch->pSlots[slot] != 0 ) &&
+                 ( CompareStrings( pVariable,
+                                   pSwitch->pCases[pSwitch->pSlots[slot] - 1]
+                                       .pConst,
+                                   true ) == 0 ) )
+            {
+                result = pSwitch->pSlots[slot] - 1;
+            }
+        }
+    }
+    else
+    {
+        result = CompareCases( hVarServer, pSwitch );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FreeSwitch                                                                */
+/*!
+    Free a switch
+
+    The FreeSwitch function releases the dispatch table of an IF/ELSE
+    chain.  The statements and variables it was built from are not
+    affected.
+
+@param[in]
+    pSwitch
+        pointer to the switch to free (may be NULL)
+
+==============================================================================*/
+void FreeSwitch( VarSwitch *pSwitch )
+{
+    if ( pSwitch != NULL )
+    {
+        free( pSwitch->pCases );
+        free( pSwitch->pSlots );
+        free( pSwitch->pTargets );
+        free( pSwitch->ppNative );
+        free( pSwitch );
+    }
+}
+
+/*============================================================================*/
+/*  CaseVariable                                                              */
+/*!
+    Get the variable compared by an IF statement case
+
+    The CaseVariable function checks that an IF statement has an ELSE
+    node and a condition of the form variable == constant, where the
+    variable is a system or local variable, and the constant is a
+    number or a string.
+
+@param[in]
+    pIF
+        pointer to the node to check
+
+@retval pointer to the variable compared by the condition
+@retval NULL if the node is not a case
+
+==============================================================================*/
+static Variable *CaseVariable( Variable *pIF )
+{
+    Variable *pVariable = NULL;
+    Variable *pCond;
+
+    if ( ( pIF != NULL ) &&
+         ( pIF->operation == VA_IF ) &&
+         ( pIF->right != NULL ) &&
+         ( pIF->right->operation == VA_ELSE ) &&
+         ( pIF->left != NULL ) &&
+         ( pIF->left->operation == VA_EQUALS ) )
+    {
+        pCond = pIF->left;
+        if ( ( pCond->left != NULL ) &&
+             ( ( pCond->left->operation == VA_SYSVAR ) ||
+               ( pCond->left->operation == VA_LOCALVAR ) ) &&
+             ( pCond->right != NULL ) &&
+             ( ( pCond->right->operation == VA_NUM ) ||
+               ( pCond->right->operation == VA_STRING ) ) )
+        {
+            pVariable = pCond->left;
+        }
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  NextCase                                                                  */
+/*!
+    Get the next case of an IF/ELSE chain
+
+    The NextCase function gets the IF statement which forms the ELSE
+    block of a case, if it compares the same variable against the
+    same kind of constant.
+
+@param[in]
+    pIF
+        pointer to the VA_IF node of the current case
+
+@param[in]
+    pVariable
+        pointer to the variable compared by the chain
+
+@retval pointer to the VA_IF node of the next case
+@retval NULL if the chain ends at the current case
+
+==============================================================================*/
+static Variable *NextCase( Variable *pIF, Variable *pVariable )
+{
+    Variable *pNext = NULL;
+    Statement *pElse = (Statement *)pIF->right->right;
+
+    if ( ( pElse != NULL ) &&
+         ( pElse->pNext == NULL ) &&
+         ( pElse->script == NULL ) &&
+         ( CaseVariable( pElse->pVariable ) == pVariable ) &&
+         ( pElse->pVariable->left->right->operation ==
+           pIF->left->right->operation ) )
+    {
+        pNext = pElse->pVariable;
+    }
+
+    return pNext;
+}
+
+/*============================================================================*/
+/*  CaseKey                                                                   */
+/*!
+    Get the table key of an integer constant
+
+    Only constants which fit in 16 bits are placed in the table, so the
+    key is the same whether the variable is compared as a 16-bit or a
+    32-bit value.
+
+@param[in]
+    pConst
+        pointer to the VA_NUM node
+
+@param[out]
+    pKey
+        pointer to the location to store the key
+
+@retval true the constant has a table key
+@retval false the constant cannot be placed in the table
+
+==============================================================================*/
+static bool CaseKey( Variable *pConst, uint32_t *pKey )
+{
+    bool result = false;
+
+    if ( pConst->obj.type == VARTYPE_UINT16 )
+    {
+        *pKey = pConst->obj.val.ui;
+        result = true;
+    }
+    else if ( ( pConst->obj.type == VARTYPE_UINT32 ) &&
+              ( pConst->obj.val.ul <= UINT16_MAX ) )
+    {
+        *pKey = pConst->obj.val.ul;
+        result = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BuildIntegerTable                                                         */
+/*!
+    Build the dense table for integer constants
+
+    The BuildIntegerTable function builds a table with one slot for
+    each value between the smallest and largest constant.  Where a
+    constant appears more than once, the first case is used, as the
+    IF/ELSE chain would select it.
+
+@param[in]
+    pSwitch
+        pointer to the switch
+
+@retval ENOTSUP the constants are not dense enough for a table
+@retval ENOMEM memory allocation failure
+@retval EOK the table was built
+
+==============================================================================*/
+static int BuildIntegerTable( VarSwitch *pSwitch )
+{
+    int result = EOK;
+    uint32_t lo = UINT32_MAX;
+    uint32_t hi = 0;
+    uint32_t key;
+    size_t i;
+
+    for ( i = 0; ( i < pSwitch->ncases ) && ( result == EOK ); i++ )
+    {
+        if ( CaseKey( pSwitch->pCases[i].pConst, &key ) == true )
+        {
+            lo = ( key < lo ) ? key : lo;
+            hi = ( key > hi ) ? key : hi;
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+    }
+
+    if ( ( result == EOK ) &&
+         ( hi - lo + 1 > SWITCH_DENSITY * pSwitch->ncases ) )
+    {
+        result = ENOTSUP;
+    }
+
+    if ( result == EOK )
+    {
+        pSwitch->base = lo;
+        pSwitch->size = hi - lo + 1;
+        pSwitch->pSlots = calloc( pSwitch->size, sizeof( uint32_t ) );
+        if ( pSwitch->pSlots != NULL )
+        {
+            for ( i = 0; i < pSwitch->ncases; i++ )
+            {
+                (void)CaseKey( pSwitch->pCases[i].pConst, &key );
+                if ( pSwitch->pSlots[key - lo] == 0 )
+                {
+                    pSwitch->pSlots[key - lo] = i + 1;
+                }
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BuildStringTable                                                          */
+/*!
+    Build the perfect hash table for string constants
+
+    The BuildStringTable function searches for a table size and seed
+    which place every distinct string constant in its own slot.  Where
+    a constant appears more than once, the first case is used, as the
+    IF/ELSE chain would select it.
+
+@param[in]
+    pSwitch
+        pointer to the switch
+
+@retval ENOTSUP no collision free table was found
+@retval ENOMEM memory allocation failure
+@retval EOK the table was built
+
+==============================================================================*/
+static int BuildStringTable( VarSwitch *pSwitch )
+{
+    int result = ENOTSUP;
+    uint32_t *pHashes;
+    uint32_t *pSlots = NULL;
+    uint32_t size = 1;
+    uint32_t seed;
+    uint32_t slot;
+    uint32_t j;
+    size_t i;
+    bool collision = true;
+    const char *str;
+
+    pHashes = calloc( pSwitch->ncases, sizeof( uint32_t ) );
+    if ( pHashes == NULL )
+    {
+        result = ENOMEM;
+    }
+
+    for ( i = 0; ( i < pSwitch->ncases ) && ( pHashes != NULL ); i++ )
+    {
+        str = pSwitch->pCases[i].pConst->obj.val.str;
+        pHashes[i] = ( str != NULL ) ? HashIdentifier( str ) : 0;
+    }
+
+    while ( size < 2 * pSwitch->ncases )
+    {
+        size <<= 1;
+    }
+
+    while ( ( pHashes != NULL ) &&
+            ( collision == true ) &&
+            ( size <= SWITCH_MAX_LOAD * pSwitch->ncases ) )
+    {
+        free( pSlots );
+        pSlots = malloc( size * sizeof( uint32_t ) );
+        if ( pSlots == NULL )
+        {
+            result = ENOMEM;
+            break;
+        }
+
+        for ( seed = 0;
+              ( seed < SWITCH_SEEDS ) && ( collision == true );
+              seed++ )
+        {
+            memset( pSlots, 0, size * sizeof( uint32_t ) );
+            collision = false;
+
+            for ( i = 0;
+                  ( i < pSwitch->ncases ) && ( collision == false );
+                  i++ )
+            {
+                slot = StringSlot( pHashes[i], seed, size );
+                j = pSlots[slot];
+                if ( j == 0 )
+                {
+                    pSlots[slot] = i + 1;
+                }
+                else if ( CompareStrings( pSwitch->pCases[j - 1].pConst,
+                                          pSwitch->pCases[i].pConst,
+                                          false ) != 0 )
+                {
+                    /* a repeated constant keeps its first case */
+                    collision = true;
+                }
+            }
+
+            if ( collision == false )
+            {
+                pSwitch->seed = seed;
+            }
+        }
+
+        if ( collision == false )
+        {
+            pSwitch->size = size;
+            pSwitch->pSlots = pSlots;
+            pSlots = NULL;
+            result = EOK;
+        }
+        else
+        {
+            size <<= 1;
+        }
+    }
+
+    free( pSlots );
+    free( pHashes );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  StringSlot                                                                */
+/*!
+    Get the table slot of a string hash
+
+@param[in]
+    hash
+        hash of the string
+
+@param[in]
+    seed
+        table seed
+
+@param[in]
+    size
+        number of table slots (a power of two)
+
+@retval the slot index
+
+==============================================================================*/
+static uint32_t StringSlot( uint32_t hash, uint32_t seed, uint32_t size )
+{
+    uint32_t mix = ( hash ^ seed ) * SWITCH_HASH_MULTIPLIER;
+
+    return ( mix ^ ( mix >> 16 ) ) & ( size - 1 );
+}
+
+/*============================================================================*/
+/*  CompareCases                                                              */
+/*!
+    Compare the switch variable against each case in turn
+
+    The CompareCases function is used when the variable is not of the
+    type of the constants.  It calls each case's comparison operation
+    in order, as the IF/ELSE chain would.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pSwitch
+        pointer to the switch
+
+@retval index of the first matching case
+@retval the number of cases if no case matches
+@retval the number of cases plus one if a comparison failed
+
+==============================================================================*/
+static size_t CompareCases( VARSERVER_HANDLE hVarServer, VarSwitch *pSwitch )
+{
+    size_t result = pSwitch->ncases;
+    size_t i;
+    int rc;
+    Variable *pCond;
+    opfn fn;
+
+    for ( i = 0; i < pSwitch->ncases; i++ )
+    {
+        pCond = pSwitch->pCases[i].pCond;
+        fn = ( pCond->fn != NULL ) ? pCond->fn : GetOperation( VA_EQUALS );
+        rc = ( fn != NULL ) ? fn( hVarServer,
+                                  pCond,
+                                  pCond->left,
+                                  pCond->right )
+                            : ENOTSUP;
+        if ( rc != EOK )
+        {
+            fprintf( stderr,
+                     "Error processing Action: %s (%d) %s\n",
+                     GetOperationName( VA_EQUALS ),
+                     rc,
+                     strerror( rc ) );
+
+            /* a failed IF condition skips the rest of the chain */
+            result = pSwitch->ncases + 1;
+            break;
+        }
+
+        if ( pCond->obj.val.ui != 0 )
+        {
+            result = i;
+            break;
+        }
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of varswitch group */
@@ -0,0 +1,516 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varsymtab varsymtab
+ * @brief Variable Action Script Symbol Table functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varsymtab.c
+
+    Variable Action Script Symbol Table functions
+
+    The Variable Action Script Symbol Table functions maintain open
+    addressed hash indexes of Variable objects, keyed either by the
+    variable identifier or by the system variable handle.
+
+    The index does not own the variables.  They remain in their
+    declaration or system variable lists, which keep their iteration
+    order.  When a key is added more than once, the first variable added
+    is retained, matching a search from the head of the list.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "varsymtab.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! initial number of entries allocated in a symbol table */
+#define SYMBOL_TABLE_INITIAL_SIZE    ( 64 )
+
+/*! FNV-1a offset basis */
+#define FNV_OFFSET_BASIS    ( 2166136261u )
+
+/*! FNV-1a prime */
+#define FNV_PRIME           ( 16777619u )
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static uint32_t HashHandle( VAR_HANDLE hVar );
+static int Insert( SymbolTable *pTable,
+                   uint32_t hash,
+                   Variable *pVariable,
+                   bool byName );
+static SymbolEntry *Probe( SymbolTable *pTable,
+                           uint32_t hash,
+                           const char *id,
+                           VAR_HANDLE hVar );
+static int Grow( SymbolTable *pTable, bool byName );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  HashIdentifier                                                            */
+/*!
+    Calculate the hash of a variable identifier
+
+    The HashIdentifier function calculates the FNV-1a hash of the
+    specified variable identifier.
+
+@param[in]
+    id
+        pointer to the NUL terminated variable identifier
+
+@retval the identifier hash
+
+==============================================================================*/
+uint32_t HashIdentifier( const char *id )
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    while ( *id != '\0' )
+    {
+        hash ^= (uint8_t)*id++;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/*============================================================================*/
+/*  AddSymbol                                                                 */
+/*!
+    Add a variable to a symbol table keyed by identifier
+
+    The AddSymbol function adds the specified variable to the symbol
+    table using its identifier as the key.  If a variable with the same
+    identifier is already in the table the table is not changed.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    pVariable
+        pointer to the variable to add
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval EOK the variable is in the table
+
+==============================================================================*/
+int AddSymbol( SymbolTable *pTable, Variable *pVariable )
+{
+    int result = EINVAL;
+
+    if ( ( pTable != NULL ) &&
+         ( pVariable != NULL ) &&
+         ( pVariable->id != NULL ) )
+    {
+        result = Insert( pTable,
+                         HashIdentifier( pVariable->id ),
+                         pVariable,
+                         true );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindSymbol                                                                */
+/*!
+    Search for a variable in a symbol table keyed by identifier
+
+    The FindSymbol function looks up the variable with the specified
+    identifier in the symbol table.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    id
+        pointer to the variable identifier to search for
+
+@retval pointer to the Variable that we found
+@retval NULL if no variable was found
+
+==============================================================================*/
+Variable *FindSymbol( SymbolTable *pTable, const char *id )
+{
+    Variable *pVariable = NULL;
+    SymbolEntry *pEntry;
+
+    if ( ( pTable != NULL ) &&
+         ( pTable->n > 0 ) &&
+         ( id != NULL ) )
+    {
+        pEntry = Probe( pTable, HashIdentifier( id ), id, VAR_INVALID );
+        pVariable = pEntry->pVariable;
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  AddHandle                                                                 */
+/*!
+    Add a variable to a symbol table keyed by system variable handle
+
+    The AddHandle function adds the specified system variable to the
+    symbol table using its variable handle as the key.  If a variable
+    with the same handle is already in the table the table is not changed.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    pVariable
+        pointer to the system variable to add
+
+@retval EINVAL invalid argument
+@retval ENOMEM memory allocation failure
+@retval EOK the variable is in the table
+
+==============================================================================*/
+int AddHandle( SymbolTable *pTable, Variable *pVariable )
+{
+    int result = EINVAL;
+
+    if ( ( pTable != NULL ) &&
+         ( pVariable != NULL ) &&
+         ( pVariable->hVar != VAR_INVALID ) )
+    {
+        result = Insert( pTable,
+                         HashHandle( pVariable->hVar ),
+                         pVariable,
+                         false );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FindHandle                                                                */
+/*!
+    Search for a variable in a symbol table keyed by system variable handle
+
+    The FindHandle function looks up the system variable with the
+    specified handle in the symbol table.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    hVar
+        handle of the system variable to search for
+
+@retval pointer to the Variable that we found
+@retval NULL if no variable was found
+
+==============================================================================*/
+Variable *FindHandle( SymbolTable *pTable, VAR_HANDLE hVar )
+{
+    Variable *pVariable = NULL;
+    SymbolEntry *pEntry;
+
+    if ( ( pTable != NULL ) &&
+         ( pTable->n > 0 ) &&
+         ( hVar != VAR_INVALID ) )
+    {
+        pEntry = Probe( pTable, HashHandle( hVar ), NULL, hVar );
+        pVariable = pEntry->pVariable;
+    }
+
+    return pVariable;
+}
+
+/*============================================================================*/
+/*  ClearSymbols                                                              */
+/*!
+    Clear a symbol table
+
+    The ClearSymbols function removes all of the entries from the symbol
+    table and releases its memory.  The variables are not affected.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+==============================================================================*/
+void ClearSymbols( SymbolTable *pTable )
+{
+    if ( pTable != NULL )
+    {
+        free( pTable->pEntries );
+        memset( pTable, 0, sizeof( SymbolTable ) );
+    }
+}
+
+/*============================================================================*/
+/*  HashHandle                                                                */
+/*!
+    Calculate the hash of a system variable handle
+
+    The HashHandle function mixes the bits of a system variable handle
+    so sequential handles are spread across the table.
+
+@param[in]
+    hVar
+        system variable handle
+
+@retval the handle hash
+
+==============================================================================*/
+static uint32_t HashHandle( VAR_HANDLE hVar )
+{
+    uint32_t hash = (uint32_t)hVar;
+
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/*============================================================================*/
+/*  Insert                                                                    */
+/*!
+    Insert a variable into a symbol table
+
+    The Insert function adds a variable to the symbol table unless an
+    entry with the same key already exists, growing the table to keep
+    its load factor at or below one half.  If the insertion fails the
+    table is marked as incomplete.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    hash
+        hash of the variable key
+
+@param[in]
+    pVariable
+        pointer to the variable to insert
+
+@param[in]
+    byName
+        true if the table is keyed by identifier, false if it is keyed
+        by system variable handle
+
+@retval ENOMEM memory allocation failure
+@retval EOK the variable is in the table
+
+==============================================================================*/
+static int Insert( SymbolTable *pTable,
+                   uint32_t hash,
+                   Variable *pVariable,
+                   bool byName )
+{
+    int result = EOK;
+    SymbolEntry *pEntry;
+
+    if ( ( pTable->n + 1 ) * 2 > pTable->size )
+    {
+        result = Grow( pTable, byName );
+    }
+
+    if ( result == EOK )
+    {
+        pEntry = Probe( pTable,
+                        hash,
+                        byName ? pVariable->id : NULL,
+                        byName ? VAR_INVALID : pVariable->hVar );
+        if ( pEntry->pVariable == NULL )
+        {
+            pEntry->hash = hash;
+            pEntry->pVariable = pVariable;
+            pTable->n++;
+        }
+    }
+    else
+    {
+        pTable->incomplete = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  Probe                                                                     */
+/*!
+    Search a symbol table for a key
+
+    The Probe function performs a linear probe of the symbol table
+    for the specified key, and returns either the matching entry or
+    the unused entry where the key would be inserted.  The table must
+    contain at least one unused entry.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    hash
+        hash of the key
+
+@param[in]
+    id
+        identifier key, or NULL if the table is keyed by handle
+
+@param[in]
+    hVar
+        handle key, used if id is NULL
+
+@retval pointer to the matching or unused entry
+
+==============================================================================*/
+static SymbolEntry *Probe( SymbolTable *pTable,
+                           uint32_t hash,
+                           const char *id,
+                           VAR_HANDLE hVar )
+{
+    size_t mask = pTable->size - 1;
+    size_t i = hash & mask;
+    SymbolEntry *pEntry;
+
+    while ( true )
+    {
+        pEntry = &pTable->pEntries[i];
+        if ( pEntry->pVariable == NULL )
+        {
+            break;
+        }
+
+        if ( pEntry->hash == hash )
+        {
+            if ( id != NULL )
+            {
+                if ( strcmp( pEntry->pVariable->id, id ) == 0 )
+                {
+                    break;
+                }
+            }
+            else if ( pEntry->pVariable->hVar == hVar )
+            {
+                break;
+            }
+        }
+
+        i = ( i + 1 ) & mask;
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  Grow                                                                      */
+/*!
+    Double the size of a symbol table
+
+    The Grow function allocates a new entry array twice the size of the
+    current one, and re-inserts the existing entries.
+
+@param[in]
+    pTable
+        pointer to the symbol table
+
+@param[in]
+    byName
+        true if the table is keyed by identifier
+
+@retval ENOMEM memory allocation failure
+@retval EOK the table was resized
+
+==============================================================================*/
+static int Grow( SymbolTable *pTable, bool byName )
+{
+    int result = ENOMEM;
+    SymbolEntry *pOldEntries = pTable->pEntries;
+    size_t oldSize = pTable->size;
+    size_t size;
+    size_t i;
+    SymbolEntry *pEntry;
+    Variable *pVariable;
+
+    size = ( oldSize == 0 ) ? SYMBOL_TABLE_INITIAL_SIZE : oldSize * 2;
+
+    pTable->pEntries = calloc( size, sizeof( SymbolEntry ) );
+    if ( pTable->pEntries != NULL )
+    {
+        pTable->size = size;
+
+        for ( i = 0; i < oldSize; i++ )
+        {
+            pVariable = pOldEntries[i].pVariable;
+            if ( pVariable != NULL )
+            {
+                pEntry = Probe( pTable,
+                                pOldEntries[i].hash,
+                                byName ? pVariable->id : NULL,
+                                byName ? VAR_INVALID : pVariable->hVar );
+                *pEntry = pOldEntries[i];
+            }
+        }
+
+        free( pOldEntries );
+        result = EOK;
+    }
+    else
+    {
+        /* keep the existing table */
+        pTable->pEntries = pOldEntries;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of varsymtab group */
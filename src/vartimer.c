@@ -40,6 +40,12 @@ SOFTWARE.
 
     Operators include:  create timer, create tick, delete timer
 
+    By default each timer is a POSIX timer which raises SIGRTMIN+5 with
+    the timer identifier when it expires.  When the VA_OPT_TIMER_WHEEL
+    option is set, timers are managed by the timer wheel of the
+    evaluation context and their expirations are retrieved with
+    VarActionTimerFd() and VarActionNextTimer().
+
 */
 /*============================================================================*/
 
@@ -58,31 +64,26 @@ SOFTWARE.
 #include <time.h>
 #include <signal.h>
 #include "vartimer.h"
+#include "vartimerwheel.h"
+#include "varcontext.h"
+#include "varlatency.h"
 
 /*==============================================================================
        Function declarations
 ==============================================================================*/
 
+static int ArmTimer( VarActionContext *pContext,
+                     int id,
+                     uint32_t timeoutms,
+                     bool periodic );
+
 /*==============================================================================
        Definitions
 ==============================================================================*/
 
-/*! Maximum number of timers allowed */
-#define MAX_TIMERS ( 255 )
-
 /*! timer notification */
 #define TIMER_NOTIFICATION SIGRTMIN+5
 
-/*==============================================================================
-       File Scoped Variables
-==============================================================================*/
-
-/*! array of timers */
-static timer_t timers[MAX_TIMERS] = {0};
-
-/*! the currently active (fired) timer */
-static uint16_t activeTimer = 0;
-
 /*==============================================================================
        Function definitions
 ==============================================================================*/
@@ -126,6 +127,7 @@ int VACreateTimer( VARSERVER_HANDLE hVarServer,
                    Variable *pLeft,
                    Variable *pRight )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     int id;
     int timeoutms;
@@ -149,14 +151,18 @@ int VACreateTimer( VARSERVER_HANDLE hVarServer,
         secs = timeoutms / 1000;
         msecs = timeoutms % 1000;
 
-        if( ( id > 0 ) && ( id < MAX_TIMERS ) )
+        if ( pContext->options & VA_OPT_TIMER_WHEEL )
+        {
+            result = ArmTimer( pContext, id, timeoutms, false );
+        }
+        else if( ( id > 0 ) && ( id < MAX_TIMERS ) )
         {
-            if( timers[id] != 0 )
+            if( pContext->timers[id] != 0 )
             {
                 VADeleteTimer( hVarServer, pResult, pLeft, pRight );
             }
 
-            timerID = &timers[id];
+            timerID = &pContext->timers[id];
 
             /* Set and enable alarm */
             te.sigev_notify = SIGEV_SIGNAL;
@@ -224,6 +230,7 @@ int VACreateTick( VARSERVER_HANDLE hVarServer,
                   Variable *pLeft,
                   Variable *pRight )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     int id;
     int timeoutms;
@@ -247,14 +254,18 @@ int VACreateTick( VARSERVER_HANDLE hVarServer,
         secs = timeoutms / 1000;
         msecs = timeoutms % 1000;
 
-        if( ( id > 0 ) && ( id < MAX_TIMERS ) )
+        if ( pContext->options & VA_OPT_TIMER_WHEEL )
         {
-            if( timers[id] != 0 )
+            result = ArmTimer( pContext, id, timeoutms, true );
+        }
+        else if( ( id > 0 ) && ( id < MAX_TIMERS ) )
+        {
+            if( pContext->timers[id] != 0 )
             {
                 VADeleteTimer( hVarServer, pResult, pLeft, pRight );
             }
 
-            timerID = &timers[id];
+            timerID = &pContext->timers[id];
 
             /* Set and enable alarm */
             te.sigev_notify = SIGEV_SIGNAL;
@@ -320,6 +331,7 @@ int VADeleteTimer( VARSERVER_HANDLE hVarServer,
                    Variable *pLeft,
                    Variable *pRight )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     int id;
     timer_t *timerID;
@@ -331,12 +343,20 @@ int VADeleteTimer( VARSERVER_HANDLE hVarServer,
         result = EOK;
 
         id = pLeft->obj.val.ui;
-        if( ( id > 0 ) && ( id < MAX_TIMERS ) )
+        if ( pContext->options & VA_OPT_TIMER_WHEEL )
         {
-            timerID = timers[id];
+            result = ( CancelWheelTimer( pContext->pWheel, id ) == EOK )
+                        ? EOK
+                        : ENOENT;
+        }
+        else if( ( id > 0 ) && ( id < MAX_TIMERS ) )
+        {
+            timerID = pContext->timers[id];
 
             if ( timer_delete( timerID ) == 0 )
             {
+                /* the timer is no longer owned by the context */
+                pContext->timers[id] = 0;
                 result = EOK;
             }
             else
@@ -357,7 +377,6 @@ int VADeleteTimer( VARSERVER_HANDLE hVarServer,
     return result;
 }
 
-
 /*============================================================================*/
 /*  VAGetActiveTimer                                                          */
 /*!
@@ -391,13 +410,14 @@ int VAGetActiveTimer( VARSERVER_HANDLE hVarServer,
                       Variable *pLeft,
                       Variable *pRight )
 {
+    VarActionContext *pContext = GetContext();
     int result = EINVAL;
     int id;
     timer_t *timerID;
 
     if( pResult != NULL )
     {
-        pResult->obj.val.ui = activeTimer;
+        pResult->obj.val.ui = pContext->activeTimer;
         pResult->obj.type = VARTYPE_UINT16;
         pResult->obj.len = sizeof(uint16_t);
         result = EOK;
@@ -421,7 +441,59 @@ int VAGetActiveTimer( VARSERVER_HANDLE hVarServer,
 ==============================================================================*/
 void VASetActiveTimer( uint16_t id )
 {
-    activeTimer = id;
+    VarActionContext *pContext = GetContext();
+
+    pContext->activeTimer = id;
+
+    if ( id != 0 )
+    {
+        LatencyTrigger( VA_LATENCY_TIMER, 0 );
+    }
+}
+
+/*============================================================================*/
+/*  ArmTimer                                                                  */
+/*!
+    Arm a timer wheel timer
+
+    The ArmTimer function arms a timer in the timer wheel of the
+    context, creating the timer wheel if required.
+
+@param[in]
+    pContext
+        pointer to the evaluation context
+
+@param[in]
+    id
+        timer identifier
+
+@param[in]
+    timeoutms
+        timeout in milliseconds
+
+@param[in]
+    periodic
+        true for a repeating tick timer
+
+@retval EOK the timer was armed
+@retval ENOENT invalid timer identifier
+@retval EINVAL the timer wheel could not be created
+
+==============================================================================*/
+static int ArmTimer( VarActionContext *pContext,
+                     int id,
+                     uint32_t timeoutms,
+                     bool periodic )
+{
+    if ( pContext->pWheel == NULL )
+    {
+        pContext->pWheel = CreateTimerWheel();
+    }
+
+    return ArmWheelTimer( pContext->pWheel,
+                          (uint16_t)id,
+                          timeoutms,
+                          periodic );
 }
 
 /*! @}
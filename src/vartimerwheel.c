@@ -0,0 +1,1006 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup vartimerwheel vartimerwheel
+ * @brief Hierarchical timer wheel
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file vartimerwheel.c
+
+    Hierarchical timer wheel
+
+    The timer wheel manages the script timers of an evaluation context
+    using a single timerfd on CLOCK_MONOTONIC instead of one POSIX timer
+    and signal per timer.
+
+    The wheel has four levels of 256 slots with a resolution of one
+    millisecond.  A timer is placed in the lowest level whose range
+    covers its remaining time, and is moved down a level (cascaded) as
+    the lower level wraps, so arming and cancelling a timer are O(1).
+    The timerfd is armed for the next slot which needs attention, and
+    is only re-armed when a new timer expires before the current
+    deadline.
+
+    Expired timers are queued until they are retrieved with
+    VarActionNextTimer().  A timer which expires again before it has
+    been retrieved is reported once.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+#include "vartimerwheel.h"
+#include "varcontext.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! number of bits of the expiry time indexed by each level */
+#define WHEEL_BITS      ( 8 )
+
+/*! number of slots in each level */
+#define WHEEL_SLOTS     ( 1 << WHEEL_BITS )
+
+/*! slot index mask */
+#define WHEEL_MASK      ( WHEEL_SLOTS - 1 )
+
+/*! number of levels.  Four levels cover the full uint32 timeout range */
+#define WHEEL_LEVELS    ( 4 )
+
+/*! number of timer identifiers */
+#define WHEEL_MAX_IDS   ( 65536 )
+
+/*==============================================================================
+       Type Definitions
+==============================================================================*/
+
+/*! timer wheel timer */
+typedef struct _wheelTimer
+{
+    /*! pointer to the next timer in the slot */
+    struct _wheelTimer *pNext;
+
+    /*! pointer to the previous timer in the slot */
+    struct _wheelTimer *pPrev;
+
+    /*! pointer to the slot list head (NULL if not armed) */
+    struct _wheelTimer **ppSlot;
+
+    /*! expiry time in milliseconds */
+    uint64_t expiry;
+
+    /*! reload period in milliseconds (0 for a one-shot timer) */
+    uint32_t period;
+
+    /*! timer identifier */
+    uint16_t id;
+
+    /*! wheel level containing the timer */
+    uint8_t level;
+
+    /*! true if an expiry is waiting to be retrieved */
+    bool queued;
+
+} WheelTimer;
+
+/*! hierarchical timer wheel */
+struct _timerWheel
+{
+    /*! timerfd used to wake up for the next deadline */
+    int fd;
+
+    /*! current wheel time in milliseconds */
+    uint64_t tick;
+
+    /*! time the timerfd is armed for (0 if disarmed) */
+    uint64_t deadline;
+
+    /*! wheel slots */
+    WheelTimer *pSlots[WHEEL_LEVELS][WHEEL_SLOTS];
+
+    /*! number of timers in each level */
+    size_t counts[WHEEL_LEVELS];
+
+    /*! timers indexed by identifier, allocated on first use */
+    WheelTimer **ppTimers;
+
+    /*! ring buffer of expired timer identifiers */
+    uint16_t *pReady;
+
+    /*! index of the first expired timer */
+    size_t readyHead;
+
+    /*! number of expired timer identifiers */
+    size_t nReady;
+
+    /*! number of expired timer identifiers allocated */
+    size_t readySize;
+
+};
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static uint64_t Now( void );
+static void Insert( TimerWheel *pWheel, WheelTimer *pTimer );
+static void Unlink( TimerWheel *pWheel, WheelTimer *pTimer );
+static void Advance( TimerWheel *pWheel, uint64_t now );
+static void Cascade( TimerWheel *pWheel, int level );
+static void Expire( TimerWheel *pWheel );
+static int Queue( TimerWheel *pWheel, uint16_t id );
+static uint64_t NextDeadline( TimerWheel *pWheel );
+static void SetDeadline( TimerWheel *pWheel, uint64_t deadline );
+static TimerWheel *GetWheel( void );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionTimerFd                                                          */
+/*!
+    Get the timer file descriptor of the current context
+
+    The VarActionTimerFd function gets a file descriptor which becomes
+    readable when a timer of the current context may have expired.
+    Call VarActionNextTimer() when it is readable.
+
+@retval timer file descriptor
+@retval -1 the timer wheel could not be created
+
+==============================================================================*/
+int VarActionTimerFd( void )
+{
+    return GetWheelFd( GetWheel() );
+}
+
+/*============================================================================*/
+/*  VarActionNextTimer                                                        */
+/*!
+    Get the next expired timer of the current context
+
+    The VarActionNextTimer function gets the identifier of the next
+    expired timer of the current context.  Call it until it returns
+    ENOENT each time the timer file descriptor is readable, and pass
+    each identifier to SetTimer() before evaluating the actions which
+    test it.
+
+@param[out]
+    pId
+        pointer to the location to store the timer identifier
+
+@retval EOK a timer identifier was retrieved
+@retval ENOENT no timers have expired
+@retval EINVAL invalid argument
+
+==============================================================================*/
+int VarActionNextTimer( uint16_t *pId )
+{
+    return NextWheelTimer( GetContext()->pWheel, pId );
+}
+
+/*============================================================================*/
+/*  CreateTimerWheel                                                          */
+/*!
+    Create a timer wheel
+
+@retval pointer to the new timer wheel
+@retval NULL if the timer wheel could not be created
+
+==============================================================================*/
+TimerWheel *CreateTimerWheel( void )
+{
+    TimerWheel *pWheel;
+
+    pWheel = calloc( 1, sizeof( TimerWheel ) );
+    if ( pWheel != NULL )
+    {
+        pWheel->ppTimers = calloc( WHEEL_MAX_IDS, sizeof( WheelTimer * ) );
+        pWheel->fd = timerfd_create( CLOCK_MONOTONIC,
+                                     TFD_NONBLOCK | TFD_CLOEXEC );
+        if ( ( pWheel->ppTimers != NULL ) &&
+             ( pWheel->fd != -1 ) )
+        {
+            pWheel->tick = Now();
+        }
+        else
+        {
+            FreeTimerWheel( pWheel );
+            pWheel = NULL;
+        }
+    }
+
+    return pWheel;
+}
+
+/*============================================================================*/
+/*  FreeTimerWheel                                                            */
+/*!
+    Free a timer wheel
+
+    The FreeTimerWheel function cancels all of the timers in the wheel,
+    closes its timerfd and releases its memory.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel to free
+
+==============================================================================*/
+void FreeTimerWheel( TimerWheel *pWheel )
+{
+    size_t i;
+
+    if ( pWheel != NULL )
+    {
+        if ( pWheel->ppTimers != NULL )
+        {
+            for ( i = 0; i < WHEEL_MAX_IDS; i++ )
+            {
+                free( pWheel->ppTimers[i] );
+            }
+        }
+
+        if ( pWheel->fd != -1 )
+        {
+            close( pWheel->fd );
+        }
+
+        free( pWheel->ppTimers );
+        free( pWheel->pReady );
+        free( pWheel );
+    }
+}
+
+/*============================================================================*/
+/*  GetWheelFd                                                                */
+/*!
+    Get the timerfd of a timer wheel
+
+@param[in]
+    pWheel
+        pointer to the timer wheel (may be NULL)
+
+@retval timerfd of the wheel
+@retval -1 if the wheel is NULL
+
+==============================================================================*/
+int GetWheelFd( TimerWheel *pWheel )
+{
+    return ( pWheel != NULL ) ? pWheel->fd : -1;
+}
+
+/*============================================================================*/
+/*  ArmWheelTimer                                                             */
+/*!
+    Arm a timer wheel timer
+
+    The ArmWheelTimer function arms the timer with the specified
+    identifier, replacing any previous timeout of the timer and
+    discarding any expiry which has not been retrieved.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    id
+        timer identifier (1-65535)
+
+@param[in]
+    timeoutms
+        timeout (and reload period, for a periodic timer) in milliseconds
+
+@param[in]
+    periodic
+        true to reload the timer each time it expires
+
+@retval EOK the timer was armed
+@retval ENOENT invalid timer identifier
+@retval ENOMEM memory allocation failure
+@retval EINVAL invalid argument
+
+==============================================================================*/
+int ArmWheelTimer( TimerWheel *pWheel,
+                   uint16_t id,
+                   uint32_t timeoutms,
+                   bool periodic )
+{
+    int result = EINVAL;
+    WheelTimer *pTimer;
+
+    if ( pWheel != NULL )
+    {
+        if ( id == 0 )
+        {
+            result = ENOENT;
+        }
+        else
+        {
+            pTimer = pWheel->ppTimers[id];
+            if ( pTimer == NULL )
+            {
+                pTimer = calloc( 1, sizeof( WheelTimer ) );
+                if ( pTimer != NULL )
+                {
+                    pTimer->id = id;
+                }
+
+                pWheel->ppTimers[id] = pTimer;
+            }
+
+            result = ( pTimer != NULL ) ? EOK : ENOMEM;
+        }
+
+        if ( result == EOK )
+        {
+            Unlink( pWheel, pTimer );
+
+            /* a zero period tick would expire on every wheel tick */
+            pTimer->period = ( periodic == true ) ? timeoutms : 0;
+            if ( ( periodic == true ) && ( timeoutms == 0 ) )
+            {
+                pTimer->period = 1;
+            }
+
+            pTimer->queued = false;
+            pTimer->expiry = Now() + timeoutms;
+            if ( pTimer->expiry <= pWheel->tick )
+            {
+                pTimer->expiry = pWheel->tick + 1;
+            }
+
+            Insert( pWheel, pTimer );
+
+            if ( ( pWheel->deadline == 0 ) ||
+                 ( pTimer->expiry < pWheel->deadline ) )
+            {
+                SetDeadline( pWheel, pTimer->expiry );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CancelWheelTimer                                                          */
+/*!
+    Cancel a timer wheel timer
+
+    The CancelWheelTimer function disarms the timer with the specified
+    identifier and discards any expiry which has not been retrieved.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    id
+        timer identifier
+
+@retval EOK the timer was cancelled
+@retval ENOENT the timer was not armed
+@retval EINVAL invalid argument
+
+==============================================================================*/
+int CancelWheelTimer( TimerWheel *pWheel, uint16_t id )
+{
+    int result = EINVAL;
+    WheelTimer *pTimer;
+
+    if ( pWheel != NULL )
+    {
+        result = ENOENT;
+
+        pTimer = pWheel->ppTimers[id];
+        if ( pTimer != NULL )
+        {
+            if ( ( pTimer->ppSlot != NULL ) ||
+                 ( pTimer->queued == true ) )
+            {
+                result = EOK;
+            }
+
+            Unlink( pWheel, pTimer );
+            pTimer->queued = false;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  NextWheelTimer                                                            */
+/*!
+    Get the next expired timer
+
+    The NextWheelTimer function advances the wheel to the current time
+    if no expired timers are waiting, and gets the identifier of the
+    next expired timer.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel (may be NULL)
+
+@param[out]
+    pId
+        pointer to the location to store the timer identifier
+
+@retval EOK a timer identifier was retrieved
+@retval ENOENT no timers have expired
+@retval EINVAL invalid argument
+
+==============================================================================*/
+int NextWheelTimer( TimerWheel *pWheel, uint16_t *pId )
+{
+    int result = EINVAL;
+
+    if ( pId != NULL )
+    {
+        result = ENOENT;
+
+        if ( pWheel != NULL )
+        {
+            if ( pWheel->nReady == 0 )
+            {
+                (void)PollWheel( pWheel );
+            }
+
+            while ( ( result == ENOENT ) &&
+                    ( pWheel->nReady > 0 ) )
+            {
+                result = PopWheelTimer( pWheel, pId );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PollWheel                                                                 */
+/*!
+    Advance the wheel to the current time
+
+    The PollWheel function clears the readable state of the timerfd,
+    advances the wheel to the current time, queueing the timers which
+    have expired, and re-arms the timerfd for the next deadline.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@retval number of queued expiries (including cancelled timers)
+
+==============================================================================*/
+size_t PollWheel( TimerWheel *pWheel )
+{
+    size_t n = 0;
+    uint64_t expirations;
+
+    if ( pWheel != NULL )
+    {
+        /* clear the readable state of the timerfd */
+        if ( read( pWheel->fd, &expirations, sizeof( expirations ) ) < 0 )
+        {
+            /* the deadline has not been reached */
+            expirations = 0;
+        }
+
+        Advance( pWheel, Now() );
+        pWheel->deadline = 0;
+        SetDeadline( pWheel, NextDeadline( pWheel ) );
+
+        n = pWheel->nReady;
+    }
+
+    return n;
+}
+
+/*============================================================================*/
+/*  PopWheelTimer                                                             */
+/*!
+    Remove the oldest queued expiry
+
+    The PopWheelTimer function removes one entry from the queue of
+    expired timers without advancing the wheel.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[out]
+    pId
+        pointer to the location to store the timer identifier
+
+@retval EOK a timer identifier was retrieved
+@retval ENOENT the queue is empty or the timer was cancelled after
+        it expired
+@retval EINVAL invalid argument
+
+==============================================================================*/
+int PopWheelTimer( TimerWheel *pWheel, uint16_t *pId )
+{
+    int result = EINVAL;
+    WheelTimer *pTimer;
+    uint16_t id;
+
+    if ( ( pWheel != NULL ) &&
+         ( pId != NULL ) )
+    {
+        result = ENOENT;
+
+        if ( pWheel->nReady > 0 )
+        {
+            id = pWheel->pReady[pWheel->readyHead];
+            pWheel->readyHead = ( pWheel->readyHead + 1 ) % pWheel->readySize;
+            pWheel->nReady--;
+
+            /* identifiers of cancelled timers are skipped */
+            pTimer = pWheel->ppTimers[id];
+            if ( ( pTimer != NULL ) &&
+                 ( pTimer->queued == true ) )
+            {
+                pTimer->queued = false;
+                *pId = id;
+                result = EOK;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GetWheel                                                                  */
+/*!
+    Get the timer wheel of the current context
+
+    The GetWheel function gets the timer wheel of the current context,
+    creating it if required.
+
+@retval pointer to the timer wheel
+@retval NULL if the timer wheel could not be created
+
+==============================================================================*/
+static TimerWheel *GetWheel( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    if ( pContext->pWheel == NULL )
+    {
+        pContext->pWheel = CreateTimerWheel();
+    }
+
+    return pContext->pWheel;
+}
+
+/*============================================================================*/
+/*  Now                                                                       */
+/*!
+    Get the monotonic time in milliseconds
+
+@retval monotonic time in milliseconds
+
+==============================================================================*/
+static uint64_t Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+/*============================================================================*/
+/*  Insert                                                                    */
+/*!
+    Insert a timer into the wheel
+
+    The Insert function places the timer in the lowest level whose
+    range covers the time remaining until it expires.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    pTimer
+        pointer to the timer to insert
+
+==============================================================================*/
+static void Insert( TimerWheel *pWheel, WheelTimer *pTimer )
+{
+    uint64_t delta = pTimer->expiry - pWheel->tick;
+    int level = 0;
+    size_t slot;
+
+    while ( ( level < WHEEL_LEVELS - 1 ) &&
+            ( delta >> ( WHEEL_BITS * ( level + 1 ) ) ) != 0 )
+    {
+        level++;
+    }
+
+    slot = ( pTimer->expiry >> ( WHEEL_BITS * level ) ) & WHEEL_MASK;
+
+    pTimer->level = level;
+    pTimer->ppSlot = &pWheel->pSlots[level][slot];
+    pTimer->pPrev = NULL;
+    pTimer->pNext = *pTimer->ppSlot;
+    if ( pTimer->pNext != NULL )
+    {
+        pTimer->pNext->pPrev = pTimer;
+    }
+
+    *pTimer->ppSlot = pTimer;
+    pWheel->counts[level]++;
+}
+
+/*============================================================================*/
+/*  Unlink                                                                    */
+/*!
+    Remove a timer from the wheel
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    pTimer
+        pointer to the timer to remove (may not be armed)
+
+==============================================================================*/
+static void Unlink( TimerWheel *pWheel, WheelTimer *pTimer )
+{
+    if ( pTimer->ppSlot != NULL )
+    {
+        if ( pTimer->pPrev != NULL )
+        {
+            pTimer->pPrev->pNext = pTimer->pNext;
+        }
+        else
+        {
+            *pTimer->ppSlot = pTimer->pNext;
+        }
+
+        if ( pTimer->pNext != NULL )
+        {
+            pTimer->pNext->pPrev = pTimer->pPrev;
+        }
+
+        pWheel->counts[pTimer->level]--;
+        pTimer->ppSlot = NULL;
+        pTimer->pNext = NULL;
+        pTimer->pPrev = NULL;
+    }
+}
+
+/*============================================================================*/
+/*  Advance                                                                   */
+/*!
+    Advance the wheel to the specified time
+
+    The Advance function moves the wheel forward one tick at a time,
+    cascading the higher levels as the lower levels wrap and queueing
+    the timers which expire.  Ticks where the lowest level is empty
+    are skipped.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    now
+        time to advance to in milliseconds
+
+==============================================================================*/
+static void Advance( TimerWheel *pWheel, uint64_t now )
+{
+    uint64_t next;
+
+    while ( pWheel->tick < now )
+    {
+        if ( ( pWheel->counts[0] == 0 ) &&
+             ( ( pWheel->tick & WHEEL_MASK ) != WHEEL_MASK ) )
+        {
+            /* nothing can expire before the lowest level wraps */
+            next = pWheel->tick | WHEEL_MASK;
+            pWheel->tick = ( next < now ) ? next : now;
+        }
+        else
+        {
+            pWheel->tick++;
+            if ( ( pWheel->tick & WHEEL_MASK ) == 0 )
+            {
+                Cascade( pWheel, 1 );
+            }
+
+            Expire( pWheel );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Cascade                                                                   */
+/*!
+    Cascade the current slot of a wheel level
+
+    The Cascade function re-inserts the timers in the current slot of
+    the specified level, which moves them to the lower levels.  When
+    the level wraps, the next level is cascaded first.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    level
+        wheel level to cascade
+
+==============================================================================*/
+static void Cascade( TimerWheel *pWheel, int level )
+{
+    size_t slot;
+    WheelTimer *pTimer;
+    WheelTimer *pNext;
+
+    if ( level < WHEEL_LEVELS )
+    {
+        slot = ( pWheel->tick >> ( WHEEL_BITS * level ) ) & WHEEL_MASK;
+        if ( slot == 0 )
+        {
+            Cascade( pWheel, level + 1 );
+        }
+
+        pTimer = pWheel->pSlots[level][slot];
+        pWheel->pSlots[level][slot] = NULL;
+
+        while ( pTimer != NULL )
+        {
+            pNext = pTimer->pNext;
+            pWheel->counts[level]--;
+            pTimer->ppSlot = NULL;
+            Insert( pWheel, pTimer );
+            pTimer = pNext;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  Expire                                                                    */
+/*!
+    Expire the timers in the current slot
+
+    The Expire function queues each timer in the current slot of the
+    lowest level, and reloads the periodic timers.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+==============================================================================*/
+static void Expire( TimerWheel *pWheel )
+{
+    size_t slot = pWheel->tick & WHEEL_MASK;
+    WheelTimer *pTimer;
+    WheelTimer *pNext;
+
+    pTimer = pWheel->pSlots[0][slot];
+    pWheel->pSlots[0][slot] = NULL;
+
+    while ( pTimer != NULL )
+    {
+        pNext = pTimer->pNext;
+        pWheel->counts[0]--;
+        pTimer->ppSlot = NULL;
+        pTimer->pNext = NULL;
+        pTimer->pPrev = NULL;
+
+        if ( ( pTimer->queued == false ) &&
+             ( Queue( pWheel, pTimer->id ) == EOK ) )
+        {
+            pTimer->queued = true;
+        }
+
+        if ( pTimer->period != 0 )
+        {
+            pTimer->expiry += pTimer->period;
+            if ( pTimer->expiry <= pWheel->tick )
+            {
+                /* drop the expiries missed while the wheel was idle */
+                pTimer->expiry = pWheel->tick + pTimer->period;
+            }
+
+            Insert( pWheel, pTimer );
+        }
+
+        pTimer = pNext;
+    }
+}
+
+/*============================================================================*/
+/*  Queue                                                                     */
+/*!
+    Queue an expired timer identifier
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    id
+        identifier of the expired timer
+
+@retval EOK the identifier was queued
+@retval ENOMEM memory allocation failure
+
+==============================================================================*/
+static int Queue( TimerWheel *pWheel, uint16_t id )
+{
+    int result = EOK;
+    uint16_t *pReady;
+    size_t size;
+    size_t i;
+
+    if ( pWheel->nReady == pWheel->readySize )
+    {
+        size = ( pWheel->readySize == 0 ) ? 64 : pWheel->readySize * 2;
+        pReady = malloc( size * sizeof( uint16_t ) );
+        if ( pReady != NULL )
+        {
+            /* unwrap the ring buffer into the new buffer */
+            for ( i = 0; i < pWheel->nReady; i++ )
+            {
+                pReady[i] = pWheel->pReady[( pWheel->readyHead + i ) %
+                                           pWheel->readySize];
+            }
+
+            free( pWheel->pReady );
+            pWheel->pReady = pReady;
+            pWheel->readySize = size;
+            pWheel->readyHead = 0;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pWheel->pReady[( pWheel->readyHead + pWheel->nReady ) %
+                       pWheel->readySize] = id;
+        pWheel->nReady++;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  NextDeadline                                                              */
+/*!
+    Get the next time the wheel needs attention
+
+    The NextDeadline function finds the first non-empty slot ahead of
+    the current time in each level.  For the lowest level this is the
+    expiry time of its timers, and for the higher levels it is the
+    time the slot is cascaded.
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@retval time of the next deadline in milliseconds
+@retval 0 if the wheel is empty
+
+==============================================================================*/
+static uint64_t NextDeadline( TimerWheel *pWheel )
+{
+    uint64_t deadline = 0;
+    uint64_t base;
+    uint64_t t;
+    int level;
+    size_t d;
+
+    for ( level = 0; level < WHEEL_LEVELS; level++ )
+    {
+        if ( pWheel->counts[level] > 0 )
+        {
+            base = pWheel->tick >> ( WHEEL_BITS * level );
+
+            /* the current slot of a higher level holds timers
+             * which are cascaded when the level comes around again */
+            for ( d = 1; d <= WHEEL_SLOTS; d++ )
+            {
+                if ( pWheel->pSlots[level][( base + d ) & WHEEL_MASK] != NULL )
+                {
+                    t = ( base + d ) << ( WHEEL_BITS * level );
+                    if ( ( deadline == 0 ) || ( t < deadline ) )
+                    {
+                        deadline = t;
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    return deadline;
+}
+
+/*============================================================================*/
+/*  SetDeadline                                                               */
+/*!
+    Arm the timerfd for a deadline
+
+@param[in]
+    pWheel
+        pointer to the timer wheel
+
+@param[in]
+    deadline
+        deadline in milliseconds, or 0 to disarm the timerfd
+
+==============================================================================*/
+static void SetDeadline( TimerWheel *pWheel, uint64_t deadline )
+{
+    struct itimerspec its;
+
+    if ( deadline != pWheel->deadline )
+    {
+        memset( &its, 0, sizeof( its ) );
+        its.it_value.tv_sec = deadline / 1000;
+        its.it_value.tv_nsec = ( deadline % 1000 ) * 1000000L;
+
+        if ( timerfd_settime( pWheel->fd,
+                              TFD_TIMER_ABSTIME,
+                              &its,
+                              NULL ) == 0 )
+        {
+            pWheel->deadline = deadline;
+        }
+    }
+}
+
+/*! @}
+ * end of vartimerwheel group */
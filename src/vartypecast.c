@@ -56,6 +56,7 @@ SOFTWARE.
 #include <syslog.h>
 #include "vartypecast.h"
 #include "varstrings.h"
+#include "varformat.h"
 
 /*==============================================================================
        Function declarations
@@ -324,6 +325,10 @@ int ToInt( VARSERVER_HANDLE hVarServer,
 
     result = (string)left
 
+    The optional right operand is the format of the conversion.  It is
+    compiled into a format plan when the node is created if it is
+    a constant, otherwise when it is first used or changes.
+
 @param[in]
     hVarServer
         handle to the variable server
@@ -341,6 +346,8 @@ int ToInt( VARSERVER_HANDLE hVarServer,
         pointer to the right node
 
 @retval EINVAL invalid argument
+@retval ENOTSUP unsupported type or format
+@retval ENOMEM memory allocation failure
 @retval EOK the script was successfully processed
 
 ==============================================================================*/
@@ -350,51 +357,17 @@ int ToString( VARSERVER_HANDLE hVarServer,
               Variable *pRight )
 {
     int result = EINVAL;
-    char *fmtspec;
+    const FormatPlan *pPlan;
 
     if ( ( pResult != NULL ) &&
          ( pLeft != NULL ) )
     {
         pResult->obj.type = VARTYPE_STR;
 
-        if ( ( pRight != NULL ) &&
-             ( pRight->obj.type == VARTYPE_STR ) )
+        result = GetFormat( pResult, pRight, &pPlan );
+        if ( result == EOK )
         {
-            fmtspec = pRight->obj.val.str;
-        }
-
-        /* allocate space for the number */
-        result = AllocateString( pResult, 64 );
-
-        switch( pLeft->obj.type )
-        {
-            case VARTYPE_UINT32:
-                snprintf( pResult->obj.val.str,
-                          pResult->bufsize,
-                          fmtspec ? fmtspec : "%d",
-                          pLeft->obj.val.ul );
-                pResult->obj.len = strlen( pResult->obj.val.str );
-                break;
-
-            case VARTYPE_UINT16:
-                snprintf( pResult->obj.val.str,
-                          pResult->bufsize,
-                          fmtspec ? fmtspec : "%d",
-                          pLeft->obj.val.ui );
-                pResult->obj.len = strlen( pResult->obj.val.str );
-                break;
-
-            case VARTYPE_FLOAT:
-                snprintf( pResult->obj.val.str,
-                          pResult->bufsize,
-                          fmtspec ? fmtspec : "%f",
-                          pLeft->obj.val.f );
-                pResult->obj.len = strlen( pResult->obj.val.str );
-                break;
-
-            default:
-                result = ENOTSUP;
-                break;
+            result = FormatValue( pPlan, pResult, &(pLeft->obj) );
         }
     }
 
@@ -0,0 +1,365 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varvalues varvalues
+ * @brief Variable Action Script Shared Value functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varvalues.c
+
+    Variable Action Script Shared Value functions
+
+    The Shared Value functions read numeric system variables from a
+    shared memory region published by the variable server, instead of
+    sending a request to the server for each value.
+
+    The region layout is defined in varaction/varshm.h: a header
+    followed by one slot per variable handle.  Each slot is protected by
+    a sequence lock.  The server makes the sequence number odd, writes
+    the type and value, then makes it even again.  A reader retries until
+    it sees the same even sequence number before and after reading the
+    slot, so it never waits for the server and never sees a torn value.
+
+    uint16, uint32 and float system variables are bound to their slots
+    when their nodes are created or resolved.  String variables,
+    variables whose slot is empty or changes type, variables whose read
+    keeps colliding with writes, and all variables when no region is
+    attached, are retrieved from the variable server as before.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <varaction/varaction.h>
+#include <varaction/varshm.h>
+#include "varvalues.h"
+
+/*==============================================================================
+       Definitions
+==============================================================================*/
+
+/*! number of attempts to read a slot before falling back to a request */
+#define VARSHM_MAX_RETRIES      ( 64 )
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! mapping of the attached shared value region (may be NULL) */
+static VarShmHeader *g_pRegion = NULL;
+
+/*! size of the mapping */
+static size_t g_regionSize = 0;
+
+/*! slots of the attached shared value region */
+static VarShmSlot *g_pSlots = NULL;
+
+/*==============================================================================
+       Function declarations
+==============================================================================*/
+
+static bool IsNumeric( uint32_t type );
+static bool CanBind( Variable *pVariable );
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionAttachValues                                                     */
+/*!
+    Attach the variable server's shared value region
+
+    The VarActionAttachValues function maps the named POSIX shared memory
+    object read-only and checks its header.  System variables created
+    or resolved after it is attached read their values from the region.
+    The region is shared by all contexts.
+
+@param[in]
+    name
+        name of the shared memory object, as passed to shm_open()
+
+@retval EINVAL invalid argument, or the object is not a shared value
+        region of a supported version
+@retval EALREADY a region is already attached
+@retval EOK the region was attached
+@retval other error from shm_open(), fstat() or mmap()
+
+==============================================================================*/
+int VarActionAttachValues( const char *name )
+{
+    int result = EINVAL;
+    VarShmHeader *pHeader;
+    struct stat sb;
+    size_t size;
+    int fd;
+
+    if ( g_pRegion != NULL )
+    {
+        result = EALREADY;
+    }
+    else if ( name != NULL )
+    {
+        fd = shm_open( name, O_RDONLY, 0 );
+        if ( fd == -1 )
+        {
+            result = errno;
+        }
+        else
+        {
+            if ( fstat( fd, &sb ) == 0 )
+            {
+                result = ( (size_t)sb.st_size >= sizeof( VarShmHeader ) )
+                         ? EOK
+                         : EINVAL;
+            }
+            else
+            {
+                result = errno;
+            }
+
+            if ( result == EOK )
+            {
+                size = (size_t)sb.st_size;
+                pHeader = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+                if ( pHeader == MAP_FAILED )
+                {
+                    result = errno;
+                }
+                else if ( ( pHeader->magic != VARSHM_MAGIC ) ||
+                          ( pHeader->version != VARSHM_VERSION ) ||
+                          ( pHeader->slotsize != sizeof( VarShmSlot ) ) ||
+                          ( pHeader->count >
+                            ( size - sizeof( VarShmHeader ) ) /
+                            sizeof( VarShmSlot ) ) )
+                {
+                    fprintf( stderr,
+                             "Invalid shared value region: %s\n",
+                             name );
+                    munmap( pHeader, size );
+                    result = EINVAL;
+                }
+                else
+                {
+                    g_pRegion = pHeader;
+                    g_regionSize = size;
+                    g_pSlots = (VarShmSlot *)( pHeader + 1 );
+                }
+            }
+
+            close( fd );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  VarActionDetachValues                                                     */
+/*!
+    Detach the shared value region
+
+    The VarActionDetachValues function unmaps the shared value region.
+    Bound system variables are retrieved from the variable server again.
+    It must not be called while statements are being evaluated.
+
+==============================================================================*/
+void VarActionDetachValues( void )
+{
+    if ( g_pRegion != NULL )
+    {
+        munmap( g_pRegion, g_regionSize );
+        g_pRegion = NULL;
+        g_pSlots = NULL;
+        g_regionSize = 0;
+    }
+}
+
+/*============================================================================*/
+/*  BindSharedValue                                                           */
+/*!
+    Bind a system variable to its shared value slot
+
+    The BindSharedValue function marks a numeric system variable node
+    with VF_SHM_VALUE if the attached region has a numeric slot for its
+    handle.
+
+@param[in]
+    pVariable
+        pointer to the system variable node
+
+==============================================================================*/
+void BindSharedValue( Variable *pVariable )
+{
+    uint32_t type;
+
+    if ( ( g_pSlots != NULL ) &&
+         ( pVariable != NULL ) &&
+         ( pVariable->hVar != VAR_INVALID ) &&
+         ( pVariable->hVar < g_pRegion->count ) &&
+         ( CanBind( pVariable ) ) )
+    {
+        type = atomic_load_explicit( &g_pSlots[pVariable->hVar].type,
+                                     memory_order_relaxed );
+        if ( IsNumeric( type ) )
+        {
+            pVariable->flags |= VF_SHM_VALUE;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  ReadSharedValue                                                           */
+/*!
+    Read a system variable from its shared value slot
+
+@param[in]
+    pVariable
+        pointer to the system variable node bound with BindSharedValue()
+
+@retval ENOENT no region is attached, the slot does not hold a numeric
+        value, or it could not be read without colliding with a write
+@retval EOK the value was read into the node
+
+==============================================================================*/
+int ReadSharedValue( Variable *pVariable )
+{
+    int result = ENOENT;
+    VarShmSlot *pSlot;
+    uint32_t seq;
+    uint32_t type = VARTYPE_INVALID;
+    uint32_t value = 0;
+    int i;
+
+    if ( ( g_pSlots != NULL ) &&
+         ( pVariable->hVar < g_pRegion->count ) &&
+         ( CanBind( pVariable ) ) )
+    {
+        pSlot = &g_pSlots[pVariable->hVar];
+
+        for ( i = 0; i < VARSHM_MAX_RETRIES; i++ )
+        {
+            seq = atomic_load_explicit( &pSlot->seq, memory_order_acquire );
+            if ( ( seq & 1 ) == 0 )
+            {
+                type = atomic_load_explicit( &pSlot->type,
+                                             memory_order_relaxed );
+                value = atomic_load_explicit( &pSlot->value,
+                                              memory_order_relaxed );
+                atomic_thread_fence( memory_order_acquire );
+                if ( atomic_load_explicit( &pSlot->seq,
+                                           memory_order_relaxed ) == seq )
+                {
+                    result = IsNumeric( type ) ? EOK : ENOENT;
+                    break;
+                }
+            }
+        }
+    }
+
+    if ( result == EOK )
+    {
+        pVariable->obj.type = type;
+        if ( type == VARTYPE_FLOAT )
+        {
+            memcpy( &pVariable->obj.val.f, &value, sizeof( float ) );
+            pVariable->obj.len = sizeof( float );
+        }
+        else if ( type == VARTYPE_UINT16 )
+        {
+            pVariable->obj.val.ui = (uint16_t)value;
+            pVariable->obj.len = sizeof( uint16_t );
+        }
+        else
+        {
+            pVariable->obj.val.ul = value;
+            pVariable->obj.len = sizeof( uint32_t );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  IsNumeric                                                                 */
+/*!
+    Check if a variable type can be held in a shared value slot
+
+@param[in]
+    type
+        variable type
+
+@retval true the type is uint16, uint32 or float
+@retval false the type cannot be held in a slot
+
+==============================================================================*/
+static bool IsNumeric( uint32_t type )
+{
+    return ( type == VARTYPE_UINT16 ) ||
+           ( type == VARTYPE_UINT32 ) ||
+           ( type == VARTYPE_FLOAT );
+}
+
+/*============================================================================*/
+/*  CanBind                                                                   */
+/*!
+    Check if a system variable node can take a value from a slot
+
+    A node can take a slot value if it holds a numeric value, or no
+    value yet, so no string it references is overwritten.
+
+@param[in]
+    pVariable
+        pointer to the system variable node
+
+@retval true the node can take a slot value
+@retval false the node holds a string or other value
+
+==============================================================================*/
+static bool CanBind( Variable *pVariable )
+{
+    return ( pVariable->obj.type == VARTYPE_INVALID ) ||
+           ( IsNumeric( pVariable->obj.type ) );
+}
+
+/*! @}
+ * end of varvalues group */
@@ -0,0 +1,287 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup varwrite varwrite
+ * @brief Variable Action Script System Variable Write functions
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varwrite.c
+
+    Variable Action Script System Variable Write functions
+
+    The Variable Action Script System Variable Write functions publish
+    system variable values which have been modified by assignment
+    operations.
+
+    Between BeginWrites() and FlushWrites() the writes are deferred.
+    Each modified variable is added to a write set once, and only its
+    final value is published when the write set is flushed.
+
+    If a batch set function has been registered with VarActionSetBatchSet()
+    the write set is published with a single call, otherwise each value is
+    published with VAR_Set().
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <syslog.h>
+#include "varprefetch.h"
+#include "varwrite.h"
+#include "varprofile.h"
+#include "varcontext.h"
+#include "varlatency.h"
+
+/*==============================================================================
+       File Scoped Variables
+==============================================================================*/
+
+/*! multi-variable set function (may be NULL) */
+static VarBatchSetFn g_batchSet = NULL;
+
+/*==============================================================================
+       Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VarActionSetBatchSet                                                      */
+/*!
+    Register a multi-variable set function
+
+    The VarActionSetBatchSet function registers a function which can
+    publish the values of several system variables in a single request.
+    Setting the function to NULL publishes each variable with VAR_Set().
+
+@param[in]
+    fn
+        pointer to the batch set function (may be NULL)
+
+==============================================================================*/
+void VarActionSetBatchSet( VarBatchSetFn fn )
+{
+    g_batchSet = fn;
+}
+
+/*============================================================================*/
+/*  SetVar                                                                    */
+/*!
+    Publish a system variable value
+
+    The SetVar function publishes the value of a system variable which
+    has been modified by an assignment operation.  While writes are
+    deferred the variable is added to the write set instead, and
+    its value is published by FlushWrites().
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@param[in]
+    pVariable
+        pointer to the modified system variable
+
+@retval EINVAL invalid argument
+@retval ENOMEM the write could not be deferred
+@retval EOK the value was published or deferred
+@retval other error returned by VAR_Set()
+
+==============================================================================*/
+int SetVar( VARSERVER_HANDLE hVarServer, Variable *pVariable )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    uint64_t start;
+
+    if ( ( hVarServer != NULL ) &&
+         ( pVariable != NULL ) )
+    {
+        if ( pContext->defer == false )
+        {
+            start = LatencyStart();
+            result = VAR_Set( hVarServer, pVariable->hVar, &(pVariable->obj) );
+            LatencyRequest( VA_LATENCY_SET, start );
+            ProfileSets( 1 );
+        }
+        else if ( pVariable->pending == true )
+        {
+            /* the final value is published by FlushWrites */
+            result = EOK;
+        }
+        else
+        {
+            result = AddSysvar( &pContext->writes, pVariable );
+            if ( result == EOK )
+            {
+                pVariable->pending = true;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BeginWrites                                                               */
+/*!
+    Start deferring system variable writes
+
+    The BeginWrites function starts deferring system variable writes
+    until FlushWrites() is called.
+
+==============================================================================*/
+void BeginWrites( void )
+{
+    VarActionContext *pContext = GetContext();
+
+    pContext->defer = true;
+}
+
+/*============================================================================*/
+/*  FlushWrites                                                               */
+/*!
+    Publish the deferred system variable writes
+
+    The FlushWrites function publishes the final value of each system
+    variable in the write set, and stops deferring writes.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EINVAL invalid argument
+@retval EOK the values were published
+@retval other error from the last variable which could not be published
+
+==============================================================================*/
+int FlushWrites( VARSERVER_HANDLE hVarServer )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EINVAL;
+    Variable *pVariable;
+    uint64_t start;
+    size_t i;
+    int rc;
+
+    pContext->defer = false;
+
+    if ( hVarServer != NULL )
+    {
+        result = EOK;
+
+        for ( i = 0; i < pContext->writes.n; i++ )
+        {
+            pVariable = pContext->writes.ppVars[i];
+            pContext->writes.phVars[i] = pVariable->hVar;
+            pContext->writes.ppObjs[i] = &(pVariable->obj);
+        }
+
+        start = LatencyStart();
+        if ( ( pContext->writes.n > 0 ) &&
+             ( g_batchSet != NULL ) &&
+             ( g_batchSet( hVarServer,
+                           pContext->writes.phVars,
+                           pContext->writes.ppObjs,
+                           pContext->writes.n ) == EOK ) )
+        {
+            /* all of the values were published */
+            LatencyRequest( VA_LATENCY_SET, start );
+            ProfileSets( 1 );
+        }
+        else
+        {
+            /* fall back to one request per variable */
+            for ( i = 0; i < pContext->writes.n; i++ )
+            {
+                pVariable = pContext->writes.ppVars[i];
+                start = LatencyStart();
+                rc = VAR_Set( hVarServer, pVariable->hVar, &(pVariable->obj) );
+                LatencyRequest( VA_LATENCY_SET, start );
+                ProfileSets( 1 );
+                if ( rc != EOK )
+                {
+                    result = rc;
+                }
+            }
+        }
+    }
+
+    for ( i = 0; i < pContext->writes.n; i++ )
+    {
+        pContext->writes.ppVars[i]->pending = false;
+    }
+
+    pContext->writes.n = 0;
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PublishWrites                                                             */
+/*!
+    Publish the deferred system variable writes made so far
+
+    The PublishWrites function is called before a script runs, so the
+    script sees the values assigned by the statements before it.  If
+    writes are being deferred the write set is flushed, and writes
+    continue to be deferred until the outermost compound statement
+    completes.
+
+@param[in]
+    hVarServer
+        handle to the variable server
+
+@retval EOK the values were published, or writes are not deferred
+@retval other error from FlushWrites()
+
+==============================================================================*/
+int PublishWrites( VARSERVER_HANDLE hVarServer )
+{
+    VarActionContext *pContext = GetContext();
+    int result = EOK;
+
+    if ( pContext->defer == true )
+    {
+        result = FlushWrites( hVarServer );
+        BeginWrites();
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of varwrite group */